@@ -0,0 +1,330 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file animationbench.cpp
+ *  Headless model animation benchmark.
+ *
+ *  Animates a crowd of identical, synthetic creature models, the way the
+ *  graphics manager does every frame: evaluating all animations on a pool
+ *  of worker threads, then applying them to the model nodes. Reports the
+ *  time per frame for different numbers of worker threads.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/ustring.h"
+#include "common/util.h"
+#include "common/error.h"
+#include "common/debugman.h"
+#include "common/threads.h"
+#include "common/threadpool.h"
+
+#include "graphics/graphics.h"
+#include "graphics/queueman.h"
+
+#include "graphics/aurora/model.h"
+#include "graphics/aurora/modelnode.h"
+#include "graphics/aurora/animation.h"
+#include "graphics/aurora/animnode.h"
+
+using Graphics::Aurora::Model;
+using Graphics::Aurora::ModelNode;
+using Graphics::Aurora::Animation;
+using Graphics::Aurora::AnimNode;
+
+struct Options {
+	uint32 creatures; ///< Number of creatures in the crowd.
+	uint32 nodes;     ///< Number of animated nodes in each creature.
+	uint32 keyFrames; ///< Number of keyframes in each animated node.
+	uint32 frames;    ///< Number of measured frames.
+	uint32 threads;   ///< Maximum number of worker threads.
+
+	Options() : creatures(200), nodes(30), keyFrames(40), frames(500), threads(4) {
+	}
+};
+
+/** A node of a synthetic creature, with generated keyframes. */
+class CrowdNode : public ModelNode {
+public:
+	CrowdNode(Model &model, const Common::UString &name, uint32 keyFrames, float length) :
+		ModelNode(model) {
+
+		_name   = name;
+		_render = false;
+
+		for (uint32 i = 0; i < keyFrames; i++) {
+			const float time  = (length * i) / MAX<uint32>(keyFrames - 1, 1);
+			const float angle = (std::rand() % 360) * 3.14159265f / 180.0f;
+
+			Graphics::Aurora::PositionKeyFrame position;
+
+			position.time = time;
+			position.x    = (std::rand() % 100) / 100.0f;
+			position.y    = (std::rand() % 100) / 100.0f;
+			position.z    = (std::rand() % 100) / 100.0f;
+
+			Graphics::Aurora::QuaternionKeyFrame orientation;
+
+			orientation.time = time;
+			orientation.x    = std::sin(angle / 2.0f);
+			orientation.y    = 0.0f;
+			orientation.z    = 0.0f;
+			orientation.q    = std::cos(angle / 2.0f);
+
+			_positionFrames.push_back(position);
+			_orientationFrames.push_back(orientation);
+		}
+	}
+};
+
+/** A synthetic creature model, with a node hierarchy and one looping animation. */
+class CrowdModel : public Model {
+public:
+	CrowdModel(const Options &options) : Model(Graphics::Aurora::kModelTypeObject) {
+		static const float kLength = 2.0f;
+
+		_fileName = "crowd";
+		_name     = "crowd";
+
+		State *state = new State;
+
+		Common::UString animName = "walk";
+
+		Animation *animation = new Animation;
+		animation->setName(animName);
+		animation->setLength(kLength);
+		animation->setTransTime(0.0f);
+
+		std::vector<ModelNode *> nodes;
+		for (uint32 i = 0; i < options.nodes; i++) {
+			const Common::UString name = Common::UString::sprintf("node%02u", i);
+
+			ModelNode *node = new CrowdNode(*this, name, 0, kLength);
+
+			// A simple skeleton: a binary tree of nodes
+			if (i > 0)
+				node->setParent(nodes[(i - 1) / 2]);
+			else
+				state->rootNodes.push_back(node);
+
+			nodes.push_back(node);
+			state->nodeList.push_back(node);
+			state->nodeMap.insert(std::make_pair(name, node));
+
+			// The keyframes live in a separate node
+			_animationNodes.push_back(new CrowdNode(*this, name, options.keyFrames, kLength));
+			animation->addAnimNode(new AnimNode(_animationNodes.back()));
+		}
+
+		_stateList.push_back(state);
+		_stateMap.insert(std::make_pair(state->name, state));
+
+		_animationMap.insert(std::make_pair(animation->getName(), animation));
+
+		DefaultAnimation defaultAnimation;
+		defaultAnimation.animation   = animation;
+		defaultAnimation.probability = 100;
+
+		_defaultAnimations.push_back(defaultAnimation);
+
+		finalize();
+	}
+
+	~CrowdModel() {
+		for (std::vector<ModelNode *>::iterator n = _animationNodes.begin(); n != _animationNodes.end(); ++n)
+			delete *n;
+	}
+
+private:
+	std::vector<ModelNode *> _animationNodes;
+};
+
+/** Evaluating the animations of a crowd, one creature per part. */
+class CrowdJob : public Common::ThreadPool::Job {
+public:
+	CrowdJob(std::vector<Model *> &crowd, float dt) : _crowd(&crowd), _dt(dt) {
+	}
+
+	void run(uint32 part) {
+		(*_crowd)[part]->advanceTime(_dt);
+	}
+
+private:
+	std::vector<Model *> *_crowd;
+	float _dt;
+};
+
+static void displayUsage(const char *name) {
+	std::printf("Usage: %s [options]\n\n", name);
+	std::printf("          --help              This text\n");
+	std::printf("  -cNUM   --creatures=NUM     Animate NUM creatures (default: 200)\n");
+	std::printf("  -nNUM   --nodes=NUM         With NUM animated nodes each (default: 30)\n");
+	std::printf("  -kNUM   --keyframes=NUM     With NUM keyframes each (default: 40)\n");
+	std::printf("  -fNUM   --frames=NUM        Measure NUM frames (default: 500)\n");
+	std::printf("  -tNUM   --threads=NUM       Measure with up to NUM worker threads\n");
+	std::printf("                              (default: 4)\n");
+	std::printf("\n");
+	std::printf("NUM:  A positive integer.\n");
+	std::printf("\n");
+}
+
+static bool parseNumber(const char *str, uint32 &number) {
+	char *end = 0;
+	unsigned long n = std::strtoul(str, &end, 10);
+
+	if ((*str == '\0') || (*end != '\0'))
+		return false;
+
+	number = (uint32) n;
+	return true;
+}
+
+static bool parseCommandline(int argc, char **argv, Options &options, int &code) {
+	code = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (!std::strcmp(arg, "--help")) {
+			displayUsage(argv[0]);
+			code = 0;
+			return false;
+		}
+
+		uint32 *value = 0;
+		const char *number = 0;
+
+		if      (!std::strncmp(arg, "--creatures=", 12) || !std::strncmp(arg, "-c", 2))
+			value = &options.creatures;
+		else if (!std::strncmp(arg, "--nodes=", 8)      || !std::strncmp(arg, "-n", 2))
+			value = &options.nodes;
+		else if (!std::strncmp(arg, "--keyframes=", 12) || !std::strncmp(arg, "-k", 2))
+			value = &options.keyFrames;
+		else if (!std::strncmp(arg, "--frames=", 9)     || !std::strncmp(arg, "-f", 2))
+			value = &options.frames;
+		else if (!std::strncmp(arg, "--threads=", 10)   || !std::strncmp(arg, "-t", 2))
+			value = &options.threads;
+
+		if (value)
+			number = (arg[1] == '-') ? (std::strchr(arg, '=') + 1) : (arg + 2);
+
+		if (!value || !parseNumber(number, *value)) {
+			warning("Invalid command line argument \"%s\"", arg);
+			return false;
+		}
+	}
+
+	if ((options.creatures == 0) || (options.nodes == 0) || (options.frames == 0)) {
+		warning("Nothing to animate");
+		return false;
+	}
+
+	return true;
+}
+
+/** Animate the crowd for a number of frames, returning the average microseconds per frame. */
+static double animate(std::vector<Model *> &crowd, uint32 threads, uint32 frames) {
+	static const float kFrameTime = 1.0f / 60.0f;
+
+	Common::ThreadPool pool(threads);
+
+	CrowdJob job(crowd, kFrameTime);
+
+	uint64 start = getMicroseconds();
+
+	for (uint32 i = 0; i < frames; i++) {
+		pool.run(job, crowd.size());
+
+		for (std::vector<Model *>::iterator m = crowd.begin(); m != crowd.end(); ++m)
+			(*m)->applyAnimation();
+	}
+
+	return (getMicroseconds() - start) / (double) frames;
+}
+
+void deinit();
+
+int main(int argc, char **argv) {
+	atexit(deinit);
+
+	Options options;
+
+	int code;
+	if (!parseCommandline(argc, argv, options, code))
+		return code;
+
+	Common::initThreads();
+
+	std::vector<Model *> crowd;
+
+	try {
+		// All creatures are instances of the same model, like a crowd in the game would be
+		boost::shared_ptr<Model> creature(new CrowdModel(options));
+
+		for (uint32 i = 0; i < options.creatures; i++)
+			crowd.push_back(new Model(creature));
+
+	} catch (Common::Exception &e) {
+		Common::printException(e);
+		return 1;
+	}
+
+	status("Animating %u creatures with %u nodes and %u keyframes each, for %u frames",
+	       options.creatures, options.nodes, options.keyFrames, options.frames);
+
+	// Warm up, binding the animations
+	animate(crowd, 0, 1);
+
+	std::printf("%-8s %12s %12s %8s\n", "threads", "us/frame", "us/creature", "speedup");
+
+	double serial = 0.0;
+	for (uint32 threads = 0; threads <= options.threads; threads++) {
+		const double time = animate(crowd, threads, options.frames);
+		if (threads == 0)
+			serial = time;
+
+		std::printf("%-8u %12.1f %12.3f %7.2fx\n", threads, time, time / crowd.size(),
+		            (time > 0.0) ? (serial / time) : 0.0);
+	}
+
+	for (std::vector<Model *>::iterator m = crowd.begin(); m != crowd.end(); ++m)
+		delete *m;
+
+	return 0;
+}
+
+void deinit() {
+	// Destroy global singletons
+	Graphics::GraphicsManager::destroy();
+	Graphics::QueueManager::destroy();
+
+	Common::DebugManager::destroy();
+}
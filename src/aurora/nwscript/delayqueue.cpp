@@ -0,0 +1,278 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/delayqueue.cpp
+ *  A queue of delayed script actions.
+ */
+
+#include <cassert>
+
+#include "common/util.h"
+
+#include "aurora/nwscript/delayqueue.h"
+
+namespace Aurora {
+
+namespace NWScript {
+
+DelayQueue::Slot::Slot() : head(kInvalidAction), tail(kInvalidAction) {
+}
+
+
+DelayQueue::DelayQueue() : _free(kInvalidAction), _time(0), _sequence(0),
+	_depth(0), _peakDepth(0), _lastLag(0), _maxLag(0) {
+
+	_slots[0].resize(1 << kSlotBits0);
+	for (uint32 i = 1; i < kLevels; i++)
+		_slots[i].resize(1 << kSlotBitsN);
+}
+
+DelayQueue::~DelayQueue() {
+}
+
+void DelayQueue::clear() {
+	for (uint32 i = 0; i < kLevels; i++) {
+		for (std::vector<Slot>::iterator s = _slots[i].begin(); s != _slots[i].end(); ++s) {
+			while (s->head != kInvalidAction) {
+				uint32 action = s->head;
+
+				s->head = _actions[action].next;
+				freeAction(action);
+			}
+
+			s->tail = kInvalidAction;
+		}
+	}
+
+	_depth     = 0;
+	_peakDepth = 0;
+	_lastLag   = 0;
+	_maxLag    = 0;
+}
+
+void DelayQueue::add(const Common::UString &script, ScriptState &state,
+                     Object *owner, Object *triggerer, uint32 timestamp) {
+
+	uint32 action = allocAction();
+	Action &a = _actions[action];
+
+	a.script    = script;
+	a.owner     = owner;
+	a.triggerer = triggerer;
+	a.timestamp = timestamp;
+	a.sequence  = _sequence++;
+
+	a.state.offset = state.offset;
+	a.state.globals.swap(state.globals);
+	a.state.locals.swap(state.locals);
+
+	insert(action);
+
+	_peakDepth = MAX(_peakDepth, ++_depth);
+}
+
+uint32 DelayQueue::schedule(uint32 now, ScriptPriority priority) {
+	uint32 count = 0;
+
+	while ((int32) (now - _time) >= 0) {
+		if (_depth == 0) {
+			// Nothing is waiting, so we can skip ahead
+			_time = now + 1;
+			break;
+		}
+
+		// Whenever a level wraps around, the next slot of the level above moves down
+		uint32 index = _time & ((1 << kSlotBits0) - 1);
+		for (uint32 level = 1; (level < kLevels) && (index == 0); level++) {
+			cascade(level);
+
+			index = (_time >> (kSlotBits0 + (level - 1) * kSlotBitsN)) & ((1 << kSlotBitsN) - 1);
+		}
+
+		Slot &slot = _slots[0][_time & ((1 << kSlotBits0) - 1)];
+
+		uint32 action = slot.head;
+
+		slot.head = kInvalidAction;
+		slot.tail = kInvalidAction;
+
+		while (action != kInvalidAction) {
+			Action &a    = _actions[action];
+			uint32  next = a.next;
+
+			ScriptSchedMan.schedule(a.script, a.state, a.owner, a.triggerer, priority);
+
+			_lastLag = now - a.timestamp;
+			_maxLag  = MAX(_maxLag, _lastLag);
+
+			freeAction(action);
+
+			_depth--;
+			count++;
+
+			action = next;
+		}
+
+		_time++;
+	}
+
+	return count;
+}
+
+uint32 DelayQueue::getDepth() const {
+	return _depth;
+}
+
+uint32 DelayQueue::getPeakDepth() const {
+	return _peakDepth;
+}
+
+uint32 DelayQueue::getLastLag() const {
+	return _lastLag;
+}
+
+uint32 DelayQueue::getMaxLag() const {
+	return _maxLag;
+}
+
+uint32 DelayQueue::allocAction() {
+	if (_free == kInvalidAction) {
+		_actions.push_back(Action());
+		return _actions.size() - 1;
+	}
+
+	uint32 action = _free;
+
+	_free = _actions[action].next;
+	return action;
+}
+
+void DelayQueue::freeAction(uint32 action) {
+	Action &a = _actions[action];
+
+	// Keep the memory of the state around for the next action
+	a.state.globals.clear();
+	a.state.locals.clear();
+
+	a.next = _free;
+	_free  = action;
+}
+
+void DelayQueue::append(Slot &slot, uint32 action) {
+	_actions[action].next = kInvalidAction;
+
+	if (slot.tail == kInvalidAction)
+		slot.head = action;
+	else
+		_actions[slot.tail].next = action;
+
+	slot.tail = action;
+}
+
+bool DelayQueue::isBefore(uint32 action1, uint32 action2) const {
+	const Action &a1 = _actions[action1];
+	const Action &a2 = _actions[action2];
+
+	if (a1.timestamp != a2.timestamp)
+		return ((int32) (a1.timestamp - a2.timestamp)) < 0;
+
+	return ((int32) (a1.sequence - a2.sequence)) < 0;
+}
+
+void DelayQueue::appendSorted(Slot &slot, uint32 action) {
+	/* Actions cascading down from a higher level were added before the ones
+	 * already waiting here, and overdue actions share the current slot.
+	 * Usually, though, a new action simply goes to the end. */
+
+	if ((slot.tail == kInvalidAction) || isBefore(slot.tail, action)) {
+		append(slot, action);
+		return;
+	}
+
+	if (isBefore(action, slot.head)) {
+		_actions[action].next = slot.head;
+		slot.head = action;
+		return;
+	}
+
+	uint32 prev = slot.head;
+	while (isBefore(_actions[prev].next, action))
+		prev = _actions[prev].next;
+
+	_actions[action].next = _actions[prev].next;
+	_actions[prev].next   = action;
+}
+
+void DelayQueue::insert(uint32 action) {
+	uint32 timestamp = _actions[action].timestamp;
+
+	// Actions that are already due go into the current slot
+	if ((int32) (timestamp - _time) < 0)
+		timestamp = _time;
+
+	uint32 delay = timestamp - _time;
+
+	if (delay < (1 << kSlotBits0)) {
+		appendSorted(_slots[0][timestamp & ((1 << kSlotBits0) - 1)], action);
+		return;
+	}
+
+	// Actions too far in the future wait in the last level, and get re-sorted there
+	if (delay >= (1 << kMaxDelayBits))
+		timestamp = _time + (1 << kMaxDelayBits) - 1;
+
+	uint32 level = 1;
+	while ((level < (kLevels - 1)) && (delay >= (1U << (kSlotBits0 + level * kSlotBitsN))))
+		level++;
+
+	uint32 shift = kSlotBits0 + (level - 1) * kSlotBitsN;
+
+	append(_slots[level][(timestamp >> shift) & ((1 << kSlotBitsN) - 1)], action);
+}
+
+void DelayQueue::cascade(uint32 level) {
+	assert((level > 0) && (level < kLevels));
+
+	uint32 shift = kSlotBits0 + (level - 1) * kSlotBitsN;
+
+	Slot &slot = _slots[level][(_time >> shift) & ((1 << kSlotBitsN) - 1)];
+
+	uint32 action = slot.head;
+
+	slot.head = kInvalidAction;
+	slot.tail = kInvalidAction;
+
+	while (action != kInvalidAction) {
+		uint32 next = _actions[action].next;
+
+		insert(action);
+
+		action = next;
+	}
+}
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
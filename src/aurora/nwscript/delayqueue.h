@@ -0,0 +1,151 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/delayqueue.h
+ *  A queue of delayed script actions.
+ */
+
+#ifndef AURORA_NWSCRIPT_DELAYQUEUE_H
+#define AURORA_NWSCRIPT_DELAYQUEUE_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/ustring.h"
+
+#include "aurora/nwscript/variable.h"
+#include "aurora/nwscript/scheduler.h"
+
+namespace Aurora {
+
+namespace NWScript {
+
+class Object;
+
+/** A queue of scripts to be run at a later time, as created by DelayCommand().
+ *
+ *  The queue is a hierarchical timing wheel with a resolution of one
+ *  millisecond: adding an action and taking out a due one both take
+ *  constant time, no matter how many actions are waiting.
+ *
+ *  The actions themselves are kept in a pool that is reused, so that adding
+ *  actions doesn't allocate memory once the pool is big enough. The script
+ *  state is moved into the queue, not copied.
+ *
+ *  Due actions are handed to the script scheduler in batches, in order of
+ *  their timestamps. Actions with the same timestamp keep the order in which
+ *  they were added.
+ */
+class DelayQueue {
+public:
+	DelayQueue();
+	~DelayQueue();
+
+	/** Remove all waiting actions. */
+	void clear();
+
+	/** Add a script to run at this time.
+	 *
+	 *  The state is moved into the queue, leaving the passed state empty.
+	 */
+	void add(const Common::UString &script, ScriptState &state,
+	         Object *owner, Object *triggerer, uint32 timestamp);
+
+	/** Schedule all scripts due at this time, and return their number. */
+	uint32 schedule(uint32 now, ScriptPriority priority = kScriptPriorityNormal);
+
+	/** Return the number of waiting actions. */
+	uint32 getDepth() const;
+	/** Return the highest number of waiting actions since the last clear(). */
+	uint32 getPeakDepth() const;
+
+	/** Return how late, in milliseconds, the last scheduled action was. */
+	uint32 getLastLag() const;
+	/** Return how late, in milliseconds, the latest action since the last clear() was. */
+	uint32 getMaxLag() const;
+
+private:
+	static const uint32 kInvalidAction = 0xFFFFFFFF;
+
+	static const uint32 kLevels       = 4;
+	static const uint32 kSlotBits0    = 8; ///< The first level has 256 slots of 1ms each.
+	static const uint32 kSlotBitsN    = 6; ///< All other levels have 64 slots.
+	static const uint32 kMaxDelayBits = kSlotBits0 + (kLevels - 1) * kSlotBitsN;
+
+	struct Action {
+		Common::UString script;
+		ScriptState state;
+
+		Object *owner;
+		Object *triggerer;
+
+		uint32 timestamp;
+		uint32 sequence; ///< The order in which the action was added.
+
+		uint32 next; ///< The next action in the same slot, or in the free list.
+	};
+
+	/** A list of actions, in the order they were added. */
+	struct Slot {
+		uint32 head;
+		uint32 tail;
+
+		Slot();
+	};
+
+	std::vector<Action> _actions; ///< The action pool.
+	uint32 _free;                 ///< The first unused action in the pool.
+
+	std::vector<Slot> _slots[kLevels];
+
+	uint32 _time;     ///< The next millisecond the wheel will process.
+	uint32 _sequence; ///< The sequence number of the next added action.
+
+	uint32 _depth;
+	uint32 _peakDepth;
+
+	uint32 _lastLag;
+	uint32 _maxLag;
+
+	uint32 allocAction();
+	void freeAction(uint32 action);
+
+	/** Is this action due before that one? */
+	bool isBefore(uint32 action1, uint32 action2) const;
+
+	void append(Slot &slot, uint32 action);
+	/** Add an action to a slot of the first level, keeping it sorted. */
+	void appendSorted(Slot &slot, uint32 action);
+	void insert(uint32 action);
+
+	/** Move the actions of a slot on a higher level down, now that they are closer. */
+	void cascade(uint32 level);
+};
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
+
+#endif // AURORA_NWSCRIPT_DELAYQUEUE_H
@@ -47,6 +47,7 @@ FunctionContext::~FunctionContext() {
 }
 
 FunctionContext &FunctionContext::operator=(const FunctionContext &ctx) {
+	// Assigning member-wise lets the vectors and strings reuse their memory
 	_name            = ctx._name;
 	_signature       = ctx._signature;
 	_caller          = ctx._caller;
@@ -100,6 +100,14 @@ void FunctionManager::call(uint32 function, FunctionContext &ctx) const {
 	find(function).func(ctx);
 }
 
+const Function &FunctionManager::setupContext(uint32 function, FunctionContext &ctx) const {
+	const FunctionEntry &f = find(function);
+
+	ctx = f.ctx;
+
+	return f.func;
+}
+
 const FunctionManager::FunctionEntry &FunctionManager::find(const Common::UString &function) const {
 	FunctionMap::const_iterator f = _functionMap.find(function);
 	if ((f == _functionMap.end()) || f->second.empty)
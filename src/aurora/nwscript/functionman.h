@@ -61,6 +61,13 @@ public:
 	FunctionContext createContext(uint32 function) const;
 	void call(uint32 function, FunctionContext &ctx) const;
 
+	/** Reset an existing context for a call to this function and return the function.
+	 *
+	 *  Unlike createContext(), this reuses the context's memory, so that calling
+	 *  functions over and over again through the same context doesn't allocate.
+	 */
+	const Function &setupContext(uint32 function, FunctionContext &ctx) const;
+
 private:
 	struct FunctionEntry {
 		bool empty;
@@ -75,7 +82,7 @@ private:
 	typedef std::vector<FunctionEntry> FunctionArray;
 
 	FunctionMap _functionMap;
-	FunctionArray _functionArray;
+	FunctionArray _functionArray; ///< All functions, indexed by their ID.
 
 	const FunctionEntry &find(const Common::UString &function) const;
 	const FunctionEntry &find(uint32 function) const;
@@ -0,0 +1,147 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/ncscache.cpp
+ *  A cache of loaded NWN Compiled Scripts.
+ */
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+
+#include "aurora/resman.h"
+
+#include "aurora/nwscript/ncscache.h"
+
+DECLARE_SINGLETON(Aurora::NWScript::NCSCacheManager)
+
+namespace Aurora {
+
+namespace NWScript {
+
+NCSCacheManager::NCSCacheManager() : _budget(0), _size(0), _hits(0), _misses(0),
+	_resGeneration(0) {
+}
+
+NCSCacheManager::~NCSCacheManager() {
+}
+
+void NCSCacheManager::clear() {
+	_entries.clear();
+	_usage.clear();
+
+	_size   = 0;
+	_hits   = 0;
+	_misses = 0;
+}
+
+void NCSCacheManager::setBudget(uint32 budget) {
+	_budget = budget;
+
+	enforceBudget();
+}
+
+uint32 NCSCacheManager::getBudget() const {
+	return _budget;
+}
+
+uint32 NCSCacheManager::getSize() const {
+	return _size;
+}
+
+uint32 NCSCacheManager::getHits() const {
+	return _hits;
+}
+
+uint32 NCSCacheManager::getMisses() const {
+	return _misses;
+}
+
+NCSProgramPtr NCSCacheManager::get(const Common::UString &ncs) {
+	// Resources might have been added or removed, so what we have might be stale
+	if (_resGeneration != ResMan.getGeneration()) {
+		clear();
+
+		_resGeneration = ResMan.getGeneration();
+	}
+
+	EntryMap::iterator entry = _entries.find(ncs);
+	if (entry != _entries.end()) {
+		// Move the script to the back of the usage list
+		_usage.splice(_usage.end(), _usage, entry->second.usage);
+
+		_hits++;
+		return entry->second.program;
+	}
+
+	_misses++;
+
+	Common::SeekableReadStream *stream = ResMan.getResource(ncs, kFileTypeNCS);
+	if (!stream)
+		throw Common::Exception("No such NCS \"%s\"", ncs.c_str());
+
+	NCSProgramPtr program;
+	try {
+		program.reset(new NCSProgram(*stream));
+	} catch (...) {
+		delete stream;
+		throw;
+	}
+
+	delete stream;
+
+	Entry &newEntry = _entries[ncs];
+
+	newEntry.program = program;
+	newEntry.usage   = _usage.insert(_usage.end(), ncs);
+
+	_size += program->getSize();
+
+	enforceBudget();
+
+	return program;
+}
+
+void NCSCacheManager::enforceBudget() {
+	if (_budget == 0)
+		return;
+
+	// Scripts still running keep their program alive, so dropping them here is safe
+	while ((_size > _budget) && !_usage.empty())
+		drop(_entries.find(_usage.front()));
+}
+
+void NCSCacheManager::drop(EntryMap::iterator entry) {
+	assert(entry != _entries.end());
+
+	_size -= entry->second.program->getSize();
+
+	_usage.erase(entry->second.usage);
+	_entries.erase(entry);
+}
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
@@ -0,0 +1,114 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/ncscache.h
+ *  A cache of loaded NWN Compiled Scripts.
+ */
+
+#ifndef AURORA_NWSCRIPT_NCSCACHE_H
+#define AURORA_NWSCRIPT_NCSCACHE_H
+
+#include <list>
+#include <map>
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/singleton.h"
+
+#include "aurora/nwscript/ncsfile.h"
+
+namespace Aurora {
+
+namespace NWScript {
+
+/** A cache holding the immutable bytecode of recently run scripts.
+ *
+ *  Loading a script from the resource manager for every run is wasteful,
+ *  especially for the heartbeat and event scripts that run over and over
+ *  again. The cache keeps the loaded and validated NCSProgram around, so
+ *  that a new run only needs to create its own light-weight execution state.
+ *
+ *  The cache is flushed automatically whenever the resource manager's
+ *  index changes. Optionally, the total size of the cached bytecode can be
+ *  limited, in which case the least recently used scripts are dropped first.
+ */
+class NCSCacheManager : public Common::Singleton<NCSCacheManager> {
+public:
+	NCSCacheManager();
+	~NCSCacheManager();
+
+	/** Remove all scripts from the cache. */
+	void clear();
+
+	/** Set the maximum size of all cached bytecode, in bytes. 0 means unlimited. */
+	void setBudget(uint32 budget);
+	/** Return the maximum size of all cached bytecode, in bytes. */
+	uint32 getBudget() const;
+
+	/** Return the current size of all cached bytecode, in bytes. */
+	uint32 getSize() const;
+
+	/** Return the number of cache hits since the last clear(). */
+	uint32 getHits() const;
+	/** Return the number of cache misses since the last clear(). */
+	uint32 getMisses() const;
+
+	/** Return the program of this script, loading it if necessary. */
+	NCSProgramPtr get(const Common::UString &ncs);
+
+private:
+	typedef std::list<Common::UString> UsageList;
+
+	struct Entry {
+		NCSProgramPtr program;
+		UsageList::iterator usage;
+	};
+
+	typedef std::map<Common::UString, Entry, Common::UString::iless> EntryMap;
+
+	EntryMap  _entries;
+	UsageList _usage; ///< Least recently used scripts first.
+
+	uint32 _budget;
+	uint32 _size;
+
+	uint32 _hits;
+	uint32 _misses;
+
+	uint32 _resGeneration; ///< The resource manager generation we cached for.
+
+	/** Drop least recently used scripts until we're within the budget. */
+	void enforceBudget();
+	void drop(EntryMap::iterator entry);
+};
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
+
+/** Shortcut for accessing the NCS cache manager. */
+#define NCSCacheMan Aurora::NWScript::NCSCacheManager::instance()
+
+#endif // AURORA_NWSCRIPT_NCSCACHE_H
@@ -27,6 +27,8 @@
  *  Handling BioWare's NWN Compiled Scripts.
  */
 
+#include <cassert>
+
 #include "common/util.h"
 #include "common/maths.h"
 #include "common/ustring.h"
@@ -34,9 +36,10 @@
 #include "common/debug.h"
 
 #include "aurora/error.h"
-#include "aurora/resman.h"
 
 #include "aurora/nwscript/ncsfile.h"
+#include "aurora/nwscript/ncscache.h"
+#include "aurora/nwscript/profiler.h"
 #include "aurora/nwscript/object.h"
 #include "aurora/nwscript/functionman.h"
 
@@ -49,6 +52,28 @@ static const uint32 kScriptObjectSelf        = 0x00000000;
 static const uint32 kScriptObjectInvalid     = 0x00000001;
 static const uint32 kScriptObjectTypeInvalid = 0x7F000000;
 
+/** Stack depths beyond this are considered to be analysis errors. */
+static const int32 kMaxStackDepth = 0x10000;
+
+static const char *kOpcodeNames[Aurora::NWScript::kOpcodeMAX] = {
+	"???"          , "CPDOWNSP", "RSADD"    , "CPTOPSP"  ,
+	"CONST"        , "ACTION"  , "LOGAND"   , "LOGOR"    ,
+	"INCOR"        , "EXCOR"   , "BOOLAND"  , "EQ"       ,
+	"NEQ"          , "GEQ"     , "GT"       , "LT"       ,
+	"LEQ"          , "SHLEFT"  , "SHRIGHT"  , "USHRIGHT" ,
+	"ADD"          , "SUB"     , "MUL"      , "DIV"      ,
+	"MOD"          , "NEG"     , "COMP"     , "MOVSP"    ,
+	"STORESTATEALL", "JMP"     , "JSR"      , "JZ"       ,
+	"RETN"         , "DESTRUCT", "NOT"      , "DECSP"    ,
+	"INCSP"        , "JNZ"     , "CPDOWNBP" , "CPTOPBP"  ,
+	"DECBP"        , "INCBP"   , "SAVEBP"   , "RESTOREBP",
+	"STORESTATE"   , "NOP"     , "ILLEGAL"  , "TRUNCATED"
+};
+
+static const char *kSuperOpcodeNames[Aurora::NWScript::kSuperOpcodeMAX] = {
+	"None", "CompareConst", "CompareConstJump", "PushConst", "PopStoreSP", "PopStoreBP", "Action"
+};
+
 namespace Aurora {
 
 namespace NWScript {
@@ -60,9 +85,12 @@ NCSStack::NCSStack() {
 NCSStack::~NCSStack() {
 }
 
-void NCSStack::reset() {
+void NCSStack::reset(size_t size) {
 	clear();
 
+	// Grow the stack only once, instead of piecemeal while running
+	reserve(size);
+
 	_stackPtr = -1;
 	_basePtr  = -1;
 }
@@ -82,7 +110,11 @@ Variable NCSStack::pop() {
 	if (_stackPtr == -1)
 		throw Common::Exception("NCSStack: Stack underflow");
 
-	return at(_stackPtr--);
+	// The popped position is dead now, so we can move its value out
+	Variable var;
+	var.swap(at(_stackPtr--));
+
+	return var;
 }
 
 void NCSStack::push(const Variable &obj) {
@@ -98,47 +130,60 @@ void NCSStack::push(const Variable &obj) {
 }
 
 Variable &NCSStack::getRelSP(int32 pos) {
-	if ((pos > -4) || ((pos % 4) != 0))
-		throw Common::Exception("NCSStack::get(): Illegal position %d", pos);
+	return at(getRelSPIndex(pos));
+}
 
-	int32 stackPos = _stackPtr - ((pos / -4) - 1);
-	if (stackPos < 0)
-		throw Common::Exception("NCSStack::get(): Position %d below the bottom", pos);
+void NCSStack::setRelSP(int32 pos, const Variable &obj) {
+	at(getIndex(_stackPtr, pos, "set")) = obj;
+}
 
-	return at(stackPos);
+Variable &NCSStack::getRelBP(int32 pos) {
+	return at(getRelBPIndex(pos));
 }
 
-void NCSStack::setRelSP(int32 pos, const Variable &obj) {
-	if ((pos > -4) || ((pos % 4) != 0))
-		throw Common::Exception("NCSStack::set(): Illegal position %d", pos);
+void NCSStack::setRelBP(int32 pos, const Variable &obj) {
+	at(getIndex(_basePtr, pos, "set")) = obj;
+}
 
-	int32 stackPos = _stackPtr - ((pos / -4) - 1);
-	if (stackPos < 0)
-		throw Common::Exception("NCSStack::set(): Position %d below the bottom", pos);
+void NCSStack::popRelSP(int32 pos) {
+	// Same checks, in the same order, as a CPDOWNSP followed by a MOVSP
+	Variable &top = getRelSP(-4);
+	Variable &var = at(getIndex(_stackPtr, pos, "set"));
 
-	at(stackPos) = obj;
+	// The top is removed right away, so we can move its value instead of copying it
+	if (&var != &top)
+		var.swap(top);
+
+	_stackPtr--;
 }
 
-Variable &NCSStack::getRelBP(int32 pos) {
-	if ((pos > -4) || ((pos % 4) != 0))
-		throw Common::Exception("NCSStack::get(): Illegal position %d", pos);
+void NCSStack::popRelBP(int32 pos) {
+	Variable &top = getRelSP(-4);
+	Variable &var = at(getIndex(_basePtr, pos, "set"));
 
-	int32 stackPos = _basePtr - ((pos / -4) - 1);
-	if (stackPos < 0)
-		throw Common::Exception("NCSStack::get(): Position %d below the bottom", pos);
+	if (&var != &top)
+		var.swap(top);
 
-	return at(stackPos);
+	_stackPtr--;
 }
 
-void NCSStack::setRelBP(int32 pos, const Variable &obj) {
+int32 NCSStack::getRelSPIndex(int32 pos, int32 pushed) const {
+	return getIndex(_stackPtr + pushed, pos, "get");
+}
+
+int32 NCSStack::getRelBPIndex(int32 pos) const {
+	return getIndex(_basePtr, pos, "get");
+}
+
+int32 NCSStack::getIndex(int32 ptr, int32 pos, const char *access) {
 	if ((pos > -4) || ((pos % 4) != 0))
-		throw Common::Exception("NCSStack::set(): Illegal position %d", pos);
+		throw Common::Exception("NCSStack::%s(): Illegal position %d", access, pos);
 
-	int32 stackPos = _basePtr - ((pos / -4) - 1);
+	int32 stackPos = ptr - ((pos / -4) - 1);
 	if (stackPos < 0)
-		throw Common::Exception("NCSStack::set(): Position %d below the bottom", pos);
+		throw Common::Exception("NCSStack::%s(): Position %d below the bottom", access, pos);
 
-	at(stackPos) = obj;
+	return stackPos;
 }
 
 int32 NCSStack::getStackPtr() {
@@ -193,9 +238,10 @@ void NCSStack::print() const {
 
 
 #define OPCODE(x) { &NCSFile::x, #x }
+#define SUPEROPCODE(x) { &NCSFile::x, #x }
 
 void NCSFile::setupOpcodes() {
-	static const Opcode opcodes[] = {
+	static const OpcodeDesc opcodes[kOpcodeMAX] = {
 		// 0x00
 		OPCODE(o_nop), // Doesn't exist
 		OPCODE(o_cpdownsp),
@@ -253,49 +299,85 @@ void NCSFile::setupOpcodes() {
 		OPCODE(o_restorebp),
 		// 0x2C
 		OPCODE(o_storestate),
-		OPCODE(o_nop)
+		OPCODE(o_nop),
+		OPCODE(o_illegal),
+		OPCODE(o_truncated)
 	};
 
 	_opcodes = opcodes;
-	_opcodeListSize = ARRAYSIZE(opcodes);
+
+	static const SuperOpcodeDesc superOpcodes[kSuperOpcodeMAX] = {
+		{ 0, "s_none" },
+		SUPEROPCODE(s_compareconst),
+		SUPEROPCODE(s_compareconstjump),
+		SUPEROPCODE(s_pushconst),
+		SUPEROPCODE(s_popstoresp),
+		SUPEROPCODE(s_popstorebp),
+		SUPEROPCODE(s_action)
+	};
+
+	_superOpcodes = superOpcodes;
 }
 
+#undef SUPEROPCODE
 #undef OPCODE
 
-NCSFile::NCSFile(Common::SeekableReadStream *ncs) : _owner(0), _triggerer(0) {
-	_script = ncs;
+NCSInstruction::NCSInstruction() : address(0), opcode(0), type(0), target(kNCSInvalidTarget),
+	blockStart(false), stackDepth(kNCSUnknownDepth),
+	superOpcode(kSuperOpcodeNone), superLength(1) {
 
-	load();
+	args[0] = args[1] = args[2] = 0;
 }
 
-NCSFile::NCSFile(const Common::UString &ncs) : _name(ncs), _script(0),
-	_owner(0), _triggerer(0) {
 
-	_script = ResMan.getResource(ncs, kFileTypeNCS);
-	if (!_script)
-		throw Common::Exception("No such NCS \"%s\"", ncs.c_str());
+NCSProgram::Subroutine::Subroutine() : analyzed(false), valid(false),
+	returnDepth(kNCSUnknownDepth), maxDepth(0) {
 
-	load();
 }
 
-NCSFile::~NCSFile() {
-	delete _script;
+
+NCSProgram::NCSProgram(Common::SeekableReadStream &ncs) : _data(0), _size(0), _maxStackDepth(0) {
+	load(ncs);
 }
 
-const Common::UString &NCSFile::getName() const {
-	return _name;
+NCSProgram::~NCSProgram() {
+	delete[] _data;
 }
 
-ScriptState NCSFile::getEmptyState() {
-	ScriptState state;
+const byte *NCSProgram::getData() const {
+	return _data;
+}
 
-	state.offset = 13; // 8 byte header + 5 byte program size dummy op
+uint32 NCSProgram::getSize() const {
+	return _size;
+}
 
-	return state;
+const std::vector<NCSInstruction> &NCSProgram::getInstructions() const {
+	return _instructions;
 }
 
-void NCSFile::load() {
-	readHeader(*_script);
+uint32 NCSProgram::findInstruction(uint32 address) const {
+	if (address == _size)
+		return _instructions.size();
+
+	// The instructions are sorted by their address
+	uint32 first = 0, last = _instructions.size();
+	while (first < last) {
+		uint32 middle = first + (last - first) / 2;
+
+		if      (_instructions[middle].address < address)
+			first = middle + 1;
+		else if (_instructions[middle].address > address)
+			last  = middle;
+		else
+			return middle;
+	}
+
+	return kNCSInvalidTarget;
+}
+
+void NCSProgram::load(Common::SeekableReadStream &ncs) {
+	readHeader(ncs);
 
 	if (_id != kNCSTag)
 		throw Common::Exception("Try to load non-NCS file");
@@ -303,15 +385,826 @@ void NCSFile::load() {
 	if (_version != kVersion10)
 		throw Common::Exception("Unsupported NCS file version %08X", _version);
 
-	byte lengthOpcode = _script->readByte();
+	byte lengthOpcode = ncs.readByte();
 	if (lengthOpcode != 0x42)
 		throw Common::Exception("Script size opcode != 0x42 (0x%02X)", lengthOpcode);
 
-	uint32 length = _script->readUint32BE();
-	if (length > ((uint32) _script->size()))
-		throw Common::Exception("Script size %d > stream size %d", length, _script->size());
-	if (length < ((uint32) _script->size()))
-		warning("TODO: NCSFile::load(): Script size %d < stream size %d", length, _script->size());
+	uint32 length = ncs.readUint32BE();
+	if (length > ((uint32) ncs.size()))
+		throw Common::Exception("Script size %d > stream size %d", length, ncs.size());
+	if (length < ((uint32) ncs.size()))
+		warning("TODO: NCSProgram::load(): Script size %d < stream size %d", length, ncs.size());
+
+	_size = ncs.size();
+	_data = new byte[_size];
+
+	ncs.seek(0);
+	if (ncs.read(_data, _size) != _size) {
+		delete[] _data;
+		_data = 0;
+
+		throw Common::Exception(Common::kReadError);
+	}
+
+	decode();
+}
+
+void NCSProgram::decode() {
+	Common::MemoryReadStream ncs(_data, _size);
+
+	ncs.seek(13); // 8 byte header + 5 byte program size dummy op
+
+	while ((uint32) ncs.pos() < _size) {
+		_instructions.push_back(NCSInstruction());
+
+		NCSInstruction &instr = _instructions.back();
+		instr.address = ncs.pos();
+
+		// We can't know where the next instruction starts, so we have to stop here
+		if (!decodeInstruction(ncs, instr))
+			break;
+	}
+
+	// Resolve the jump targets
+	for (std::vector<NCSInstruction>::iterator i = _instructions.begin(); i != _instructions.end(); ++i) {
+		if ((i->opcode != kOpcodeJMP) && (i->opcode != kOpcodeJSR) &&
+		    (i->opcode != kOpcodeJZ ) && (i->opcode != kOpcodeJNZ))
+			continue;
+
+		const int64 target = ((int64) i->address) + i->args[0];
+		if ((target >= 0) && (target <= _size))
+			i->target = findInstruction(target);
+	}
+
+	findBasicBlocks();
+	analyzeStackDepth();
+	fuse();
+}
+
+bool NCSProgram::decodeInstruction(Common::SeekableReadStream &ncs, NCSInstruction &instr) {
+	// Arguments that would reach past the end of the script, that's a read error
+	#define NEED(x) if ((_size - ncs.pos()) < (x)) { instr.opcode = kOpcodeTruncated; return false; }
+
+	NEED(2);
+
+	instr.opcode = ncs.readByte();
+	instr.type   = ncs.readByte();
+
+	switch (instr.opcode) {
+		case kOpcodeCPDOWNSP:
+		case kOpcodeCPTOPSP:
+		case kOpcodeCPDOWNBP:
+		case kOpcodeCPTOPBP:
+			NEED(6);
+			instr.args[0] = ncs.readSint32BE(); // Offset
+			instr.args[1] = ncs.readSint16BE(); // Size
+			break;
+
+		case kOpcodeCONST:
+			switch (instr.type) {
+				case kInstTypeInt:
+					NEED(4);
+					instr.constant.setType(kTypeInt);
+					instr.constant = (int32) ncs.readSint32BE();
+					break;
+
+				case kInstTypeFloat:
+					NEED(4);
+					instr.constant.setType(kTypeFloat);
+					instr.constant = ncs.readIEEEFloatBE();
+					break;
+
+				case kInstTypeString: {
+					NEED(2);
+					uint16 length = ncs.readUint16BE();
+
+					NEED(length);
+					instr.constant.setType(kTypeString);
+					instr.constant.getString().readFixedASCII(ncs, length);
+					break;
+				}
+
+				case kInstTypeObject:
+					NEED(4);
+					instr.args[0] = ncs.readUint32BE(); // Object ID
+					break;
+
+				default:
+					// Unknown size. Executing this instruction will throw
+					return false;
+			}
+			break;
+
+		case kOpcodeACTION:
+			NEED(3);
+			instr.args[0] = ncs.readUint16BE(); // Routine number
+			instr.args[1] = ncs.readByte();     // Argument count
+			break;
+
+		case kOpcodeEQ:
+		case kOpcodeNEQ:
+			if (instr.type == kInstTypeStructStruct) {
+				NEED(2);
+				instr.args[0] = ncs.readUint16BE(); // Struct size
+			}
+			break;
+
+		case kOpcodeMOVSP:
+		case kOpcodeJMP:
+		case kOpcodeJSR:
+		case kOpcodeJZ:
+		case kOpcodeJNZ:
+		case kOpcodeDECSP:
+		case kOpcodeINCSP:
+		case kOpcodeDECBP:
+		case kOpcodeINCBP:
+			NEED(4);
+			instr.args[0] = ncs.readSint32BE(); // Offset
+			break;
+
+		case kOpcodeDESTRUCT:
+			NEED(6);
+			instr.args[0] = ncs.readSint16BE(); // Stack size
+			instr.args[1] = ncs.readSint16BE(); // Don't remove offset
+			instr.args[2] = ncs.readSint16BE(); // Don't remove size
+			break;
+
+		case kOpcodeSTORESTATE:
+			NEED(8);
+			instr.args[0] = ncs.readUint32BE(); // BP size
+			instr.args[1] = ncs.readUint32BE(); // SP size
+			break;
+
+		default:
+			if (instr.opcode >= kOpcodeIllegal) {
+				instr.args[0] = instr.opcode;
+				instr.opcode  = kOpcodeIllegal;
+			}
+			break;
+	}
+
+	#undef NEED
+
+	return true;
+}
+
+
+uint32 NCSProgram::getMaxStackDepth() const {
+	return _maxStackDepth;
+}
+
+const char *NCSProgram::getOpcodeName(uint8 opcode) {
+	if (opcode >= kOpcodeMAX)
+		return kOpcodeNames[0];
+
+	return kOpcodeNames[opcode];
+}
+
+const char *NCSProgram::getSuperOpcodeName(uint8 superOpcode) {
+	if (superOpcode >= kSuperOpcodeMAX)
+		return kSuperOpcodeNames[0];
+
+	return kSuperOpcodeNames[superOpcode];
+}
+
+void NCSProgram::findBasicBlocks() {
+	if (_instructions.empty())
+		return;
+
+	_instructions[0].blockStart = true;
+
+	for (uint32 i = 0; i < _instructions.size(); i++) {
+		const NCSInstruction &instr = _instructions[i];
+
+		switch (instr.opcode) {
+			case kOpcodeJMP:
+			case kOpcodeJSR:
+			case kOpcodeJZ:
+			case kOpcodeJNZ:
+				if (instr.target < _instructions.size())
+					_instructions[instr.target].blockStart = true;
+
+				// Fall through
+
+			case kOpcodeRETN:
+				if ((i + 1) < _instructions.size())
+					_instructions[i + 1].blockStart = true;
+				break;
+
+			case kOpcodeSTORESTATE: {
+				// A stored script state resumes at an offset relative to the instruction
+				uint32 resume = findInstruction(instr.address + instr.type);
+				if (resume < _instructions.size())
+					_instructions[resume].blockStart = true;
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
+
+void NCSProgram::analyzeStackDepth() {
+	if (_instructions.empty())
+		return;
+
+	SubroutineMap subroutines;
+	int32 returnDepth, maxDepth;
+
+	// The script itself, run from the start
+	if (!analyzeCode(0, 0, subroutines, returnDepth, maxDepth))
+		return;
+
+	int32 depth = maxDepth;
+
+	// The code run from stored script states, with the stored variables on the stack
+	for (std::vector<NCSInstruction>::const_iterator i = _instructions.begin(); i != _instructions.end(); ++i) {
+		if (i->opcode != kOpcodeSTORESTATE)
+			continue;
+
+		uint32 resume = findInstruction(i->address + i->type);
+		if ((resume >= _instructions.size()) || (_instructions[resume].stackDepth != kNCSUnknownDepth))
+			continue;
+
+		const uint32 stored = ((uint32) i->args[0]) / 4 + ((uint32) i->args[1]) / 4;
+		if (stored > (uint32) kMaxStackDepth)
+			return;
+
+		if (!analyzeCode(resume, stored, subroutines, returnDepth, maxDepth))
+			return;
+
+		depth = MAX(depth, maxDepth);
+	}
+
+	if (depth <= kMaxStackDepth)
+		_maxStackDepth = depth;
+}
+
+bool NCSProgram::analyzeCode(uint32 entry, int32 depth, SubroutineMap &subroutines,
+                             int32 &returnDepth, int32 &maxDepth) {
+
+	returnDepth = kNCSUnknownDepth;
+	maxDepth    = depth;
+
+	// Code paths still to follow, with the stack depth at their start
+	std::vector< std::pair<uint32, int32> > paths;
+	paths.push_back(std::make_pair(entry, depth));
+
+	while (!paths.empty()) {
+		uint32 i = paths.back().first;
+		depth    = paths.back().second;
+
+		paths.pop_back();
+
+		while (true) {
+			if ((depth > kMaxStackDepth) || (depth < -kMaxStackDepth))
+				return false;
+
+			// Running past the end of the script ends it, same as returning
+			if (i >= _instructions.size()) {
+				if ((returnDepth != kNCSUnknownDepth) && (returnDepth != depth))
+					return false;
+
+				returnDepth = depth;
+				break;
+			}
+
+			NCSInstruction &instr = _instructions[i];
+
+			// We've been here before. We need to arrive with the same stack depth every time
+			if (instr.stackDepth != kNCSUnknownDepth) {
+				if (instr.stackDepth != depth)
+					return false;
+
+				break;
+			}
+
+			instr.stackDepth = depth;
+
+			if (instr.opcode == kOpcodeRETN) {
+				if ((returnDepth != kNCSUnknownDepth) && (returnDepth != depth))
+					return false;
+
+				returnDepth = depth;
+				break;
+			}
+
+			// Executing these throws, ending the script
+			if ((instr.opcode == kOpcodeIllegal) || (instr.opcode == kOpcodeTruncated))
+				break;
+
+			if (instr.opcode == kOpcodeJMP) {
+				if (instr.target == kNCSInvalidTarget)
+					break;
+
+				i = instr.target;
+				continue;
+			}
+
+			if (instr.opcode == kOpcodeJSR) {
+				if (instr.target == kNCSInvalidTarget)
+					break;
+
+				const Subroutine &subroutine = analyzeSubroutine(instr.target, subroutines);
+				if (!subroutine.analyzed || !subroutine.valid || (subroutine.returnDepth == kNCSUnknownDepth))
+					return false;
+
+				maxDepth = MAX(maxDepth, depth + subroutine.maxDepth);
+				depth   += subroutine.returnDepth;
+
+				i++;
+				continue;
+			}
+
+			int32 effect;
+			if (!getStackEffect(instr, effect))
+				return false;
+
+			depth   += effect;
+			maxDepth = MAX(maxDepth, depth);
+
+			if (((instr.opcode == kOpcodeJZ) || (instr.opcode == kOpcodeJNZ)) &&
+			    (instr.target != kNCSInvalidTarget))
+				paths.push_back(std::make_pair(instr.target, depth));
+
+			i++;
+		}
+	}
+
+	return true;
+}
+
+const NCSProgram::Subroutine &NCSProgram::analyzeSubroutine(uint32 entry, SubroutineMap &subroutines) {
+	std::pair<SubroutineMap::iterator, bool> result;
+
+	result = subroutines.insert(std::make_pair(entry, Subroutine()));
+
+	// Either analyzed already, or we're recursing into a subroutine we're still analyzing
+	Subroutine &subroutine = result.first->second;
+	if (!result.second)
+		return subroutine;
+
+	subroutine.valid    = analyzeCode(entry, 0, subroutines, subroutine.returnDepth, subroutine.maxDepth);
+	subroutine.analyzed = true;
+
+	return subroutine;
+}
+
+bool NCSProgram::getStackEffect(const NCSInstruction &instr, int32 &effect) const {
+	effect = 0;
+
+	switch (instr.opcode) {
+		case kOpcodeRSADD:
+		case kOpcodeCONST:
+		case kOpcodeSAVEBP:
+			effect = 1;
+			break;
+
+		case kOpcodeCPTOPSP:
+		case kOpcodeCPTOPBP:
+			effect = MAX<int32>(instr.args[1], 0) / 4;
+			break;
+
+		case kOpcodeLOGAND:
+		case kOpcodeLOGOR:
+		case kOpcodeINCOR:
+		case kOpcodeEXCOR:
+		case kOpcodeBOOLAND:
+		case kOpcodeEQ:
+		case kOpcodeNEQ:
+		case kOpcodeGEQ:
+		case kOpcodeGT:
+		case kOpcodeLT:
+		case kOpcodeLEQ:
+		case kOpcodeSHLEFT:
+		case kOpcodeSHRIGHT:
+		case kOpcodeUSHRIGHT:
+		case kOpcodeMUL:
+		case kOpcodeDIV:
+		case kOpcodeMOD:
+		case kOpcodeJZ:
+		case kOpcodeJNZ:
+		case kOpcodeRESTOREBP:
+			effect = -1;
+			break;
+
+		case kOpcodeADD:
+		case kOpcodeSUB:
+			effect = (instr.type == kInstTypeVectorVector) ? -3 : -1;
+			break;
+
+		case kOpcodeMOVSP:
+			effect = instr.args[0] / 4;
+			break;
+
+		case kOpcodeDESTRUCT:
+			for (int32 size = instr.args[0]; size > 0; size -= 4) {
+				effect--;
+
+				// Variables in the range that should not be removed are pushed back
+				if ((size <= (instr.args[1] + instr.args[2])) && (size > instr.args[1]))
+					effect++;
+			}
+			break;
+
+		case kOpcodeACTION:
+			try {
+				FunctionContext ctx = FunctionMan.createContext((uint32) instr.args[0]);
+
+				const uint8 argCount = instr.args[1];
+				if ((argCount < ctx.getParamMin()) || (argCount > ctx.getParamMax()))
+					return false;
+
+				for (uint8 i = 0; i < argCount; i++) {
+					const Type type = ctx.getParams()[i].getType();
+
+					if      (type == kTypeVector)
+						effect -= 3;
+					else if (type != kTypeScriptState)
+						effect -= 1;
+				}
+
+				const Type type = ctx.getReturn().getType();
+
+				if      (type == kTypeVector)
+					effect += 3;
+				else if (type != kTypeVoid)
+					effect += 1;
+
+			} catch (...) {
+				// An unknown engine function
+				return false;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return true;
+}
+
+void NCSProgram::fuse() {
+	for (uint32 i = 0; i < _instructions.size(); ) {
+		SuperOpcode superOpcode = kSuperOpcodeNone;
+
+		const uint8 length = findSuperInstruction(i, superOpcode);
+		if (length < 2) {
+			i++;
+			continue;
+		}
+
+		_instructions[i].superOpcode = superOpcode;
+		_instructions[i].superLength = length;
+
+		i += length;
+	}
+}
+
+static bool isCopy(const NCSInstruction &instr, bool single) {
+	if ((instr.opcode != kOpcodeCPTOPSP) && (instr.opcode != kOpcodeCPTOPBP))
+		return false;
+
+	if (instr.type != kInstTypeDirect)
+		return false;
+
+	if (single)
+		return instr.args[1] == 4;
+
+	return (instr.args[1] > 0) && ((instr.args[1] % 4) == 0);
+}
+
+static bool isConstant(const NCSInstruction &instr) {
+	return (instr.opcode == kOpcodeCONST) &&
+	       ((instr.type == kInstTypeInt) || (instr.type == kInstTypeFloat) || (instr.type == kInstTypeString));
+}
+
+static bool isComparison(const NCSInstruction &instr) {
+	if ((instr.opcode == kOpcodeEQ) || (instr.opcode == kOpcodeNEQ))
+		return instr.type != kInstTypeStructStruct;
+
+	if ((instr.opcode == kOpcodeLT) || (instr.opcode == kOpcodeGT) ||
+	    (instr.opcode == kOpcodeLEQ) || (instr.opcode == kOpcodeGEQ))
+		return instr.type == kInstTypeIntInt;
+
+	return false;
+}
+
+static bool isBranch(const NCSInstruction &instr) {
+	return ((instr.opcode == kOpcodeJZ) || (instr.opcode == kOpcodeJNZ)) &&
+	       (instr.type == kInstTypeNone);
+}
+
+static bool isPop(const NCSInstruction &instr) {
+	return (instr.opcode == kOpcodeMOVSP) && (instr.type == kInstTypeNone) && (instr.args[0] == -4);
+}
+
+static bool isReserve(const NCSInstruction &instr) {
+	if (instr.opcode != kOpcodeRSADD)
+		return false;
+
+	switch (instr.type) {
+		case kInstTypeInt:
+		case kInstTypeFloat:
+		case kInstTypeString:
+		case kInstTypeObject:
+		case kInstTypeEffect:
+		case kInstTypeEvent:
+		case kInstTypeLocation:
+		case kInstTypeTalent:
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+uint8 NCSProgram::findSuperInstruction(uint32 index, SuperOpcode &superOpcode) const {
+	const NCSInstruction *instr = &_instructions[index];
+	const uint32 count = _instructions.size() - index;
+
+	if (instr[0].opcode == kOpcodeCPTOPSP) {
+		// Comparing a variable against a constant, and branching on the result
+		if ((count >= 4) && isCopy(instr[0], true) && isConstant(instr[1]) &&
+		    isComparison(instr[2]) && isBranch(instr[3]) && isInBlock(index, 4)) {
+
+			superOpcode = kSuperOpcodeCompareConstJump;
+			return 4;
+		}
+
+		// Comparing a variable against a constant
+		if ((count >= 3) && isCopy(instr[0], true) && isConstant(instr[1]) &&
+		    isComparison(instr[2]) && isInBlock(index, 3)) {
+
+			superOpcode = kSuperOpcodeCompareConst;
+			return 3;
+		}
+	}
+
+	if ((instr[0].opcode == kOpcodeCPTOPSP) || (instr[0].opcode == kOpcodeCPTOPBP)) {
+		// Copying variables as the arguments of an engine function call
+		uint32 copies = 0, length = 0;
+		while ((length < count) && isCopy(instr[length], false)) {
+			copies += instr[length].args[1] / 4;
+			length++;
+		}
+
+		if ((length < count) && (instr[length].opcode == kOpcodeACTION) &&
+		    (instr[length].type == kInstTypeNone) && (copies <= kNCSMaxFusedArguments) &&
+		    (length < 0xFF) && isInBlock(index, length + 1)) {
+
+			superOpcode = kSuperOpcodeAction;
+			return length + 1;
+		}
+	}
+
+	// Declaring a variable initialized with a constant
+	if ((count >= 4) && isReserve(instr[0]) && isConstant(instr[1]) &&
+	    (instr[2].opcode == kOpcodeCPDOWNSP) && (instr[2].type == kInstTypeDirect) &&
+	    (instr[2].args[0] == -8) && (instr[2].args[1] == 4) && isPop(instr[3]) && isInBlock(index, 4)) {
+
+		superOpcode = kSuperOpcodePushConst;
+		return 4;
+	}
+
+	// Assigning the top of the stack to a variable, and removing it from the stack
+	if ((count >= 2) && ((instr[0].opcode == kOpcodeCPDOWNSP) || (instr[0].opcode == kOpcodeCPDOWNBP)) &&
+	    (instr[0].type == kInstTypeDirect) && (instr[0].args[1] == 4) && isPop(instr[1]) && isInBlock(index, 2)) {
+
+		superOpcode = (instr[0].opcode == kOpcodeCPDOWNSP) ? kSuperOpcodePopStoreSP : kSuperOpcodePopStoreBP;
+		return 2;
+	}
+
+	return 0;
+}
+
+bool NCSProgram::isInBlock(uint32 index, uint32 length) const {
+	if ((index + length) > _instructions.size())
+		return false;
+
+	for (uint32 i = index + 1; i < (index + length); i++)
+		if (_instructions[i].blockStart)
+			return false;
+
+	return true;
+}
+
+static const char *getTypeName(uint8 type) {
+	switch (type) {
+		case kInstTypeNone:
+		case kInstTypeDirect:
+			return "";
+		case kInstTypeInt:
+			return "I";
+		case kInstTypeFloat:
+			return "F";
+		case kInstTypeString:
+			return "S";
+		case kInstTypeObject:
+			return "O";
+		case kInstTypeEffect:
+			return "E";
+		case kInstTypeEvent:
+			return "EV";
+		case kInstTypeLocation:
+			return "L";
+		case kInstTypeTalent:
+			return "T";
+		case kInstTypeIntInt:
+			return "II";
+		case kInstTypeFloatFloat:
+			return "FF";
+		case kInstTypeObjectObject:
+			return "OO";
+		case kInstTypeStringString:
+			return "SS";
+		case kInstTypeStructStruct:
+			return "TT";
+		case kInstTypeIntFloat:
+			return "IF";
+		case kInstTypeFloatInt:
+			return "FI";
+		case kInstTypeEffectEffect:
+			return "EE";
+		case kInstTypeEventEvent:
+			return "EVEV";
+		case kInstTypeLocationLocation:
+			return "LL";
+		case kInstTypeTalentTalent:
+			return "TT";
+		case kInstTypeVectorVector:
+			return "VV";
+		case kInstTypeVectorFloat:
+			return "VF";
+		case kInstTypeFloatVector:
+			return "FV";
+		default:
+			break;
+	}
+
+	return "?";
+}
+
+static Common::UString getArguments(const NCSInstruction &instr) {
+	switch (instr.opcode) {
+		case kOpcodeCPDOWNSP:
+		case kOpcodeCPTOPSP:
+		case kOpcodeCPDOWNBP:
+		case kOpcodeCPTOPBP:
+			return Common::UString::sprintf("%d, %d", instr.args[0], instr.args[1]);
+
+		case kOpcodeCONST:
+			if (instr.type == kInstTypeInt)
+				return Common::UString::sprintf("%d", instr.constant.getInt());
+			if (instr.type == kInstTypeFloat)
+				return Common::UString::sprintf("%f", instr.constant.getFloat());
+			if (instr.type == kInstTypeString)
+				return "\"" + instr.constant.getString() + "\"";
+			if (instr.type == kInstTypeObject)
+				return Common::UString::sprintf("0x%08X", (uint32) instr.args[0]);
+			break;
+
+		case kOpcodeACTION: {
+			Common::UString name;
+			try {
+				name = FunctionMan.createContext((uint32) instr.args[0]).getName();
+			} catch (...) {
+				name = "???";
+			}
+
+			return Common::UString::sprintf("%s (%d), %d", name.c_str(), instr.args[0], instr.args[1]);
+		}
+
+		case kOpcodeEQ:
+		case kOpcodeNEQ:
+			if (instr.type == kInstTypeStructStruct)
+				return Common::UString::sprintf("%d", instr.args[0]);
+			break;
+
+		case kOpcodeMOVSP:
+		case kOpcodeDECSP:
+		case kOpcodeINCSP:
+		case kOpcodeDECBP:
+		case kOpcodeINCBP:
+			return Common::UString::sprintf("%d", instr.args[0]);
+
+		case kOpcodeJMP:
+		case kOpcodeJSR:
+		case kOpcodeJZ:
+		case kOpcodeJNZ:
+			return Common::UString::sprintf("%08X", instr.address + instr.args[0]);
+
+		case kOpcodeDESTRUCT:
+			return Common::UString::sprintf("%d, %d, %d", instr.args[0], instr.args[1], instr.args[2]);
+
+		case kOpcodeSTORESTATE:
+			return Common::UString::sprintf("%d, %d (resume at %08X)",
+			                                instr.args[0], instr.args[1], instr.address + instr.type);
+
+		case kOpcodeIllegal:
+			return Common::UString::sprintf("0x%02X", instr.args[0]);
+
+		default:
+			break;
+	}
+
+	return "";
+}
+
+void NCSProgram::disassemble(std::vector<Common::UString> &lines) const {
+	if (_maxStackDepth > 0)
+		lines.push_back(Common::UString::sprintf("; Max stack depth: %d", _maxStackDepth));
+	else
+		lines.push_back("; Max stack depth: unknown");
+
+	uint32 fused = 0;
+	for (std::vector<NCSInstruction>::const_iterator i = _instructions.begin(); i != _instructions.end(); ++i) {
+		if (i->blockStart) {
+			lines.push_back("");
+			lines.push_back(Common::UString::sprintf("%08X:", i->address));
+		}
+
+		Common::UString depth = "  ?";
+		if (i->stackDepth != kNCSUnknownDepth)
+			depth = Common::UString::sprintf("%3d", i->stackDepth);
+
+		// The type of a STORESTATE is the offset to resume at
+		const char *type = (i->opcode == kOpcodeSTORESTATE) ? "" : getTypeName(i->type);
+
+		Common::UString line = Common::UString::sprintf("  %08X [%s]  %-10s %-4s %-24s", i->address,
+				depth.c_str(), getOpcodeName(i->opcode), type, getArguments(*i).c_str());
+
+		if (i->superOpcode != kSuperOpcodeNone) {
+			line += Common::UString::sprintf("    ; %s (%d)", getSuperOpcodeName(i->superOpcode), i->superLength);
+
+			fused = i->superLength - 1;
+		} else if (fused > 0) {
+			line += "    ; |";
+
+			fused--;
+		}
+
+		line.trimRight();
+		lines.push_back(line);
+	}
+}
+
+
+NCSFile::NCSFile(Common::SeekableReadStream *ncs) : _pc(0), _instr(0), _running(false),
+	_resumed(false), _fusion(true), _owner(0), _triggerer(0), _contextDepth(0), _argumentCount(0) {
+
+	try {
+		_program.reset(new NCSProgram(*ncs));
+	} catch (...) {
+		delete ncs;
+		throw;
+	}
+
+	delete ncs;
+
+	load();
+}
+
+NCSFile::NCSFile(const Common::UString &ncs) : _name(ncs), _pc(0), _instr(0),
+	_running(false), _resumed(false), _fusion(true), _owner(0), _triggerer(0), _contextDepth(0),
+	_argumentCount(0) {
+
+	_program = NCSCacheMan.get(ncs);
+
+	load();
+}
+
+NCSFile::NCSFile(const Common::UString &name, const NCSProgramPtr &program) : _name(name),
+	_program(program), _pc(0), _instr(0), _running(false), _resumed(false), _fusion(true),
+	_owner(0), _triggerer(0), _contextDepth(0), _argumentCount(0) {
+
+	load();
+}
+
+NCSFile::~NCSFile() {
+	for (std::vector<FunctionContext *>::iterator c = _contexts.begin(); c != _contexts.end(); ++c)
+		delete *c;
+}
+
+const Common::UString &NCSFile::getName() const {
+	return _name;
+}
+
+ScriptState NCSFile::getEmptyState() {
+	ScriptState state;
+
+	state.offset = 13; // 8 byte header + 5 byte program size dummy op
+
+	return state;
+}
+
+void NCSFile::load() {
+	// The program has already been validated and decoded
+	_id      = _program->getID();
+	_version = _program->getVersion();
 
 	setupOpcodes();
 
@@ -319,7 +1212,11 @@ void NCSFile::load() {
 }
 
 void NCSFile::reset() {
-	_stack.reset();
+	// Make room for as much stack as the program is ever going to need
+	const uint32 stackDepth = _program->getMaxStackDepth();
+	_stack.reset((stackDepth > 0) ? stackDepth : NCSStack::kInitialStackSize);
+
+	_argumentCount = 0;
 
 	while (!_returnOffsets.empty())
 		_returnOffsets.pop();
@@ -327,7 +1224,10 @@ void NCSFile::reset() {
 	_storedState.setType(kTypeVoid);
 	_return.setType(kTypeVoid);
 
-	_script->seek(13); // 8 byte header + 5 byte program size dummy op
+	_pc    = 0;
+	_instr = 0;
+
+	_running = false;
 }
 
 const Variable &NCSFile::run(Object *owner, Object *triggerer) {
@@ -335,12 +1235,21 @@ const Variable &NCSFile::run(Object *owner, Object *triggerer) {
 }
 
 const Variable &NCSFile::run(const ScriptState &state, Object *owner, Object *triggerer) {
+	start(state, owner, triggerer);
+	resume(0xFFFFFFFF);
+
+	return _return;
+}
+
+void NCSFile::start(const ScriptState &state, Object *owner, Object *triggerer) {
 	debugC(1, kDebugScripts, "=== Running script \"%s\" (%d) ===",
 	       _name.c_str(), state.offset);
 
 	reset();
 
-	_script->seek(state.offset);
+	_pc = _program->findInstruction(state.offset);
+	if (_pc == kNCSInvalidTarget)
+		throw Common::Exception("NCSFile::run(): Illegal script offset %d", state.offset);
 
 	// Push global variables
 	std::vector<class Variable>::const_reverse_iterator var;
@@ -353,18 +1262,40 @@ const Variable &NCSFile::run(const ScriptState &state, Object *owner, Object *tr
 	for (var = state.locals.rbegin(); var != state.locals.rend(); ++var)
 		_stack.push(*var);
 
-	return execute(owner, triggerer);
-}
-
-const Variable &NCSFile::execute(Object *owner, Object *triggerer) {
 	_owner     = owner;
 	_triggerer = triggerer;
 
-	while (!_script->eos() && !_script->err())
-		executeStep();
+	_running = true;
+	_resumed = false;
+}
 
-	if (_script->err())
-		throw Common::Exception(Common::kReadError);
+bool NCSFile::resume(uint32 maxSteps) {
+	if (!_running)
+		throw Common::Exception("NCSFile::resume(): Script \"%s\" is not running", _name.c_str());
+
+	const bool profile = ScriptProf.isEnabled();
+	if (profile)
+		ScriptProf.enterScript(_name, _resumed);
+
+	uint32 steps = 0;
+
+	try {
+		executeSteps(maxSteps, steps);
+	} catch (...) {
+		if (profile)
+			ScriptProf.leaveScript(steps);
+
+		finish();
+		throw;
+	}
+
+	if (profile)
+		ScriptProf.leaveScript(steps);
+
+	if (_pc < _program->getInstructions().size()) {
+		_resumed = true;
+		return false;
+	}
 
 	if (!_stack.empty())
 		_return = _stack.top();
@@ -373,39 +1304,84 @@ const Variable &NCSFile::execute(Object *owner, Object *triggerer) {
 		debugC(1, kDebugScripts, "=> Script\"%s\" returns: %d",
 		       _name.c_str(), _stack.top().getInt());
 
+	finish();
+	return true;
+}
+
+bool NCSFile::isRunning() const {
+	return _running;
+}
+
+const Variable &NCSFile::getReturn() const {
+	return _return;
+}
+
+void NCSFile::setFusion(bool fusion) {
+	_fusion = fusion;
+}
+
+void NCSFile::finish() {
+	_running = false;
+
 	_owner     = 0;
 	_triggerer = 0;
+}
 
-	return _return;
+void NCSFile::executeSteps(uint32 maxSteps, uint32 &steps) {
+	const std::vector<NCSInstruction> &instructions = _program->getInstructions();
+
+	const uint32 count = instructions.size();
+	while ((_pc < count) && (steps < maxSteps)) {
+		_instr = &instructions[_pc++];
+
+		// A superinstruction only runs when all of its steps fit, so that scripts
+		// are suspended at the same instructions with and without fusion
+		if (_fusion && (_instr->superOpcode != kSuperOpcodeNone) &&
+		    (_instr->superLength <= (maxSteps - steps))) {
+
+			steps += _instr->superLength;
+			executeSuperStep();
+			continue;
+		}
+
+		steps++;
+		executeStep();
+	}
 }
 
 void NCSFile::executeStep() {
-	byte opcode = _script->readByte();
-	InstructionType type = (InstructionType)_script->readByte();
-
-	if (opcode >= _opcodeListSize)
-		throw Common::Exception("NCSFile::executeStep(): Illegal instruction 0x%02x", opcode);
+	const uint8 opcode = _instr->opcode;
 
 	debugC(1, kDebugScripts, "NWScript opcode %s [0x%02X]", _opcodes[opcode].desc, opcode);
 
-	try {
-		(this->*(_opcodes[opcode].proc))(type);
-	} catch (Common::Exception &e) {
-		throw;
-	}
+	(this->*(_opcodes[opcode].proc))((InstructionType) _instr->type);
 
 	_stack.print();
 	debugC(2, kDebugScripts, "[RETURN: %d]",
 	       _returnOffsets.empty() ? -1 : _returnOffsets.top());
 }
 
-void NCSFile::decompile() {
-	uint32 oldScriptPos = _script->pos();
-	_script->seek(13); // 8 byte header + 5 byte program size dummy op
+void NCSFile::executeSuperStep() {
+	const uint8 superOpcode = _instr->superOpcode;
+
+	debugC(1, kDebugScripts, "NWScript superinstruction %s", _superOpcodes[superOpcode].desc);
+
+	// Continue after the last fused instruction, unless the superinstruction jumps
+	_pc += _instr->superLength - 1;
 
-	// TODO
+	(this->*(_superOpcodes[superOpcode].proc))();
 
-	_script->seek(oldScriptPos);
+	_stack.print();
+	debugC(2, kDebugScripts, "[RETURN: %d]",
+	       _returnOffsets.empty() ? -1 : _returnOffsets.top());
+}
+
+void NCSFile::jump() {
+	if (_instr->target == kNCSInvalidTarget)
+		throw Common::Exception("NCSFile::jump(): Illegal jump target %d",
+		                        _instr->address + _instr->args[0]);
+
+	_pc = _instr->target;
 }
 
 // OPCODES!
@@ -444,21 +1420,13 @@ void NCSFile::o_rsadd(InstructionType type) {
 void NCSFile::o_const(InstructionType type) {
 	switch (type) {
 		case kInstTypeInt:
-			_stack.push(_script->readSint32BE());
-			break;
-
 		case kInstTypeFloat:
-			_stack.push(_script->readIEEEFloatBE());
+		case kInstTypeString:
+			_stack.push(_instr->constant);
 			break;
 
-		case kInstTypeString: {
-			_stack.push(kTypeString);
-			_stack.top().getString().readFixedASCII(*_script, _script->readUint16BE());
-			break;
-		}
-
 		case kInstTypeObject: {
-			uint32 objectID = _script->readUint32BE();
+			uint32 objectID = (uint32) _instr->args[0];
 
 			if      (objectID == kScriptObjectSelf)
 				_stack.push(_owner);
@@ -477,8 +1445,21 @@ void NCSFile::o_const(InstructionType type) {
 	}
 }
 
-void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
-                         uint32 function, uint8 argCount) {
+FunctionContext &NCSFile::acquireContext() {
+	if (_contextDepth >= _contexts.size())
+		_contexts.push_back(new FunctionContext);
+
+	return *_contexts[_contextDepth++];
+}
+
+void NCSFile::releaseContext() {
+	assert(_contextDepth > 0);
+
+	_contextDepth--;
+}
+
+void NCSFile::callEngine(FunctionContext &ctx, uint32 function, const Function &func,
+                         uint8 argCount) {
 
 	if ((argCount < ctx.getParamMin()) || (argCount > ctx.getParamMax()))
 		throw Common::Exception("NCSFile::callEngine(): Argument count mismatch (%d vs %d - %d)",
@@ -498,20 +1479,26 @@ void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
 			case kTypeString:
 			case kTypeObject:
 			case kTypeEngineType:
-				param = _stack.pop();
+				popArgument(param);
 				break;
 
 			case kTypeVector: {
-				float z = _stack.pop().getFloat();
-				float y = _stack.pop().getFloat();
-				float x = _stack.pop().getFloat();
+				popArgument(_argument);
+				float z = _argument.getFloat();
+				popArgument(_argument);
+				float y = _argument.getFloat();
+				popArgument(_argument);
+				float x = _argument.getFloat();
 
 				param.setVector(x, y, z);
 				break;
 			}
 
 			case kTypeScriptState:
-				param.getScriptState() = _storedState.getScriptState();
+				if (_storedState.getType() != kTypeScriptState)
+					throw Common::Exception("NCSFile::callEngine(): No stored script state");
+
+				param.swap(_storedState);
 				_storedState.setType(kTypeVoid);
 				break;
 
@@ -523,9 +1510,29 @@ void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
 
 	}
 
+	// Copied arguments the function didn't take stay on the stack
+	for (uint32 i = 0; i < _argumentCount; i++)
+		_stack.push(_stack.at(_arguments[i]));
+
+	_argumentCount = 0;
+
 	debugC(1, kDebugScripts, "NWScript engine function %s (%d)",
 	       ctx.getName().c_str(), function);
-	FunctionMan.call(function, ctx);
+
+	if (!ScriptProf.isEnabled()) {
+		func(ctx);
+	} else {
+		ScriptProf.enterFunction(function, ctx.getName());
+
+		try {
+			func(ctx);
+		} catch (...) {
+			ScriptProf.leaveFunction();
+			throw;
+		}
+
+		ScriptProf.leaveFunction();
+	}
 
 	Variable &retVal = ctx.getReturn();
 	switch (retVal.getType()) {
@@ -557,22 +1564,40 @@ void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
 	}
 }
 
+void NCSFile::popArgument(Variable &arg) {
+	// Arguments copied by a superinstruction are taken from where they were copied from
+	if (_argumentCount > 0)
+		arg = _stack.at(_arguments[--_argumentCount]);
+	else
+		arg = _stack.pop();
+}
+
 void NCSFile::o_action(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_action(): Illegal type %d", type);
 
-	uint16 routineNumber = _script->readUint16BE();
-	uint8  argCount      = _script->readByte();
+	uint16 routineNumber = _instr->args[0];
+	uint8  argCount      = _instr->args[1];
 
-	Aurora::NWScript::FunctionContext ctx = FunctionMan.createContext(routineNumber);
+	FunctionContext &ctx = acquireContext();
 
 	try {
-		callEngine(ctx, routineNumber, argCount);
-	} catch (Common::Exception &e) {
-		e.add("Failed running engine function \"%s\" (%d)",
-		      ctx.getName().c_str(), routineNumber);
+		const Function &func = FunctionMan.setupContext(routineNumber, ctx);
+
+		try {
+			callEngine(ctx, routineNumber, func, argCount);
+		} catch (Common::Exception &e) {
+			e.add("Failed running engine function \"%s\" (%d)",
+			      ctx.getName().c_str(), routineNumber);
+			throw;
+		}
+
+	} catch (...) {
+		releaseContext();
 		throw;
 	}
+
+	releaseContext();
 }
 
 void NCSFile::o_logand(InstructionType type) {
@@ -641,8 +1666,7 @@ void NCSFile::o_booland(InstructionType type) {
 }
 
 void NCSFile::o_eq(InstructionType type) {
-	if (type == kInstTypeStructStruct) // TODO!
-		_script->readUint16BE();
+	// TODO: kInstTypeStructStruct
 
 	Variable arg1 = _stack.pop();
 	Variable arg2 = _stack.pop();
@@ -651,8 +1675,7 @@ void NCSFile::o_eq(InstructionType type) {
 }
 
 void NCSFile::o_neq(InstructionType type) {
-	if (type == kInstTypeStructStruct) // TODO!
-		_script->readUint16BE();
+	// TODO: kInstTypeStructStruct
 
 	Variable arg1 = _stack.pop();
 	Variable arg2 = _stack.pop();
@@ -866,25 +1889,22 @@ void NCSFile::o_movsp(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_movsp(): Illegal type %d", type);
 
-	_stack.setStackPtr(_stack.getStackPtr() - _script->readSint32BE());
+	_stack.setStackPtr(_stack.getStackPtr() - _instr->args[0]);
 }
 
 void NCSFile::o_jmp(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_jmp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
-	_script->seek(offset - 6, SEEK_CUR);
+	jump();
 }
 
 void NCSFile::o_jz(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_jz(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
-
 	if (!_stack.pop().getInt())
-		_script->seek(offset - 6, SEEK_CUR);
+		jump();
 }
 
 void NCSFile::o_not(InstructionType type) {
@@ -898,7 +1918,7 @@ void NCSFile::o_decsp(InstructionType type) {
 	if (type != kInstTypeInt)
 		throw Common::Exception("NCSFile::o_decsp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = _instr->args[0];
 
 	_stack.setRelSP(offset, _stack.getRelSP(offset).getInt() - 1);
 }
@@ -907,7 +1927,7 @@ void NCSFile::o_incsp(InstructionType type) {
 	if (type != kInstTypeInt)
 		throw Common::Exception("NCSFile::o_incsp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = _instr->args[0];
 
 	_stack.setRelSP(offset, _stack.getRelSP(offset).getInt() + 1);
 }
@@ -916,17 +1936,15 @@ void NCSFile::o_jnz(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_jnz(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
-
 	if (_stack.pop().getInt())
-		_script->seek(offset - 6, SEEK_CUR);
+		jump();
 }
 
 void NCSFile::o_decbp(InstructionType type) {
 	if (type != kInstTypeInt)
 		throw Common::Exception("NCSFile::o_decbp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = _instr->args[0];
 
 	_stack.setRelBP(offset, _stack.getRelBP(offset).getInt() - 1);
 }
@@ -935,7 +1953,7 @@ void NCSFile::o_incbp(InstructionType type) {
 	if (type != kInstTypeInt)
 		throw Common::Exception("NCSFile::o_incbp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = _instr->args[0];
 
 	_stack.setRelBP(offset, _stack.getRelBP(offset).getInt() + 1);
 }
@@ -963,8 +1981,8 @@ void NCSFile::o_cpdownsp(InstructionType type) {
 	if (type != kInstTypeDirect)
 		throw Common::Exception("NCSFile::o_cpdownsp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = _instr->args[0];
+	int16 size   = _instr->args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cpdownsp(): Illegal size %d", size);
@@ -983,8 +2001,8 @@ void NCSFile::o_cptopsp(InstructionType type) {
 	if (type != kInstTypeDirect)
 		throw Common::Exception("NCSFile::o_cptopsp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = _instr->args[0];
+	int16 size   = _instr->args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cptopsp(): Illegal size %d", size);
@@ -1269,28 +2287,27 @@ void NCSFile::o_jsr(InstructionType type) {
 	if (type != kInstTypeNone)
 		throw Common::Exception("NCSFile::o_jsr(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE();
+	// Push the index of the next instruction
+	_returnOffsets.push(_pc);
 
-	// Push the current script position
-	_returnOffsets.push(_script->pos());
-
-	_script->seek(offset - 6, SEEK_CUR);
+	jump();
 }
 
 void NCSFile::o_retn(InstructionType type) {
-	uint32 returnAddress = _script->size();
+	// Returning from the outermost level ends the script
+	uint32 returnAddress = _program->getInstructions().size();
 	if (!_returnOffsets.empty()) {
 		returnAddress = _returnOffsets.top();
 		_returnOffsets.pop();
 	}
 
-	_script->seek(returnAddress);
+	_pc = returnAddress;
 }
 
 void NCSFile::o_destruct(InstructionType type) {
-	int16 stackSize        = _script->readSint16BE();
-	int16 dontRemoveOffset = _script->readSint16BE();
-	int16 dontRemoveSize   = _script->readSint16BE();
+	int16 stackSize        = _instr->args[0];
+	int16 dontRemoveOffset = _instr->args[1];
+	int16 dontRemoveSize   = _instr->args[2];
 
 	if ((stackSize % 4) != 0)
 		throw Common::Exception("NCSFile::o_destruct(): Illegal stack size %d", stackSize);
@@ -1321,8 +2338,8 @@ void NCSFile::o_cpdownbp(InstructionType type) {
 	if (type != kInstTypeDirect)
 		throw Common::Exception("NCSFile::o_cpdownbp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE() - 4;
-	int16 size   = _script->readSint16BE();
+	int32 offset = _instr->args[0] - 4;
+	int16 size   = _instr->args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cpdownbp(): Illegal size %d", size);
@@ -1341,8 +2358,8 @@ void NCSFile::o_cptopbp(InstructionType type) {
 	if (type != kInstTypeDirect)
 		throw Common::Exception("NCSFile::o_cptopbp(): Illegal type %d", type);
 
-	int32 offset = _script->readSint32BE() - 4;
-	int16 size   = _script->readSint16BE();
+	int32 offset = _instr->args[0] - 4;
+	int16 size   = _instr->args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cptopbp(): Illegal size %d", size);
@@ -1357,8 +2374,8 @@ void NCSFile::o_cptopbp(InstructionType type) {
 
 void NCSFile::o_storestate(InstructionType type) {
 	uint8  offset = (uint8) type;
-	uint32 sizeBP = _script->readUint32BE();
-	uint32 sizeSP = _script->readUint32BE();
+	uint32 sizeBP = (uint32) _instr->args[0];
+	uint32 sizeSP = (uint32) _instr->args[1];
 
 	if ((sizeBP % 4) != 0)
 		throw Common::Exception("NCSFile::o_storestate(): Illegal BP size %d", sizeBP);
@@ -1368,7 +2385,7 @@ void NCSFile::o_storestate(InstructionType type) {
 	_storedState.setType(kTypeScriptState);
 	ScriptState &state = _storedState.getScriptState();
 
-	state.offset = _script->pos() - 10 + offset;
+	state.offset = _instr->address + offset;
 
 	sizeBP /= 4;
 	sizeSP /= 4;
@@ -1380,6 +2397,109 @@ void NCSFile::o_storestate(InstructionType type) {
 		state.locals.push_back(_stack.getRelSP(posSP));
 }
 
+void NCSFile::o_illegal(InstructionType type) {
+	throw Common::Exception("NCSFile::executeStep(): Illegal instruction 0x%02x", _instr->args[0]);
+}
+
+void NCSFile::o_truncated(InstructionType type) {
+	throw Common::Exception(Common::kReadError);
+}
+
+// SUPERINSTRUCTIONS!
+
+bool NCSFile::compareConst() {
+	// CPTOPSP, CONST, EQ/NEQ/LT/GT/LEQ/GEQ
+	const Variable &var      = _stack.getRelSP(_instr[0].args[0]);
+	const Variable &constant = _instr[1].constant;
+
+	switch (_instr[2].opcode) {
+		case kOpcodeEQ:
+			return var == constant;
+		case kOpcodeNEQ:
+			return var != constant;
+		case kOpcodeLT:
+			return var.getInt() <  constant.getInt();
+		case kOpcodeGT:
+			return var.getInt() >  constant.getInt();
+		case kOpcodeLEQ:
+			return var.getInt() <= constant.getInt();
+		case kOpcodeGEQ:
+			return var.getInt() >= constant.getInt();
+		default:
+			break;
+	}
+
+	throw Common::Exception("NCSFile::compareConst(): Invalid comparison %d", _instr[2].opcode);
+}
+
+void NCSFile::s_compareconst() {
+	// CPTOPSP, CONST, comparison
+	_stack.push((int32) compareConst());
+}
+
+void NCSFile::s_compareconstjump() {
+	// CPTOPSP, CONST, comparison, JZ/JNZ
+	const bool result = compareConst();
+
+	_instr += 3;
+
+	if ((_instr->opcode == kOpcodeJZ) ? !result : result)
+		jump();
+}
+
+void NCSFile::s_pushconst() {
+	// RSADD, CONST, CPDOWNSP, MOVSP
+	_stack.push(_instr[1].constant);
+}
+
+void NCSFile::s_popstoresp() {
+	// CPDOWNSP, MOVSP -4
+	_stack.popRelSP(_instr[0].args[0]);
+}
+
+void NCSFile::s_popstorebp() {
+	// CPDOWNBP, MOVSP -4
+	_stack.popRelBP(_instr[0].args[0] - 4);
+}
+
+void NCSFile::s_action() {
+	// CPTOPSP/CPTOPBP..., ACTION
+
+	/* Instead of pushing copies of the arguments onto the stack, only to
+	 * pop them off again right away, we remember where the copies would
+	 * have come from. The engine function call then takes its arguments
+	 * directly from there. */
+
+	const int32 top = (_stack.getStackPtr() / -4) - 1;
+
+	_argumentCount = 0;
+	for (const NCSInstruction *copy = _instr; copy->opcode != kOpcodeACTION; copy++) {
+		int32 offset = copy->args[0];
+		if (copy->opcode == kOpcodeCPTOPBP)
+			offset -= 4;
+
+		for (int32 size = copy->args[1]; size > 0; size -= 4) {
+			int32 index;
+			if (copy->opcode == kOpcodeCPTOPSP) {
+				index = _stack.getRelSPIndex(offset, _argumentCount);
+			} else {
+				index = _stack.getRelBPIndex(offset);
+				offset += 4;
+			}
+
+			// A copy of a copy we just made is a copy of the same variable
+			if ((index > top) && (index <= (top + (int32) _argumentCount)))
+				index = _arguments[index - top - 1];
+
+			_arguments[_argumentCount++] = index;
+		}
+	}
+
+	_instr += _instr->superLength - 1;
+
+	o_action((InstructionType) _instr->type);
+}
+
 } // End of namespace NWScript
 
 } // End of namespace Aurora
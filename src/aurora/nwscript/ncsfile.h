@@ -32,8 +32,12 @@
 
 #include <vector>
 #include <stack>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
 
 #include "common/types.h"
+#include "common/noncopyable.h"
 
 #include "aurora/types.h"
 #include "aurora/aurorafile.h"
@@ -50,12 +54,18 @@ namespace Aurora {
 
 namespace NWScript {
 
+class FunctionContext;
+
 class NCSStack : public std::vector<Variable> {
 public:
+	/** The number of variables the stack has room for from the start, if not known better. */
+	static const size_t kInitialStackSize = 256;
+
 	NCSStack();
 	~NCSStack();
 
-	void reset();
+	/** Empty the stack, making room for this many variables. */
+	void reset(size_t size = kInitialStackSize);
 
 	bool empty() const;
 
@@ -69,6 +79,20 @@ public:
 	Variable &getRelBP(int32 pos);
 	void setRelBP(int32 pos, const Variable &obj);
 
+	/** Pop the top of the stack into this position relative to the stack pointer before popping. */
+	void popRelSP(int32 pos);
+	/** Pop the top of the stack into this position relative to the base pointer. */
+	void popRelBP(int32 pos);
+
+	/** Return the index of the variable at this position relative to the stack pointer.
+	 *
+	 *  @param pos    The position, in bytes, as used by the instructions.
+	 *  @param pushed Pretend that this many more variables have been pushed already.
+	 */
+	int32 getRelSPIndex(int32 pos, int32 pushed = 0) const;
+	/** Return the index of the variable at this position relative to the base pointer. */
+	int32 getRelBPIndex(int32 pos) const;
+
 	int32 getStackPtr();
 	void  setStackPtr(int32 pos);
 
@@ -80,15 +104,262 @@ public:
 private:
 	int32 _stackPtr;
 	int32 _basePtr;
+
+	static int32 getIndex(int32 ptr, int32 pos, const char *access);
+};
+
+/** An NCS opcode. */
+enum Opcode {
+	kOpcodeCPDOWNSP      = 0x01,
+	kOpcodeRSADD         = 0x02,
+	kOpcodeCPTOPSP       = 0x03,
+	kOpcodeCONST         = 0x04,
+	kOpcodeACTION        = 0x05,
+	kOpcodeLOGAND        = 0x06,
+	kOpcodeLOGOR         = 0x07,
+	kOpcodeINCOR         = 0x08,
+	kOpcodeEXCOR         = 0x09,
+	kOpcodeBOOLAND       = 0x0A,
+	kOpcodeEQ            = 0x0B,
+	kOpcodeNEQ           = 0x0C,
+	kOpcodeGEQ           = 0x0D,
+	kOpcodeGT            = 0x0E,
+	kOpcodeLT            = 0x0F,
+	kOpcodeLEQ           = 0x10,
+	kOpcodeSHLEFT        = 0x11,
+	kOpcodeSHRIGHT       = 0x12,
+	kOpcodeUSHRIGHT      = 0x13,
+	kOpcodeADD           = 0x14,
+	kOpcodeSUB           = 0x15,
+	kOpcodeMUL           = 0x16,
+	kOpcodeDIV           = 0x17,
+	kOpcodeMOD           = 0x18,
+	kOpcodeNEG           = 0x19,
+	kOpcodeCOMP          = 0x1A,
+	kOpcodeMOVSP         = 0x1B,
+	kOpcodeSTORESTATEALL = 0x1C,
+	kOpcodeJMP           = 0x1D,
+	kOpcodeJSR           = 0x1E,
+	kOpcodeJZ            = 0x1F,
+	kOpcodeRETN          = 0x20,
+	kOpcodeDESTRUCT      = 0x21,
+	kOpcodeNOT           = 0x22,
+	kOpcodeDECSP         = 0x23,
+	kOpcodeINCSP         = 0x24,
+	kOpcodeJNZ           = 0x25,
+	kOpcodeCPDOWNBP      = 0x26,
+	kOpcodeCPTOPBP       = 0x27,
+	kOpcodeDECBP         = 0x28,
+	kOpcodeINCBP         = 0x29,
+	kOpcodeSAVEBP        = 0x2A,
+	kOpcodeRESTOREBP     = 0x2B,
+	kOpcodeSTORESTATE    = 0x2C,
+	kOpcodeNOP           = 0x2D,
+
+	// Pseudo opcodes, produced by the decoder
+	kOpcodeIllegal       = 0x2E, ///< An unknown opcode.
+	kOpcodeTruncated     = 0x2F, ///< An instruction cut short by the end of the script.
+
+	kOpcodeMAX
+};
+
+/** A superinstruction, fusing a common sequence of NCS instructions into one.
+ *
+ *  Each superinstruction has exactly the same effect as the sequence
+ *  of instructions it replaces.
+ */
+enum SuperOpcode {
+	kSuperOpcodeNone = 0,
+	kSuperOpcodeCompareConst,     ///< CPTOPSP, CONST, comparison.
+	kSuperOpcodeCompareConstJump, ///< CPTOPSP, CONST, comparison, JZ/JNZ.
+	kSuperOpcodePushConst,        ///< RSADD, CONST, CPDOWNSP, MOVSP: An initialized variable.
+	kSuperOpcodePopStoreSP,       ///< CPDOWNSP, MOVSP: An assignment to a local variable.
+	kSuperOpcodePopStoreBP,       ///< CPDOWNBP, MOVSP: An assignment to a global variable.
+	kSuperOpcodeAction,           ///< CPTOPSP/CPTOPBP..., ACTION: An engine function call.
+
+	kSuperOpcodeMAX
+};
+
+/** The type of an NCS instruction. */
+enum InstructionType {
+	// Unary
+	kInstTypeNone      =  0,
+	kInstTypeDirect    =  1,
+	kInstTypeInt       =  3,
+	kInstTypeFloat     =  4,
+	kInstTypeString    =  5,
+	kInstTypeObject    =  6,
+	kInstTypeEffect    = 16,
+	kInstTypeEvent     = 17,
+	kInstTypeLocation  = 18,
+	kInstTypeTalent    = 19,
+
+	// Binary
+	kInstTypeIntInt           = 32,
+	kInstTypeFloatFloat       = 33,
+	kInstTypeObjectObject     = 34,
+	kInstTypeStringString     = 35,
+	kInstTypeStructStruct     = 36,
+	kInstTypeIntFloat         = 37,
+	kInstTypeFloatInt         = 38,
+	kInstTypeEffectEffect     = 48,
+	kInstTypeEventEvent       = 49,
+	kInstTypeLocationLocation = 50,
+	kInstTypeTalentTalent     = 51,
+	kInstTypeVectorVector     = 58,
+	kInstTypeVectorFloat      = 59,
+	kInstTypeFloatVector      = 60
+};
+
+/** An NCS instruction, decoded at load time. */
+struct NCSInstruction {
+	uint32 address; ///< Offset of the instruction within the NCS.
+
+	uint8 opcode;
+	uint8 type;
+
+	int32 args[3]; ///< The instruction's direct arguments.
+
+	/** For jumps, the index of the destination instruction. */
+	uint32 target;
+
+	/** For CONST, the value of the constant. */
+	Variable constant;
+
+	/** Does a basic block start with this instruction?
+	 *
+	 *  That is the case for the first instruction, every jump target, every
+	 *  instruction following a jump or a return, and every instruction a
+	 *  stored script state resumes execution at.
+	 */
+	bool blockStart;
+
+	/** The stack depth before this instruction, in variables.
+	 *
+	 *  Relative to the start of the subroutine the instruction belongs to.
+	 *  kNCSUnknownDepth if the analysis couldn't follow the instruction.
+	 */
+	int32 stackDepth;
+
+	/** The superinstruction starting with this instruction, if any. */
+	uint8 superOpcode;
+	/** The number of instructions the superinstruction covers. */
+	uint8 superLength;
+
+	NCSInstruction();
 };
 
+static const uint32 kNCSInvalidTarget = 0xFFFFFFFF;
+static const int32  kNCSUnknownDepth  = (int32) 0x80000000;
+
+/** The most variables an engine function call superinstruction copies. */
+static const uint32 kNCSMaxFusedArguments = 16;
+
+/** The immutable part of an NCS: its validated bytecode.
+ *
+ *  A program can be shared by any number of NCSFile instances, each of which
+ *  only holds the state of one execution.
+ *
+ *  When loading, the bytecode is decoded into a list of instructions, with
+ *  all their arguments read and all jump targets resolved, so that executing
+ *  the program never needs to go back to the raw bytecode.
+ */
+class NCSProgram : public AuroraBase, Common::NonCopyable {
+public:
+	NCSProgram(Common::SeekableReadStream &ncs);
+	~NCSProgram();
+
+	/** Return the bytecode, including the header. */
+	const byte *getData() const;
+	/** Return the size of the bytecode in bytes. */
+	uint32 getSize() const;
+
+	/** Return the decoded instructions. */
+	const std::vector<NCSInstruction> &getInstructions() const;
+
+	/** Return the index of the instruction at this offset.
+	 *
+	 *  The end of the script maps onto the number of instructions. Any other
+	 *  offset not at the start of an instruction yields kNCSInvalidTarget.
+	 */
+	uint32 findInstruction(uint32 address) const;
+
+	/** Return the maximum number of variables the stack ever holds.
+	 *
+	 *  If the analysis failed to determine it, because the program calls
+	 *  unknown engine functions or is recursive, for example, this returns 0.
+	 */
+	uint32 getMaxStackDepth() const;
+
+	/** Disassemble the program, one line per instruction.
+	 *
+	 *  Besides the instructions themselves, the listing shows the basic
+	 *  blocks, the stack depths and the superinstructions.
+	 */
+	void disassemble(std::vector<Common::UString> &lines) const;
+
+	/** Return the name of an opcode. */
+	static const char *getOpcodeName(uint8 opcode);
+	/** Return the name of a superinstruction. */
+	static const char *getSuperOpcodeName(uint8 superOpcode);
+
+private:
+	/** The stack effects of a subroutine. */
+	struct Subroutine {
+		bool analyzed; ///< Has the analysis finished?
+		bool valid;    ///< Was the analysis successful?
+
+		int32 returnDepth; ///< The stack depth when returning.
+		int32 maxDepth;    ///< The maximum stack depth.
+
+		Subroutine();
+	};
+
+	typedef std::map<uint32, Subroutine> SubroutineMap;
+
+	byte  *_data;
+	uint32 _size;
+
+	std::vector<NCSInstruction> _instructions;
+
+	uint32 _maxStackDepth;
+
+	void load(Common::SeekableReadStream &ncs);
+
+	void decode();
+	bool decodeInstruction(Common::SeekableReadStream &ncs, NCSInstruction &instr);
+
+	/** Mark the instructions that start basic blocks. */
+	void findBasicBlocks();
+
+	/** Find the maximum stack depth of the whole program. */
+	void analyzeStackDepth();
+	/** Follow the code starting at this instruction, recording the stack depths. */
+	bool analyzeCode(uint32 entry, int32 depth, SubroutineMap &subroutines,
+	                 int32 &returnDepth, int32 &maxDepth);
+	/** Analyze the subroutine starting at this instruction, if not already done. */
+	const Subroutine &analyzeSubroutine(uint32 entry, SubroutineMap &subroutines);
+	/** Return by how much an instruction changes the stack depth. */
+	bool getStackEffect(const NCSInstruction &instr, int32 &effect) const;
+
+	/** Fuse common instruction sequences into superinstructions. */
+	void fuse();
+	/** Return the length of the superinstruction that can start at this instruction. */
+	uint8 findSuperInstruction(uint32 index, SuperOpcode &superOpcode) const;
+	/** Are the instructions following this one, up to this length, all inside the same basic block? */
+	bool isInBlock(uint32 index, uint32 length) const;
+};
+
+typedef boost::shared_ptr<const NCSProgram> NCSProgramPtr;
+
 #define DECLARE_OPCODE(x) void x(InstructionType type)
 
 /** An NCS, BioWare's NWN Compile Script. */
-class NCSFile : public AuroraBase {
+class NCSFile : public AuroraBase, Common::NonCopyable {
 public:
 	NCSFile(Common::SeekableReadStream *ncs);
 	NCSFile(const Common::UString &ncs);
+	NCSFile(const Common::UString &name, const NCSProgramPtr &program);
 	~NCSFile();
 
 	const Common::UString &getName() const;
@@ -99,75 +370,108 @@ public:
 	/** Run the current script, from this state to finish. */
 	const Variable &run(const ScriptState &state, Object *owner = 0, Object *triggerer = 0);
 
+	/** Prepare running the script from this state, without executing anything yet.
+	 *
+	 *  The script is then executed piecemeal by calling resume(), which makes
+	 *  it possible to spread the execution of a long script over several frames.
+	 */
+	void start(const ScriptState &state, Object *owner = 0, Object *triggerer = 0);
+
+	/** Continue running a started script, for at most this many instructions.
+	 *
+	 *  The script is only ever suspended between two instructions. Engine
+	 *  functions, including nested scripts run by them, always run to completion.
+	 *
+	 *  @return true if the script has finished.
+	 */
+	bool resume(uint32 maxSteps);
+
+	/** Has the script been started, and not yet finished? */
+	bool isRunning() const;
+
+	/** Return the value the last finished run of the script returned. */
+	const Variable &getReturn() const;
+
+	/** Execute superinstructions in place of the sequences they fuse? Enabled by default. */
+	void setFusion(bool fusion);
+
 	static ScriptState getEmptyState();
 
 private:
-	enum InstructionType {
-		// Unary
-		kInstTypeNone      =  0,
-		kInstTypeDirect    =  1,
-		kInstTypeInt       =  3,
-		kInstTypeFloat     =  4,
-		kInstTypeString    =  5,
-		kInstTypeObject    =  6,
-		kInstTypeEffect    = 16,
-		kInstTypeEvent     = 17,
-		kInstTypeLocation  = 18,
-		kInstTypeTalent    = 19,
-
-		// Binary
-		kInstTypeIntInt           = 32,
-		kInstTypeFloatFloat       = 33,
-		kInstTypeObjectObject     = 34,
-		kInstTypeStringString     = 35,
-		kInstTypeStructStruct     = 36,
-		kInstTypeIntFloat         = 37,
-		kInstTypeFloatInt         = 38,
-		kInstTypeEffectEffect     = 48,
-		kInstTypeEventEvent       = 49,
-		kInstTypeLocationLocation = 50,
-		kInstTypeTalentTalent     = 51,
-		kInstTypeVectorVector     = 58,
-		kInstTypeVectorFloat      = 59,
-		kInstTypeFloatVector      = 60
-	};
-
 	Common::UString _name;
 
+	NCSProgramPtr _program;
+
 	NCSStack _stack;
-	Common::SeekableReadStream *_script;
+
+	uint32 _pc; ///< Index of the next instruction to execute.
+	const NCSInstruction *_instr; ///< The instruction currently executing.
 
 	Variable _return;
 
+	bool _running; ///< Has the script been started, and not yet finished?
+	bool _resumed; ///< Has the running script already been suspended once?
+
+	bool _fusion; ///< Execute superinstructions?
+
 	Object *_owner;
 	Object *_triggerer;
 
-	std::stack<uint32> _returnOffsets;
+	std::stack<uint32> _returnOffsets; ///< Instruction indices to return to.
 
 	Variable _storedState;
 
+	/** Contexts for engine function calls, reused for every call at the same depth. */
+	std::vector<FunctionContext *> _contexts;
+	uint32 _contextDepth; ///< The number of engine function calls currently running.
+
+	/** Stack indices of the arguments an engine function call superinstruction copies. */
+	int32 _arguments[kNCSMaxFusedArguments];
+	uint32 _argumentCount; ///< The number of copied arguments not yet taken.
+	Variable _argument;    ///< Scratch space for taking vector arguments off the stack.
+
 	typedef void (NCSFile::*OpcodeProc)(InstructionType type);
-	struct Opcode {
+	struct OpcodeDesc {
 		OpcodeProc proc;
 		const char *desc;
 	};
-	const Opcode *_opcodes;
-	uint32 _opcodeListSize;
+	const OpcodeDesc *_opcodes;
 	void setupOpcodes();
 
+	typedef void (NCSFile::*SuperOpcodeProc)();
+	struct SuperOpcodeDesc {
+		SuperOpcodeProc proc;
+		const char *desc;
+	};
+	const SuperOpcodeDesc *_superOpcodes;
+
 	void load();
 
 	/** Reset the script for another execution. */
 	void reset();
 
-	const Variable &execute(Object *owner = 0, Object *triggerer = 0);
+	/** Execute at most maxSteps script steps, counting the executed steps. */
+	void executeSteps(uint32 maxSteps, uint32 &steps);
+
+	/** The script ended, normally or abnormally. */
+	void finish();
 
 	/** Execute one script step. */
 	void executeStep();
+	/** Execute one superinstruction, covering several script steps. */
+	void executeSuperStep();
+
+	/** Continue execution at the current instruction's jump target. */
+	void jump();
+
+	/** Get a context for an engine function call, to be released after the call. */
+	FunctionContext &acquireContext();
+	void releaseContext();
 
-	void decompile(); // TODO
+	void callEngine(FunctionContext &ctx, uint32 function, const Function &func, uint8 argCount);
 
-	void callEngine(Aurora::NWScript::FunctionContext &ctx, uint32 function, uint8 argCount);
+	/** Take the next argument of an engine function call off the stack. */
+	void popArgument(Variable &arg);
 
 	// Opcode declarations
 	DECLARE_OPCODE(o_nop);
@@ -215,6 +519,18 @@ private:
 	DECLARE_OPCODE(o_savebp);
 	DECLARE_OPCODE(o_restorebp);
 	DECLARE_OPCODE(o_storestate);
+	DECLARE_OPCODE(o_illegal);
+	DECLARE_OPCODE(o_truncated);
+
+	// Superinstructions
+	bool compareConst();
+
+	void s_compareconst();
+	void s_compareconstjump();
+	void s_pushconst();
+	void s_popstoresp();
+	void s_popstorebp();
+	void s_action();
 };
 
 #undef DECLARE_OPCODE
@@ -36,7 +36,7 @@ namespace Aurora {
 
 namespace NWScript {
 
-Object::Object() : _id(kObjectIDInvalid), _objectContainer(0) {
+Object::Object() : _id(kObjectIDInvalid), _objectContainer(0), _objectContainerTag(0) {
 }
 
 Object::~Object() {
@@ -31,6 +31,9 @@
 #define AURORA_NWSCRIPT_OBJECT_H
 
 #include <map>
+#include <vector>
+
+#include <boost/unordered/unordered_map.hpp>
 
 #include "common/types.h"
 #include "common/ustring.h"
@@ -44,7 +47,10 @@ namespace NWScript {
 class ObjectContainer;
 
 typedef std::map<uint32, class Object *> ObjectIDMap;
-typedef std::multimap<Common::UString, class Object *> ObjectTagMap;
+typedef std::vector<class Object *> ObjectList;
+typedef boost::unordered_map<Common::UString, ObjectList,
+                             Common::hashUStringCaseInsensitive,
+                             Common::UString::iequal> ObjectTagMap;
 
 class Object : public VariableContainer {
 public:
@@ -64,7 +70,7 @@ protected:
 
 private:
 	ObjectContainer *_objectContainer;
-	ObjectTagMap::iterator _objectContainerTag;
+	ObjectList *_objectContainerTag; ///< The objects in the container sharing our tag.
 
 	friend class ObjectContainer;
 };
@@ -27,6 +27,8 @@
  *  An NWScript object container.
  */
 
+#include <algorithm>
+
 #include "common/error.h"
 
 #include "aurora/types.h"
@@ -37,7 +39,13 @@ namespace Aurora {
 
 namespace NWScript {
 
-ObjectContainer::SearchContext::SearchContext() : _empty(true), _object(0) {
+static bool compareObjectID(uint32 id, const Object *object) {
+	return id < object->getID();
+}
+
+
+ObjectContainer::SearchContext::SearchContext() : _empty(true), _object(0),
+	_all(true), _lastID(0), _revision(0), _list(0), _position(0) {
 }
 
 ObjectContainer::SearchContext::~SearchContext() {
@@ -48,70 +56,139 @@ Object *ObjectContainer::SearchContext::getObject() const {
 }
 
 
-ObjectContainer::ObjectContainer() : _currentID(0) {
+ObjectContainer::ObjectContainer() : _currentID(0), _revision(0) {
 }
 
 ObjectContainer::~ObjectContainer() {
 }
 
 void ObjectContainer::addObject(Object &obj) {
-	Common::StackLock lock(_mutex);
+	Common::StackWriteLock lock(_lock);
 
-	removeObject(obj);
+	removeObjectLocked(obj);
 
 	obj._id = ++_currentID;
 
+	// IDs only ever go up, so the tag lists stay sorted by ID
+	ObjectList &list = _objectTags[obj.getTag()];
+	list.push_back(&obj);
+
+	_objects.insert(std::make_pair(obj._id, &obj));
+
 	obj._objectContainer    = this;
-	obj._objectContainerTag = _objects.insert(std::make_pair(obj.getTag(), &obj));
+	obj._objectContainerTag = &list;
+
+	_revision++;
 }
 
 void ObjectContainer::removeObject(Object &obj) {
-	Common::StackLock lock(_mutex);
+	Common::StackWriteLock lock(_lock);
 
+	removeObjectLocked(obj);
+}
+
+void ObjectContainer::removeObjectLocked(Object &obj) {
 	if (!obj._objectContainer)
 		return;
 
+	ObjectList &list = *obj._objectContainerTag;
+
+	ObjectList::iterator o = std::find(list.begin(), list.end(), &obj);
+	if (o != list.end())
+		list.erase(o);
+
+	// The (possibly empty) tag list itself is kept, so that pointers to it stay valid
+
+	_objects.erase(obj._id);
+
 	obj._id = kObjectIDInvalid;
 
-	obj._objectContainer = 0;
+	obj._objectContainer    = 0;
+	obj._objectContainerTag = 0;
 
-	_objects.erase(obj._objectContainerTag);
-	obj._objectContainerTag = _objects.end();
+	_revision++;
 }
 
 bool ObjectContainer::findObjectInit(SearchContext &ctx) const {
-	ctx._object = 0;
-	ctx._tag    = "";
-	ctx._range  = std::make_pair(_objects.begin(), _objects.end());
-	ctx._empty  = ctx._range.first == ctx._range.second;
+	Common::StackReadLock lock(_lock);
+
+	ctx._object   = 0;
+	ctx._tag      = "";
+	ctx._all      = true;
+	ctx._lastID   = 0;
+	ctx._revision = _revision;
+	ctx._list     = 0;
+	ctx._position = 0;
+	ctx._next     = _objects.begin();
+	ctx._empty    = _objects.empty();
 
 	return !ctx._empty;
 }
 
 bool ObjectContainer::findObjectInit(SearchContext &ctx, const Common::UString &tag) const {
-	ctx._object = 0;
-	ctx._tag    = tag;
-	ctx._range  = _objects.equal_range(tag);
-	ctx._empty  = ctx._range.first == ctx._range.second;
+	Common::StackReadLock lock(_lock);
+
+	ObjectTagMap::const_iterator list = _objectTags.find(tag);
+
+	ctx._object   = 0;
+	ctx._tag      = tag;
+	ctx._all      = false;
+	ctx._lastID   = 0;
+	ctx._revision = _revision;
+	ctx._list     = (list != _objectTags.end()) ? &list->second : 0;
+	ctx._position = 0;
+	ctx._empty    = !ctx._list || ctx._list->empty();
 
 	return !ctx._empty;
 }
 
 Object *ObjectContainer::findNextObject(SearchContext &ctx) const {
-	if (ctx._empty || (ctx._range.first == ctx._range.second)) {
-		ctx._empty  = true;
-		ctx._object = 0;
-		return 0;
-	}
+	Common::StackReadLock lock(_lock);
+
+	if (!ctx._empty && (ctx._revision != _revision))
+		updateContext(ctx);
+
+	if (ctx._all) {
+		if (ctx._empty || (ctx._next == _objects.end())) {
+			ctx._empty  = true;
+			ctx._object = 0;
+			return 0;
+		}
 
-	ctx._object = ctx._range.first->second;
+		ctx._object = ctx._next->second;
+
+		++ctx._next;
+
+	} else {
+		if (ctx._empty || (ctx._position >= ctx._list->size())) {
+			ctx._empty  = true;
+			ctx._object = 0;
+			return 0;
+		}
+
+		ctx._object = (*ctx._list)[ctx._position++];
+	}
 
-	++ctx._range.first;
+	ctx._lastID = ctx._object->getID();
 
 	return ctx._object;
 }
 
+void ObjectContainer::updateContext(SearchContext &ctx) const {
+	// Continue with the first object added after the last one we found
+
+	if (ctx._all) {
+		ctx._next = _objects.upper_bound(ctx._lastID);
+	} else
+		ctx._position = std::upper_bound(ctx._list->begin(), ctx._list->end(),
+		                                 ctx._lastID, compareObjectID) - ctx._list->begin();
+
+	ctx._revision = _revision;
+}
+
 Object *ObjectContainer::findObject() const {
+	Common::StackReadLock lock(_lock);
+
 	if (_objects.empty())
 		return 0;
 
@@ -119,10 +196,13 @@ Object *ObjectContainer::findObject() const {
 }
 
 Object *ObjectContainer::findObject(const Common::UString &tag) const {
-	SearchContext ctx;
-	findObjectInit(ctx, tag);
+	Common::StackReadLock lock(_lock);
+
+	ObjectTagMap::const_iterator list = _objectTags.find(tag);
+	if ((list == _objectTags.end()) || list->second.empty())
+		return 0;
 
-	return findNextObject(ctx);
+	return list->second.front();
 }
 
 } // End of namespace NWScript
@@ -38,6 +38,15 @@ namespace Aurora {
 
 namespace NWScript {
 
+/** A container of NWScript objects.
+ *
+ *  Objects are indexed by their ID and, case-insensitively, by their tag.
+ *  Objects sharing a tag are found in the order they were added.
+ *
+ *  Searching is guarded by a read lock, so that several threads can search
+ *  the same container at once. Search contexts stay valid when objects are
+ *  added or removed during a search.
+ */
 class ObjectContainer {
 public:
 	class SearchContext {
@@ -51,7 +60,15 @@ public:
 		bool _empty;
 		Object *_object;
 		Common::UString _tag;
-		std::pair<ObjectTagMap::const_iterator, ObjectTagMap::const_iterator> _range;
+
+		bool   _all;      ///< Are we looking at all objects, regardless of tag?
+		uint32 _lastID;   ///< ID of the last object found.
+		uint32 _revision; ///< Revision of the container when the position was found.
+
+		const ObjectList *_list;     ///< The objects with the tag we're looking for.
+		size_t            _position; ///< Position of the next object in _list.
+
+		ObjectIDMap::const_iterator _next; ///< The next object when looking at all objects.
 
 		friend class ObjectContainer;
 	};
@@ -78,11 +95,18 @@ public:
 	Object *findObject(const Common::UString &tag) const;
 
 private:
-	Common::Mutex _mutex;
+	mutable Common::ReadWriteLock _lock;
 
 	uint32 _currentID;
+	uint32 _revision; ///< Changes whenever an object is added or removed.
+
+	ObjectIDMap  _objects;    ///< All objects, by ID.
+	ObjectTagMap _objectTags; ///< All objects, by tag.
+
+	void removeObjectLocked(Object &obj);
 
-	ObjectTagMap _objects;
+	/** Restore the search position after the container changed. */
+	void updateContext(SearchContext &ctx) const;
 };
 
 } // End of namespace NWScript
@@ -0,0 +1,213 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/profiler.cpp
+ *  A profiler for NWScript scripts and engine functions.
+ */
+
+#include <algorithm>
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/file.h"
+
+#include "aurora/nwscript/profiler.h"
+#include "aurora/nwscript/allocations.h"
+
+DECLARE_SINGLETON(Aurora::NWScript::ScriptProfiler)
+
+namespace Aurora {
+
+namespace NWScript {
+
+static bool compareTotalTime(const ScriptProfiler::Stats &a, const ScriptProfiler::Stats &b) {
+	return a.totalTime > b.totalTime;
+}
+
+static void resetStats(ScriptProfiler::Stats &stats) {
+	stats.calls        = 0;
+	stats.instructions = 0;
+	stats.totalTime    = 0;
+	stats.selfTime     = 0;
+	stats.allocations  = 0;
+}
+
+
+ScriptProfiler::Stats::Stats(const Common::UString &n) : name(n), calls(0), instructions(0),
+	totalTime(0), selfTime(0), allocations(0) {
+
+}
+
+
+ScriptProfiler::ScriptProfiler() : _enabled(false) {
+}
+
+ScriptProfiler::~ScriptProfiler() {
+}
+
+void ScriptProfiler::setEnabled(bool enabled) {
+	_enabled = enabled;
+}
+
+void ScriptProfiler::clear() {
+	// Scripts currently running still point to their statistics, so we can't remove them
+
+	for (ScriptMap::iterator s = _scripts.begin(); s != _scripts.end(); ++s)
+		resetStats(s->second);
+	for (FunctionMap::iterator f = _functions.begin(); f != _functions.end(); ++f)
+		resetStats(f->second);
+}
+
+void ScriptProfiler::enterScript(const Common::UString &name, bool resumed) {
+	ScriptMap::iterator script = _scripts.find(name);
+	if (script == _scripts.end())
+		script = _scripts.insert(std::make_pair(name, Stats(name))).first;
+
+	enter(script->second, !resumed);
+}
+
+void ScriptProfiler::leaveScript(uint64 instructions) {
+	if (_frames.empty())
+		return;
+
+	_frames.back().stats->instructions += instructions;
+
+	leave();
+}
+
+void ScriptProfiler::enterFunction(uint32 id, const Common::UString &name) {
+	FunctionMap::iterator function = _functions.find(id);
+	if (function == _functions.end())
+		function = _functions.insert(std::make_pair(id, Stats(name))).first;
+
+	enter(function->second);
+}
+
+void ScriptProfiler::leaveFunction() {
+	leave();
+}
+
+void ScriptProfiler::enter(Stats &stats, bool newCall) {
+	if (newCall)
+		stats.calls++;
+
+	_frames.push_back(Frame());
+
+	Frame &frame = _frames.back();
+
+	frame.stats       = &stats;
+	frame.childTime   = 0;
+	frame.allocations = getAllocationCount();
+	frame.start       = getMicroseconds();
+}
+
+void ScriptProfiler::leave() {
+	if (_frames.empty())
+		return;
+
+	const uint64 now = getMicroseconds();
+
+	const Frame &frame = _frames.back();
+
+	const uint64 time = now - frame.start;
+
+	frame.stats->totalTime   += time;
+	frame.stats->selfTime    += time - MIN(time, frame.childTime);
+	frame.stats->allocations += getAllocationCount() - frame.allocations;
+
+	_frames.pop_back();
+
+	if (!_frames.empty())
+		_frames.back().childTime += time;
+}
+
+void ScriptProfiler::getScriptStats(std::vector<Stats> &stats) const {
+	stats.clear();
+	stats.reserve(_scripts.size());
+
+	for (ScriptMap::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s)
+		if (s->second.calls > 0)
+			stats.push_back(s->second);
+
+	std::sort(stats.begin(), stats.end(), compareTotalTime);
+}
+
+void ScriptProfiler::getFunctionStats(std::vector<Stats> &stats) const {
+	stats.clear();
+	stats.reserve(_functions.size());
+
+	for (FunctionMap::const_iterator f = _functions.begin(); f != _functions.end(); ++f)
+		if (f->second.calls > 0)
+			stats.push_back(f->second);
+
+	std::sort(stats.begin(), stats.end(), compareTotalTime);
+}
+
+static void writeStats(Common::DumpFile &file, const char *type,
+                       const std::vector<ScriptProfiler::Stats> &stats) {
+
+	// Without an allocation counter, leave the allocations empty instead of claiming 0
+	const bool allocations = hasAllocationCounter();
+
+	for (std::vector<ScriptProfiler::Stats>::const_iterator s = stats.begin(); s != stats.end(); ++s) {
+		Common::UString line = Common::UString::sprintf("%s,\"%s\",%llu,%llu,%llu,%llu,", type,
+		                       s->name.c_str(), (unsigned long long) s->calls,
+		                       (unsigned long long) s->instructions, (unsigned long long) s->totalTime,
+		                       (unsigned long long) s->selfTime);
+
+		if (allocations)
+			line += Common::UString::sprintf("%llu", (unsigned long long) s->allocations);
+
+		file.writeString(line + "\n");
+	}
+}
+
+void ScriptProfiler::dumpCSV(const Common::UString &fileName) const {
+	Common::DumpFile file;
+
+	if (!file.open(fileName))
+		throw Common::Exception(Common::kOpenError);
+
+	file.writeString("type,name,calls,instructions,total_us,self_us,allocations\n");
+
+	std::vector<Stats> stats;
+
+	getScriptStats(stats);
+	writeStats(file, "script", stats);
+
+	getFunctionStats(stats);
+	writeStats(file, "function", stats);
+
+	file.flush();
+
+	if (file.err())
+		throw Common::Exception("Write error");
+
+	file.close();
+}
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
@@ -0,0 +1,137 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/profiler.h
+ *  A profiler for NWScript scripts and engine functions.
+ */
+
+#ifndef AURORA_NWSCRIPT_PROFILER_H
+#define AURORA_NWSCRIPT_PROFILER_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/singleton.h"
+
+namespace Aurora {
+
+namespace NWScript {
+
+/** Collects execution statistics of scripts and engine functions.
+ *
+ *  For each script (by resref) and each engine function (by routine
+ *  number), the profiler counts the number of calls, the instructions
+ *  executed, the wall time spent and the heap allocations made. Heap
+ *  allocations are only counted when the program installed an allocation
+ *  counter, see setAllocationCounter().
+ *
+ *  The total time and allocations of a call include everything it
+ *  called in turn, so a script calling ExecuteScript() is charged for the
+ *  executed script as well. The self time leaves out time spent in
+ *  nested calls.
+ *
+ *  When disabled, the only overhead is a check of isEnabled() once per
+ *  script run and engine function call.
+ */
+class ScriptProfiler : public Common::Singleton<ScriptProfiler> {
+public:
+	/** The statistics of one script or engine function. */
+	struct Stats {
+		Common::UString name;
+
+		uint64 calls;        ///< Number of times it was called.
+		uint64 instructions; ///< Number of script instructions executed, excluding nested scripts.
+		uint64 totalTime;    ///< Wall time spent, in microseconds.
+		uint64 selfTime;     ///< Wall time spent, in microseconds, excluding nested calls.
+		uint64 allocations;  ///< Number of heap allocations made.
+
+		Stats(const Common::UString &n = "");
+	};
+
+	ScriptProfiler();
+	~ScriptProfiler();
+
+	/** Enable or disable collecting statistics. */
+	void setEnabled(bool enabled);
+
+	bool isEnabled() const {
+		return _enabled;
+	}
+
+	/** Throw away all collected statistics. */
+	void clear();
+
+	/** A script starts running, or, if resumed, continues running after a suspension. */
+	void enterScript(const Common::UString &name, bool resumed = false);
+	/** The currently profiled script finished running, after this many instructions. */
+	void leaveScript(uint64 instructions);
+
+	/** An engine function is called. */
+	void enterFunction(uint32 id, const Common::UString &name);
+	/** The currently profiled engine function returned. */
+	void leaveFunction();
+
+	/** Get the statistics of all scripts, sorted by total time. */
+	void getScriptStats(std::vector<Stats> &stats) const;
+	/** Get the statistics of all engine functions, sorted by total time. */
+	void getFunctionStats(std::vector<Stats> &stats) const;
+
+	/** Write all statistics into a CSV file. */
+	void dumpCSV(const Common::UString &fileName) const;
+
+private:
+	typedef std::map<Common::UString, Stats, Common::UString::iless> ScriptMap;
+	typedef std::map<uint32, Stats> FunctionMap;
+
+	/** A currently running script or function. */
+	struct Frame {
+		Stats *stats;
+
+		uint64 start;       ///< Timestamp when the call started.
+		uint64 childTime;   ///< Time spent in nested calls.
+		uint64 allocations; ///< Allocation count when the call started.
+	};
+
+	bool _enabled;
+
+	ScriptMap   _scripts;
+	FunctionMap _functions;
+
+	std::vector<Frame> _frames;
+
+	void enter(Stats &stats, bool newCall = true);
+	void leave();
+};
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
+
+/** Shortcut for accessing the script profiler. */
+#define ScriptProf Aurora::NWScript::ScriptProfiler::instance()
+
+#endif // AURORA_NWSCRIPT_PROFILER_H
@@ -0,0 +1,174 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/scheduler.cpp
+ *  A scheduler running scripts in time slices.
+ */
+
+#include <cassert>
+
+#include "common/util.h"
+#include "common/error.h"
+
+#include "aurora/nwscript/scheduler.h"
+#include "aurora/nwscript/ncsfile.h"
+
+/** Number of instructions to execute between checks of the budget. */
+static const uint32 kSliceSize = 256;
+
+DECLARE_SINGLETON(Aurora::NWScript::ScriptScheduler)
+
+namespace Aurora {
+
+namespace NWScript {
+
+ScriptScheduler::ScriptScheduler() : _budget(0), _suspensions(0) {
+}
+
+ScriptScheduler::~ScriptScheduler() {
+	clear();
+}
+
+void ScriptScheduler::setBudget(uint32 budget) {
+	_budget = budget;
+}
+
+uint32 ScriptScheduler::getBudget() const {
+	return _budget;
+}
+
+void ScriptScheduler::schedule(const Common::UString &script, Object *owner, Object *triggerer,
+                               ScriptPriority priority) {
+
+	schedule(script, NCSFile::getEmptyState(), owner, triggerer, priority);
+}
+
+void ScriptScheduler::schedule(const Common::UString &script, const ScriptState &state,
+                               Object *owner, Object *triggerer, ScriptPriority priority) {
+
+	if (script.empty())
+		return;
+
+	assert((priority >= 0) && (priority < kScriptPriorityMAX));
+
+	NCSFile *ncs = 0;
+
+	try {
+		ncs = new NCSFile(script);
+
+		ncs->start(state, owner, triggerer);
+
+	} catch (Common::Exception &e) {
+		delete ncs;
+
+		e.add("Failed running script \"%s\"", script.c_str());
+		Common::printException(e, "WARNING: ");
+		return;
+	}
+
+	_scripts[priority].push_back(ncs);
+}
+
+void ScriptScheduler::run() {
+	const uint64 start = getMicroseconds();
+
+	bool ranSlice = false;
+	for (int i = 0; i < kScriptPriorityMAX; i++) {
+		ScriptList &scripts = _scripts[i];
+
+		while (!scripts.empty()) {
+			// Always run at least one slice, so that we make progress
+			if (ranSlice && (_budget > 0) && ((getMicroseconds() - start) >= _budget)) {
+				_suspensions++;
+				return;
+			}
+
+			NCSFile *script = scripts.front();
+
+			ranSlice = true;
+			if (!runSlice(*script, kSliceSize))
+				continue;
+
+			// The script may have scheduled new ones, but it's still at the front
+			scripts.pop_front();
+			delete script;
+		}
+	}
+}
+
+void ScriptScheduler::finish() {
+	// Finishing scripts might schedule new ones, of any priority
+	while (getPending() > 0) {
+		for (int i = 0; i < kScriptPriorityMAX; i++) {
+			ScriptList &scripts = _scripts[i];
+
+			while (!scripts.empty()) {
+				NCSFile *script = scripts.front();
+
+				runSlice(*script, 0xFFFFFFFF);
+
+				scripts.pop_front();
+				delete script;
+			}
+		}
+	}
+}
+
+void ScriptScheduler::clear() {
+	for (int i = 0; i < kScriptPriorityMAX; i++) {
+		for (ScriptList::iterator s = _scripts[i].begin(); s != _scripts[i].end(); ++s)
+			delete *s;
+
+		_scripts[i].clear();
+	}
+}
+
+uint32 ScriptScheduler::getPending() const {
+	uint32 pending = 0;
+	for (int i = 0; i < kScriptPriorityMAX; i++)
+		pending += _scripts[i].size();
+
+	return pending;
+}
+
+uint32 ScriptScheduler::getSuspensions() const {
+	return _suspensions;
+}
+
+bool ScriptScheduler::runSlice(NCSFile &script, uint32 maxSteps) {
+	try {
+		return script.resume(maxSteps);
+	} catch (Common::Exception &e) {
+		e.add("Failed running script \"%s\"", script.getName().c_str());
+		Common::printException(e, "WARNING: ");
+	}
+
+	// A script that failed has finished, too
+	return true;
+}
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
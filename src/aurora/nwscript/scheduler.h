@@ -0,0 +1,125 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file aurora/nwscript/scheduler.h
+ *  A scheduler running scripts in time slices.
+ */
+
+#ifndef AURORA_NWSCRIPT_SCHEDULER_H
+#define AURORA_NWSCRIPT_SCHEDULER_H
+
+#include <list>
+
+#include "common/types.h"
+#include "common/ustring.h"
+#include "common/singleton.h"
+
+#include "aurora/nwscript/types.h"
+
+namespace Aurora {
+
+namespace NWScript {
+
+class Object;
+class NCSFile;
+struct ScriptState;
+
+/** The priority of a scheduled script. */
+enum ScriptPriority {
+	kScriptPriorityHigh   = 0, ///< Scripts reacting to the player.
+	kScriptPriorityNormal    , ///< Scripts reacting to other events, delayed commands.
+	kScriptPriorityLow       , ///< Periodic scripts, like heartbeats.
+	kScriptPriorityMAX
+};
+
+/** Runs scripts cooperatively, within a per-frame time budget.
+ *
+ *  Scripts whose return value isn't needed right away can be scheduled
+ *  instead of run directly. Once per frame, run() then executes the
+ *  scheduled scripts, highest priority first, in order of scheduling.
+ *
+ *  If the budget is used up, the currently running script is suspended
+ *  between two instructions and resumed in the next frame. This bounds the
+ *  time scripts can take away from a frame, except for single instructions
+ *  (especially engine functions) that take longer by themselves.
+ *
+ *  At least one slice of instructions is executed every frame, so scripts
+ *  always make progress. Low priority scripts, however, can be starved by
+ *  a constant flow of higher priority ones.
+ */
+class ScriptScheduler : public Common::Singleton<ScriptScheduler> {
+public:
+	ScriptScheduler();
+	~ScriptScheduler();
+
+	/** Set the time scripts may run each frame, in microseconds. 0 means unlimited. */
+	void setBudget(uint32 budget);
+	/** Return the time scripts may run each frame, in microseconds. */
+	uint32 getBudget() const;
+
+	/** Schedule a script to run from the start. */
+	void schedule(const Common::UString &script, Object *owner = 0, Object *triggerer = 0,
+	              ScriptPriority priority = kScriptPriorityNormal);
+	/** Schedule a script to run from this state. */
+	void schedule(const Common::UString &script, const ScriptState &state,
+	              Object *owner = 0, Object *triggerer = 0,
+	              ScriptPriority priority = kScriptPriorityNormal);
+
+	/** Run scheduled scripts until they are finished or the budget is used up. */
+	void run();
+
+	/** Run all scheduled scripts to completion, disregarding the budget. */
+	void finish();
+
+	/** Drop all scheduled scripts, without running them. */
+	void clear();
+
+	/** Return the number of scheduled scripts not yet finished. */
+	uint32 getPending() const;
+
+	/** Return the number of frames in which the budget ran out before all scripts finished. */
+	uint32 getSuspensions() const;
+
+private:
+	typedef std::list<NCSFile *> ScriptList;
+
+	uint32 _budget;
+
+	ScriptList _scripts[kScriptPriorityMAX];
+
+	uint32 _suspensions;
+
+	/** Run a slice of a script. Return true if the script has finished. */
+	bool runSlice(NCSFile &script, uint32 maxSteps);
+};
+
+} // End of namespace NWScript
+
+} // End of namespace Aurora
+
+/** Shortcut for accessing the script scheduler. */
+#define ScriptSchedMan Aurora::NWScript::ScriptScheduler::instance()
+
+#endif // AURORA_NWSCRIPT_SCHEDULER_H
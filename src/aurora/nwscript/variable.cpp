@@ -27,6 +27,9 @@
  *  NWScript variable.
  */
 
+#include <new>
+#include <algorithm>
+
 #include "common/error.h"
 
 #include "aurora/nwscript/variable.h"
@@ -36,6 +39,13 @@ namespace Aurora {
 
 namespace NWScript {
 
+Variable::SharedScriptState::SharedScriptState() : refCount(1) {
+}
+
+Variable::SharedScriptState::SharedScriptState(const ScriptState &s) : refCount(1), state(s) {
+}
+
+
 Variable::Variable(Type type) : _type(kTypeVoid) {
 	setType(type);
 }
@@ -87,20 +97,32 @@ Variable::Variable(const Variable &var) : _type(kTypeVoid) {
 }
 
 Variable::~Variable() {
-	setType(kTypeVoid);
+	destroy();
 }
 
-void Variable::setType(Type type) {
+Common::UString &Variable::string() {
+	return *reinterpret_cast<Common::UString *>(_value._string);
+}
+
+const Common::UString &Variable::string() const {
+	return *reinterpret_cast<const Common::UString *>(_value._string);
+}
+
+void Variable::destroy() {
 	if      (_type == kTypeString)
-		delete _value._string;
+		string().~UString();
 	else if (_type == kTypeEngineType)
 		delete _value._engineType;
-	else if (_type == kTypeScriptState)
+	else if ((_type == kTypeScriptState) && (--_value._scriptState->refCount == 0))
 		delete _value._scriptState;
 
-	_type = type;
+	_type = kTypeVoid;
+}
 
-	switch (_type) {
+void Variable::setType(Type type) {
+	destroy();
+
+	switch (type) {
 		case kTypeVoid:
 			break;
 
@@ -113,7 +135,7 @@ void Variable::setType(Type type) {
 			break;
 
 		case kTypeString:
-			_value._string = new Common::UString;
+			new (_value._string) Common::UString;
 			break;
 
 		case kTypeObject:
@@ -131,29 +153,49 @@ void Variable::setType(Type type) {
 			break;
 
 		case kTypeScriptState:
-			_value._scriptState = new ScriptState;
+			_value._scriptState = new SharedScriptState;
 			break;
 
 		default:
 			throw Common::Exception("Variable::setType(): Invalid type %d", type);
 			break;
 	}
+
+	_type = type;
 }
 
 Variable &Variable::operator=(const Variable &var) {
 	if (&var == this)
 		return *this;
 
-	setType(var._type);
+	if (var._type == kTypeString) {
+		// Reuse our string's memory, if we already have one
+		if (_type != kTypeString)
+			setType(kTypeString);
+
+		string() = var.string();
+
+	} else if (var._type == kTypeEngineType) {
+		setType(kTypeEngineType);
 
-	if      (_type == kTypeString)
-		*_value._string = *var._value._string;
-	else if (_type == kTypeEngineType)
 		*this = var._value._engineType;
-	else if (_type == kTypeScriptState)
-		*_value._scriptState = *var._value._scriptState;
-	else
+
+	} else if (var._type == kTypeScriptState) {
+		// Share the script state. It will be copied when modified
+		SharedScriptState *state = var._value._scriptState;
+		state->refCount++;
+
+		destroy();
+
+		_type = kTypeScriptState;
+		_value._scriptState = state;
+
+	} else {
+		destroy();
+
+		_type  = var._type;
 		_value = var._value;
+	}
 
 	return *this;
 }
@@ -180,7 +222,7 @@ Variable &Variable::operator=(const Common::UString &value) {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't assign a string value to a non-string variable");
 
-	*_value._string = value;
+	string() = value;
 
 	return *this;
 }
@@ -231,7 +273,7 @@ bool Variable::operator==(const Variable &var) const {
 			return _value._float == var._value._float;
 
 		case kTypeString:
-			return *_value._string == *var._value._string;
+			return string() == var.string();
 
 		case kTypeObject:
 			return _value._object == var._value._object;
@@ -274,14 +316,14 @@ const Common::UString &Variable::getString() const {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't get a string value from a non-string variable");
 
-	return *_value._string;
+	return string();
 }
 
 Common::UString &Variable::getString() {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't get a string value from a non-string variable");
 
-	return *_value._string;
+	return string();
 }
 
 Object *Variable::getObject() const {
@@ -320,14 +362,53 @@ ScriptState &Variable::getScriptState() {
 	if (_type != kTypeScriptState)
 		throw Common::Exception("Can't get a script state value from a non-script-state variable");
 
-	return *_value._scriptState;
+	// We're about to be modified, so we need our own copy
+	if (_value._scriptState->refCount > 1) {
+		SharedScriptState *state = new SharedScriptState(_value._scriptState->state);
+
+		_value._scriptState->refCount--;
+		_value._scriptState = state;
+	}
+
+	return _value._scriptState->state;
 }
 
 const ScriptState &Variable::getScriptState() const {
 	if (_type != kTypeScriptState)
 		throw Common::Exception("Can't get a script state value from a non-script-state variable");
 
-	return *_value._scriptState;
+	return _value._scriptState->state;
+}
+
+void Variable::swap(Variable &var) {
+	if (&var == this)
+		return;
+
+	if ((_type == kTypeString) && (var._type == kTypeString)) {
+		string().swap(var.string());
+		return;
+	}
+
+	if ((_type == kTypeString) || (var._type == kTypeString)) {
+		// Strings can't be moved bytewise, so construct a new one in the other variable
+		Variable &str   = (_type == kTypeString) ? *this : var;
+		Variable &other = (_type == kTypeString) ? var   : *this;
+
+		const Type type  = other._type;
+		const ValueUnion value = other._value;
+
+		new (other._value._string) Common::UString;
+		other._type = kTypeString;
+		other.string().swap(str.string());
+
+		str.string().~UString();
+		str._type  = type;
+		str._value = value;
+		return;
+	}
+
+	std::swap(_type , var._type);
+	std::swap(_value, var._value);
 }
 
 } // End of namespace NWScript
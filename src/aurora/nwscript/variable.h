@@ -52,6 +52,14 @@ struct ScriptState {
 	std::vector<class Variable> locals;
 };
 
+/** A NWScript variable.
+ *
+ *  Variables are copied around a lot while a script runs, so they are laid
+ *  out to make copying cheap: strings are stored in place (profiting from
+ *  std::string's small string storage) and script states are shared between
+ *  copies until one of them is modified. Copying any other type never
+ *  allocates memory.
+ */
 class Variable {
 public:
 	Variable(Type type = kTypeVoid);
@@ -94,18 +102,38 @@ public:
 	ScriptState &getScriptState();
 	const ScriptState &getScriptState() const;
 
+	/** Exchange the values of two variables, without copying them. */
+	void swap(Variable &var);
+
 private:
+	/** A script state, shared between variables. */
+	struct SharedScriptState {
+		uint32 refCount;
+		ScriptState state;
+
+		SharedScriptState();
+		SharedScriptState(const ScriptState &s);
+	};
+
 	Type _type;
 
-	union {
+	union ValueUnion {
 		int32 _int;
 		float _float;
-		Common::UString *_string;
 		Object *_object;
 		float _vector[3];
-		ScriptState *_scriptState;
+		SharedScriptState *_scriptState;
 		EngineType *_engineType;
+
+		/** Storage for a Common::UString, constructed in place. */
+		byte _string[sizeof(Common::UString)];
 	} _value;
+
+	Common::UString &string();
+	const Common::UString &string() const;
+
+	/** Free the current value and make the variable void. */
+	void destroy();
 };
 
 } // End of namespace NWScript
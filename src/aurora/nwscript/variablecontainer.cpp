@@ -27,6 +27,8 @@
  *  An NWScript variable container.
  */
 
+#include <cstring>
+
 #include "common/error.h"
 
 #include "aurora/nwscript/variablecontainer.h"
@@ -41,43 +43,203 @@ VariableContainer::VariableContainer() {
 VariableContainer::~VariableContainer() {
 }
 
+uint32 VariableContainer::hashName(const Common::UString &var) {
+	// FNV-1a over the raw UTF-8 string
+	uint32 hash = 2166136261U;
+
+	for (const char *c = var.c_str(); *c; c++)
+		hash = (hash ^ (byte) *c) * 16777619U;
+
+	return hash;
+}
+
+bool VariableContainer::equalNames(const Common::UString &var1, const Common::UString &var2) {
+	// Equal UTF-8 strings are equal byte for byte, no need to decode them
+	return (var1.size() == var2.size()) && (std::strcmp(var1.c_str(), var2.c_str()) == 0);
+}
+
+uint32 VariableContainer::findVariable(const Common::UString &var, uint32 hash) const {
+	if (_index.empty()) {
+		for (uint32 i = 0; i < _variables.size(); i++)
+			if ((_variables[i].hash == hash) && equalNames(_variables[i].name, var))
+				return i;
+
+		return kInvalidVariable;
+	}
+
+	const uint32 mask = _index.size() - 1;
+
+	for (uint32 slot = hash & mask; _index[slot] != kInvalidVariable; slot = (slot + 1) & mask) {
+		const Entry &entry = _variables[_index[slot]];
+
+		if ((entry.hash == hash) && equalNames(entry.name, var))
+			return _index[slot];
+	}
+
+	return kInvalidVariable;
+}
+
+uint32 VariableContainer::findSlot(uint32 variable) const {
+	const uint32 mask = _index.size() - 1;
+
+	uint32 slot = _variables[variable].hash & mask;
+	while (_index[slot] != variable)
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+uint32 VariableContainer::addVariable(const Common::UString &var, uint32 hash, Type type) {
+	const uint32 variable = _variables.size();
+
+	_variables.resize(variable + 1);
+
+	Entry &entry = _variables.back();
+
+	entry.hash = hash;
+	entry.name = var;
+	entry.value.setType(type);
+
+	if (_index.empty() && (_variables.size() <= kVariablesUnindexed))
+		return variable;
+
+	// Keep the hash table at most 3/4 full
+	if ((_variables.size() * 4) > (_index.size() * 3)) {
+		rebuildIndex();
+		return variable;
+	}
+
+	const uint32 mask = _index.size() - 1;
+
+	uint32 slot = hash & mask;
+	while (_index[slot] != kInvalidVariable)
+		slot = (slot + 1) & mask;
+
+	_index[slot] = variable;
+
+	return variable;
+}
+
+void VariableContainer::rebuildIndex() {
+	uint32 size = 16;
+	while (size < (_variables.size() * 2))
+		size <<= 1;
+
+	_index.assign(size, kInvalidVariable);
+
+	const uint32 mask = size - 1;
+
+	for (uint32 i = 0; i < _variables.size(); i++) {
+		uint32 slot = _variables[i].hash & mask;
+		while (_index[slot] != kInvalidVariable)
+			slot = (slot + 1) & mask;
+
+		_index[slot] = i;
+	}
+}
+
 bool VariableContainer::hasVariable(const Common::UString &var) const {
-	return _variables.find(var) != _variables.end();
+	return findVariable(var, hashName(var)) != kInvalidVariable;
 }
 
 Variable &VariableContainer::getVariable(const Common::UString &var, Type type) {
-	VariableMap::iterator v = _variables.find(var);
-	if ((v == _variables.end()) && (type != kTypeVoid)) {
-		std::pair<VariableMap::iterator, bool> result;
+	const uint32 hash = hashName(var);
 
-		result = _variables.insert(std::make_pair(var, Variable(type)));
+	uint32 variable = findVariable(var, hash);
+	if (variable == kInvalidVariable) {
+		if (type == kTypeVoid)
+			throw Common::Exception("VariableContainer::getVariable(): No such variable \"%s\"", var.c_str());
 
-		v = result.first;
+		variable = addVariable(var, hash, type);
 	}
 
-	return v->second;
+	return _variables[variable].value;
 }
 
 const Variable &VariableContainer::getVariable(const Common::UString &var) const {
-	VariableMap::const_iterator v = _variables.find(var);
-	if (v == _variables.end())
+	const uint32 variable = findVariable(var, hashName(var));
+	if (variable == kInvalidVariable)
 		throw Common::Exception("VariableContainer::getVariable(): No such variable \"%s\"", var.c_str());
 
-	return v->second;
+	return _variables[variable].value;
 }
 
 void VariableContainer::setVariable(const Common::UString &var, const Variable &value) {
-	_variables[var] = value;
+	const uint32 hash = hashName(var);
+
+	uint32 variable = findVariable(var, hash);
+	if (variable == kInvalidVariable)
+		variable = addVariable(var, hash, kTypeVoid);
+
+	_variables[variable].value = value;
 }
 
 void VariableContainer::removeVariable(const Common::UString &var) {
-	VariableMap::iterator v = _variables.find(var);
-	if (v != _variables.end())
-		_variables.erase(v);
+	const uint32 variable = findVariable(var, hashName(var));
+	if (variable == kInvalidVariable)
+		return;
+
+	const uint32 last = _variables.size() - 1;
+
+	if (!_index.empty()) {
+		const uint32 mask = _index.size() - 1;
+
+		/* Empty the variable's slot, and move following entries of the same
+		 * probe sequence back, so that they can still be found. */
+
+		uint32 hole = findSlot(variable);
+		for (uint32 next = (hole + 1) & mask; _index[next] != kInvalidVariable; next = (next + 1) & mask) {
+			const uint32 home = _variables[_index[next]].hash & mask;
+
+			const bool stays = (hole <= next) ? ((hole < home) && (home <= next)) :
+			                                    ((hole < home) || (home <= next));
+			if (stays)
+				continue;
+
+			_index[hole] = _index[next];
+			hole = next;
+		}
+
+		_index[hole] = kInvalidVariable;
+
+		if (variable != last)
+			_index[findSlot(last)] = variable;
+	}
+
+	// Fill the gap with the last variable
+	if (variable != last) {
+		Entry &entry = _variables[variable];
+		Entry &lastEntry = _variables[last];
+
+		entry.hash = lastEntry.hash;
+		entry.name.swap(lastEntry.name);
+		entry.value.swap(lastEntry.value);
+	}
+
+	_variables.pop_back();
 }
 
 void VariableContainer::clearVariables() {
 	_variables.clear();
+	_index.clear();
+}
+
+uint32 VariableContainer::getVariableCount() const {
+	return _variables.size();
+}
+
+const Common::UString &VariableContainer::getVariableName(uint32 n) const {
+	if (n >= _variables.size())
+		throw Common::Exception("VariableContainer::getVariableName(): Variable %d out of range", n);
+
+	return _variables[n].name;
+}
+
+const Variable &VariableContainer::getVariableValue(uint32 n) const {
+	if (n >= _variables.size())
+		throw Common::Exception("VariableContainer::getVariableValue(): Variable %d out of range", n);
+
+	return _variables[n].value;
 }
 
 } // End of namespace NWScript
@@ -30,8 +30,9 @@
 #ifndef AURORA_NWSCRIPT_VARIABLECONTAINER_H
 #define AURORA_NWSCRIPT_VARIABLECONTAINER_H
 
-#include <map>
+#include <vector>
 
+#include "common/types.h"
 #include "common/ustring.h"
 
 #include "aurora/nwscript/variable.h"
@@ -40,6 +41,15 @@ namespace Aurora {
 
 namespace NWScript {
 
+/** A container of named NWScript variables, like an object's local variables.
+ *
+ *  The variables are kept in one flat array, in no particular order. For up
+ *  to kVariablesUnindexed variables, lookups just compare the hashed names.
+ *  Containers with more variables also build an open-addressing hash table
+ *  over that array.
+ *
+ *  References to variables stay valid until a variable is added or removed.
+ */
 class VariableContainer {
 public:
 	VariableContainer();
@@ -55,10 +65,40 @@ public:
 	void removeVariable(const Common::UString &var);
 	void clearVariables();
 
+	/** Return the number of variables in the container. */
+	uint32 getVariableCount() const;
+	/** Return the name of the nth variable. */
+	const Common::UString &getVariableName(uint32 n) const;
+	/** Return the value of the nth variable. */
+	const Variable &getVariableValue(uint32 n) const;
+
 private:
-	typedef std::map<Common::UString, Variable> VariableMap;
+	/** Containers with this many variables or less don't need a hash table. */
+	static const uint32 kVariablesUnindexed = 8;
+
+	static const uint32 kInvalidVariable = 0xFFFFFFFF;
+
+	struct Entry {
+		uint32 hash;
+		Common::UString name;
+		Variable value;
+	};
+
+	std::vector<Entry> _variables;
+
+	/** Open-addressing hash table of indices into _variables, or empty. */
+	std::vector<uint32> _index;
+
+	static uint32 hashName(const Common::UString &var);
+	static bool equalNames(const Common::UString &var1, const Common::UString &var2);
+
+	uint32 findVariable(const Common::UString &var, uint32 hash) const;
+	uint32 addVariable(const Common::UString &var, uint32 hash, Type type);
+
+	/** Find the slot in the hash table pointing to this variable. */
+	uint32 findSlot(uint32 variable) const;
 
-	VariableMap _variables;
+	void rebuildIndex();
 };
 
 } // End of namespace NWScript
@@ -86,7 +86,9 @@ ResourceManager::ChangeID::ChangeID(ChangeSetList::iterator c) : _empty(false),
 }
 
 
-ResourceManager::ResourceManager() : _rimsAreERFs(false), _hashAlgo(Common::kHashFNV64) {
+ResourceManager::ResourceManager() : _rimsAreERFs(false), _hashAlgo(Common::kHashFNV64),
+	_generation(0) {
+
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeDDS);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTPC);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTXB);
@@ -151,6 +153,8 @@ void ResourceManager::clearResources() {
 	_typeAliases.clear();
 
 	_changes.clear();
+
+	_generation++;
 }
 
 void ResourceManager::setRIMsAreERFs(bool rimsAreERFs) {
@@ -449,10 +453,14 @@ void ResourceManager::undo(ChangeID &change) {
 	// And finally set the change ID to a defined empty state
 	change._empty  = true;
 	change._change = _changes.end();
+
+	_generation++;
 }
 
 void ResourceManager::addTypeAlias(FileType alias, FileType realType) {
 	_typeAliases[alias] = realType;
+
+	_generation++;
 }
 
 void ResourceManager::blacklist(const Common::UString &name, FileType type) {
@@ -462,6 +470,8 @@ void ResourceManager::blacklist(const Common::UString &name, FileType type) {
 
 	for (ResourceList::iterator res = resList->second.begin(); res != resList->second.end(); ++res)
 		res->priority = 0;
+
+	_generation++;
 }
 
 void ResourceManager::declareResource(const Common::UString &name, FileType type) {
@@ -686,6 +696,8 @@ void ResourceManager::addResource(Resource &resource, uint64 hash, ChangeID &cha
 	change._change->resources.push_back(ResourceChange());
 	change._change->resources.back().hashIt = resList;
 	change._change->resources.back().resIt  = --resList->second.end();
+
+	_generation++;
 }
 
 void ResourceManager::addResource(Resource &resource, const Common::UString &name, ChangeID &change) {
@@ -769,6 +781,10 @@ void ResourceManager::dumpResourcesList(const Common::UString &fileName) const {
 	file.close();
 }
 
+uint32 ResourceManager::getGeneration() const {
+	return _generation;
+}
+
 ResourceManager::ChangeID ResourceManager::newChangeSet() {
 	// Generate a new change set
 
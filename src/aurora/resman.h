@@ -306,6 +306,14 @@ public:
 	/** Dump a list of all resources into a file. */
 	void dumpResourcesList(const Common::UString &fileName) const;
 
+	/** Return the current generation of the resource index.
+	 *
+	 *  The generation changes whenever resources are added, removed or
+	 *  blacklisted, so that users caching loaded resources can notice when
+	 *  their cache might have gone stale.
+	 */
+	uint32 getGeneration() const;
+
 private:
 	bool _rimsAreERFs; ///< Are .rim files actually ERF files?
 
@@ -326,6 +334,8 @@ private:
 
 	ChangeSetList _changes;
 
+	uint32 _generation; ///< Changes whenever the resource index changes.
+
 	FileTypeList _resourceTypeTypes[kResourceMAX]; ///< All valid resource type file types.
 
 
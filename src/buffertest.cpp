@@ -0,0 +1,391 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file buffertest.cpp
+ *  Vertex and index buffer object render test.
+ *
+ *  Draws a synthetic mesh the way ModelNode::renderGeometry() does: from
+ *  client memory, compiled into a display list, from vertex and index
+ *  buffer objects, and from a copy of the buffers that outlives its
+ *  source. All of these need to produce exactly the same pixels.
+ *
+ *  Meant to be run under Mesa's software rasterizer, so that the result
+ *  does not depend on the graphics driver: "make check" sets
+ *  LIBGL_ALWAYS_SOFTWARE=1. Without a display to open a window on, the
+ *  test is skipped.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include "common/util.h"
+#include "common/maths.h"
+#include "common/error.h"
+#include "common/debugman.h"
+#include "common/configman.h"
+#include "common/threads.h"
+
+#include "graphics/types.h"
+#include "graphics/graphics.h"
+#include "graphics/queueman.h"
+#include "graphics/glstate.h"
+#include "graphics/vertexbuffer.h"
+#include "graphics/indexbuffer.h"
+
+using namespace Graphics;
+
+/** Exit code telling the test harness that the test was skipped. */
+static const int kExitSkip = 77;
+
+static const int kWidth  = 128;
+static const int kHeight = 128;
+
+/** Fewer lit pixels than that, and the mesh wasn't drawn at all. */
+static const uint32 kMinLitPixels = 1000;
+
+/** Open a window with an OpenGL context, through the graphics manager. */
+static bool initGraphics() {
+	ConfigMan.setInt(Common::kConfigRealmDefault, "width" , kWidth);
+	ConfigMan.setInt(Common::kConfigRealmDefault, "height", kHeight);
+
+	ConfigMan.setBool(Common::kConfigRealmDefault, "fullscreen", false);
+
+	try {
+		GfxMan.init();
+	} catch (Common::Exception &e) {
+		Common::printException(e, "Skipping: ");
+		return false;
+	}
+
+	status("OpenGL renderer: %s, %s", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+	if (!GfxMan.supportBufferObjects()) {
+		status("Skipping: No support for buffer objects");
+		return false;
+	}
+
+	// The graphics manager has set up the render state for drawing models.
+	// Its perspective projection only gets loaded when rendering a frame,
+	// though, so we're drawing with an orthographic one. And we want to
+	// see every triangle of our mesh.
+	GLStateMan.disable(GL_CULL_FACE);
+
+	return true;
+}
+
+/** Create a tessellated, wavy disc, laid out like the model loaders do it:
+ *  one block of data per vertex attribute.
+ */
+static void createMesh(VertexBuffer &vertexBuffer, IndexBuffer &indexBuffer, GLenum indexType) {
+	static const uint32 kRings   = 24;
+	static const uint32 kSectors = 48;
+
+	const uint32 vertexCount = 1 + kRings * kSectors;
+
+	vertexBuffer.setSize(vertexCount, (3 + 3 + 4 + 2) * sizeof(float));
+
+	float *data = (float *) vertexBuffer.getData();
+
+	float *positions = data;
+	float *normals   = data + 3 * vertexCount;
+	float *colors    = data + 6 * vertexCount;
+	float *texCoords = data + 10 * vertexCount;
+
+	VertexDecl vertexDecl;
+
+	VertexAttrib vp;
+	vp.index = VPOSITION;
+	vp.size = 3;
+	vp.type = GL_FLOAT;
+	vp.stride = 0;
+	vp.pointer = positions;
+	vertexDecl.push_back(vp);
+
+	VertexAttrib vn;
+	vn.index = VNORMAL;
+	vn.size = 3;
+	vn.type = GL_FLOAT;
+	vn.stride = 0;
+	vn.pointer = normals;
+	vertexDecl.push_back(vn);
+
+	VertexAttrib vc;
+	vc.index = VCOLOR;
+	vc.size = 4;
+	vc.type = GL_FLOAT;
+	vc.stride = 0;
+	vc.pointer = colors;
+	vertexDecl.push_back(vc);
+
+	VertexAttrib vt;
+	vt.index = VTCOORD;
+	vt.size = 2;
+	vt.type = GL_FLOAT;
+	vt.stride = 0;
+	vt.pointer = texCoords;
+	vertexDecl.push_back(vt);
+
+	vertexBuffer.setVertexDecl(vertexDecl);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		float radius = 0.0f, angle = 0.0f;
+		if (v > 0) {
+			radius = (((v - 1) / kSectors) + 1) / (float) kRings;
+			angle  = ((v - 1) % kSectors) * 2.0f * M_PI / kSectors;
+		}
+
+		const float x = radius * cosf(angle);
+		const float y = radius * sinf(angle);
+		const float z = 0.2f * sinf(5.0f * radius + 3.0f * angle);
+
+		*positions++ = x;
+		*positions++ = y;
+		*positions++ = z;
+
+		*normals++ = 0.0f;
+		*normals++ = 0.0f;
+		*normals++ = 1.0f;
+
+		*colors++ = 0.5f + 0.5f * x;
+		*colors++ = 0.5f + 0.5f * y;
+		*colors++ = 0.5f + z;
+		*colors++ = 1.0f;
+
+		*texCoords++ = x;
+		*texCoords++ = y;
+	}
+
+	std::vector<uint32> indices;
+
+	// The center fan
+	for (uint32 s = 0; s < kSectors; s++) {
+		indices.push_back(0);
+		indices.push_back(1 + s);
+		indices.push_back(1 + (s + 1) % kSectors);
+	}
+
+	// The rings around it
+	for (uint32 r = 0; r < kRings - 1; r++) {
+		for (uint32 s = 0; s < kSectors; s++) {
+			const uint32 a0 = 1 + r * kSectors + s;
+			const uint32 a1 = 1 + r * kSectors + (s + 1) % kSectors;
+			const uint32 b0 = a0 + kSectors;
+			const uint32 b1 = a1 + kSectors;
+
+			indices.push_back(a0);
+			indices.push_back(b0);
+			indices.push_back(a1);
+
+			indices.push_back(a1);
+			indices.push_back(b0);
+			indices.push_back(b1);
+		}
+	}
+
+	if (indexType == GL_UNSIGNED_SHORT) {
+		indexBuffer.setSize(indices.size(), sizeof(uint16), GL_UNSIGNED_SHORT);
+
+		uint16 *data16 = (uint16 *) indexBuffer.getData();
+		for (uint32 i = 0; i < indices.size(); i++)
+			data16[i] = indices[i];
+
+	} else {
+		indexBuffer.setSize(indices.size(), sizeof(uint32), GL_UNSIGNED_INT);
+
+		std::memcpy(indexBuffer.getData(), &indices[0], indices.size() * sizeof(uint32));
+	}
+}
+
+/** Draw the buffers, the same way ModelNode::renderGeometry() does. */
+static void renderGeometry(const VertexBuffer &vertexBuffer, const IndexBuffer &indexBuffer) {
+	vertexBuffer.bind();
+	indexBuffer.bind();
+
+	indexBuffer.draw();
+
+	indexBuffer.unbind();
+	vertexBuffer.unbind();
+}
+
+/** Render one frame with the buffers, directly or from a display list, and read back its pixels. */
+static bool renderFrame(const VertexBuffer &vertexBuffer, const IndexBuffer &indexBuffer,
+                        bool displayList, std::vector<byte> &pixels) {
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glLoadIdentity();
+	glRotatef(30.0f, 1.0f, 0.0f, 0.0f);
+
+	if (displayList) {
+		GLuint list = glGenLists(1);
+
+		glNewList(list, GL_COMPILE);
+		renderGeometry(vertexBuffer, indexBuffer);
+		glEndList();
+
+		glCallList(list);
+
+		glDeleteLists(list, 1);
+	} else
+		renderGeometry(vertexBuffer, indexBuffer);
+
+	pixels.resize(kWidth * kHeight * 4);
+	glReadPixels(0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	GLenum glErr = glGetError();
+	if (glErr != GL_NO_ERROR) {
+		status("OpenGL error 0x%X", glErr);
+		return false;
+	}
+
+	return true;
+}
+
+static uint32 countLitPixels(const std::vector<byte> &pixels) {
+	uint32 count = 0;
+	for (uint32 i = 0; i < pixels.size(); i += 4)
+		if (pixels[i + 0] || pixels[i + 1] || pixels[i + 2])
+			count++;
+
+	return count;
+}
+
+/** Render the frame again and compare it to the reference frame. */
+static bool compareFrame(const char *name, const VertexBuffer &vertexBuffer,
+                         const IndexBuffer &indexBuffer, bool displayList,
+                         const std::vector<byte> &reference) {
+
+	std::vector<byte> pixels;
+	if (!renderFrame(vertexBuffer, indexBuffer, displayList, pixels))
+		return false;
+
+	if (pixels != reference) {
+		status("%s: Pixels differ from the client memory rendering", name);
+		return false;
+	}
+
+	status("%s: Same pixels", name);
+	return true;
+}
+
+static bool testBuffers(GLenum indexType) {
+	const char *name = (indexType == GL_UNSIGNED_SHORT) ? "16-bit indices" : "32-bit indices";
+
+	VertexBuffer vertexBuffer;
+	IndexBuffer  indexBuffer;
+
+	createMesh(vertexBuffer, indexBuffer, indexType);
+
+	// The reference: straight from client memory
+
+	std::vector<byte> reference;
+	if (!renderFrame(vertexBuffer, indexBuffer, false, reference))
+		return false;
+
+	const uint32 litPixels = countLitPixels(reference);
+	if (litPixels < kMinLitPixels) {
+		status("%s: Only %u pixels lit, the mesh wasn't drawn", name, litPixels);
+		return false;
+	}
+
+	status("%s: %u pixels lit", name, litPixels);
+
+	if (!compareFrame("Display list", vertexBuffer, indexBuffer, true, reference))
+		return false;
+
+	// From buffer objects
+
+	vertexBuffer.initGL();
+	indexBuffer.initGL();
+
+	if ((vertexBuffer.getVBO() == 0) || (indexBuffer.getIBO() == 0)) {
+		status("%s: Failed to create the buffer objects", name);
+		return false;
+	}
+
+	if (!compareFrame("Buffer objects", vertexBuffer, indexBuffer, false, reference))
+		return false;
+	if (!compareFrame("Buffer objects, display list", vertexBuffer, indexBuffer, true, reference))
+		return false;
+
+	// From a copy, like ModelNode::inheritGeometry() makes, that outlives its source
+
+	VertexBuffer vertexCopy(vertexBuffer);
+	IndexBuffer  indexCopy(indexBuffer);
+
+	vertexBuffer.destroyGL();
+	indexBuffer.destroyGL();
+
+	vertexBuffer.setSize(0, 0);
+	indexBuffer.setSize(0, 0, GL_UNSIGNED_SHORT);
+
+	vertexCopy.initGL();
+	indexCopy.initGL();
+
+	if (!compareFrame("Copied buffer objects", vertexCopy, indexCopy, false, reference))
+		return false;
+
+	vertexCopy.destroyGL();
+	indexCopy.destroyGL();
+
+	if (!compareFrame("Copied buffers, client memory", vertexCopy, indexCopy, false, reference))
+		return false;
+
+	return true;
+}
+
+void deinit();
+
+int main(int argc, char **argv) {
+	atexit(deinit);
+
+	Common::initThreads();
+
+	if (!initGraphics())
+		return kExitSkip;
+
+	try {
+		if (!testBuffers(GL_UNSIGNED_SHORT) || !testBuffers(GL_UNSIGNED_INT))
+			return 1;
+	} catch (Common::Exception &e) {
+		Common::printException(e);
+		return 1;
+	}
+
+	return 0;
+}
+
+void deinit() {
+	// Destroy global singletons
+	Graphics::GraphicsManager::destroy();
+	Graphics::GLStateManager::destroy();
+	Graphics::QueueManager::destroy();
+
+	Common::ConfigManager::destroy();
+
+	Common::DebugManager::destroy();
+}
@@ -0,0 +1,108 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/frustum.cpp
+ *  A view frustum.
+ */
+
+#include <cmath>
+
+#include "common/frustum.h"
+#include "common/matrix.h"
+#include "common/boundingbox.h"
+
+namespace Common {
+
+Frustum::Frustum() {
+	// Without a matrix, nothing is culled
+	for (int i = 0; i < 6; i++) {
+		_planes[i][0] = 0.0;
+		_planes[i][1] = 0.0;
+		_planes[i][2] = 0.0;
+		_planes[i][3] = 1.0;
+	}
+}
+
+Frustum::~Frustum() {
+}
+
+void Frustum::set(const Matrix &clip) {
+	/* Each plane is the sum or difference of the fourth and one of the
+	 * other rows of the clip matrix. See Gribb and Hartmann, "Fast
+	 * Extraction of Viewing Frustum Planes from the World-View-Projection
+	 * Matrix". */
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			_planes[2 * i + 0][j] = clip(3, j) + clip(i, j);
+			_planes[2 * i + 1][j] = clip(3, j) - clip(i, j);
+		}
+	}
+
+	// Normalize, so that the planes give us real distances
+	for (int i = 0; i < 6; i++) {
+		const float length = sqrtf(_planes[i][0] * _planes[i][0] +
+		                           _planes[i][1] * _planes[i][1] +
+		                           _planes[i][2] * _planes[i][2]);
+
+		if (length == 0.0)
+			continue;
+
+		for (int j = 0; j < 4; j++)
+			_planes[i][j] /= length;
+	}
+}
+
+bool Frustum::isIn(float x, float y, float z) const {
+	for (int i = 0; i < 6; i++)
+		if ((_planes[i][0] * x + _planes[i][1] * y + _planes[i][2] * z + _planes[i][3]) < 0.0)
+			return false;
+
+	return true;
+}
+
+bool Frustum::isIn(const BoundingBox &box) const {
+	if (box.isEmpty())
+		return false;
+
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	for (int i = 0; i < 6; i++) {
+		// The corner furthest along the plane's normal
+		const float x = (_planes[i][0] >= 0.0) ? max[0] : min[0];
+		const float y = (_planes[i][1] >= 0.0) ? max[1] : min[1];
+		const float z = (_planes[i][2] >= 0.0) ? max[2] : min[2];
+
+		// If even that corner is behind the plane, the whole box is
+		if ((_planes[i][0] * x + _planes[i][1] * y + _planes[i][2] * z + _planes[i][3]) < 0.0)
+			return false;
+	}
+
+	return true;
+}
+
+} // End of namespace Common
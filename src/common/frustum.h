@@ -0,0 +1,69 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/frustum.h
+ *  A view frustum.
+ */
+
+#ifndef COMMON_FRUSTUM_H
+#define COMMON_FRUSTUM_H
+
+namespace Common {
+
+class Matrix;
+class BoundingBox;
+
+/** A view frustum, the volume of space visible on the screen.
+ *
+ *  The frustum is described by six planes, all facing inwards.
+ */
+class Frustum {
+public:
+	Frustum();
+	~Frustum();
+
+	/** Derive the frustum from a combined projection and modelview matrix.
+	 *
+	 *  The frustum is then in the coordinate system the modelview matrix
+	 *  transforms from.
+	 */
+	void set(const Matrix &clip);
+
+	/** Is that point within the frustum? */
+	bool isIn(float x, float y, float z) const;
+	/** Is any part of that bounding box within the frustum?
+	 *
+	 *  This is conservative: a box close to a corner of the frustum
+	 *  might be considered inside, even though it's not.
+	 */
+	bool isIn(const BoundingBox &box) const;
+
+private:
+	float _planes[6][4]; ///< The plane equations, a * x + b * y + c * z + d.
+};
+
+} // End of namespace Common
+
+#endif // COMMON_FRUSTUM_H
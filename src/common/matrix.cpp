@@ -156,6 +156,16 @@ Matrix &Matrix::operator*=(const float &right) {
 Matrix &Matrix::operator*=(const Matrix &right) {
 	assert(_columns == right._rows);
 
+	if ((_rows == 4) && (_columns == 4) && (right._columns == 4)) {
+		// Common case, multiply without allocating new elements
+		float t[16];
+
+		multiply_4x4_4x4(t, _elements, right._elements);
+		memcpy(_elements, t, sizeof(t));
+
+		return *this;
+	}
+
 	float *t = new float[_rows * right._columns];
 
 	multiply(t, *this, right);
@@ -98,6 +98,90 @@ StackLock::~StackLock() {
 }
 
 
+ReadWriteLock::ReadWriteLock() : _readers(0), _waitingWriters(0), _writing(false) {
+	_mutex    = SDL_CreateMutex();
+	_canRead  = SDL_CreateCond();
+	_canWrite = SDL_CreateCond();
+
+	assert(_mutex && _canRead && _canWrite);
+}
+
+ReadWriteLock::~ReadWriteLock() {
+	SDL_DestroyCond(_canWrite);
+	SDL_DestroyCond(_canRead);
+	SDL_DestroyMutex(_mutex);
+}
+
+void ReadWriteLock::lockRead() {
+	SDL_LockMutex(_mutex);
+
+	while (_writing || (_waitingWriters > 0))
+		SDL_CondWait(_canRead, _mutex);
+
+	_readers++;
+
+	SDL_UnlockMutex(_mutex);
+}
+
+void ReadWriteLock::unlockRead() {
+	SDL_LockMutex(_mutex);
+
+	assert(_readers > 0);
+
+	if ((--_readers == 0) && (_waitingWriters > 0))
+		SDL_CondSignal(_canWrite);
+
+	SDL_UnlockMutex(_mutex);
+}
+
+void ReadWriteLock::lockWrite() {
+	SDL_LockMutex(_mutex);
+
+	_waitingWriters++;
+
+	while (_writing || (_readers > 0))
+		SDL_CondWait(_canWrite, _mutex);
+
+	_waitingWriters--;
+	_writing = true;
+
+	SDL_UnlockMutex(_mutex);
+}
+
+void ReadWriteLock::unlockWrite() {
+	SDL_LockMutex(_mutex);
+
+	assert(_writing);
+
+	_writing = false;
+
+	if (_waitingWriters > 0)
+		SDL_CondSignal(_canWrite);
+	else
+		SDL_CondBroadcast(_canRead);
+
+	SDL_UnlockMutex(_mutex);
+}
+
+
+StackReadLock::StackReadLock(ReadWriteLock &lock) : _lock(&lock) {
+	_lock->lockRead();
+}
+
+StackReadLock::~StackReadLock() {
+	_lock->unlockRead();
+}
+
+
+StackWriteLock::StackWriteLock(ReadWriteLock &lock) : _lock(&lock) {
+	_lock->lockWrite();
+}
+
+StackWriteLock::~StackWriteLock() {
+	_lock->unlockWrite();
+}
+
+
 Condition::Condition() : _ownMutex(true) {
 	_mutex = new Mutex;
 
@@ -140,4 +224,8 @@ void Condition::signal() {
 	SDL_CondSignal(_condition);
 }
 
+void Condition::broadcast() {
+	SDL_CondBroadcast(_condition);
+}
+
 } // End of namespace Common
@@ -77,6 +77,53 @@ private:
 	Semaphore *_semaphore;
 };
 
+/** A lock that allows either many readers or one writer at a time.
+ *
+ *  Writers waiting for the lock take precedence over new readers.
+ *  The lock is not recursive.
+ */
+class ReadWriteLock {
+public:
+	ReadWriteLock();
+	~ReadWriteLock();
+
+	void lockRead();
+	void unlockRead();
+
+	void lockWrite();
+	void unlockWrite();
+
+private:
+	SDL_mutex *_mutex;
+
+	SDL_cond *_canRead;
+	SDL_cond *_canWrite;
+
+	uint32 _readers;        ///< Number of readers holding the lock.
+	uint32 _waitingWriters; ///< Number of writers waiting for the lock.
+	bool   _writing;        ///< Does a writer hold the lock?
+};
+
+/** Convenience class that read-locks a ReadWriteLock on creation and unlocks it on destruction. */
+class StackReadLock {
+public:
+	StackReadLock(ReadWriteLock &lock);
+	~StackReadLock();
+
+private:
+	ReadWriteLock *_lock;
+};
+
+/** Convenience class that write-locks a ReadWriteLock on creation and unlocks it on destruction. */
+class StackWriteLock {
+public:
+	StackWriteLock(ReadWriteLock &lock);
+	~StackWriteLock();
+
+private:
+	ReadWriteLock *_lock;
+};
+
 /** A condition. */
 class Condition {
 public:
@@ -86,6 +133,7 @@ public:
 
 	bool wait(uint32 timeout = 0);
 	void signal();
+	void broadcast(); ///< Wake up all threads waiting on the condition.
 
 private:
 	bool _ownMutex;
@@ -0,0 +1,151 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/threadpool.cpp
+ *  A pool of worker threads.
+ */
+
+#include "common/util.h"
+#include "common/threadpool.h"
+
+namespace Common {
+
+ThreadPool::Job::~Job() {
+}
+
+
+ThreadPool::Worker::Worker(ThreadPool &pool) : _pool(&pool) {
+}
+
+ThreadPool::Worker::~Worker() {
+	destroyThread();
+}
+
+void ThreadPool::Worker::threadMethod() {
+	while (!_killThread) {
+		_pool->_mutex.lock();
+
+		// Wait for something to do, but check regularly whether we should quit
+		if (!_pool->_job || (_pool->_nextPart >= _pool->_partCount))
+			_pool->_newJob.wait(100);
+
+		_pool->_mutex.unlock();
+
+		_pool->work();
+	}
+}
+
+
+ThreadPool::ThreadPool(uint32 threadCount) : _newJob(_mutex), _jobDone(_mutex),
+	_job(0), _partCount(0), _nextPart(0), _partsDone(0), _chunkSize(1) {
+
+	for (uint32 i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			warning("ThreadPool: Failed to create worker thread %u", i);
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+}
+
+uint32 ThreadPool::getThreadCount() const {
+	return _workers.size();
+}
+
+void ThreadPool::run(Job &job, uint32 partCount) {
+	// Nothing to split, just do it here
+	if (_workers.empty() || (partCount <= 1)) {
+		for (uint32 i = 0; i < partCount; i++)
+			job.run(i);
+
+		return;
+	}
+
+	_mutex.lock();
+
+	_job       = &job;
+	_partCount = partCount;
+	_nextPart  = 0;
+	_partsDone = 0;
+
+	// A few chunks per thread, so that threads finishing early can help out the others
+	_chunkSize = MAX<uint32>(1, partCount / ((_workers.size() + 1) * 4));
+
+	_newJob.broadcast();
+
+	_mutex.unlock();
+
+	work();
+
+	_mutex.lock();
+
+	while (_partsDone < _partCount)
+		_jobDone.wait();
+
+	_job = 0;
+
+	_mutex.unlock();
+}
+
+void ThreadPool::work() {
+	while (true) {
+		_mutex.lock();
+
+		if (!_job || (_nextPart >= _partCount)) {
+			_mutex.unlock();
+			return;
+		}
+
+		Job   *job   = _job;
+		uint32 first = _nextPart;
+		uint32 count = MIN(_chunkSize, _partCount - first);
+
+		_nextPart += count;
+
+		_mutex.unlock();
+
+		for (uint32 i = 0; i < count; i++)
+			job->run(first + i);
+
+		_mutex.lock();
+
+		_partsDone += count;
+		if (_partsDone >= _partCount)
+			_jobDone.signal();
+
+		_mutex.unlock();
+	}
+}
+
+} // End of namespace Common
@@ -0,0 +1,103 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/threadpool.h
+ *  A pool of worker threads.
+ */
+
+#ifndef COMMON_THREADPOOL_H
+#define COMMON_THREADPOOL_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/noncopyable.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+namespace Common {
+
+/** A pool of worker threads, running the independent parts of a job in parallel. */
+class ThreadPool : NonCopyable {
+public:
+	/** A job that can be split into independent parts. */
+	class Job {
+	public:
+		virtual ~Job();
+
+		/** Run that part of the job.
+		 *
+		 *  Different parts of the same job run in different threads at the
+		 *  same time, so they must not touch the same data.
+		 */
+		virtual void run(uint32 part) = 0;
+	};
+
+	/** Create a pool with that many worker threads. */
+	ThreadPool(uint32 threadCount);
+	~ThreadPool();
+
+	/** Return the number of worker threads. */
+	uint32 getThreadCount() const;
+
+	/** Run all parts of the job, and wait for them to finish.
+	 *
+	 *  The calling thread works on the job too. Only one thread may run
+	 *  jobs on the pool at a time.
+	 */
+	void run(Job &job, uint32 partCount);
+
+private:
+	/** A worker thread, taking parts of the current job. */
+	class Worker : public Thread {
+	public:
+		Worker(ThreadPool &pool);
+		~Worker();
+
+	private:
+		ThreadPool *_pool;
+
+		void threadMethod();
+	};
+
+	std::vector<Worker *> _workers;
+
+	Mutex     _mutex;   ///< Protecting the job state.
+	Condition _newJob;  ///< Signalled when a new job is started.
+	Condition _jobDone; ///< Signalled when the last part of a job is done.
+
+	Job   *_job;       ///< The job currently running.
+	uint32 _partCount; ///< The number of parts in the current job.
+	uint32 _nextPart;  ///< The next part of the current job nobody is working on yet.
+	uint32 _partsDone; ///< The number of finished parts of the current job.
+	uint32 _chunkSize; ///< The number of parts a thread takes at once.
+
+	/** Take and run parts of the current job, until there are none left. */
+	void work();
+};
+
+} // End of namespace Common
+
+#endif // COMMON_THREADPOOL_H
@@ -27,6 +27,8 @@
  *  A transformation matrix.
  */
 
+#include <cstring>
+
 #include "common/transmatrix.h"
 #include "common/maths.h"
 
@@ -66,33 +68,37 @@ void TransformationMatrix::loadIdentity() {
 }
 
 void TransformationMatrix::translate(float x, float y, float z) {
-	Matrix tMatrix(4, 4);
+	float t[16];
 
-	tMatrix.set(kIdentity);
+	memcpy(t, kIdentity, sizeof(t));
 
-	tMatrix(0, 3) = x;
-	tMatrix(1, 3) = y;
-	tMatrix(2, 3) = z;
+	t[12] = x;
+	t[13] = y;
+	t[14] = z;
 
-	(*this) *= tMatrix;
+	multiply(t);
 }
 
 void TransformationMatrix::scale(float x, float y, float z) {
-	Matrix sMatrix(4, 4);
+	float s[16];
 
-	sMatrix.set(kIdentity);
+	memcpy(s, kIdentity, sizeof(s));
 
-	sMatrix(0, 0) = x;
-	sMatrix(1, 1) = y;
-	sMatrix(2, 2) = z;
+	s[ 0] = x;
+	s[ 5] = y;
+	s[10] = z;
 
-	(*this) *= sMatrix;
+	multiply(s);
 }
 
 void TransformationMatrix::rotate(float angle, float x, float y, float z) {
 	// Normalize the axis vector
 	float length = x * x + y * y + z * z;
-	if ((length != 1.0) && (length != 0.0)) {
+	if (length == 0.0)
+		// Like glRotatef(), there's nothing to rotate around
+		return;
+
+	if (length != 1.0) {
 		length = sqrtf(length);
 
 		x /= length;
@@ -123,15 +129,18 @@ void TransformationMatrix::rotate(float angle, float x, float y, float z) {
 	e[14] = 0.0;
 	e[15] = 1.0;
 
-	Matrix rMatrix(4, 4);
-
-	rMatrix.set(e);
-
-	(*this) *= rMatrix;
+	multiply(e);
 }
 
 void TransformationMatrix::transform(const Matrix &m) {
 	(*this) *= m;
 }
 
+void TransformationMatrix::multiply(const float *m) {
+	float t[16];
+
+	multiply_4x4_4x4(t, _elements, m);
+	memcpy(_elements, t, sizeof(t));
+}
+
 } // End of namespace Common
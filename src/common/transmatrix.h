@@ -53,6 +53,10 @@ public:
 	void rotate(float angle, float x, float y, float z);
 
 	void transform(const Matrix &m);
+
+private:
+	/** Multiply with that 4x4 matrix, given in column-major order. */
+	void multiply(const float *m);
 };
 
 } // End of namespace Common
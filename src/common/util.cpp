@@ -34,6 +34,14 @@
 #include <cstdio>
 #include <cstdlib>
 
+#if defined(WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/time.h>
+	#include <time.h>
+#endif
+
 void warning(const char *s, ...) {
 	char buf[STRINGBUFLEN];
 	va_list va;
@@ -142,3 +150,29 @@ uint64 convertIEEEDouble(double value) {
 
 	return conv.dInt;
 }
+
+uint64 getMicroseconds() {
+#if defined(WIN32)
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	// Split up, so that the multiplication doesn't overflow after a few days of uptime
+	const uint64 count = counter.QuadPart;
+	const uint64 freq  = frequency.QuadPart;
+
+	return (count / freq) * 1000000 + ((count % freq) * 1000000) / freq;
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	// A monotonic clock, so that durations never go negative when the system time is changed
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+
+	return ((uint64) tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
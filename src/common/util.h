@@ -127,4 +127,7 @@ double convertIEEEDouble(uint64 data);
 uint32 convertIEEEFloat(float value);
 uint64 convertIEEEDouble(double value);
 
+/** Return a timestamp in microseconds, for measuring short durations. */
+uint64 getMicroseconds();
+
 #endif // COMMON_UTIL_H
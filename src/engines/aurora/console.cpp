@@ -37,6 +37,7 @@
 #include "common/readline.h"
 
 #include "aurora/resman.h"
+#include "aurora/nwscript/allocations.h"
 
 #include "graphics/graphics.h"
 #include "graphics/font.h"
@@ -686,6 +687,12 @@ Console::Console(const Common::UString &font, int fontHeight) : _neverShown(true
 			"Usage: playsound <sound>\nPlay the specified sound");
 	registerCommand("silence"    , boost::bind(&Console::cmdSilence    , this, _1),
 			"Usage: silence\nStop all playing sounds and music");
+	registerCommand("scriptprof" , boost::bind(&Console::cmdScriptProf , this, _1),
+			"Usage: scriptprof [on|off|clear|dump <file>]\n"
+			"Control the script profiler, or print the most expensive scripts and functions");
+	registerCommand("texturemem" , boost::bind(&Console::cmdTextureMem , this, _1),
+			"Usage: texturemem [<count>]\n"
+			"Print the texture memory use and the biggest textures");
 
 	_console->setPrompt(kPrompt);
 
@@ -1161,6 +1168,93 @@ void Console::cmdSilence(const CommandLine &cl) {
 	SoundMan.stopAll();
 }
 
+void Console::cmdScriptProf(const CommandLine &cl) {
+	std::vector<Common::UString> args;
+	Common::UString::split(cl.args, ' ', args);
+
+	if        (args.empty()) {
+		if (!ScriptProf.isEnabled())
+			print("The script profiler is disabled. Use \"scriptprof on\" to enable it");
+
+		std::vector<Aurora::NWScript::ScriptProfiler::Stats> stats;
+
+		ScriptProf.getScriptStats(stats);
+		printScriptStats("Scripts", stats);
+
+		ScriptProf.getFunctionStats(stats);
+		printScriptStats("Engine functions", stats);
+
+	} else if (args[0] == "on") {
+		ScriptProf.setEnabled(true);
+		print("Script profiler enabled");
+	} else if (args[0] == "off") {
+		ScriptProf.setEnabled(false);
+		print("Script profiler disabled");
+	} else if (args[0] == "clear") {
+		ScriptProf.clear();
+		print("Script profiler statistics cleared");
+	} else if ((args[0] == "dump") && (args.size() == 2)) {
+		try {
+			ScriptProf.dumpCSV(args[1]);
+			printf("Dumped script profiler statistics to file \"%s\"", args[1].c_str());
+		} catch (...) {
+			printf("Failed dumping script profiler statistics to file \"%s\"", args[1].c_str());
+		}
+	} else
+		printCommandHelp(cl.cmd);
+}
+
+void Console::cmdTextureMem(const CommandLine &cl) {
+	uint32 count = 10;
+	if (!cl.args.empty()) {
+		int n = 0;
+		if (!cl.args.parse(n) || (n <= 0)) {
+			printCommandHelp(cl.cmd);
+			return;
+		}
+
+		count = n;
+	}
+
+	std::vector<Graphics::Aurora::TextureManager::Stats> stats;
+	TextureMan.getStats(stats);
+
+	printf("%u textures, %u KiB (%u KiB unused), budget %u KiB",
+	       (uint) stats.size(), TextureMan.getSize() / 1024,
+	       TextureMan.getUnusedSize() / 1024, TextureMan.getBudget() / 1024);
+	printf("Unused textures reused %u times, textures loaded %u times",
+	       TextureMan.getHits(), TextureMan.getMisses());
+
+	printf("%-32s %10s %6s", "Name", "KiB", "Refs");
+
+	std::vector<Graphics::Aurora::TextureManager::Stats>::const_iterator s;
+	for (s = stats.begin(); (s != stats.end()) && (count > 0); ++s, count--)
+		printf("%-32s %10u %6u", s->name.c_str(), s->size / 1024, s->referenceCount);
+}
+
+void Console::printScriptStats(const char *title,
+		const std::vector<Aurora::NWScript::ScriptProfiler::Stats> &stats) {
+
+	static const uint32 kMaxLines = 10;
+
+	printf("%s, by total time:", title);
+	printf("%-24s %8s %10s %9s %9s %8s", "Name", "Calls", "Instr", "Total ms", "Self ms", "Allocs");
+
+	// Only the benchmark programs count heap allocations
+	const bool allocations = Aurora::NWScript::hasAllocationCounter();
+
+	uint32 n = 0;
+	std::vector<Aurora::NWScript::ScriptProfiler::Stats>::const_iterator s;
+	for (s = stats.begin(); (s != stats.end()) && (n < kMaxLines); ++s, n++) {
+		const Common::UString allocs = allocations ?
+			Common::UString::sprintf("%llu", (unsigned long long) s->allocations) : "n/a";
+
+		printf("%-24s %8llu %10llu %9.1f %9.1f %8s", s->name.c_str(),
+		       (unsigned long long) s->calls, (unsigned long long) s->instructions,
+		       s->totalTime / 1000.0, s->selfTime / 1000.0, allocs.c_str());
+	}
+}
+
 void Console::printCommandHelp(const Common::UString &cmd) {
 	CommandMap::const_iterator c = _commands.find(cmd);
 	if (c == _commands.end()) {
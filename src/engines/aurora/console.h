@@ -30,6 +30,8 @@
 #ifndef ENGINES_AURORA_CONSOLE_H
 #define ENGINES_AURORA_CONSOLE_H
 
+#include <vector>
+
 #include <boost/function.hpp>
 
 #include "common/types.h"
@@ -37,6 +39,8 @@
 #include "common/ustring.h"
 #include "common/file.h"
 
+#include "aurora/nwscript/profiler.h"
+
 #include "events/types.h"
 #include "events/notifyable.h"
 
@@ -278,9 +282,14 @@ private:
 	void cmdListSounds (const CommandLine &cl);
 	void cmdPlaySound  (const CommandLine &cl);
 	void cmdSilence    (const CommandLine &cl);
+	void cmdScriptProf (const CommandLine &cl);
+	void cmdTextureMem (const CommandLine &cl);
 
 	void updateHelpArguments();
 
+	void printScriptStats(const char *title,
+	                      const std::vector<Aurora::NWScript::ScriptProfiler::Stats> &stats);
+
 	void printFullHelp();
 	bool printHints(const Common::UString &command);
 
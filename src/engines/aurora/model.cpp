@@ -58,7 +58,7 @@ Graphics::Aurora::Model *loadModelObject(const Common::UString &resref,
 
 	try {
 
-		model = kModelLoader->load(resref, Graphics::Aurora::kModelTypeObject, texture);
+		model = kModelLoader->loadInstance(resref, Graphics::Aurora::kModelTypeObject, texture);
 
 	} catch (Common::Exception &e) {
 
@@ -27,6 +27,8 @@
  *  An abstract Aurora model loader.
  */
 
+#include <boost/shared_ptr.hpp>
+
 #include "graphics/aurora/model.h"
 
 #include "engines/aurora/modelloader.h"
@@ -36,6 +38,38 @@ namespace Engines {
 ModelLoader::~ModelLoader() {
 }
 
+Graphics::Aurora::Model *ModelLoader::loadInstance(const Common::UString &resref,
+		Graphics::Aurora::ModelType type, const Common::UString &texture) {
+
+	const Common::UString key =
+		Common::UString::sprintf("%d/%s/%s", (int) type, resref.c_str(), texture.c_str());
+
+	boost::shared_ptr<Graphics::Aurora::Model> modelTemplate;
+
+	TemplateMap::iterator t = _templates.find(key);
+	if (t != _templates.end())
+		modelTemplate = t->second.lock();
+
+	if (!modelTemplate) {
+		// Forget about templates whose instances are all gone
+		for (t = _templates.begin(); t != _templates.end(); ) {
+			if (t->second.expired())
+				_templates.erase(t++);
+			else
+				++t;
+		}
+
+		Graphics::Aurora::Model *model = load(resref, type, texture);
+		if (!model)
+			return 0;
+
+		modelTemplate.reset(model);
+		_templates.insert(std::make_pair(key, modelTemplate));
+	}
+
+	return new Graphics::Aurora::Model(modelTemplate);
+}
+
 void ModelLoader::free(Graphics::Aurora::Model *&model) {
 	delete model;
 	model = 0;
@@ -30,11 +30,13 @@
 #ifndef ENGINES_AURORA_MODELLOADER_H
 #define ENGINES_AURORA_MODELLOADER_H
 
-#include "graphics/aurora/types.h"
+#include <map>
+
+#include <boost/weak_ptr.hpp>
 
-namespace Common {
-	class UString;
-}
+#include "common/ustring.h"
+
+#include "graphics/aurora/types.h"
 
 namespace Engines {
 
@@ -42,9 +44,22 @@ class ModelLoader {
 public:
 	virtual ~ModelLoader();
 
+	/** Load a model, as an instance sharing its geometry and animations
+	 *  with all other currently existing instances of the same model.
+	 */
+	Graphics::Aurora::Model *loadInstance(const Common::UString &resref,
+			Graphics::Aurora::ModelType type, const Common::UString &texture);
+
 	virtual Graphics::Aurora::Model *load(const Common::UString &resref,
 			Graphics::Aurora::ModelType type, const Common::UString &texture) = 0;
 	virtual void free(Graphics::Aurora::Model *&model);
+
+private:
+	typedef std::map<Common::UString, boost::weak_ptr<Graphics::Aurora::Model>,
+	                 Common::UString::iless> TemplateMap;
+
+	/** The loaded models instances are created from, alive as long as they have instances. */
+	TemplateMap _templates;
 };
 
 } // End of namespace Engines
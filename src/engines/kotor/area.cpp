@@ -27,6 +27,8 @@
  *  An area.
  */
 
+#include <set>
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
@@ -38,6 +40,7 @@
 #include "aurora/2dareg.h"
 
 #include "graphics/graphics.h"
+#include "graphics/camera.h"
 
 #include "graphics/aurora/cursorman.h"
 
@@ -131,19 +134,18 @@ void Area::show() {
 	playAmbientSound();
 	playAmbientMusic();
 
+	_visible = true;
+
 	GfxMan.lockFrame();
 
-	// Show rooms
-	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
-		(*r)->model->show();
+	// Show the rooms visible from the camera's position
+	showVisibleRooms();
 
 	// Show objects
 	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
 		(*o)->show();
 
 	GfxMan.unlockFrame();
-
-	_visible = true;
 }
 
 void Area::hide() {
@@ -163,8 +165,10 @@ void Area::hide() {
 		(*o)->hide();
 
 	// Hide rooms
-	for (std::vector<Room *>::iterator room = _rooms.begin(); room != _rooms.end(); ++room)
+	for (std::vector<Room *>::iterator room = _rooms.begin(); room != _rooms.end(); ++room) {
 		(*room)->model->hide();
+		(*room)->visible = false;
+	}
 
 	GfxMan.unlockFrame();
 
@@ -386,11 +390,16 @@ void Area::loadVisibles() {
 			for (std::vector<Room *>::iterator iRoom = _rooms.begin(); iRoom != _rooms.end(); ++iRoom)
 				(*room)->visibles.push_back(*iRoom);
 
-			return;
+			continue;
 		}
 
+		// A room can always see itself
+		(*room)->visibles.push_back(*room);
+
 		// Otherwise, go through all rooms again, look for a match with the visibilities
 		for (std::vector<Room *>::iterator iRoom = _rooms.begin(); iRoom != _rooms.end(); ++iRoom) {
+			if (*iRoom == *room)
+				continue;
 
 			for (std::vector<Common::UString>::const_iterator vRoom = rooms.begin(); vRoom != rooms.end(); ++vRoom) {
 				if (vRoom->equalsIgnoreCase((*iRoom)->lytRoom->model)) {
@@ -406,6 +415,57 @@ void Area::loadVisibles() {
 
 }
 
+void Area::showVisibleRooms() {
+	if (!_visible)
+		return;
+
+	// The camera position, in world coordinates
+	CameraMan.lock();
+	const float *cPos = CameraMan.getPosition();
+
+	const float x =  cPos[0];
+	const float y =  cPos[1];
+	const float z = -cPos[2];
+
+	CameraMan.unlock();
+
+	/* Collect the rooms visible from the rooms the camera is in. Room
+	 * bounding boxes overlap around doorways, so the camera can be in
+	 * several rooms at once. */
+
+	std::set<Room *> visibles;
+
+	bool inRoom = false;
+	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r) {
+		if (!(*r)->model->isIn(x, y, z))
+			continue;
+
+		inRoom = true;
+		visibles.insert((*r)->visibles.begin(), (*r)->visibles.end());
+	}
+
+	// Outside of all rooms, we don't know what's visible, so we show everything
+	if (!inRoom)
+		visibles.insert(_rooms.begin(), _rooms.end());
+
+	GfxMan.lockFrame();
+
+	for (std::vector<Room *>::iterator r = _rooms.begin(); r != _rooms.end(); ++r) {
+		const bool visible = visibles.find(*r) != visibles.end();
+		if (visible == (*r)->visible)
+			continue;
+
+		if (visible)
+			(*r)->model->show();
+		else
+			(*r)->model->hide();
+
+		(*r)->visible = visible;
+	}
+
+	GfxMan.unlockFrame();
+}
+
 void Area::addEvent(const Events::Event &event) {
 	_eventQueue.push_back(event);
 }
@@ -489,6 +549,8 @@ void Area::removeFocus() {
 
 void Area::notifyCameraMoved() {
 	checkActive();
+
+	showVisibleRooms();
 }
 
 } // End of namespace KotOR
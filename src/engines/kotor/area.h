@@ -86,8 +86,8 @@ private:
 
 		Graphics::Aurora::Model *model;
 
-		bool visible;
-		std::vector<Room *> visibles;
+		bool visible;                 ///< Is the room currently shown?
+		std::vector<Room *> visibles; ///< The rooms visible from within this room.
 
 		Room(const Aurora::LYTFile::Room &lRoom);
 		~Room();
@@ -147,6 +147,9 @@ private:
 	void loadModels();
 	void loadVisibles();
 
+	/** Show the rooms visible from where the camera is, and hide all others. */
+	void showVisibleRooms();
+
 	void loadProperties(const Aurora::GFFStruct &props);
 
 	void loadPlaceables(const Aurora::GFFList &list);
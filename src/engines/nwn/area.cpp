@@ -53,6 +53,9 @@
 #include "engines/nwn/door.h"
 #include "engines/nwn/creature.h"
 
+/** The length of a tile's side. */
+static const float kTileSize = 10.0f;
+
 namespace Engines {
 
 namespace NWN {
@@ -86,12 +89,26 @@ Area::~Area() {
 	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
 		delete *o;
 
+	// Objects that entered later, like the PC, live on without us
+	std::vector<Engines::NWN::Object *> visitors;
+	_objectGrid.getObjects(visitors);
+	for (std::vector<Engines::NWN::Object *>::iterator o = visitors.begin(); o != visitors.end(); ++o)
+		(*o)->setArea(0);
+
 	// Delete tiles and tileset
 	for (std::vector<Tile>::iterator t = _tiles.begin(); t != _tiles.end(); ++t)
 		delete t->model;
 	delete _tileset;
 }
 
+ObjectGrid &Area::getObjectGrid() {
+	return _objectGrid;
+}
+
+const ObjectGrid &Area::getObjectGrid() const {
+	return _objectGrid;
+}
+
 Common::UString Area::getName(const Common::UString &resRef) {
 	try {
 		Aurora::GFFFile are(resRef, Aurora::kFileTypeARE, MKTAG('A', 'R', 'E', ' '));
@@ -280,6 +297,8 @@ void Area::loadARE(const Aurora::GFFStruct &are) {
 
 	_tiles.resize(_width * _height);
 
+	_objectGrid.resize(_width, _height, kTileSize);
+
 	loadTiles(are.getList("Tile_List"));
 
 	// Scripts
@@ -447,8 +466,8 @@ void Area::loadTiles() {
 
 			// A tile is 10 units wide and deep.
 			// There's extra special 5x5 tiles at the edges.
-			const float tileX = x * 10.0 + 5.0;
-			const float tileY = y * 10.0 + 5.0;
+			const float tileX = x * kTileSize + kTileSize / 2.0f;
+			const float tileY = y * kTileSize + kTileSize / 2.0f;
 
 			// The actual height of a tile is dictated by the tileset.
 			const float tileZ = t.height * _tileset->getTilesHeight();
@@ -50,6 +50,7 @@
 #include "events/notifyable.h"
 
 #include "engines/nwn/tileset.h"
+#include "engines/nwn/objectgrid.h"
 
 #include "engines/nwn/script/container.h"
 
@@ -111,6 +112,13 @@ public:
 	void removeFocus();
 
 
+	// Objects
+
+	/** Return the spatial index of the objects currently in the area. */
+	ObjectGrid &getObjectGrid();
+	/** Return the spatial index of the objects currently in the area. */
+	const ObjectGrid &getObjectGrid() const;
+
 	/** Return the localized name of an area. */
 	static Common::UString getName(const Common::UString &resRef);
 
@@ -192,6 +200,9 @@ private:
 	ObjectList _objects;   ///< List of all objects in the area.
 	ObjectMap  _objectMap; ///< Map of all non-static objects in the area.
 
+	/** All objects currently in the area, including ones not loaded with it. */
+	ObjectGrid _objectGrid;
+
 	/** The currently active (highlighted) object. */
 	Engines::NWN::Object *_activeObject;
 
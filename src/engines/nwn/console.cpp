@@ -86,6 +86,8 @@ Console::Console() : ::Engines::Console(Graphics::Aurora::kSystemFontMono, 13),
 	registerCommand("playmusic"    , boost::bind(&Console::cmdPlayMusic    , this, _1),
 			"Usage: playmusic [<music>]\nPlay the specified music resource. "
 			"If none was specified, play the default area music.");
+	registerCommand("delayqueue"   , boost::bind(&Console::cmdDelayQueue   , this, _1),
+			"Usage: delayqueue\nShow the state of the delayed script actions");
 }
 
 Console::~Console() {
@@ -290,6 +292,16 @@ void Console::cmdPlayMusic(const CommandLine &cl) {
 	_module->_currentArea->playAmbientMusic(cl.args);
 }
 
+void Console::cmdDelayQueue(const CommandLine &cl) {
+	if (!_module)
+		return;
+
+	const Aurora::NWScript::DelayQueue &queue = _module->_delayedActions;
+
+	printf("Waiting actions: %u (peak %u)", queue.getDepth(), queue.getPeakDepth());
+	printf("Lag: %ums (max %ums)", queue.getLastLag(), queue.getMaxLag());
+}
+
 } // End of namespace NWN
 
 } // End of namespace Engines
@@ -88,6 +88,7 @@ private:
 	void cmdListMusic    (const CommandLine &cl);
 	void cmdStopMusic    (const CommandLine &cl);
 	void cmdPlayMusic    (const CommandLine &cl);
+	void cmdDelayQueue   (const CommandLine &cl);
 };
 
 } // End of namespace NWN
@@ -215,7 +215,7 @@ bool Door::open(Object *opener) {
 
 	if (isLocked()) {
 		playSound(_soundLocked);
-		runScript(kScriptFailToOpen, this, opener);
+		queueScript(kScriptFailToOpen, this, opener, Aurora::NWScript::kScriptPriorityHigh);
 		return false;
 	}
 
@@ -225,7 +225,7 @@ bool Door::open(Object *opener) {
 	playSound(_soundOpened);
 	if (_model)
 		_model->playAnimation("opening1");
-	runScript(kScriptOpen, this, opener);
+	queueScript(kScriptOpen, this, opener, Aurora::NWScript::kScriptPriorityHigh);
 
 	// Also open the linked door
 	evaluateLink();
@@ -248,7 +248,7 @@ bool Door::close(Object *closer) {
 	playSound(_soundClosed);
 	if (_model)
 		_model->playAnimation("closing1");
-	runScript(kScriptClosed, this, closer);
+	queueScript(kScriptClosed, this, closer, Aurora::NWScript::kScriptPriorityHigh);
 
 	// Also close the linked door
 	evaluateLink();
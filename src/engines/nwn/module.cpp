@@ -51,6 +51,8 @@
 #include "engines/nwn/area.h"
 #include "engines/nwn/console.h"
 
+#include "aurora/nwscript/scheduler.h"
+
 #include "engines/nwn/script/container.h"
 
 #include "engines/nwn/gui/ingame/ingame.h"
@@ -95,11 +97,6 @@ namespace Engines {
 
 namespace NWN {
 
-bool Module::Action::operator<(const Action &s) const {
-	return timestamp < s.timestamp;
-}
-
-
 Module::Module(Console &console) : _console(&console), _hasModule(false), _pc(0),
 	_currentTexturePack(-1), _exit(false), _currentArea(0) {
 
@@ -365,7 +362,7 @@ void Module::enterArea() {
 
 	_pc->setArea(_currentArea);
 
-	_currentArea->runScript(kScriptEnter, _currentArea, _pc);
+	_currentArea->queueScript(kScriptEnter, _currentArea, _pc, Aurora::NWScript::kScriptPriorityHigh);
 
 	_console->printf("Entering area \"%s\"", _currentArea->getResRef().c_str());
 }
@@ -392,6 +389,8 @@ void Module::run() {
 			handleEvents();
 			handleActions();
 
+			ScriptSchedMan.run();
+
 			_ingameGUI->updatePartyMember(0, *_pc);
 
 			if (!EventMan.quitRequested() && !_exit && !_newArea.empty())
@@ -493,23 +492,13 @@ bool Module::handleCamera(const Events::Event &e) {
 }
 
 void Module::handleActions() {
-	uint32 now = EventMan.getTimestamp();
-
-	while (!_delayedActions.empty()) {
-		std::multiset<Action>::iterator action = _delayedActions.begin();
-
-		if (now < action->timestamp)
-			break;
-
-		if (action->type == kActionScript)
-			ScriptContainer::runScript(action->script, action->state,
-			                           action->owner, action->triggerer);
-
-		_delayedActions.erase(action);
-	}
+	_delayedActions.schedule(EventMan.getTimestamp(), Aurora::NWScript::kScriptPriorityNormal);
 }
 
 void Module::unload() {
+	// Let scheduled scripts finish while their objects still exist
+	ScriptSchedMan.finish();
+
 	unloadAreas();
 	unloadTexturePack();
 	unloadHAKs();
@@ -520,6 +509,7 @@ void Module::unload() {
 void Module::unloadModule() {
 	runScript(kScriptExit, this, _pc);
 	handleActions();
+	ScriptSchedMan.finish();
 
 	_delayedActions.clear();
 
@@ -701,19 +691,11 @@ void Module::changeModule(const Common::UString &module) {
 }
 
 void Module::delayScript(const Common::UString &script,
-                         const Aurora::NWScript::ScriptState &state,
+                         Aurora::NWScript::ScriptState &state,
                          Aurora::NWScript::Object *owner,
                          Aurora::NWScript::Object *triggerer, uint32 delay) {
-	Action action;
-
-	action.type      = kActionScript;
-	action.script    = script;
-	action.state     = state;
-	action.owner     = owner;
-	action.triggerer = triggerer;
-	action.timestamp = EventMan.getTimestamp() + delay;
 
-	_delayedActions.insert(action);
+	_delayedActions.add(script, state, owner, triggerer, EventMan.getTimestamp() + delay);
 }
 
 Common::UString Module::getDescription(const Common::UString &module) {
@@ -31,7 +31,6 @@
 #define ENGINES_NWN_MODULE_H
 
 #include <list>
-#include <set>
 #include <map>
 
 #include "common/ustring.h"
@@ -40,6 +39,7 @@
 
 #include "aurora/nwscript/object.h"
 #include "aurora/nwscript/objectcontainer.h"
+#include "aurora/nwscript/delayqueue.h"
 
 #include "graphics/aurora/types.h"
 
@@ -96,7 +96,7 @@ public:
 	void changeModule(const Common::UString &module);
 
 	void delayScript(const Common::UString &script,
-	                 const Aurora::NWScript::ScriptState &state,
+	                 Aurora::NWScript::ScriptState &state,
 	                 Aurora::NWScript::Object *owner, Aurora::NWScript::Object *triggerer,
 	                 uint32 delay);
 
@@ -104,25 +104,6 @@ public:
 	static Common::UString getDescription(const Common::UString &module);
 
 private:
-	enum ActionType {
-		kActionNone   = 0,
-		kActionScript = 1
-	};
-
-	struct Action {
-		ActionType type;
-
-		Common::UString script;
-
-		Aurora::NWScript::ScriptState state;
-		Aurora::NWScript::Object *owner;
-		Aurora::NWScript::Object *triggerer;
-
-		uint32 timestamp;
-
-		bool operator<(const Action &s) const;
-	};
-
 	typedef std::map<Common::UString, Area *> AreaMap;
 
 	Console *_console;
@@ -153,7 +134,7 @@ private:
 
 	Common::UString _newModule; ///< The module we should change to.
 
-	std::multiset<Action> _delayedActions;
+	Aurora::NWScript::DelayQueue _delayedActions;
 
 
 	void unload(); ///< Unload the whole shebang.
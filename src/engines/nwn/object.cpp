@@ -47,6 +47,7 @@
 
 #include "engines/nwn/types.h"
 #include "engines/nwn/object.h"
+#include "engines/nwn/area.h"
 
 namespace Engines {
 
@@ -65,6 +66,8 @@ Object::Object(ObjectType type) : _type(type),
 }
 
 Object::~Object() {
+	setArea(0);
+
 	delete _ssf;
 }
 
@@ -135,7 +138,16 @@ Area *Object::getArea() const {
 }
 
 void Object::setArea(Area *area) {
+	if (area == _area)
+		return;
+
+	if (_area)
+		_area->getObjectGrid().removeObject(*this);
+
 	_area = area;
+
+	if (_area)
+		_area->getObjectGrid().addObject(*this);
 }
 
 Location Object::getLocation() const {
@@ -163,9 +175,15 @@ void Object::getOrientation(float &x, float &y, float &z) const {
 }
 
 void Object::setPosition(float x, float y, float z) {
+	const float oldX = _position[0];
+	const float oldY = _position[1];
+
 	_position[0] = x;
 	_position[1] = y;
 	_position[2] = z;
+
+	if (_area)
+		_area->getObjectGrid().moveObject(*this, oldX, oldY);
 }
 
 void Object::setOrientation(float x, float y, float z) {
@@ -0,0 +1,254 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file engines/nwn/objectgrid.cpp
+ *  A spatial index of the objects within a NWN area.
+ */
+
+#include <algorithm>
+
+#include "common/util.h"
+
+#include "engines/nwn/objectgrid.h"
+#include "engines/nwn/object.h"
+
+namespace Engines {
+
+namespace NWN {
+
+ObjectGrid::Filter::~Filter() {
+}
+
+
+bool ObjectGrid::Candidate::operator<(const Candidate &c) const {
+	if (distance != c.distance)
+		return distance < c.distance;
+
+	// Keep the order of objects the same distance away stable
+	return object->getID() < c.object->getID();
+}
+
+
+ObjectGrid::ObjectGrid() : _width(1), _height(1), _cellSize(1.0f) {
+	_cells.resize(1);
+}
+
+ObjectGrid::~ObjectGrid() {
+}
+
+void ObjectGrid::resize(uint32 width, uint32 height, float cellSize) {
+	std::vector<Object *> objects;
+	getObjects(objects);
+
+	_width    = MAX<uint32>(width , 1);
+	_height   = MAX<uint32>(height, 1);
+	_cellSize = (cellSize > 0.0f) ? cellSize : 1.0f;
+
+	_cells.clear();
+	_cells.resize(_width * _height);
+
+	for (std::vector<Object *>::iterator o = objects.begin(); o != objects.end(); ++o)
+		addObject(**o);
+}
+
+uint32 ObjectGrid::getCellX(float x) const {
+	x /= _cellSize;
+	if (x <= 0.0f)
+		return 0;
+	if (x >= _width)
+		return _width - 1;
+
+	return (uint32) x;
+}
+
+uint32 ObjectGrid::getCellY(float y) const {
+	y /= _cellSize;
+	if (y <= 0.0f)
+		return 0;
+	if (y >= _height)
+		return _height - 1;
+
+	return (uint32) y;
+}
+
+ObjectGrid::Cell &ObjectGrid::getCell(float x, float y) {
+	return _cells[getCellY(y) * _width + getCellX(x)];
+}
+
+void ObjectGrid::addObject(Object &object) {
+	float x, y, z;
+	object.getPosition(x, y, z);
+
+	getCell(x, y).push_back(&object);
+}
+
+void ObjectGrid::removeObject(Object &object) {
+	float x, y, z;
+	object.getPosition(x, y, z);
+
+	Cell &cell = getCell(x, y);
+
+	Cell::iterator o = std::find(cell.begin(), cell.end(), &object);
+	if (o == cell.end())
+		return;
+
+	*o = cell.back();
+	cell.pop_back();
+}
+
+void ObjectGrid::moveObject(Object &object, float oldX, float oldY) {
+	float x, y, z;
+	object.getPosition(x, y, z);
+
+	Cell &oldCell = getCell(oldX, oldY);
+	Cell &newCell = getCell(x, y);
+	if (&oldCell == &newCell)
+		return;
+
+	Cell::iterator o = std::find(oldCell.begin(), oldCell.end(), &object);
+	if (o == oldCell.end())
+		return;
+
+	*o = oldCell.back();
+	oldCell.pop_back();
+
+	newCell.push_back(&object);
+}
+
+void ObjectGrid::getObjects(std::vector<Object *> &objects) const {
+	for (std::vector<Cell>::const_iterator c = _cells.begin(); c != _cells.end(); ++c)
+		objects.insert(objects.end(), c->begin(), c->end());
+}
+
+void ObjectGrid::findObjects(float x1, float y1, float x2, float y2, const Filter &filter,
+                             std::vector<Object *> &objects) const {
+
+	if (x1 > x2)
+		SWAP(x1, x2);
+	if (y1 > y2)
+		SWAP(y1, y2);
+
+	const uint32 cellX1 = getCellX(x1), cellX2 = getCellX(x2);
+	const uint32 cellY1 = getCellY(y1), cellY2 = getCellY(y2);
+
+	for (uint32 cellY = cellY1; cellY <= cellY2; cellY++) {
+		for (uint32 cellX = cellX1; cellX <= cellX2; cellX++) {
+			const Cell &cell = _cells[cellY * _width + cellX];
+
+			for (Cell::const_iterator o = cell.begin(); o != cell.end(); ++o) {
+				float x, y, z;
+				(*o)->getPosition(x, y, z);
+
+				if ((x >= x1) && (x <= x2) && (y >= y1) && (y <= y2) && filter.accept(**o))
+					objects.push_back(*o);
+			}
+		}
+	}
+}
+
+Object *ObjectGrid::findNearestObject(float x, float y, float z, uint32 nth,
+                                      const Filter &filter) const {
+
+	const int32 cellX = getCellX(x);
+	const int32 cellY = getCellY(y);
+
+	const int32 maxRing = MAX(MAX(cellX, (int32) _width  - 1 - cellX),
+	                          MAX(cellY, (int32) _height - 1 - cellY));
+
+	std::vector<Candidate> candidates;
+
+	/* Look at rings of cells around the position, growing outwards. Once we
+	 * found enough objects, and the nth nearest of them is closer than
+	 * anything outside the rings we've already looked at can be, we're done. */
+
+	for (int32 ring = 0; ring <= maxRing; ring++) {
+		const int32 left   = cellX - ring, right = cellX + ring;
+		const int32 bottom = cellY - ring, top   = cellY + ring;
+
+		for (int32 cy = MAX<int32>(bottom, 0); cy <= MIN<int32>(top, _height - 1); cy++) {
+			if ((cy == bottom) || (cy == top)) {
+				for (int32 cx = MAX<int32>(left, 0); cx <= MIN<int32>(right, _width - 1); cx++)
+					findCandidates(_cells[cy * _width + cx], x, y, z, filter, candidates);
+
+				continue;
+			}
+
+			// Between the top and bottom rows, only the outermost cells are part of the ring
+			if (left >= 0)
+				findCandidates(_cells[cy * _width + left ], x, y, z, filter, candidates);
+			if (right < (int32) _width)
+				findCandidates(_cells[cy * _width + right], x, y, z, filter, candidates);
+		}
+
+		if (candidates.size() <= nth)
+			continue;
+
+		std::nth_element(candidates.begin(), candidates.begin() + nth, candidates.end());
+
+		// How close can an object outside the rings be? Not at all, past the grid's borders.
+		float bound = 1.0e30f;
+		if (left   > 0)
+			bound = MIN(bound, x - left * _cellSize);
+		if (right  < (int32) _width - 1)
+			bound = MIN(bound, (right + 1) * _cellSize - x);
+		if (bottom > 0)
+			bound = MIN(bound, y - bottom * _cellSize);
+		if (top    < (int32) _height - 1)
+			bound = MIN(bound, (top + 1) * _cellSize - y);
+
+		if (candidates[nth].distance <= bound)
+			return candidates[nth].object;
+	}
+
+	// The last ring covers the whole grid, so there aren't enough objects
+	return 0;
+}
+
+void ObjectGrid::findCandidates(const Cell &cell, float x, float y, float z, const Filter &filter,
+                                std::vector<Candidate> &candidates) const {
+
+	for (Cell::const_iterator o = cell.begin(); o != cell.end(); ++o) {
+		if (!filter.accept(**o))
+			continue;
+
+		Candidate candidate;
+
+		candidate.distance = getDistance(x, y, z, **o);
+		candidate.object   = *o;
+
+		candidates.push_back(candidate);
+	}
+}
+
+float ObjectGrid::getDistance(float x, float y, float z, const Object &object) {
+	float ox, oy, oz;
+	object.getPosition(ox, oy, oz);
+
+	return ABS(ox - x) + ABS(oy - y) + ABS(oz - z);
+}
+
+} // End of namespace NWN
+
+} // End of namespace Engines
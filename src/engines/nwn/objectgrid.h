@@ -0,0 +1,117 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file engines/nwn/objectgrid.h
+ *  A spatial index of the objects within a NWN area.
+ */
+
+#ifndef ENGINES_NWN_OBJECTGRID_H
+#define ENGINES_NWN_OBJECTGRID_H
+
+#include <vector>
+
+#include "common/types.h"
+
+namespace Engines {
+
+namespace NWN {
+
+class Object;
+
+/** A uniform grid sorting the objects within an area by their position.
+ *
+ *  Each cell of the grid covers one tile of the area. Objects outside of
+ *  the area's bounds are kept in the nearest cell along the border.
+ *
+ *  Distances are measured as the sum of the absolute differences of each
+ *  coordinate, like the scripts always have.
+ */
+class ObjectGrid {
+public:
+	/** A filter deciding which objects a search finds. */
+	class Filter {
+	public:
+		virtual ~Filter();
+
+		virtual bool accept(const Object &object) const = 0;
+	};
+
+	ObjectGrid();
+	~ObjectGrid();
+
+	/** Set the size of the grid, in cells, and the size of each cell. */
+	void resize(uint32 width, uint32 height, float cellSize);
+
+	/** Add an object at its current position. */
+	void addObject(Object &object);
+	/** Remove an object that's at its current position. */
+	void removeObject(Object &object);
+	/** Update the cell of an object that moved away from this position. */
+	void moveObject(Object &object, float oldX, float oldY);
+
+	/** Return all objects within the grid. */
+	void getObjects(std::vector<Object *> &objects) const;
+
+	/** Return all objects within this rectangle that match the filter. */
+	void findObjects(float x1, float y1, float x2, float y2, const Filter &filter,
+	                 std::vector<Object *> &objects) const;
+
+	/** Return the nth (starting from 0) nearest object to this position that matches the filter. */
+	Object *findNearestObject(float x, float y, float z, uint32 nth, const Filter &filter) const;
+
+	/** Return the distance between a position and an object. */
+	static float getDistance(float x, float y, float z, const Object &object);
+
+private:
+	typedef std::vector<Object *> Cell;
+
+	/** An object found while searching for the nearest ones. */
+	struct Candidate {
+		float distance;
+		Object *object;
+
+		bool operator<(const Candidate &c) const;
+	};
+
+	uint32 _width;
+	uint32 _height;
+	float  _cellSize;
+
+	std::vector<Cell> _cells;
+
+	uint32 getCellX(float x) const;
+	uint32 getCellY(float y) const;
+
+	Cell &getCell(float x, float y);
+
+	void findCandidates(const Cell &cell, float x, float y, float z, const Filter &filter,
+	                    std::vector<Candidate> &candidates) const;
+};
+
+} // End of namespace NWN
+
+} // End of namespace Engines
+
+#endif // ENGINES_NWN_OBJECTGRID_H
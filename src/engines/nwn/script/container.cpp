@@ -142,6 +142,13 @@ bool ScriptContainer::runScript(Script script, Aurora::NWScript::Object *owner,
 	return runScript(getScript(script), owner, triggerer);
 }
 
+void ScriptContainer::queueScript(Script script, Aurora::NWScript::Object *owner,
+                                  Aurora::NWScript::Object *triggerer,
+                                  Aurora::NWScript::ScriptPriority priority) {
+
+	ScriptSchedMan.schedule(getScript(script), owner, triggerer, priority);
+}
+
 bool ScriptContainer::runScript(const Common::UString &script,
                                 Aurora::NWScript::Object *owner,
                                 Aurora::NWScript::Object *triggerer) {
@@ -35,6 +35,8 @@
 
 #include "aurora/types.h"
 
+#include "aurora/nwscript/scheduler.h"
+
 #include "engines/nwn/types.h"
 
 namespace Aurora {
@@ -67,6 +69,11 @@ public:
 	                      Aurora::NWScript::Object *owner = 0,
 	                      Aurora::NWScript::Object *triggerer = 0);
 
+	/** Schedule a script, for when its return value isn't needed. */
+	void queueScript(Script script, Aurora::NWScript::Object *owner = 0,
+	                 Aurora::NWScript::Object *triggerer = 0,
+	                 Aurora::NWScript::ScriptPriority priority = Aurora::NWScript::kScriptPriorityNormal);
+
 protected:
 	void clearScripts();
 
@@ -51,19 +51,81 @@ namespace Engines {
 
 namespace NWN {
 
-ObjectDistanceSort::ObjectDistanceSort(const Object &target) {
-	target.getPosition(xt, yt, zt);
+ObjectSearchFilter::ObjectSearchFilter(uint32 types, const Object *exclude,
+                                       const Common::UString &tag) :
+	_types(types), _exclude(exclude), _tag(tag) {
+
+}
+
+ObjectSearchFilter::~ObjectSearchFilter() {
+}
+
+bool ObjectSearchFilter::accept(const Object &object) const {
+	if (&object == _exclude)
+		return false;
+
+	if (!(object.getType() & _types))
+		return false;
+
+	if (!_tag.empty() && !_tag.equalsIgnoreCase(object.getTag()))
+		return false;
+
+	return true;
 }
 
-bool ObjectDistanceSort::operator()(Object *a, Object *b) {
-	return getDistance(*a) < getDistance(*b);
+
+CreatureSearchFilter::CreatureSearchFilter(const Object *exclude) :
+	ObjectSearchFilter(kObjectTypeCreature, exclude) {
+
+}
+
+CreatureSearchFilter::~CreatureSearchFilter() {
+}
+
+void CreatureSearchFilter::addCriterion(int32 type, int32 value) {
+	if (type < 0)
+		return;
+
+	if ((type != kCreatureTypeRacialType) && (type != kCreatureTypePlayerChar) &&
+	    (type != kCreatureTypeClass)      && (type != kCreatureTypeIsAlive)) {
+
+		warning("TODO: Creature search criterion %d", type);
+		return;
+	}
+
+	Criterion criterion;
+
+	criterion.type  = type;
+	criterion.value = value;
+
+	_criteria.push_back(criterion);
 }
 
-float ObjectDistanceSort::getDistance(Object &a) {
-	float x, y, z;
-	a.getPosition(x, y, z);
+bool CreatureSearchFilter::accept(const Object &object) const {
+	if (!ObjectSearchFilter::accept(object))
+		return false;
+
+	const Creature *creature = dynamic_cast<const Creature *>(&object);
+	if (!creature)
+		return false;
+
+	for (std::vector<Criterion>::const_iterator c = _criteria.begin(); c != _criteria.end(); ++c) {
+		bool match = true;
 
-	return ABS(x - xt) + ABS(y - yt) + ABS(z - zt);
+		if      (c->type == kCreatureTypeRacialType)
+			match = creature->getRace() == (uint32) c->value;
+		else if (c->type == kCreatureTypePlayerChar)
+			match = creature->isPC() == (c->value != 0);
+		else if (c->type == kCreatureTypeClass)
+			match = creature->getClassLevel((uint32) c->value) > 0;
+		else if (c->type == kCreatureTypeIsAlive)
+			match = (creature->getCurrentHP() > 0) == (c->value != 0);
+
+		if (!match)
+			return false;
+	}
+
+	return true;
 }
 
 
@@ -168,7 +230,15 @@ ScriptFunctions::Defaults::~Defaults() {
 }
 
 
-ScriptFunctions::ScriptFunctions() {
+bool ScriptFunctions::ShapeSearch::operator==(const ShapeSearch &search) const {
+	return (shape == search.shape) && (size == search.size) && (area == search.area) &&
+	       (x == search.x) && (y == search.y) && (z == search.z) && (types == search.types);
+}
+
+
+ScriptFunctions::ScriptFunctions() : _searchedArea(0), _objectInArea(0), _objectInShape(0) {
+	_searchedShape.area = 0;
+
 	registerFunctions();
 }
 
@@ -178,6 +248,16 @@ ScriptFunctions::~ScriptFunctions() {
 
 void ScriptFunctions::setModule(Module *module) {
 	_module = module;
+
+	// The objects we found might not survive the module
+	_objectsInArea.clear();
+	_objectsInShape.clear();
+
+	_searchedArea       = 0;
+	_searchedShape.area = 0;
+
+	_objectInArea  = 0;
+	_objectInShape = 0;
 }
 
 Common::UString ScriptFunctions::floatToString(float f, int width, int decimals) {
@@ -276,6 +356,18 @@ Area *ScriptFunctions::convertArea(Aurora::NWScript::Object *o) {
 	return dynamic_cast<Area *>(o);
 }
 
+Area *ScriptFunctions::getAreaParam(Aurora::NWScript::FunctionContext &ctx) {
+	Area *area = convertArea(ctx.getParams()[0].getObject());
+	if (area)
+		return area;
+
+	Object *caller = convertObject(ctx.getCaller());
+	if (caller)
+		return caller->getArea();
+
+	return 0;
+}
+
 Module *ScriptFunctions::convertModule(Aurora::NWScript::Object *o) {
 	return dynamic_cast<Module *>(o);
 }
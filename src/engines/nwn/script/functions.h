@@ -30,8 +30,15 @@
 #ifndef ENGINES_NWN_SCRIPT_FUNCTIONS_H
 #define ENGINES_NWN_SCRIPT_FUNCTIONS_H
 
+#include <vector>
+
+#include "common/ustring.h"
+
 #include "aurora/nwscript/objectcontainer.h"
 
+#include "engines/nwn/types.h"
+#include "engines/nwn/objectgrid.h"
+
 namespace Aurora {
 	namespace NWScript {
 		class Variable;
@@ -55,16 +62,40 @@ class Creature;
 
 class Location;
 
-class ObjectDistanceSort {
+/** Decides which objects the script functions searching an area find. */
+class ObjectSearchFilter : public ObjectGrid::Filter {
+public:
+	ObjectSearchFilter(uint32 types, const Object *exclude = 0,
+	                   const Common::UString &tag = "");
+	~ObjectSearchFilter();
+
+	bool accept(const Object &object) const;
+
+private:
+	uint32 _types;           ///< Bitfield of all object types to find.
+	const Object *_exclude;  ///< Never find this object.
+	Common::UString _tag;    ///< Only find objects with this tag, if not empty.
+};
+
+/** Decides which creatures the script functions searching for the nearest creature find. */
+class CreatureSearchFilter : public ObjectSearchFilter {
 public:
-	ObjectDistanceSort(const Object &target);
+	CreatureSearchFilter(const Object *exclude = 0);
+	~CreatureSearchFilter();
 
-	bool operator()(Object *a, Object *b);
+	/** Only find creatures matching this criterion, too. Criteria of type -1 are ignored. */
+	void addCriterion(int32 type, int32 value);
+
+	bool accept(const Object &object) const;
 
 private:
-	float xt, yt, zt;
+	/** A CreatureType and the value the creature needs to have. */
+	struct Criterion {
+		int32 type;
+		int32 value;
+	};
 
-	float getDistance(Object &a);
+	std::vector<Criterion> _criteria;
 };
 
 class ScriptFunctions {
@@ -132,6 +163,26 @@ private:
 
 	Aurora::NWScript::ObjectContainer::SearchContext _objSearchContext;
 
+	/** The parameters of a GetFirstObjectInShape() call. */
+	struct ShapeSearch {
+		int32  shape;
+		float  size;
+		Area  *area;
+		float  x, y, z;
+		uint32 types;
+
+		bool operator==(const ShapeSearch &search) const;
+	};
+
+	std::vector<Object *> _objectsInArea;  ///< Objects found by GetFirstObjectInArea().
+	std::vector<Object *> _objectsInShape; ///< Objects found by GetFirstObjectInShape().
+
+	Area       *_searchedArea;  ///< The area GetFirstObjectInArea() searched.
+	ShapeSearch _searchedShape; ///< The shape GetFirstObjectInShape() searched.
+
+	size_t _objectInArea;  ///< The next object GetNextObjectInArea() returns.
+	size_t _objectInShape; ///< The next object GetNextObjectInShape() returns.
+
 
 	void registerFunctions();
 	void registerFunctions000(const Defaults &d);
@@ -162,6 +213,11 @@ private:
 
 	Location *convertLocation(Aurora::NWScript::EngineType *e);
 
+	/** Return the area given as the first parameter, or the caller's area if there's none. */
+	Area *getAreaParam(Aurora::NWScript::FunctionContext &ctx);
+	/** Read the parameters of GetFirst/NextObjectInShape(). */
+	bool getShapeParams(Aurora::NWScript::FunctionContext &ctx, ShapeSearch &search);
+
 	void jumpTo(Object *object, Area *area, float x, float y, float z);
 
 	void random(Aurora::NWScript::FunctionContext &ctx);
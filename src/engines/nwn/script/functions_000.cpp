@@ -41,6 +41,7 @@
 
 #include "engines/nwn/types.h"
 #include "engines/nwn/module.h"
+#include "engines/nwn/area.h"
 #include "engines/nwn/object.h"
 #include "engines/nwn/door.h"
 #include "engines/nwn/creature.h"
@@ -439,7 +440,7 @@ void ScriptFunctions::assignCommand(Aurora::NWScript::FunctionContext &ctx) {
 	if (!object)
 		object = ctx.getCaller();
 
-	const Aurora::NWScript::ScriptState &state = ctx.getParams()[1].getScriptState();
+	Aurora::NWScript::ScriptState &state = ctx.getParams()[1].getScriptState();
 
 	_module->delayScript(script, state, object, ctx.getTriggerer(), 0);
 }
@@ -454,7 +455,7 @@ void ScriptFunctions::delayCommand(Aurora::NWScript::FunctionContext &ctx) {
 
 	uint32 delay = ctx.getParams()[0].getFloat() * 1000;
 
-	const Aurora::NWScript::ScriptState &state = ctx.getParams()[1].getScriptState();
+	Aurora::NWScript::ScriptState &state = ctx.getParams()[1].getScriptState();
 
 	_module->delayScript(script, state, ctx.getCaller(), ctx.getTriggerer(), delay);
 }
@@ -690,35 +691,19 @@ void ScriptFunctions::getNearestCreature(Aurora::NWScript::FunctionContext &ctx)
 
 	int nth = ctx.getParams()[3].getInt() - 1;
 
-	// TODO: ScriptFunctions::getNearestCreature(): Critia
-	/*
-	int crit1Type  = ctx.getParams()[0].getInt();
-	int crit1Value = ctx.getParams()[1].getInt();
-	int crit2Type  = ctx.getParams()[4].getInt();
-	int crit2Value = ctx.getParams()[5].getInt();
-	int crit3Type  = ctx.getParams()[6].getInt();
-	int crit3Value = ctx.getParams()[7].getInt();
-	*/
-
-	if (!_module->findObjectInit(_objSearchContext))
+	if ((nth < 0) || !target->getArea())
 		return;
 
-	std::list<Object *> creatures;
-	while (_module->findNextObject(_objSearchContext)) {
-		Creature *creature = convertCreature(_objSearchContext.getObject());
-
-		if (creature && (creature != target) && (creature->getArea() == target->getArea()))
-			creatures.push_back(creature);
-	}
+	float x, y, z;
+	target->getPosition(x, y, z);
 
-	creatures.sort(ObjectDistanceSort(*target));
+	CreatureSearchFilter filter(target);
 
-	std::list<Object *>::iterator it = creatures.begin();
-	for (int n = 0; (n < nth) && (it != creatures.end()); ++n)
-		++it;
+	filter.addCriterion(ctx.getParams()[0].getInt(), ctx.getParams()[1].getInt());
+	filter.addCriterion(ctx.getParams()[4].getInt(), ctx.getParams()[5].getInt());
+	filter.addCriterion(ctx.getParams()[6].getInt(), ctx.getParams()[7].getInt());
 
-	if (it != creatures.end())
-		ctx.getReturn() = *it;
+	ctx.getReturn() = target->getArea()->getObjectGrid().findNearestObject(x, y, z, nth, filter);
 }
 
 void ScriptFunctions::actionSpeakString(Aurora::NWScript::FunctionContext &ctx) {
@@ -1038,11 +1023,31 @@ void ScriptFunctions::intToString(Aurora::NWScript::FunctionContext &ctx) {
 }
 
 void ScriptFunctions::getFirstObjectInArea(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetFirstObjectInArea");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	_objectsInArea.clear();
+	_objectInArea = 0;
+
+	_searchedArea = getAreaParam(ctx);
+	if (!_searchedArea)
+		return;
+
+	_searchedArea->getObjectGrid().getObjects(_objectsInArea);
+
+	getNextObjectInArea(ctx);
 }
 
 void ScriptFunctions::getNextObjectInArea(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetNextObjectInArea");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	// We can only continue the search through the area GetFirstObjectInArea() was called for
+	if (!_searchedArea || (getAreaParam(ctx) != _searchedArea))
+		return;
+
+	if (_objectInArea >= _objectsInArea.size())
+		return;
+
+	ctx.getReturn() = _objectsInArea[_objectInArea++];
 }
 
 void ScriptFunctions::d2(Aurora::NWScript::FunctionContext &ctx) {
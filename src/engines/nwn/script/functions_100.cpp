@@ -39,9 +39,11 @@
 
 #include "engines/nwn/types.h"
 #include "engines/nwn/module.h"
+#include "engines/nwn/area.h"
 #include "engines/nwn/object.h"
 #include "engines/nwn/waypoint.h"
 #include "engines/nwn/creature.h"
+#include "engines/nwn/location.h"
 
 #include "engines/nwn/script/functions.h"
 
@@ -542,11 +544,82 @@ void ScriptFunctions::getAlignmentGoodEvil(Aurora::NWScript::FunctionContext &ct
 }
 
 void ScriptFunctions::getFirstObjectInShape(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetFirstObjectInShape");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	_objectsInShape.clear();
+	_objectInShape = 0;
+
+	_searchedShape.area = 0;
+	if (!getShapeParams(ctx, _searchedShape))
+		return;
+
+	const Shape shape = (Shape) _searchedShape.shape;
+	const float size  = _searchedShape.size;
+
+	const float x = _searchedShape.x, y = _searchedShape.y, z = _searchedShape.z;
+
+	if (ctx.getParams()[3].getInt() != 0)
+		warning("TODO: GetFirstObjectInShape: Line of sight");
+	if ((shape == kShapeCone) || (shape == kShapeSpellCone))
+		warning("TODO: GetFirstObjectInShape: Cones, searching a sphere instead");
+
+	ObjectSearchFilter filter(_searchedShape.types);
+
+	_searchedShape.area->getObjectGrid().findObjects(x - size, y - size, x + size, y + size,
+	                                                 filter, _objectsInShape);
+
+	// The grid found everything within the square around the shape, throw out the rest
+	std::vector<Object *>::iterator o = _objectsInShape.begin();
+	while (o != _objectsInShape.end()) {
+		float ox, oy, oz;
+		(*o)->getPosition(ox, oy, oz);
+
+		const float dx = ox - x, dy = oy - y, dz = oz - z;
+
+		bool inside;
+		if      (shape == kShapeCube)
+			inside = ABS(dz) <= size;
+		else if (shape == kShapeSpellCylinder)
+			inside = (dx * dx + dy * dy) <= (size * size);
+		else
+			inside = (dx * dx + dy * dy + dz * dz) <= (size * size);
+
+		if (inside)
+			++o;
+		else
+			o = _objectsInShape.erase(o);
+	}
+
+	getNextObjectInShape(ctx);
+}
+
+bool ScriptFunctions::getShapeParams(Aurora::NWScript::FunctionContext &ctx, ShapeSearch &search) {
+	Location *location = convertLocation(ctx.getParams()[2].getEngineType());
+	if (!location || !location->getArea())
+		return false;
+
+	search.shape = ctx.getParams()[0].getInt();
+	search.size  = ctx.getParams()[1].getFloat();
+	search.area  = location->getArea();
+	search.types = (uint32) ctx.getParams()[4].getInt();
+
+	location->getPosition(search.x, search.y, search.z);
+
+	return true;
 }
 
 void ScriptFunctions::getNextObjectInShape(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetNextObjectInShape");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	// We can only continue the search through the shape GetFirstObjectInShape() was called for
+	ShapeSearch search;
+	if (!_searchedShape.area || !getShapeParams(ctx, search) || !(search == _searchedShape))
+		return;
+
+	if (_objectInShape >= _objectsInShape.size())
+		return;
+
+	ctx.getReturn() = _objectsInShape[_objectInShape++];
 }
 
 void ScriptFunctions::effectEntangle(Aurora::NWScript::FunctionContext &ctx) {
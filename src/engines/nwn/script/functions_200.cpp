@@ -610,7 +610,26 @@ void ScriptFunctions::getFacingFromLocation(Aurora::NWScript::FunctionContext &c
 }
 
 void ScriptFunctions::getNearestCreatureToLocation(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetNearestCreatureToLocation");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	Location *location = convertLocation(ctx.getParams()[2].getEngineType());
+	if (!location || !location->getArea())
+		return;
+
+	int nth = ctx.getParams()[3].getInt() - 1;
+	if (nth < 0)
+		return;
+
+	float x, y, z;
+	location->getPosition(x, y, z);
+
+	CreatureSearchFilter filter;
+
+	filter.addCriterion(ctx.getParams()[0].getInt(), ctx.getParams()[1].getInt());
+	filter.addCriterion(ctx.getParams()[4].getInt(), ctx.getParams()[5].getInt());
+	filter.addCriterion(ctx.getParams()[6].getInt(), ctx.getParams()[7].getInt());
+
+	ctx.getReturn() = location->getArea()->getObjectGrid().findNearestObject(x, y, z, nth, filter);
 }
 
 void ScriptFunctions::getNearestObject(Aurora::NWScript::FunctionContext &ctx) {
@@ -623,33 +642,38 @@ void ScriptFunctions::getNearestObject(Aurora::NWScript::FunctionContext &ctx) {
 	if (!target)
 		return;
 
-	ObjectType type = (ObjectType) ctx.getParams()[0].getInt();
+	uint32 types = (uint32) ctx.getParams()[0].getInt();
 	int nth = ctx.getParams()[2].getInt() - 1;
 
-	if (!_module->findObjectInit(_objSearchContext))
+	if ((nth < 0) || !target->getArea())
 		return;
 
-	std::list<Object *> objects;
-	while (_module->findNextObject(_objSearchContext)) {
-		Object *object = convertObject(_objSearchContext.getObject());
-
-		if (object && (object != target) && (object->getType() == type) &&
-		    (object->getArea() == target->getArea()))
-			objects.push_back(object);
-	}
-
-	objects.sort(ObjectDistanceSort(*target));
+	float x, y, z;
+	target->getPosition(x, y, z);
 
-	std::list<Object *>::iterator it = objects.begin();
-	for (int n = 0; (n < nth) && (it != objects.end()); ++n)
-		++it;
+	ObjectSearchFilter filter(types, target);
 
-	if (it != objects.end())
-		ctx.getReturn() = *it;
+	ctx.getReturn() = target->getArea()->getObjectGrid().findNearestObject(x, y, z, nth, filter);
 }
 
 void ScriptFunctions::getNearestObjectToLocation(Aurora::NWScript::FunctionContext &ctx) {
-	warning("TODO: GetNearestObjectToLocation");
+	ctx.getReturn() = (Aurora::NWScript::Object *) 0;
+
+	Location *location = convertLocation(ctx.getParams()[1].getEngineType());
+	if (!location || !location->getArea())
+		return;
+
+	uint32 types = (uint32) ctx.getParams()[0].getInt();
+	int nth = ctx.getParams()[2].getInt() - 1;
+	if (nth < 0)
+		return;
+
+	float x, y, z;
+	location->getPosition(x, y, z);
+
+	ObjectSearchFilter filter(types);
+
+	ctx.getReturn() = location->getArea()->getObjectGrid().findNearestObject(x, y, z, nth, filter);
 }
 
 void ScriptFunctions::getNearestObjectByTag(Aurora::NWScript::FunctionContext &ctx) {
@@ -669,25 +693,15 @@ void ScriptFunctions::getNearestObjectByTag(Aurora::NWScript::FunctionContext &c
 
 	int nth = ctx.getParams()[2].getInt() - 1;
 
-	if (!_module->findObjectInit(_objSearchContext, tag))
+	if ((nth < 0) || !target->getArea())
 		return;
 
-	std::list<Object *> objects;
-	while (_module->findNextObject(_objSearchContext)) {
-		Object *object = convertObject(_objSearchContext.getObject());
-
-		if (object && (object != target) && (object->getArea() == target->getArea()))
-			objects.push_back(object);
-	}
-
-	objects.sort(ObjectDistanceSort(*target));
+	float x, y, z;
+	target->getPosition(x, y, z);
 
-	std::list<Object *>::iterator it = objects.begin();
-	for (int n = 0; (n < nth) && (it != objects.end()); ++n)
-		++it;
+	ObjectSearchFilter filter(kObjectTypeAll, target, tag);
 
-	if (it != objects.end())
-		ctx.getReturn() = *it;
+	ctx.getReturn() = target->getArea()->getObjectGrid().findNearestObject(x, y, z, nth, filter);
 }
 
 void ScriptFunctions::intToFloat(Aurora::NWScript::FunctionContext &ctx) {
@@ -1072,7 +1086,7 @@ void ScriptFunctions::actionDoCommand(Aurora::NWScript::FunctionContext &ctx) {
 	if (script.empty())
 		throw Common::Exception("ScriptFunctions::actionDoCommand(): Script needed");
 
-	const Aurora::NWScript::ScriptState &state = ctx.getParams()[0].getScriptState();
+	Aurora::NWScript::ScriptState &state = ctx.getParams()[0].getScriptState();
 
 	_module->delayScript(script, state, ctx.getCaller(), ctx.getTriggerer(), 0);
 }
@@ -252,6 +252,26 @@ enum Ability {
 	kAbilityMAX
 };
 
+enum Shape {
+	kShapeSpellCylinder = 0,
+	kShapeCone          = 1,
+	kShapeCube          = 2,
+	kShapeSpellCone     = 3,
+	kShapeSphere        = 4
+};
+
+/** The criteria GetNearestCreature() can use to find creatures. */
+enum CreatureType {
+	kCreatureTypeRacialType             = 0,
+	kCreatureTypePlayerChar             = 1,
+	kCreatureTypeClass                  = 2,
+	kCreatureTypeReputation             = 3,
+	kCreatureTypeIsAlive                = 4,
+	kCreatureTypeHasSpellEffect         = 5,
+	kCreatureTypeDoesNotHaveSpellEffect = 6,
+	kCreatureTypePerception             = 7
+};
+
 enum Alignment {
 	kAlignmentAll     = 0,
 	kAlignmentNeutral = 1,
@@ -71,16 +71,26 @@ void Animation::setTransTime(float transtime) {
 	_transtime = transtime;
 }
 
-void Animation::update(Model *model, float lastFrame, float nextFrame) {
+void Animation::bind(Model &model, std::vector<AnimNodeTarget> &targets) const {
+	targets.clear();
+	targets.reserve(nodeList.size());
+
+	for (NodeList::const_iterator n = nodeList.begin(); n != nodeList.end(); ++n)
+		targets.push_back((*n)->bind(model));
+}
+
+void Animation::evaluate(std::vector<AnimNodeTarget> &targets, float scale,
+                         float lastFrame, float nextFrame, bool rootOnly) const {
+
 	// TODO: Also need to fire off associated events
 	//       for event in _events event->fire()
 
+	assert(targets.size() == nodeList.size());
 
-	float scale = model->getAnimationScale(_name);
-	for (NodeList::iterator n = nodeList.begin();
-	     n != nodeList.end(); ++n) {
-		(*n)->update(model, lastFrame, nextFrame, scale);
-	}
+	std::vector<AnimNodeTarget>::iterator t = targets.begin();
+	for (NodeList::const_iterator n = nodeList.begin(); n != nodeList.end(); ++n, ++t)
+		if (!rootOnly || t->root)
+			(*n)->evaluate(*t, lastFrame, nextFrame, scale);
 }
 
 void Animation::addAnimNode(AnimNode *node) {
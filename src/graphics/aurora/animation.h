@@ -53,6 +53,7 @@ namespace Graphics {
 namespace Aurora {
 
 class AnimNode;
+struct AnimNodeTarget;
 
 class Animation {
 public:
@@ -81,7 +82,18 @@ public:
 	float getLength() const;
 	void setTransTime(float transtime);
 
-	void update(Model *model, float lastFrame, float nextFrame);
+	/** Find the model nodes this animation animates within that model, one for each animation node. */
+	void bind(Model &model, std::vector<AnimNodeTarget> &targets) const;
+
+	/** Evaluate the bound model nodes' properties, interpolating between frames.
+	 *
+	 *  The results are only stored in the targets, and still need to be
+	 *  applied to the model nodes. If rootOnly is set, only the model's
+	 *  root nodes are evaluated.
+	 */
+	void evaluate(std::vector<AnimNodeTarget> &targets, float scale, float lastFrame, float nextFrame,
+	              bool rootOnly = false) const;
+
 	void addAnimNode(AnimNode *node);
 };
 
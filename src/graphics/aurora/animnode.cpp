@@ -39,6 +39,14 @@ namespace Graphics {
 
 namespace Aurora {
 
+AnimNodeTarget::AnimNodeTarget(ModelNode *n) : node(n), root(n && !n->getParent()),
+	positionFrame(0), orientationFrame(0), evaluated(false) {
+
+	position[0] = 0.0f; position[1] = 0.0f; position[2] = 0.0f;
+
+	orientation[0] = 0.0f; orientation[1] = 0.0f; orientation[2] = 0.0f; orientation[3] = 0.0f;
+}
+
 
 AnimNode::AnimNode(ModelNode *modelnode) :
 	_parent(0) {
@@ -67,24 +75,29 @@ const Common::UString &AnimNode::getName() const {
 	return _name;
 }
 
-void AnimNode::update(Model *model, float lastFrame, float nextFrame, float scale) {
+AnimNodeTarget AnimNode::bind(Model &model) const {
 	if (!_nodedata)
-		return;
+		return AnimNodeTarget();
+
+	return AnimNodeTarget(model.getNode(_name));
+}
 
-	ModelNode *target = model->getNode(_name);
-	if (!target)
+void AnimNode::evaluate(AnimNodeTarget &target, float lastFrame, float nextFrame, float scale) const {
+	if (!_nodedata || !target.node)
 		return;
 
 	// Determine the corresponding keyframes
 	float posX, posY, posZ;
-	_nodedata->interpolatePosition(nextFrame, posX, posY, posZ);
+	_nodedata->interpolatePosition(nextFrame, target.positionFrame, posX, posY, posZ);
+
+	float *o = target.orientation;
+	_nodedata->interpolateOrientation(nextFrame, target.orientationFrame, o[0], o[1], o[2], o[3]);
 
-	float oX, oY, oZ, oA;
-	_nodedata->interpolateOrientation(nextFrame, oX, oY, oZ, oA);
+	target.position[0] = posX * scale;
+	target.position[1] = posY * scale;
+	target.position[2] = posZ * scale;
 
-	// Update the position/orientation of corresponding modelnode
-	target->setPosition(posX * scale, posY * scale, posZ * scale);
-	target->setOrientation(oX, oY, oZ, oA);
+	target.evaluated = true;
 }
 
 } // End of namespace Aurora
@@ -46,8 +46,26 @@ namespace Graphics {
 
 namespace Aurora {
 
+class Model;
 class ModelNode;
 
+/** The model node an animation node animates, within one specific model. */
+struct AnimNodeTarget {
+	ModelNode *node; ///< The model node to animate, or 0 if there's none.
+
+	bool root; ///< Is the model node one of the model's root nodes?
+
+	uint32 positionFrame;    ///< The position keyframe last used, to continue searching from.
+	uint32 orientationFrame; ///< The orientation keyframe last used, to continue searching from.
+
+	float position   [3]; ///< The evaluated position, not yet applied to the node.
+	float orientation[4]; ///< The evaluated orientation, not yet applied to the node.
+
+	bool evaluated; ///< Were position and orientation evaluated, but not yet applied?
+
+	AnimNodeTarget(ModelNode *n = 0);
+};
+
 class AnimNode {
 public:
 	AnimNode(ModelNode *modelnode);
@@ -56,8 +74,15 @@ public:
 	/** Get the node's name. */
 	const Common::UString &getName() const;
 
-	/** Update the model properties interpolating between frames */
-	void update(Model *model, float lastFrame, float nextFrame, float scale);
+	/** Find the model node this node animates within that model. */
+	AnimNodeTarget bind(Model &model) const;
+
+	/** Evaluate the target node's properties interpolating between frames.
+	 *
+	 *  This only changes the target, not the node itself, and is safe to
+	 *  run in parallel for different targets.
+	 */
+	void evaluate(AnimNodeTarget &target, float lastFrame, float nextFrame, float scale) const;
 protected:
 	// Animation *_animation; ///< The animation this node belongs to.
 
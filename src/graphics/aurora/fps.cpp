@@ -38,12 +38,15 @@ namespace Graphics {
 
 namespace Aurora {
 
-FPS::FPS(const FontHandle &font) : Text(font, "0 fps"), _fps(0) {
+FPS::FPS(const FontHandle &font) : Text(font, "0 fps"), _fps(0),
+	_worldObjects(0), _culledObjects(0), _textureBinds(0), _stateChanges(0), _elidedChanges(0) {
+
 	init();
 }
 
 FPS::FPS(const FontHandle &font, float r, float g, float b, float a) :
-	Text(font, "0 fps", r, g, b, a), _fps(0) {
+	Text(font, "0 fps", r, g, b, a), _fps(0), _worldObjects(0), _culledObjects(0),
+	_textureBinds(0), _stateChanges(0), _elidedChanges(0) {
 
 	init();
 }
@@ -62,12 +65,31 @@ void FPS::render(RenderPass pass) {
 	if (pass == kRenderPassOpaque)
 		return;
 
-	uint32 fps = GfxMan.getFPS();
-
-	if (fps != _fps) {
-		_fps = fps;
-
-		set(Common::UString::sprintf("%d fps", _fps));
+	uint32 fps           = GfxMan.getFPS();
+	uint32 worldObjects  = GfxMan.getWorldObjectCount();
+	uint32 culledObjects = GfxMan.getCulledObjectCount();
+	uint32 textureBinds  = GfxMan.getTextureBindCount();
+	uint32 stateChanges  = GfxMan.getStateChangeCount();
+	uint32 elidedChanges = GfxMan.getElidedChangeCount();
+
+	if ((fps != _fps) || (worldObjects != _worldObjects) || (culledObjects != _culledObjects) ||
+	    (textureBinds != _textureBinds) || (stateChanges != _stateChanges) ||
+	    (elidedChanges != _elidedChanges)) {
+
+		_fps           = fps;
+		_worldObjects  = worldObjects;
+		_culledObjects = culledObjects;
+		_textureBinds  = textureBinds;
+		_stateChanges  = stateChanges;
+		_elidedChanges = elidedChanges;
+
+		if (_worldObjects == 0)
+			set(Common::UString::sprintf("%d fps", _fps));
+		else
+			set(Common::UString::sprintf("%d fps, %d/%d objects culled, %d texture binds, "
+			                             "%d state changes, %d redundant changes dropped",
+			                             _fps, _culledObjects, _worldObjects, _textureBinds,
+			                             _stateChanges, _elidedChanges));
 	}
 
 	Text::render(pass);
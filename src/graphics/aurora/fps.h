@@ -52,6 +52,12 @@ public:
 private:
 	uint32 _fps;
 
+	uint32 _worldObjects;  ///< Number of world objects in the last frame.
+	uint32 _culledObjects; ///< Number of world objects culled from the last frame.
+	uint32 _textureBinds;  ///< Number of textures bound in the last frame.
+	uint32 _stateChanges;  ///< Number of other state changes in the last frame.
+	uint32 _elidedChanges; ///< Number of redundant state changes dropped in the last frame.
+
 	void init();
 
 	void notifyResized(int oldWidth, int oldHeight, int newWidth, int newHeight);
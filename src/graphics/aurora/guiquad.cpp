@@ -31,6 +31,7 @@
 #include "common/ustring.h"
 
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 #include "graphics/aurora/guiquad.h"
 #include "graphics/aurora/texture.h"
@@ -180,7 +181,7 @@ void GUIQuad::render(RenderPass pass) {
 	glColor4f(_r, _g, _b, _a);
 
 	if (_xor) {
-		glEnable(GL_COLOR_LOGIC_OP);
+		GLStateMan.enable(GL_COLOR_LOGIC_OP);
 		glLogicOp(GL_XOR);
 	}
 
@@ -196,7 +197,7 @@ void GUIQuad::render(RenderPass pass) {
 	glEnd();
 
 	if (_xor)
-		glDisable(GL_COLOR_LOGIC_OP);
+		GLStateMan.disable(GL_COLOR_LOGIC_OP);
 
 	glColor4f(1.0, 1.0, 1.0, 1.0);
 }
@@ -31,9 +31,11 @@
 
 #include "common/stream.h"
 #include "common/debug.h"
+#include "common/frustum.h"
 
 #include "graphics/graphics.h"
 #include "graphics/camera.h"
+#include "graphics/glstate.h"
 
 #include "graphics/aurora/model.h"
 #include "graphics/aurora/animation.h"
@@ -47,8 +49,10 @@ namespace Aurora {
 
 Model::Model(ModelType type) : Renderable((RenderableType) type),
 	_type(type), _supermodel(0), _currentState(0),
-	_currentAnimation(0), _nextAnimation(0), _drawBound(false),
-	_lists(0) {
+	_currentAnimation(0), _nextAnimation(0), _boundAnimation(0),
+	_boundAnimationScale(1.0f), _animationEvaluated(false), _animationLOD(kAnimationLODFull),
+	_drawBound(false),
+	_lists(0), _hasBuffers(false) {
 
 	for (int i = 0; i < kRenderPassAll; i++)
 		_needBuild[i] = true;
@@ -63,6 +67,52 @@ Model::Model(ModelType type) : Renderable((RenderableType) type),
 	_elapsedTime = 0.0;
 
 	_loopAnimation = 0;
+
+	// Spread the reduced rate animation updates of different models over different frames
+	_animationLODTime = (_id % 16) / 16.0f;
+
+	// Models pick their default animations on animation worker threads, so each needs its own random numbers
+	_randomState = _id + SDL_GetTicks();
+}
+
+Model::Model(const boost::shared_ptr<Model> &modelTemplate) :
+	Renderable((RenderableType) modelTemplate->_type),
+	_type(modelTemplate->_type), _supermodel(modelTemplate->_supermodel), _currentState(0),
+	_currentAnimation(0), _nextAnimation(0), _boundAnimation(0),
+	_boundAnimationScale(1.0f), _animationEvaluated(false), _animationLOD(kAnimationLODFull),
+	_drawBound(false),
+	_lists(0), _hasBuffers(false), _template(modelTemplate) {
+
+	for (int i = 0; i < kRenderPassAll; i++)
+		_needBuild[i] = true;
+
+	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
+	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
+
+	_elapsedTime   = 0.0;
+	_loopAnimation = 0;
+
+	_animationLODTime = (_id % 16) / 16.0f;
+
+	_randomState = _id + SDL_GetTicks();
+
+	const Model &model = *modelTemplate;
+
+	_fileName       = model._fileName;
+	_name           = model._name;
+	_superModelName = model._superModelName;
+
+	_modelScale[0] = model._modelScale[0];
+	_modelScale[1] = model._modelScale[1];
+	_modelScale[2] = model._modelScale[2];
+
+	_animationScale    = model._animationScale;
+	_animationMap      = model._animationMap;
+	_defaultAnimations = model._defaultAnimations;
+
+	copyStates(model);
+
+	finalize();
 }
 
 Model::~Model() {
@@ -123,6 +173,21 @@ bool Model::isIn(float x1, float y1, float z1, float x2, float y2, float z2) con
 	return _absoluteBoundBox.isIn(x1, y1, z1, x2, y2, z2);
 }
 
+bool Model::isIn(const Common::Frustum &frustum) const {
+	// GUI models aren't in the world, and we can't cull what we can't bound
+	if ((_type == kModelTypeGUIFront) || _absoluteBoundBox.isEmpty())
+		return true;
+
+	return frustum.isIn(_absoluteBoundBox);
+}
+
+const Common::BoundingBox *Model::getAbsoluteBound() const {
+	if (_type == kModelTypeGUIFront)
+		return 0;
+
+	return &_absoluteBoundBox;
+}
+
 float Model::getWidth() const {
 	return _boundBox.getWidth() * _modelScale[0];
 }
@@ -156,8 +221,15 @@ void Model::playDefaultAnimation() {
 	_loopAnimation = 0;
 }
 
-Animation *Model::selectDefaultAnimation() const {
-	uint8 pick = std::rand() % 100;
+uint32 Model::getRandom() {
+	// A linear congruential generator, with the constants of most std::rand() implementations
+	_randomState = _randomState * 1103515245 + 12345;
+
+	return (_randomState >> 16) & 0x7FFF;
+}
+
+Animation *Model::selectDefaultAnimation() {
+	uint8 pick = getRandom() % 100;
 	for (DefaultAnimations::const_iterator a = _defaultAnimations.begin(); a != _defaultAnimations.end(); ++a) {
 		if (pick < a->probability)
 			return a->animation;
@@ -255,6 +327,8 @@ void Model::createAbsolutePosition() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	updateBound();
 }
 
 const std::list<Common::UString> &Model::getStates() const {
@@ -289,6 +363,10 @@ void Model::setState(const Common::UString &name) {
 
 	_currentState = state;
 
+	// The animated nodes changed
+	_boundAnimation     = 0;
+	_animationEvaluated = false;
+
 	// TODO: Do we need to recreate the bounding box on a state change?
 
 	// createBound();
@@ -408,9 +486,60 @@ bool Model::buildList(RenderPass pass) {
 	if (_lists == 0)
 		_lists = glGenLists(kRenderPassAll);
 
+	// Textures still decoding only have their placeholder recorded into the list,
+	// and their nodes are only guessed to be opaque or transparent
+	const bool texturesReady = updateTransparency();
+
+	// State changes are only recorded into the list. Don't leave anything out,
+	// and don't assume anything about the state afterwards.
+	GLStateMan.invalidate();
+
 	glNewList(_lists + pass, GL_COMPILE);
 
+	renderNodes(pass);
+
+	glEndList();
+
+	GLStateMan.invalidate();
+
+
+	_needBuild[pass] = !texturesReady;
+	return true;
+}
+
+bool Model::updateTransparency() {
+	bool ready = true;
+
+	for (NodeList::iterator n = _currentState->nodeList.begin(); n != _currentState->nodeList.end(); ++n)
+		if (!(*n)->updateTransparency())
+			ready = false;
+
+	return ready;
+}
+
+void Model::buildBuffers() {
+	if (_hasBuffers)
+		return;
+
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+			(*n)->buildBuffers();
+
+	_hasBuffers = true;
+}
+
+void Model::destroyBuffers() {
+	if (!_hasBuffers)
+		return;
 
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+			(*n)->destroyBuffers();
+
+	_hasBuffers = false;
+}
+
+void Model::renderNodes(RenderPass pass) {
 	// Apply our global model transformation
 
 	glScalef(_modelScale[0], _modelScale[1], _modelScale[2]);
@@ -437,17 +566,29 @@ bool Model::buildList(RenderPass pass) {
 		(*n)->render(pass);
 		glPopMatrix();
 	}
+}
 
+void Model::advanceTime(float dt) {
+	manageAnimations(dt);
+}
 
-	glEndList();
+void Model::applyAnimation() {
+	if (!_animationEvaluated)
+		return;
 
+	_animationEvaluated = false;
 
-	_needBuild[pass] = false;
-	return true;
-}
+	for (std::vector<AnimNodeTarget>::iterator t = _animationTargets.begin();
+	     t != _animationTargets.end(); ++t) {
 
-void Model::advanceTime(float dt) {
-	manageAnimations(dt);
+		if (!t->node || !t->evaluated)
+			continue;
+
+		t->node->setPosition(t->position[0], t->position[1], t->position[2]);
+		t->node->setOrientation(t->orientation[0], t->orientation[1], t->orientation[2], t->orientation[3]);
+
+		t->evaluated = false;
+	}
 }
 
 void Model::manageAnimations(float dt) {
@@ -489,9 +630,68 @@ void Model::manageAnimations(float dt) {
 		nextFrame    = 0.0f;
 	}
 
-	// Update the animation, if we have any
-	if (_currentAnimation)
-		_currentAnimation->update(this, lastFrame, nextFrame);
+	// Update the animation, if we have any and it's due at our level of detail
+	if (_currentAnimation && updateAnimationLOD(dt)) {
+		if (_boundAnimation != _currentAnimation)
+			bindAnimation();
+
+		const bool rootOnly = _animationLOD == kAnimationLODRoot;
+
+		_currentAnimation->evaluate(_animationTargets, _boundAnimationScale, lastFrame, nextFrame, rootOnly);
+
+		_animationEvaluated = true;
+	}
+}
+
+bool Model::updateAnimationLOD(float dt) {
+	const AnimationLOD &lod = GfxMan.getAnimationLOD();
+
+	// GUI models are always fully animated
+	if (_type != kModelTypeObject) {
+		_animationLOD = kAnimationLODFull;
+		return true;
+	}
+
+	// Find the level for our distance to the camera. To avoid flickering between
+	// two levels at the border, we need to come back a bit closer to get more detail.
+	const float closer = 1.0f - lod.hysteresis;
+
+	float reducedDistance = lod.reducedDistance;
+	if (_animationLOD >= kAnimationLODReduced)
+		reducedDistance *= closer;
+
+	float rootDistance = lod.rootDistance;
+	if (_animationLOD >= kAnimationLODRoot)
+		rootDistance *= closer;
+
+	_animationLOD = kAnimationLODFull;
+	if ((lod.reducedDistance > 0.0f) && (_distance > reducedDistance))
+		_animationLOD = kAnimationLODReduced;
+	if ((lod.rootDistance    > 0.0f) && (_distance > rootDistance))
+		_animationLOD = kAnimationLODRoot;
+
+	// Off screen, the animation won't be seen anyway. Time still advances,
+	// so the animation continues at the right place once we're back.
+	if (lod.freezeOffScreen && !isOnScreen())
+		return false;
+
+	if (_animationLOD == kAnimationLODFull)
+		return true;
+
+	// Only update at the reduced rate
+	_animationLODTime += dt * lod.reducedRate;
+	if (_animationLODTime < 1.0f)
+		return false;
+
+	_animationLODTime = 0.0f;
+	return true;
+}
+
+void Model::bindAnimation() {
+	_currentAnimation->bind(*this, _animationTargets);
+
+	_boundAnimation      = _currentAnimation;
+	_boundAnimationScale = getAnimationScale(_currentAnimation->getName());
 }
 
 void Model::render(RenderPass pass) {
@@ -505,13 +705,45 @@ void Model::render(RenderPass pass) {
 	}
 
 	// Render
-	buildList(pass);
-	glCallList(_lists + pass);
+	if (GfxMan.supportBufferObjects()) {
+		updateTransparency();
+
+		// The geometry lives in buffer objects, so we can just draw it directly
+		buildBuffers();
+		renderNodes(pass);
+	} else {
+		buildList(pass);
+		glCallList(_lists + pass);
+
+		// The list changed the state behind our back
+		GLStateMan.invalidate();
+	}
 
 	// Reset the first texture units
 	TextureMan.reset();
 }
 
+bool Model::addToRenderQueue(RenderQueue &queue) {
+	// The bounding box is drawn directly, together with the model
+	if (!_currentState || _drawBound)
+		return false;
+
+	// Without buffer objects, our display lists are faster than drawing from client memory
+	if (!GfxMan.supportBufferObjects())
+		return false;
+
+	buildBuffers();
+
+	updateTransparency();
+
+	// Our global model transformation is the same as our absolute position
+	for (NodeList::iterator n = _currentState->rootNodes.begin();
+	     n != _currentState->rootNodes.end(); ++n)
+		(*n)->addToRenderQueue(queue, _absolutePosition);
+
+	return true;
+}
+
 void Model::doDrawBound() {
 	if (!_drawBound)
 		return;
@@ -570,9 +802,14 @@ void Model::doDrawBound() {
 
 void Model::doRebuild() {
 	needRebuild();
+
+	if (GfxMan.supportBufferObjects())
+		buildBuffers();
 }
 
 void Model::doDestroy() {
+	destroyBuffers();
+
 	if (_lists == 0)
 		return;
 
@@ -581,13 +818,18 @@ void Model::doDestroy() {
 }
 
 void Model::finalize() {
-	_currentState = 0;
+	_currentState       = 0;
+	_boundAnimation     = 0;
+	_animationEvaluated = false;
 
 	createStateNamesList();
 	setState();
 
 	createBound();
 
+	// We might have new nodes whose geometry needs to be uploaded
+	_hasBuffers = false;
+
 	// Order all node children lists
 	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
 		for (NodeList::iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n)
@@ -603,6 +845,43 @@ void Model::needRebuild() {
 		_needBuild[i] = true;
 }
 
+void Model::copyStates(const Model &model) {
+	for (StateList::const_iterator s = model._stateList.begin(); s != model._stateList.end(); ++s) {
+		State *state = new State;
+
+		state->name = (*s)->name;
+
+		// Copy the nodes, remembering which copy belongs to which original
+		std::map<const ModelNode *, ModelNode *> copies;
+		for (NodeList::const_iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			ModelNode *node = new ModelNode(**n);
+
+			node->_model = this;
+
+			copies.insert(std::make_pair(*n, node));
+
+			state->nodeList.push_back(node);
+			state->nodeMap.insert(std::make_pair(node->_name, node));
+		}
+
+		// Point the copies to each other instead of to the originals
+		for (NodeList::iterator n = state->nodeList.begin(); n != state->nodeList.end(); ++n) {
+			std::map<const ModelNode *, ModelNode *>::const_iterator parent = copies.find((*n)->_parent);
+
+			(*n)->_parent = (parent != copies.end()) ? parent->second : 0;
+
+			for (std::list<ModelNode *>::iterator c = (*n)->_children.begin(); c != (*n)->_children.end(); ++c)
+				*c = copies.find(*c)->second;
+		}
+
+		for (NodeList::const_iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n)
+			state->rootNodes.push_back(copies.find(*n)->second);
+
+		_stateList.push_back(state);
+		_stateMap.insert(std::make_pair(state->name, state));
+	}
+}
+
 void Model::createStateNamesList() {
 	_stateNames.clear();
 
@@ -638,6 +917,8 @@ void Model::createBound() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	updateBound();
 }
 
 void Model::readValue(Common::SeekableReadStream &stream, uint32 &value) {
@@ -34,6 +34,8 @@
 #include <list>
 #include <map>
 
+#include <boost/shared_ptr.hpp>
+
 #include "common/ustring.h"
 #include "common/transmatrix.h"
 #include "common/boundingbox.h"
@@ -43,6 +45,7 @@
 #include "graphics/renderable.h"
 
 #include "graphics/aurora/types.h"
+#include "graphics/aurora/animnode.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -58,6 +61,13 @@ class Animation;
 class Model : public GLContainer, public Renderable {
 public:
 	Model(ModelType type = kModelTypeObject);
+	/** Create a new instance of an already loaded model.
+	 *
+	 *  The instance shares the template's geometry and animations, but
+	 *  has its own node hierarchy, position, animation and state. The
+	 *  template is kept alive for as long as the instance exists.
+	 */
+	Model(const boost::shared_ptr<Model> &modelTemplate);
 	~Model();
 
 	ModelType getType() const; ///< Return the model's type.
@@ -79,6 +89,11 @@ public:
 	bool isIn(float x, float y, float z) const;
 	/** Does the line from x1.y1.z1 to x2.y2.z2 intersect with model's bounding box? */
 	bool isIn(float x1, float y1, float z1, float x2, float y2, float z2) const;
+	/** Is any part of the model's bounding box within that view frustum? */
+	bool isIn(const Common::Frustum &frustum) const;
+
+	/** Get the model's bounding box in world coordinates. */
+	const Common::BoundingBox *getAbsoluteBound() const;
 
 
 	// Positioning
@@ -144,7 +159,9 @@ public:
 	// Renderable
 	void calculateDistance();
 	void render(RenderPass pass);
+	bool addToRenderQueue(RenderQueue &queue);
 	void advanceTime(float dt);
+	void applyAnimation();
 
 
 protected:
@@ -174,6 +191,13 @@ protected:
 
 	typedef std::list<DefaultAnimation> DefaultAnimations;
 
+	/** The detail with which a model is animated. */
+	enum AnimationLODLevel {
+		kAnimationLODFull    = 0, ///< Update all nodes every frame.
+		kAnimationLODReduced = 1, ///< Update all nodes at a reduced rate.
+		kAnimationLODRoot    = 2  ///< Only update the root nodes, at a reduced rate.
+	};
+
 
 	ModelType _type; ///< The model's type.
 
@@ -195,8 +219,22 @@ protected:
 	Animation *_currentAnimation; ///< The currently playing animations.
 	Animation *_nextAnimation;    ///< The animation that's scheduled next.
 
+	Animation *_boundAnimation; ///< The animation the animation targets were found for.
+	float      _boundAnimationScale; ///< The scale of the bound animation.
+
+	/** The nodes animated by the bound animation, one for each of its animation nodes. */
+	std::vector<AnimNodeTarget> _animationTargets;
+
+	/** Were the animation targets evaluated, but not yet applied to the nodes? */
+	bool _animationEvaluated;
+
+	AnimationLODLevel _animationLOD; ///< The detail the model is currently animated with.
+	float _animationLODTime; ///< Progress towards the next reduced rate update, in updates.
+
 	int32 _loopAnimation; ///< Number of times to loop the current animation.
 
+	uint32 _randomState; ///< State of the random numbers picking the default animations.
+
 	float _animationScale; ///< The scale of the animation.
 
 	/** All default animations, sorted from least to most probable. */
@@ -240,9 +278,31 @@ private:
 
 	ListID _lists; ///< OpenGL display lists for the model
 
+	bool _hasBuffers; ///< Was the nodes' geometry uploaded into buffer objects?
+
+	/** The model this is an instance of, owning the shared animations. */
+	boost::shared_ptr<Model> _template;
+
 
 	bool buildList(RenderPass pass);
 
+	/** Decide the transparency of the current state's nodes whose textures are ready.
+	 *
+	 *  Return whether the textures of all nodes in the current state are ready.
+	 */
+	bool updateTransparency();
+
+	/** Upload the geometry of all nodes into buffer objects. */
+	void buildBuffers();
+	/** Delete the buffer objects holding the geometry of all nodes. */
+	void destroyBuffers();
+
+	/** Render the model's nodes, either directly or into a display list. */
+	void renderNodes(RenderPass pass);
+
+	/** Copy the states of another model, with new nodes sharing its geometry. */
+	void copyStates(const Model &model);
+
 	void createStateNamesList(); ///< Create the list of all state names.
 	void createBound();          ///< Create the model's bounding box.
 
@@ -251,7 +311,16 @@ private:
 	void doDrawBound();
 	void manageAnimations(float dt);
 
-	Animation *selectDefaultAnimation() const;
+	/** Find the nodes the current animation animates. */
+	void bindAnimation();
+
+	/** Find the animation detail level, and return whether the animation should be evaluated now. */
+	bool updateAnimationLOD(float dt);
+
+	/** Return a random number between 0 and 32767, without touching std::rand()'s shared state. */
+	uint32 getRandom();
+
+	Animation *selectDefaultAnimation();
 
 
 public:
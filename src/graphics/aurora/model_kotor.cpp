@@ -530,9 +530,9 @@ void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 2;
 	uint32 vertexSize = (vpsize + vnsize + vtsize * textureCount) * sizeof(float);
-	_vertexBuffer.setSize(vertexCount, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCount, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	VertexAttrib vp;
@@ -561,7 +561,7 @@ void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
 		vertexDecl.push_back(vt);
 	}
 
-	_vertexBuffer.setVertexDecl(vertexDecl);
+	_geometry->vertexBuffer.setVertexDecl(vertexDecl);
 
 	float *v = vertexData;
 	for (uint32 i = 0; i < vertexCount; i++) {
@@ -598,9 +598,9 @@ void ModelNode_KotOR::readMesh(Model_KotOR::ParserContext &ctx) {
 
 	ctx.mdl->seekTo(ctx.offModelData + offVerts);
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
 
-	uint16 *f = (uint16 *) _indexBuffer.getData();
+	uint16 *f = (uint16 *) _geometry->indexBuffer.getData();
 	for (uint32 i = 0; i < facesCount * 3; i++)
 		f[i] = ctx.mdl->readUint16LE();
 
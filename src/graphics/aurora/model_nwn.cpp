@@ -760,7 +760,7 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 	// Convert to one normal per vertex by duplicating vertex data
 	// for face verts with multiple normals
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
 
 	std::vector<Normal> new_verts_norms;
 	boost::unordered_set<Normal> verts_norms;
@@ -768,7 +768,7 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 
 	Normal n;
 	uint16 vertexCountNew = vertexCount;
-	uint16 *f = (uint16 *) _indexBuffer.getData();
+	uint16 *f = (uint16 *) _geometry->indexBuffer.getData();
 	ctx.mdl->seekTo(ctx.offModelData + facesOffset);
 	for (uint32 i = 0; i < facesCount; i++) {
 		// Face normal
@@ -804,9 +804,9 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 2;
 	uint32 vertexSize = (vpsize + vnsize + vtsize * textureCount) * sizeof(float);
-	_vertexBuffer.setSize(vertexCountNew, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCountNew, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	// Read vertex coordinates
@@ -893,7 +893,7 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 		}
 	}
 
-	_vertexBuffer.setVertexDecl(vertexDecl);
+	_geometry->vertexBuffer.setVertexDecl(vertexDecl);
 
 	createBound();
 
@@ -1279,13 +1279,13 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 	// Read faces
 
 	uint32 facesCount = mesh.faceCount;
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
 
 	boost::unordered_set<FaceVert> verts;
 	typedef boost::unordered_set<FaceVert>::iterator verts_set_it;
 
 	uint32 vertexCount = 0;
-	uint32 *f = (uint32 *) _indexBuffer.getData();
+	uint32 *f = (uint32 *) _geometry->indexBuffer.getData();
 	for (uint32 i = 0; i < facesCount; i++) {
 		const uint32 v[3] = {mesh.vIA[i], mesh.vIB[i], mesh.vIC[i]};
 		const uint32 t[3] = {mesh.tIA[i], mesh.tIB[i], mesh.tIC[i]};
@@ -1318,9 +1318,9 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 2;
 	uint32 vertexSize = (vpsize + vnsize + vtsize * textureCount) * sizeof(float);
-	_vertexBuffer.setSize(vertexCount, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCount, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	VertexAttrib vp;
@@ -1349,7 +1349,7 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 		vertexDecl.push_back(vt);
 	}
 
-	_vertexBuffer.setVertexDecl(vertexDecl);
+	_geometry->vertexBuffer.setVertexDecl(vertexDecl);
 
 	for (verts_set_it i = verts.begin(); i != verts.end(); ++i) {
 		float *v = vertexData + i->i * vertexSize / sizeof(float);
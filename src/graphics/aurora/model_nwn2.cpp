@@ -211,9 +211,9 @@ bool ModelNode_NWN2::loadRigid(Model_NWN2::ParserContext &ctx) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 3;
 	uint32 vertexSize = (vpsize + vnsize + vtsize) * sizeof(float);
-	_vertexBuffer.setSize(vertexCount, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCount, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	VertexAttrib vp;
@@ -240,7 +240,7 @@ bool ModelNode_NWN2::loadRigid(Model_NWN2::ParserContext &ctx) {
 	vt.pointer = vertexData + vpsize + vnsize;
 	vertexDecl.push_back(vt);
 
-	_vertexBuffer.setVertexDecl(vertexDecl);
+	_geometry->vertexBuffer.setVertexDecl(vertexDecl);
 
 	float *v = vertexData;
 	for (uint32 i = 0; i < vertexCount; i++) {
@@ -266,9 +266,9 @@ bool ModelNode_NWN2::loadRigid(Model_NWN2::ParserContext &ctx) {
 
 	// Read faces
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
 
-	uint16 *f = (uint16 *) _indexBuffer.getData();
+	uint16 *f = (uint16 *) _geometry->indexBuffer.getData();
 	for (uint32 i = 0; i < facesCount * 3; i++)
 		f[i] = ctx.mdb->readUint16LE();
 
@@ -328,9 +328,9 @@ bool ModelNode_NWN2::loadSkin(Model_NWN2::ParserContext &ctx) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 3;
 	uint32 vertexSize = (vpsize + vnsize + vtsize) * sizeof(float);
-	_vertexBuffer.setSize(vertexCount, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCount, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	VertexAttrib vp;
@@ -385,9 +385,9 @@ bool ModelNode_NWN2::loadSkin(Model_NWN2::ParserContext &ctx) {
 
 	// Read faces
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
 
-	uint16 *f = (uint16 *) _indexBuffer.getData();
+	uint16 *f = (uint16 *) _geometry->indexBuffer.getData();
 	for (uint32 i = 0; i < facesCount * 3; i++)
 		f[i] = ctx.mdb->readUint16LE();
 
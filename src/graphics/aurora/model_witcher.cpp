@@ -397,9 +397,9 @@ void ModelNode_Witcher::readMesh(Model_Witcher::ParserContext &ctx) {
 	GLsizei vnsize = 3;
 	GLsizei vtsize = 2;
 	uint32 vertexSize = (vpsize + vnsize + vtsize) * sizeof(float);
-	_vertexBuffer.setSize(vertexCount, vertexSize);
+	_geometry->vertexBuffer.setSize(vertexCount, vertexSize);
 
-	float *vertexData = (float *) _vertexBuffer.getData();
+	float *vertexData = (float *) _geometry->vertexBuffer.getData();
 	VertexDecl vertexDecl;
 
 	VertexAttrib vp;
@@ -426,7 +426,7 @@ void ModelNode_Witcher::readMesh(Model_Witcher::ParserContext &ctx) {
 	vt.pointer = vertexData + (vpsize + vnsize) * vertexCount;
 	vertexDecl.push_back(vt);
 
-	_vertexBuffer.setVertexDecl(vertexDecl);
+	_geometry->vertexBuffer.setVertexDecl(vertexDecl);
 
 	// Read vertex position
 	ctx.mdb->seekTo(ctx.offRawData + vertexOffset);
@@ -459,10 +459,10 @@ void ModelNode_Witcher::readMesh(Model_Witcher::ParserContext &ctx) {
 
 	// Read faces
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
+	_geometry->indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
 
 	ctx.mdb->seekTo(ctx.offRawData + facesOffset);
-	uint32 *f = (uint32 *) _indexBuffer.getData();
+	uint32 *f = (uint32 *) _geometry->indexBuffer.getData();
 	for (uint32 i = 0; i < facesCount; i++) {
 		ctx.mdb->skip(4 * 4 + 4);
 
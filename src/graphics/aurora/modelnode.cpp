@@ -32,6 +32,8 @@
 
 #include "graphics/graphics.h"
 #include "graphics/camera.h"
+#include "graphics/glstate.h"
+#include "graphics/renderqueue.h"
 
 #include "graphics/images/txi.h"
 
@@ -47,72 +49,10 @@ static bool nodeComp(ModelNode *a, ModelNode *b) {
 	return a->isInFrontOf(*b);
 }
 
-// OpenGL < 2 vertex attribute helper functions
-
-static void EnableVertexPos(const VertexAttrib &va) {
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(va.size, va.type, va.stride, va.pointer);
-}
-
-static void EnableVertexNorm(const VertexAttrib &va) {
-	assert(va.size == 3);
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glNormalPointer(va.type, va.stride, va.pointer);
-}
-
-static void EnableVertexCol(const VertexAttrib &va) {
-	glEnableClientState(GL_COLOR_ARRAY);
-	glColorPointer(va.size, va.type, va.stride, va.pointer);
-}
-
-static void EnableVertexTex(const VertexAttrib &va) {
-	glClientActiveTextureARB(GL_TEXTURE0 + va.index - VTCOORD);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	glTexCoordPointer(va.size, va.type, va.stride, va.pointer);
-}
-
-static void DisableVertexPos(const VertexAttrib &va) {
-	glDisableClientState(GL_VERTEX_ARRAY);
-}
-
-static void DisableVertexNorm(const VertexAttrib &va) {
-	glDisableClientState(GL_NORMAL_ARRAY);
-}
-
-static void DisableVertexCol(const VertexAttrib &va) {
-	glDisableClientState(GL_COLOR_ARRAY);
-}
-
-static void DisableVertexTex(const VertexAttrib &va) {
-	glClientActiveTextureARB(GL_TEXTURE0 + va.index - VTCOORD);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-}
-
-static void EnableVertexAttrib(const VertexAttrib &va) {
-	if (va.index == VPOSITION)
-		EnableVertexPos(va);
-	else if (va.index == VNORMAL)
-		EnableVertexNorm(va);
-	else if (va.index == VCOLOR)
-		EnableVertexCol(va);
-	else if (va.index >= VTCOORD)
-		EnableVertexTex(va);
-}
-
-static void DisableVertexAttrib(const VertexAttrib &va) {
-	if (va.index == VPOSITION)
-		DisableVertexPos(va);
-	else if (va.index == VNORMAL)
-		DisableVertexNorm(va);
-	else if (va.index == VCOLOR)
-		DisableVertexCol(va);
-	else if (va.index >= VTCOORD)
-		DisableVertexTex(va);
-}
 
 ModelNode::ModelNode(Model &model) :
-	_model(&model), _parent(0), _level(0),
-	_isTransparent(false), _render(false), _hasTransparencyHint(false) {
+	_model(&model), _parent(0), _level(0), _geometry(new Geometry),
+	_isTransparent(false), _transparencyKnown(false), _render(false), _hasTransparencyHint(false) {
 
 	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
 	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
@@ -160,6 +100,14 @@ float ModelNode::getDepth() const {
 	return _boundBox.getDepth() * _model->_modelScale[2];
 }
 
+bool ModelNode::hasTexturesReady() const {
+	for (std::vector<TextureHandle>::const_iterator t = _textures.begin(); t != _textures.end(); ++t)
+		if (!TextureMan.isReady(*t))
+			return false;
+
+	return true;
+}
+
 bool ModelNode::isInFrontOf(const ModelNode &node) const {
 	assert(_model == node._model);
 
@@ -262,8 +210,11 @@ void ModelNode::inheritGeometry(ModelNode &node) const {
 	node._textures      = _textures;
 	node._render        = _render;
 	node._isTransparent = _isTransparent;
-	node._vertexBuffer  = _vertexBuffer;
-	node._indexBuffer   = _indexBuffer;
+	node._geometry      = _geometry;
+
+	node._hasTransparencyHint = _hasTransparencyHint;
+	node._transparencyHint    = _transparencyHint;
+	node._transparencyKnown   = _transparencyKnown;
 
 	memcpy(node._center, _center, 3 * sizeof(float));
 	node._boundBox = _boundBox;
@@ -291,6 +242,10 @@ void ModelNode::addChild(Model *model) {
 	bool visible = _model->isVisible();
 	_model->hide();
 
+	// The nodes an animation would find might change
+	_model->_boundAnimation     = 0;
+	_model->_animationEvaluated = false;
+
 	// Take over the nodes in the model's currentstate
 
 	for (Model::NodeList::iterator r = model->_currentState->rootNodes.begin();
@@ -344,24 +299,16 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 
 	_textures.resize(textures.size());
 
-	bool hasAlpha = true;
-	bool isDecal  = true;
+	_transparencyKnown = false;
 
 	for (uint t = 0; t != textures.size(); t++) {
 
 		try {
 
+			// Let the images decode in the background while we load the rest of the model
 			if (!textures[t].empty() && (textures[t] != "NULL")) {
-				_textures[t] = TextureMan.get(textures[t]);
+				_textures[t] = TextureMan.get(textures[t], true);
 				hasTexture = true;
-
-				if (!_textures[t].getTexture().hasAlpha())
-					hasAlpha = false;
-				if (_textures[t].getTexture().getTXI().getFeatures().alphaMean == 1.0)
-					hasAlpha = false;
-
-				if (!_textures[t].getTexture().getTXI().getFeatures().decal)
-					isDecal = false;
 			}
 
 		} catch (...) {
@@ -370,6 +317,40 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 
 	}
 
+	// If the node has no actual texture, we just assume
+	// that the geometry shouldn't be rendered.
+	if (!hasTexture)
+		_render = false;
+}
+
+bool ModelNode::updateTransparency() {
+	if (_transparencyKnown)
+		return true;
+
+	// Don't wait for the textures to be decoded, just go by the hint until then
+	if (!hasTexturesReady()) {
+		_isTransparent = _hasTransparencyHint && _transparencyHint;
+		return false;
+	}
+
+	bool hasAlpha = true;
+	bool isDecal  = true;
+
+	for (std::vector<TextureHandle>::const_iterator t = _textures.begin(); t != _textures.end(); ++t) {
+		if (t->empty())
+			continue;
+
+		const Texture &texture = t->getTexture();
+
+		if (!texture.hasAlpha())
+			hasAlpha = false;
+		if (texture.getTXI().getFeatures().alphaMean == 1.0)
+			hasAlpha = false;
+
+		if (!texture.getTXI().getFeatures().decal)
+			isDecal = false;
+	}
+
 	if (_hasTransparencyHint) {
 		_isTransparent = _transparencyHint;
 		if (isDecal)
@@ -378,21 +359,19 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 		_isTransparent = hasAlpha;
 	}
 
-	// If the node has no actual texture, we just assume
-	// that the geometry shouldn't be rendered.
-	if (!hasTexture)
-		_render = false;
+	_transparencyKnown = true;
+	return true;
 }
 
 void ModelNode::createBound() {
-	const VertexAttrib &vpos = _vertexBuffer.getVertexDecl()[0];
+	const VertexAttrib &vpos = _geometry->vertexBuffer.getVertexDecl()[0];
 	assert(vpos.index == VPOSITION);
 	assert(vpos.type == GL_FLOAT);
 	uint32 stride = MAX<uint32>(vpos.size, vpos.stride / sizeof(float));
 	float *vX = (float *) vpos.pointer;
 	float *vY = vX + 1;
 	float *vZ = vY + 1;
-	for (uint32 v = 0; v < _vertexBuffer.getCount(); v++)
+	for (uint32 v = 0; v < _geometry->vertexBuffer.getCount(); v++)
 		_boundBox.add(vX[v * stride], vY[v * stride], vZ[v * stride]);
 
 	createCenter();
@@ -449,32 +428,36 @@ void ModelNode::orderChildren() {
 		(*c)->orderChildren();
 }
 
-void ModelNode::renderGeometry() {
-	// Enable all needed texture units
-	for (uint32 t = 0; t < _textures.size(); t++) {
-		TextureMan.activeTexture(t);
-		glEnable(GL_TEXTURE_2D);
-
-		TextureMan.set(_textures[t]);
-	}
+void ModelNode::buildBuffers() {
+	if (_geometry->indexBuffer.getCount() == 0)
+		return;
 
-	// Render the node's faces
+	_geometry->vertexBuffer.initGL();
+	_geometry->indexBuffer.initGL();
+}
 
-	const VertexDecl &vertexDecl = _vertexBuffer.getVertexDecl();
+void ModelNode::destroyBuffers() {
+	_geometry->vertexBuffer.destroyGL();
+	_geometry->indexBuffer.destroyGL();
+}
 
-	for (uint32 i = 0; i < vertexDecl.size(); i++)
-		EnableVertexAttrib(vertexDecl[i]);
+void ModelNode::renderGeometry() {
+	// Enable the texture units we need and disable all others. Nodes with
+	// the same textures then don't need to change any texture state.
+	for (uint32 t = 0; t < GfxMan.getTextureUnitCount(); t++) {
+		const bool enabled = t < _textures.size();
+
+		GLStateMan.setTextureEnabled(t, enabled);
+		if (enabled)
+			GLStateMan.bindTexture(t, TextureMan.getID(_textures[t]));
+	}
 
-	glDrawElements(GL_TRIANGLES, _indexBuffer.getCount(), _indexBuffer.getType(), _indexBuffer.getData());
+	// Render the node's faces, from the buffer objects if we have them
 
-	for (uint32 i = 0; i < vertexDecl.size(); i++)
-		DisableVertexAttrib(vertexDecl[i]);
+	_geometry->vertexBuffer.bind();
+	_geometry->indexBuffer.bind();
 
-	// Disable the texture units again
-	for (uint32 i = 0; i < _textures.size(); i++) {
-		TextureMan.activeTexture(i);
-		glDisable(GL_TEXTURE_2D);
-	}
+	_geometry->indexBuffer.draw();
 }
 
 void ModelNode::render(RenderPass pass) {
@@ -490,7 +473,7 @@ void ModelNode::render(RenderPass pass) {
 
 	// Render the node's geometry
 
-	bool shouldRender = _render && (_indexBuffer.getCount() > 0);
+	bool shouldRender = _render && (_geometry->indexBuffer.getCount() > 0);
 	if (((pass == kRenderPassOpaque)      &&  _isTransparent) ||
 	    ((pass == kRenderPassTransparent) && !_isTransparent))
 		shouldRender = false;
@@ -507,21 +490,127 @@ void ModelNode::render(RenderPass pass) {
 	}
 }
 
-void ModelNode::interpolatePosition(float time, float &x, float &y, float &z) const {
+void ModelNode::addToRenderQueue(RenderQueue &queue, const Common::TransformationMatrix &parent) {
+	// Apply the node's transformation, the same way render() does
+
+	Common::TransformationMatrix transform = parent;
+
+	transform.translate(_position[0], _position[1], _position[2]);
+	transform.rotate(_orientation[3], _orientation[0], _orientation[1], _orientation[2]);
+
+	transform.rotate(_rotation[0], 1.0, 0.0, 0.0);
+	transform.rotate(_rotation[1], 0.0, 1.0, 0.0);
+	transform.rotate(_rotation[2], 0.0, 0.0, 1.0);
+
+
+	// Queue the node's geometry
+
+	if (_render && (_geometry->indexBuffer.getCount() > 0)) {
+		TextureID textures[RenderQueue::kMaxTextures];
+
+		const uint32 textureCount = MIN<uint32>(_textures.size(), RenderQueue::kMaxTextures);
+		for (uint32 t = 0; t < textureCount; t++)
+			textures[t] = TextureMan.getID(_textures[t]);
+
+		queue.add(_isTransparent ? kRenderPassTransparent : kRenderPassOpaque,
+		          _geometry->vertexBuffer, _geometry->indexBuffer, textures, textureCount, transform);
+	}
+
+
+	// Queue the node's children
+	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c)
+		(*c)->addToRenderQueue(queue, transform);
+}
+
+/** Find the keyframe at or directly before that time.
+ *
+ *  This is the last keyframe with a time lower than the one given, or the
+ *  first keyframe if there's none. Since animations mostly move forward,
+ *  the previously found keyframe and the one after it are checked first,
+ *  before falling back to a binary search.
+ */
+template<typename T>
+static uint32 findKeyFrame(const std::vector<T> &frames, float time, uint32 frame) {
+	const uint32 count = frames.size();
+
+	for (uint32 i = frame; (i < count) && (i <= frame + 1); i++) {
+		const bool afterLast  = (i == 0) || (frames[i].time < time);
+		const bool beforeNext = (i + 1 >= count) || (frames[i + 1].time >= time);
+
+		if (afterLast && beforeNext)
+			return i;
+	}
+
+	uint32 low  = 0;
+	uint32 high = count;
+
+	// Find the first keyframe with a time not lower than the one given
+	while (low < high) {
+		const uint32 mid = low + (high - low) / 2;
+
+		if (frames[mid].time < time)
+			low  = mid + 1;
+		else
+			high = mid;
+	}
+
+	return (low > 0) ? (low - 1) : 0;
+}
+
+/** Spherically interpolate between two orientation quaternions. */
+static void slerp(const QuaternionKeyFrame &from, const QuaternionKeyFrame &to, float f,
+                  float &x, float &y, float &z, float &w) {
+
+	float cosTheta = from.x * to.x + from.y * to.y + from.z * to.z + from.q * to.q;
+
+	// Take the shorter way around
+	float sign = 1.0f;
+	if (cosTheta < 0.0f) {
+		cosTheta = -cosTheta;
+		sign     = -1.0f;
+	}
+
+	float kFrom = 1.0f - f;
+	float kTo   = f;
+
+	// Nearly the same orientation, a linear interpolation is precise enough and stable
+	if (cosTheta < 0.9995f) {
+		const float theta    = acos(cosTheta);
+		const float sinTheta = sin(theta);
+
+		kFrom = sin((1.0f - f) * theta) / sinTheta;
+		kTo   = sin(f * theta) / sinTheta;
+	}
+
+	kTo *= sign;
+
+	x = kFrom * from.x + kTo * to.x;
+	y = kFrom * from.y + kTo * to.y;
+	z = kFrom * from.z + kTo * to.z;
+	w = kFrom * from.q + kTo * to.q;
+
+	const float length = sqrt(x * x + y * y + z * z + w * w);
+	if (length > 0.0f) {
+		x /= length;
+		y /= length;
+		z /= length;
+		w /= length;
+	}
+}
+
+/** The rotation angle of an orientation quaternion, in degrees. */
+static float quaternionAngle(float w) {
+	return Common::rad2deg(acos(CLIP(w, -1.0f, 1.0f)) * 2.0);
+}
+
+void ModelNode::interpolatePosition(float time, uint32 &frame, float &x, float &y, float &z) const {
 	// If less than 2 keyframes, don't interpolate, just return the only position
 	if (_positionFrames.size() < 2) {
 		getPosition(x, y, z);
 		return;
 	}
 
-	uint32 lastFrame = 0;
-	for (uint32 i = 0; i < _positionFrames.size(); i++) {
-		const PositionKeyFrame &pos = _positionFrames[i];
-		if (pos.time >= time)
-			break;
-
-		lastFrame = i;
-	}
+	const uint32 lastFrame = frame = findKeyFrame(_positionFrames, time, frame);
 
 	const PositionKeyFrame &last = _positionFrames[lastFrame];
 	if (lastFrame + 1 >= _positionFrames.size() || last.time == time) {
@@ -539,39 +628,34 @@ void ModelNode::interpolatePosition(float time, float &x, float &y, float &z) co
 	z = f * next.z + (1.0f - f) * last.z;
 }
 
-void ModelNode::interpolateOrientation(float time, float &x, float &y, float &z, float &a) const {
+void ModelNode::interpolateOrientation(float time, uint32 &frame,
+                                       float &x, float &y, float &z, float &a) const {
+
 	// If less than 2 keyframes, don't interpolate just return the only orientation
 	if (_orientationFrames.size() < 2) {
 		getOrientation(x, y, z, a);
 		return;
 	}
 
-	uint32 lastFrame = 0;
-	for (uint32 i = 0; i < _orientationFrames.size(); i++) {
-		const QuaternionKeyFrame &pos = _orientationFrames[i];
-		if (pos.time >= time)
-			break;
-
-		lastFrame = i;
-	}
+	const uint32 lastFrame = frame = findKeyFrame(_orientationFrames, time, frame);
 
 	const QuaternionKeyFrame &last = _orientationFrames[lastFrame];
 	if (lastFrame + 1 >= _orientationFrames.size() || last.time == time) {
 		x = last.x;
 		y = last.y;
 		z = last.z;
-		a = Common::rad2deg(acos(last.q) * 2.0);
+		a = quaternionAngle(last.q);
+		return;
 	}
 
 	const QuaternionKeyFrame &next = _orientationFrames[lastFrame + 1];
 
 	const float f = (time - last.time) / (next.time - last.time);
-	x = f * next.x + (1.0f - f) * last.x;
-	y = f * next.y + (1.0f - f) * last.y;
-	z = f * next.z + (1.0f - f) * last.z;
 
-	const float q = f * next.q + (1.0f - f) * last.q;
-	a = Common::rad2deg(acos(q) * 2.0);
+	float w;
+	slerp(last, next, f, x, y, z, w);
+
+	a = quaternionAngle(w);
 }
 
 } // End of namespace Aurora
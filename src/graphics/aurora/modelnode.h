@@ -33,6 +33,8 @@
 #include <list>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "common/ustring.h"
 #include "common/transmatrix.h"
 #include "common/boundingbox.h"
@@ -46,6 +48,8 @@
 
 namespace Graphics {
 
+class RenderQueue;
+
 namespace Aurora {
 
 class Model;
@@ -109,6 +113,12 @@ public:
 
 
 protected:
+	/** The node's geometry, shared between all instances of a model. */
+	struct Geometry {
+		VertexBuffer vertexBuffer; ///< Node geometry vertex buffer.
+		IndexBuffer  indexBuffer;  ///< Node geometry index buffer.
+	};
+
 	Model *_model; ///< The model this node belongs to.
 
 	ModelNode *_parent;               ///< The node's parent.
@@ -118,8 +128,7 @@ protected:
 
 	Common::UString _name; ///< The node's name.
 
-	VertexBuffer _vertexBuffer; ///< Node geometry vertex buffer.
-	IndexBuffer _indexBuffer;   ///< Node geometry index buffer.
+	boost::shared_ptr<Geometry> _geometry; ///< Node geometry.
 
 	float _center     [3]; ///< The node's center.
 	float _position   [3]; ///< Position of the node.
@@ -142,6 +151,7 @@ protected:
 	std::vector<TextureHandle> _textures; ///< Textures.
 
 	bool _isTransparent;
+	bool _transparencyKnown; ///< Were the textures decoded to decide _isTransparent?
 
 	bool _dangly; ///< Is the node mesh's dangly?
 
@@ -176,11 +186,20 @@ protected:
 
 	// Loading helpers
 	void loadTextures(const std::vector<Common::UString> &textures);
+	/** Decide whether the node is transparent, once its textures are ready.
+	 *
+	 *  Until then, only the transparency hint is used. Return whether the
+	 *  textures are ready.
+	 */
+	bool updateTransparency();
 	void createBound();
 	void createCenter();
 
 	void render(RenderPass pass);
 
+	/** Add the geometry of this node and its children to a render queue. */
+	void addToRenderQueue(RenderQueue &queue, const Common::TransformationMatrix &parent);
+
 
 private:
 	const Common::BoundingBox &getAbsoluteBound() const;
@@ -188,6 +207,11 @@ private:
 
 	void orderChildren();
 
+	/** Upload the node's geometry into buffer objects. */
+	void buildBuffers();
+	/** Delete the buffer objects holding the node's geometry. */
+	void destroyBuffers();
+
 	void renderGeometry();
 
 
@@ -199,6 +223,9 @@ public:
 
 	void setParent(ModelNode *parent); ///< Set the node's parent.
 
+	/** Are all of the node's textures ready to be rendered? */
+	bool hasTexturesReady() const;
+
 	/** Is this node in front of that other node? */
 	bool isInFrontOf(const ModelNode &node) const;
 
@@ -209,8 +236,19 @@ public:
 	void reparent(ModelNode &parent);
 
 	// Animation helpers
-	void interpolatePosition(float time, float &x, float &y, float &z) const;
-	void interpolateOrientation(float time, float &x, float &y, float &z, float &a) const;
+
+	/** Interpolate the position at that time between the position keyframes.
+	 *
+	 *  frame is the keyframe the search starts at, and is updated to the
+	 *  keyframe found, to make the next search for a later time quicker.
+	 */
+	void interpolatePosition(float time, uint32 &frame, float &x, float &y, float &z) const;
+	/** Interpolate the orientation at that time between the orientation keyframes.
+	 *
+	 *  frame is the keyframe the search starts at, and is updated to the
+	 *  keyframe found, to make the next search for a later time quicker.
+	 */
+	void interpolateOrientation(float time, uint32 &frame, float &x, float &y, float &z, float &a) const;
 
 	friend class Model;
 };
@@ -33,8 +33,10 @@
 #include "common/stream.h"
 
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/textureloader.h"
 
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 #include "graphics/images/txi.h"
 #include "graphics/images/decoder.h"
 #include "graphics/images/tga.h"
@@ -53,8 +55,9 @@ namespace Graphics {
 
 namespace Aurora {
 
-Texture::Texture(const Common::UString &name) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+Texture::Texture(const Common::UString &name, TextureLoader *loader) : _textureID(0),
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_imageStream(0), _loader(loader), _decodeState(kDecodeDone) {
 
 	_txi = new TXI();
 
@@ -65,7 +68,8 @@ Texture::Texture(const Common::UString &name) : _textureID(0),
 }
 
 Texture::Texture(ImageDecoder *image, const TXI *txi) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_imageStream(0), _loader(0), _decodeState(kDecodeDone) {
 
 	if (txi)
 		_txi = new TXI(*txi);
@@ -82,6 +86,8 @@ Texture::~Texture() {
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
+	cancelDecode();
+
 	if (_textureID != 0)
 		GfxMan.abandon(&_textureID, 1);
 
@@ -94,49 +100,142 @@ TextureID Texture::getID() const {
 }
 
 const uint32 Texture::getWidth() const {
+	waitDecoded();
+
 	return _width;
 }
 
 const uint32 Texture::getHeight() const {
+	waitDecoded();
+
 	return _height;
 }
 
 bool Texture::hasAlpha() const {
+	waitDecoded();
+
 	if (!_image)
 		return false;
 
 	return _image->hasAlpha();
 }
 
+bool Texture::isDecoded() const {
+	if (!_loader)
+		return true;
+
+	return _loader->isDecoded(*this);
+}
+
+bool Texture::isDeferrable() const {
+	return _loader != 0;
+}
+
+uint32 Texture::getImageSize() const {
+	waitDecoded();
+
+	if (!_image)
+		return 0;
+
+	uint32 size = 0;
+	for (uint32 i = 0; i < _image->getMipMapCount(); i++)
+		size += _image->getMipMap(i).size;
+
+	return size;
+}
+
+void Texture::waitDecoded() const {
+	if (!_loader)
+		return;
+
+	_loader->wait(const_cast<Texture &>(*this));
+}
+
+bool Texture::hasFailed() const {
+	if (!_loader || !isDecoded())
+		return false;
+
+	// A failed decode leaves us without an image
+	return _image == 0;
+}
+
+void Texture::cancelDecode() {
+	if (_loader)
+		_loader->remove(*this);
+
+	delete _imageStream;
+	_imageStream = 0;
+}
+
 void Texture::load(const Common::UString &name) {
-	Common::SeekableReadStream *img = ResMan.getResource(::Aurora::kResourceImage, name, &_type);
-	if (!img)
+	_imageStream = ResMan.getResource(::Aurora::kResourceImage, name, &_type);
+	if (!_imageStream)
 		throw Common::Exception("No such image resource \"%s\"", name.c_str());
 
 	_name = name;
 
-	// Loading the different image formats
-	if      (_type == ::Aurora::kFileTypeTGA)
-		_image = new TGA(*img);
-	else if (_type == ::Aurora::kFileTypeDDS)
-		_image = new DDS(*img);
-	else if (_type == ::Aurora::kFileTypeTPC)
-		_image = new TPC(*img);
-	else if (_type == ::Aurora::kFileTypeTXB)
-		_image = new TXB(*img);
-	else if (_type == ::Aurora::kFileTypeSBM)
-		_image = new SBM(*img);
-	else {
-		delete img;
+	if ((_type != ::Aurora::kFileTypeTGA) && (_type != ::Aurora::kFileTypeDDS) &&
+	    (_type != ::Aurora::kFileTypeTPC) && (_type != ::Aurora::kFileTypeTXB) &&
+	    (_type != ::Aurora::kFileTypeSBM)) {
+
+		delete _imageStream;
+		_imageStream = 0;
+
 		throw Common::Exception("Unsupported image resource type %d", (int) _type);
 	}
 
+	loadTXI(ResMan.getResource(name, ::Aurora::kFileTypeTXI));
+
+	// Only the fetching of the resources has to happen here, the loader decodes the image
+	if (_loader) {
+		_loader->add(*this);
+		return;
+	}
+
+	readImage();
+}
+
+void Texture::readImage() {
+	Common::SeekableReadStream *img = _imageStream;
+	_imageStream = 0;
+
+	try {
+		// Loading the different image formats
+		if      (_type == ::Aurora::kFileTypeTGA)
+			_image = new TGA(*img);
+		else if (_type == ::Aurora::kFileTypeDDS)
+			_image = new DDS(*img);
+		else if (_type == ::Aurora::kFileTypeTPC)
+			_image = new TPC(*img);
+		else if (_type == ::Aurora::kFileTypeTXB)
+			_image = new TXB(*img);
+		else if (_type == ::Aurora::kFileTypeSBM)
+			_image = new SBM(*img);
+	} catch (...) {
+		delete img;
+		throw;
+	}
+
 	delete img;
 
-	loadTXI(ResMan.getResource(name, ::Aurora::kFileTypeTXI));
 	loadImage();
 }
 
+void Texture::decode() {
+	try {
+		readImage();
+	} catch (Common::Exception &e) {
+		delete _image;
+
+		_image  = 0;
+		_width  = 0;
+		_height = 0;
+
+		e.add("Failed decoding texture \"%s\"", _name.c_str());
+		Common::printException(e, "WARNING: ");
+	}
+}
+
 void Texture::load(ImageDecoder *image) {
 	_image = image;
 
@@ -187,12 +286,14 @@ void Texture::doDestroy() {
 	if (_textureID == 0)
 		return;
 
-	glDeleteTextures(1, &_textureID);
+	GLStateMan.deleteTextures(1, &_textureID);
 
 	_textureID = 0;
 }
 
 void Texture::doRebuild() {
+	waitDecoded();
+
 	if (!_image)
 		// No image
 		return;
@@ -202,7 +303,7 @@ void Texture::doRebuild() {
 		glGenTextures(1, &_textureID);
 
 	// Bind the texture
-	glBindTexture(GL_TEXTURE_2D, _textureID);
+	GLStateMan.bindTexture(_textureID);
 
 	// Texture wrapping
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -260,6 +361,8 @@ void Texture::doRebuild() {
 }
 
 const TXI &Texture::getTXI() const {
+	waitDecoded();
+
 	return *_txi;
 }
 
@@ -267,6 +370,8 @@ bool Texture::reload(ImageDecoder *image, const TXI *txi) {
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
+	cancelDecode();
+
 	if (txi) {
 		delete _txi;
 		_txi = new TXI(*txi);
@@ -293,10 +398,13 @@ bool Texture::reload(const Common::UString &name) {
 	removeFromQueue(kQueueNewTexture);
 	removeFromQueue(kQueueTexture);
 
+	cancelDecode();
+
 	delete _txi;
 	delete _image;
 
-	_txi = new TXI();
+	_txi   = new TXI();
+	_image = 0;
 
 	load(_name);
 
@@ -307,6 +415,8 @@ bool Texture::reload(const Common::UString &name) {
 }
 
 bool Texture::dumpTGA(const Common::UString &fileName) const {
+	waitDecoded();
+
 	if (!_image)
 		return false;
 
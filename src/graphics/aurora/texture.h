@@ -30,6 +30,8 @@
 #ifndef GRAPHICS_AURORA_TEXTURE_H
 #define GRAPHICS_AURORA_TEXTURE_H
 
+#include <list>
+
 #include "common/ustring.h"
 
 #include "graphics/types.h"
@@ -48,11 +50,16 @@ class TXI;
 
 namespace Aurora {
 
+class TextureLoader;
+
 /** A texture. */
 class Texture : public Graphics::Texture {
 public:
-	/** Create a texture from this image resource. */
-	Texture(const Common::UString &name);
+	/** Create a texture from this image resource.
+	 *
+	 *  If a loader is given, the image is decoded in its worker threads.
+	 */
+	Texture(const Common::UString &name, TextureLoader *loader = 0);
 	/** Take over the image and create a texture from it. */
 	Texture(ImageDecoder *image, const TXI *txi = 0);
 	~Texture();
@@ -62,6 +69,11 @@ public:
 
 	bool hasAlpha() const;
 
+	// Graphics::Texture
+	bool isDecoded() const;
+	bool isDeferrable() const;
+	uint32 getImageSize() const;
+
 	/** Return the TXI. */
 	const TXI &getTXI() const;
 
@@ -79,6 +91,13 @@ protected:
 	void doDestroy();
 
 private:
+	/** The state of a texture decoded in the background. */
+	enum DecodeState {
+		kDecodeDone,    ///< Not (or not anymore) in the loader.
+		kDecodeQueued,  ///< Waiting for a worker thread.
+		kDecodeRunning  ///< Currently being decoded.
+	};
+
 	Common::UString _name;
 
 	TextureID _textureID; ///< OpenGL texture ID.
@@ -91,15 +110,35 @@ private:
 	uint32 _width;
 	uint32 _height;
 
+	Common::SeekableReadStream *_imageStream; ///< The image data still to be decoded.
+
+	TextureLoader *_loader; ///< The loader decoding our image, if any.
+
+	DecodeState                    _decodeState; ///< Protected by the loader's mutex.
+	std::list<Texture *>::iterator _decodeRef;   ///< Our place in the loader's queue.
+
 	void load(const Common::UString &name);
 	void load(ImageDecoder *image);
 
 	void loadTXI(Common::SeekableReadStream *stream);
 	void loadImage();
 
+	/** Read the image out of the image stream. */
+	void readImage();
+	/** Read the image, but only warn about errors. Called by the loader. */
+	void decode();
+
+	/** Wait for the image to be decoded in the background. */
+	void waitDecoded() const;
+	/** Did decoding the image in the background fail? Doesn't wait for the decoding. */
+	bool hasFailed() const;
+	/** Stop the background decoding, throwing away the image stream. */
+	void cancelDecode();
+
 	TextureID getID() const;
 
 	friend class TextureManager;
+	friend class TextureLoader;
 };
 
 } // End of namespace Aurora
@@ -0,0 +1,167 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureloader.cpp
+ *  Decoding texture images in background threads.
+ */
+
+#include <cassert>
+
+#include "common/util.h"
+
+#include "graphics/aurora/textureloader.h"
+#include "graphics/aurora/texture.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+TextureLoader::Worker::Worker(TextureLoader &loader) : _loader(&loader) {
+}
+
+TextureLoader::Worker::~Worker() {
+	destroyThread();
+}
+
+void TextureLoader::Worker::threadMethod() {
+	while (!_killThread) {
+		Texture *texture = _loader->take();
+		if (!texture)
+			continue;
+
+		_loader->decode(*texture);
+	}
+}
+
+
+TextureLoader::TextureLoader(uint32 threadCount) : _newTexture(_mutex), _decoded(_mutex) {
+	for (uint32 i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			warning("TextureLoader: Failed to create worker thread %u", i);
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+TextureLoader::~TextureLoader() {
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+
+	// Textures are supposed to have removed themselves already
+	assert(_queue.empty());
+}
+
+uint32 TextureLoader::getThreadCount() const {
+	return _workers.size();
+}
+
+void TextureLoader::add(Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	assert(texture._decodeState == Texture::kDecodeDone);
+
+	texture._decodeState = Texture::kDecodeQueued;
+	texture._decodeRef   = _queue.insert(_queue.end(), &texture);
+
+	_newTexture.signal();
+}
+
+void TextureLoader::remove(Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	if (texture._decodeState == Texture::kDecodeQueued) {
+		_queue.erase(texture._decodeRef);
+
+		texture._decodeState = Texture::kDecodeDone;
+		return;
+	}
+
+	while (texture._decodeState != Texture::kDecodeDone)
+		_decoded.wait();
+}
+
+bool TextureLoader::isDecoded(const Texture &texture) {
+	Common::StackLock lock(_mutex);
+
+	return texture._decodeState == Texture::kDecodeDone;
+}
+
+void TextureLoader::wait(Texture &texture) {
+	_mutex.lock();
+
+	if (texture._decodeState == Texture::kDecodeQueued) {
+		// No worker got to it yet, so don't wait for one and decode it ourselves
+
+		_queue.erase(texture._decodeRef);
+		texture._decodeState = Texture::kDecodeRunning;
+
+		_mutex.unlock();
+
+		decode(texture);
+		return;
+	}
+
+	while (texture._decodeState != Texture::kDecodeDone)
+		_decoded.wait();
+
+	_mutex.unlock();
+}
+
+Texture *TextureLoader::take() {
+	Common::StackLock lock(_mutex);
+
+	// Wait for something to do, but check regularly whether we should quit
+	if (_queue.empty())
+		_newTexture.wait(100);
+
+	if (_queue.empty())
+		return 0;
+
+	Texture *texture = _queue.front();
+	_queue.pop_front();
+
+	texture->_decodeState = Texture::kDecodeRunning;
+
+	return texture;
+}
+
+void TextureLoader::decode(Texture &texture) {
+	texture.decode();
+
+	Common::StackLock lock(_mutex);
+
+	texture._decodeState = Texture::kDecodeDone;
+
+	_decoded.broadcast();
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
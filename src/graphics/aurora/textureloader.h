@@ -0,0 +1,108 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/textureloader.h
+ *  Decoding texture images in background threads.
+ */
+
+#ifndef GRAPHICS_AURORA_TEXTURELOADER_H
+#define GRAPHICS_AURORA_TEXTURELOADER_H
+
+#include <list>
+#include <vector>
+
+#include "common/types.h"
+#include "common/noncopyable.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+class Texture;
+
+/** Decodes the images of textures in a set of worker threads.
+ *
+ *  Textures are decoded in the order they were added. Waiting on a texture
+ *  no worker has picked up yet decodes it right in the waiting thread.
+ */
+class TextureLoader : Common::NonCopyable {
+public:
+	/** Create a loader with that many worker threads. */
+	TextureLoader(uint32 threadCount);
+	~TextureLoader();
+
+	/** Return the number of worker threads. */
+	uint32 getThreadCount() const;
+
+	/** Queue the texture's image for decoding. */
+	void add(Texture &texture);
+	/** Remove the texture from the loader, without decoding it.
+	 *
+	 *  If the texture is currently being decoded, wait for it to finish.
+	 */
+	void remove(Texture &texture);
+
+	/** Has the texture's image been decoded? */
+	bool isDecoded(const Texture &texture);
+	/** Wait until the texture's image has been decoded. */
+	void wait(Texture &texture);
+
+private:
+	/** A worker thread, decoding queued textures. */
+	class Worker : public Common::Thread {
+	public:
+		Worker(TextureLoader &loader);
+		~Worker();
+
+	private:
+		TextureLoader *_loader;
+
+		void threadMethod();
+	};
+
+	std::vector<Worker *> _workers;
+
+	std::list<Texture *> _queue; ///< Textures waiting to be decoded.
+
+	Common::Mutex     _mutex;      ///< A mutex protecting the queue and the textures' states.
+	Common::Condition _newTexture; ///< Signals that a texture was added to the queue.
+	Common::Condition _decoded;    ///< Signals that a texture was decoded.
+
+	/** Take the next texture out of the queue, waiting a bit for one to arrive. */
+	Texture *take();
+
+	/** Decode the texture, which has already been taken out of the queue. */
+	void decode(Texture &texture);
+
+	friend class Worker;
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_TEXTURELOADER_H
@@ -27,6 +27,8 @@
  *  The Aurora texture manager.
  */
 
+#include <algorithm>
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/uuid.h"
@@ -35,9 +37,13 @@
 
 #include "graphics/aurora/textureman.h"
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/textureloader.h"
 #include "graphics/aurora/pltfile.h"
 
+#include "graphics/images/surface.h"
+
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 #include "events/requests.h"
 
@@ -47,12 +53,16 @@ namespace Graphics {
 
 namespace Aurora {
 
-ManagedTexture::ManagedTexture(const Common::UString &name) : reloadable(false) {
+ManagedTexture::ManagedTexture(const Common::UString &name, TextureLoader *loader) :
+	reloadable(false), size(0), sizeKnown(false) {
+
 	referenceCount = 0;
-	texture = new Texture(name);
+	texture = new Texture(name, loader);
 }
 
-ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) : reloadable(false) {
+ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) : reloadable(false),
+	size(0), sizeKnown(false) {
+
 	referenceCount = 0;
 	texture = t;
 }
@@ -154,11 +164,41 @@ PLTFile &PLTHandle::getPLT() const {
 }
 
 
-TextureManager::TextureManager() {
+static bool compareSize(const TextureManager::Stats &a, const TextureManager::Stats &b) {
+	return a.size > b.size;
+}
+
+TextureManager::Stats::Stats(const Common::UString &n, uint32 s, uint32 r) :
+	name(n), size(s), referenceCount(r) {
+
+}
+
+
+TextureManager::TextureManager() : _budget(0), _size(0), _unusedSize(0), _unknownSizes(0),
+	_hits(0), _misses(0), _resGeneration(0), _loader(0), _placeholder(0) {
+
+	Surface *placeholder = new Surface(1, 1);
+
+	placeholder->fill(0x80, 0x80, 0x80, 0xFF);
+
+	_placeholder = new Texture(placeholder);
 }
 
 TextureManager::~TextureManager() {
 	clear();
+
+	delete _placeholder;
+	delete _loader;
+}
+
+void TextureManager::setDecodeThreadCount(uint32 count) {
+	Common::StackLock lock(_mutex);
+
+	delete _loader;
+	_loader = 0;
+
+	if (count > 0)
+		_loader = new TextureLoader(count);
 }
 
 void TextureManager::clear() {
@@ -173,6 +213,67 @@ void TextureManager::clear() {
 	for (TextureMap::iterator t = _textures.begin(); t != _textures.end(); ++t)
 		delete t->second;
 	_textures.clear();
+
+	_unused.clear();
+
+	_size         = 0;
+	_unusedSize   = 0;
+	_unknownSizes = 0;
+	_hits         = 0;
+	_misses       = 0;
+}
+
+void TextureManager::setBudget(uint32 budget) {
+	Common::StackLock lock(_mutex);
+
+	_budget = budget;
+
+	if (_budget == 0)
+		dropUnused();
+	else
+		enforceBudget();
+}
+
+uint32 TextureManager::getBudget() const {
+	return _budget;
+}
+
+uint32 TextureManager::getSize() {
+	Common::StackLock lock(_mutex);
+
+	updateSizes();
+
+	return _size;
+}
+
+uint32 TextureManager::getUnusedSize() {
+	Common::StackLock lock(_mutex);
+
+	updateSizes();
+
+	return _unusedSize;
+}
+
+uint32 TextureManager::getHits() const {
+	return _hits;
+}
+
+uint32 TextureManager::getMisses() const {
+	return _misses;
+}
+
+void TextureManager::getStats(std::vector<Stats> &stats) {
+	Common::StackLock lock(_mutex);
+
+	updateSizes();
+
+	stats.clear();
+	stats.reserve(_textures.size());
+
+	for (TextureMap::const_iterator t = _textures.begin(); t != _textures.end(); ++t)
+		stats.push_back(Stats(t->first, t->second->size, t->second->referenceCount));
+
+	std::sort(stats.begin(), stats.end(), compareSize);
 }
 
 TextureHandle TextureManager::add(Texture *texture, Common::UString name) {
@@ -186,8 +287,13 @@ TextureHandle TextureManager::add(Texture *texture, Common::UString name) {
 	}
 
 	TextureMap::iterator text = _textures.find(name);
-	if (text != _textures.end())
-		throw Common::Exception("Texture \"%s\" already exists", name.c_str());
+	if (text != _textures.end()) {
+		if (text->second->referenceCount > 0)
+			throw Common::Exception("Texture \"%s\" already exists", name.c_str());
+
+		// Just an unused texture we kept around, make room for the new one
+		drop(text);
+	}
 
 	std::pair<TextureMap::iterator, bool> result;
 
@@ -198,11 +304,16 @@ TextureHandle TextureManager::add(Texture *texture, Common::UString name) {
 	text = result.first;
 
 	text->second->reloadable = reloadable;
+	text->second->usage      = _unused.end();
+
+	_unknownSizes++;
+	updateSize(*text->second);
+	enforceBudget();
 
 	return TextureHandle(text);
 }
 
-TextureHandle TextureManager::get(const Common::UString &name) {
+TextureHandle TextureManager::get(const Common::UString &name, bool background) {
 	Common::StackLock lock(_mutex);
 
 	if (ResMan.hasResource(name, ::Aurora::kFileTypePLT)) {
@@ -213,17 +324,49 @@ TextureHandle TextureManager::get(const Common::UString &name) {
 		return _newPLTs.back().getPLT().getTexture();
 	}
 
+	// Resources might have been added or removed, so the unused textures might be stale
+	if (_resGeneration != ResMan.getGeneration()) {
+		dropUnused();
+
+		_resGeneration = ResMan.getGeneration();
+	}
+
 	TextureMap::iterator texture = _textures.find(name);
+	if ((texture != _textures.end()) && (texture->second->referenceCount == 0)) {
+		// Reuse a texture we kept around
+		ManagedTexture &managed = *texture->second;
+
+		_unused.erase(managed.usage);
+		_unusedSize -= managed.size;
+
+		managed.usage = _unused.end();
+
+		_hits++;
+	}
+
 	if (texture == _textures.end()) {
 		std::pair<TextureMap::iterator, bool> result;
 
-		ManagedTexture *t = new ManagedTexture(name);
+		TextureLoader *loader = 0;
+		if (background && _loader && (_loader->getThreadCount() > 0))
+			loader = _loader;
+
+		ManagedTexture *t = new ManagedTexture(name, loader);
 
 		result = _textures.insert(std::make_pair(name, t));
 
 		texture = result.first;
 
 		texture->second->reloadable = true;
+		texture->second->usage      = _unused.end();
+
+		_misses++;
+
+		// Textures decoded in the background only tell us their size later
+		_unknownSizes++;
+		updateSize(*texture->second);
+		if (texture->second->sizeKnown)
+			enforceBudget();
 	}
 
 	return TextureHandle(texture);
@@ -253,9 +396,20 @@ void TextureManager::release(TextureHandle &texture) {
 	Common::StackLock lock(_mutex);
 
 	if (!texture._empty && (texture._it != _textures.end())) {
-		if (--texture._it->second->referenceCount == 0) {
-			delete texture._it->second;
-			_textures.erase(texture._it);
+		ManagedTexture &managed = *texture._it->second;
+
+		if (--managed.referenceCount == 0) {
+			if (managed.reloadable && (_budget > 0)) {
+				// Keep the texture around, in case it's needed again soon
+
+				managed.usage = _unused.insert(_unused.end(), texture._it->first);
+				_unusedSize  += managed.size;
+
+				updateSizes();
+				enforceBudget();
+
+			} else
+				drop(texture._it);
 		}
 	}
 
@@ -280,6 +434,9 @@ void TextureManager::release(PLTHandle &plt) {
 void TextureManager::reloadAll() {
 	Common::StackLock lock(_mutex);
 
+	// No need to reload what isn't used
+	dropUnused();
+
 	GfxMan.lockFrame();
 
 	TextureMap::iterator texture;
@@ -296,6 +453,82 @@ void TextureManager::reloadAll() {
 
 	RequestMan.sync();
 	GfxMan.unlockFrame();
+
+	resetSizes();
+}
+
+void TextureManager::updateSize(ManagedTexture &texture) {
+	if (texture.sizeKnown || !texture.texture->isDecoded())
+		return;
+
+	texture.size      = texture.texture->getImageSize();
+	texture.sizeKnown = true;
+
+	_size += texture.size;
+	if (texture.usage != _unused.end())
+		_unusedSize += texture.size;
+
+	_unknownSizes--;
+}
+
+void TextureManager::updateSizes() {
+	if (_unknownSizes == 0)
+		return;
+
+	for (TextureMap::iterator t = _textures.begin(); t != _textures.end(); ++t)
+		updateSize(*t->second);
+}
+
+void TextureManager::resetSizes() {
+	for (TextureMap::iterator t = _textures.begin(); t != _textures.end(); ++t) {
+		ManagedTexture &texture = *t->second;
+		if (!texture.sizeKnown)
+			continue;
+
+		_size -= texture.size;
+		if (texture.usage != _unused.end())
+			_unusedSize -= texture.size;
+
+		texture.size      = 0;
+		texture.sizeKnown = false;
+
+		_unknownSizes++;
+	}
+
+	updateSizes();
+}
+
+void TextureManager::enforceBudget() {
+	if (_budget == 0)
+		return;
+
+	// Only unused textures can go, the others stay, budget or not
+	while ((_size > _budget) && !_unused.empty())
+		drop(_textures.find(_unused.front()));
+}
+
+void TextureManager::dropUnused() {
+	while (!_unused.empty())
+		drop(_textures.find(_unused.front()));
+}
+
+void TextureManager::drop(TextureMap::iterator texture) {
+	assert(texture != _textures.end());
+
+	ManagedTexture *managed = texture->second;
+
+	if (managed->usage != _unused.end()) {
+		_unused.erase(managed->usage);
+		_unusedSize -= managed->size;
+	}
+
+	if (managed->sizeKnown)
+		_size -= managed->size;
+	else
+		_unknownSizes--;
+
+	delete managed;
+	_textures.erase(texture);
 }
 
 void TextureManager::getNewPLTs(std::list<PLTHandle> &plts) {
@@ -309,13 +542,11 @@ void TextureManager::clearNewPLTs() {
 }
 
 void TextureManager::reset() {
-	activeTexture(0);
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateMan.resetTextures();
 }
 
 void TextureManager::set() {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateMan.bindTexture(0);
 }
 
 void TextureManager::set(const TextureHandle &handle) {
@@ -324,54 +555,46 @@ void TextureManager::set(const TextureHandle &handle) {
 		return;
 	}
 
-	TextureID id = handle._it->second->texture->getID();
-	if (id == 0)
+	const Texture &texture = *handle._it->second->texture;
+	if ((texture.getID() == 0) && !texture.isDeferrable())
 		warning("Empty texture ID for texture \"%s\"", handle._it->first.c_str());
 
-	glBindTexture(GL_TEXTURE_2D, id);
-}
-
-static GLenum texture[32] = {
-	GL_TEXTURE0_ARB,
-	GL_TEXTURE1_ARB,
-	GL_TEXTURE2_ARB,
-	GL_TEXTURE3_ARB,
-	GL_TEXTURE4_ARB,
-	GL_TEXTURE5_ARB,
-	GL_TEXTURE6_ARB,
-	GL_TEXTURE7_ARB,
-	GL_TEXTURE8_ARB,
-	GL_TEXTURE9_ARB,
-	GL_TEXTURE10_ARB,
-	GL_TEXTURE11_ARB,
-	GL_TEXTURE12_ARB,
-	GL_TEXTURE13_ARB,
-	GL_TEXTURE14_ARB,
-	GL_TEXTURE15_ARB,
-	GL_TEXTURE16_ARB,
-	GL_TEXTURE17_ARB,
-	GL_TEXTURE18_ARB,
-	GL_TEXTURE19_ARB,
-	GL_TEXTURE20_ARB,
-	GL_TEXTURE21_ARB,
-	GL_TEXTURE22_ARB,
-	GL_TEXTURE23_ARB,
-	GL_TEXTURE24_ARB,
-	GL_TEXTURE25_ARB,
-	GL_TEXTURE26_ARB,
-	GL_TEXTURE27_ARB,
-	GL_TEXTURE28_ARB,
-	GL_TEXTURE29_ARB,
-	GL_TEXTURE30_ARB,
-	GL_TEXTURE31_ARB
-};
+	GLStateMan.bindTexture(getID(texture));
+}
+
+bool TextureManager::isReady(const TextureHandle &handle) const {
+	if (handle.empty())
+		return true;
+
+	const Texture &texture = *handle._it->second->texture;
+	if ((texture.getID() != 0) || !texture.isDeferrable())
+		return true;
+
+	// A texture that failed to decode will never be uploaded, so it just keeps the placeholder
+	return texture.hasFailed();
+}
+
+TextureID TextureManager::getID(const TextureHandle &handle) const {
+	if (handle.empty())
+		return 0;
+
+	return getID(*handle._it->second->texture);
+}
+
+TextureID TextureManager::getID(const Texture &texture) const {
+	// Textures decoded in the background might not be uploaded yet
+	if ((texture.getID() == 0) && texture.isDeferrable())
+		return _placeholder->getID();
+
+	return texture.getID();
+}
 
 void TextureManager::activeTexture(uint32 n) {
-	if (n >= ARRAYSIZE(texture))
+	// OpenGL doesn't go beyond GL_TEXTURE31
+	if (n >= 32)
 		return;
 
-	if (GfxMan.supportMultipleTextures())
-		glActiveTextureARB(texture[n]);
+	GLStateMan.activeTexture(n);
 }
 
 } // End of namespace Aurora
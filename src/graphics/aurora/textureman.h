@@ -32,6 +32,7 @@
 
 #include <map>
 #include <list>
+#include <vector>
 
 #include "graphics/types.h"
 
@@ -45,8 +46,11 @@ namespace Graphics {
 namespace Aurora {
 
 class Texture;
+class TextureLoader;
 class PLTFile;
 
+typedef std::list<Common::UString> TextureUsageList;
+
 /** A managed texture, storing how often it's referenced. */
 struct ManagedTexture {
 	Texture *texture;
@@ -54,7 +58,12 @@ struct ManagedTexture {
 
 	bool reloadable;
 
-	ManagedTexture(const Common::UString &name);
+	uint32 size;      ///< The size of the texture's image data, in bytes.
+	bool   sizeKnown; ///< Do we know the size yet, or is the image still decoding?
+
+	TextureUsageList::iterator usage; ///< Our place in the list of unused textures.
+
+	ManagedTexture(const Common::UString &name, TextureLoader *loader = 0);
 	ManagedTexture(const Common::UString &name, Texture *t);
 	~ManagedTexture();
 };
@@ -118,17 +127,69 @@ private:
 	friend class TextureManager;
 };
 
-/** The global Aurora texture manager. */
+/** The global Aurora texture manager.
+ *
+ *  Textures that aren't referenced anymore are kept around for a while,
+ *  in case they're needed again soon, for example when going back to an
+ *  area. They're dropped, least recently used first, when the size of all
+ *  textures exceeds the budget, or when the resource manager's index
+ *  changes.
+ */
 class TextureManager : public Common::Singleton<TextureManager> {
 public:
+	/** Memory usage of a texture. */
+	struct Stats {
+		Common::UString name;
+
+		uint32 size;           ///< The size of the texture's image data, in bytes.
+		uint32 referenceCount; ///< 0 if the texture is only kept for reuse.
+
+		Stats(const Common::UString &n = "", uint32 s = 0, uint32 r = 0);
+	};
+
 	TextureManager();
 	~TextureManager();
 
 	void clear();
 
+	/** Set the maximum size of all textures, in bytes.
+	 *
+	 *  Only unused textures can be dropped to meet the budget. 0 means
+	 *  that unused textures are not kept at all.
+	 */
+	void setBudget(uint32 budget);
+	/** Return the maximum size of all textures, in bytes. */
+	uint32 getBudget() const;
+
+	/** Return the current size of all textures, in bytes. */
+	uint32 getSize();
+	/** Return the current size of all unused textures, in bytes. */
+	uint32 getUnusedSize();
+
+	/** Return the number of times an unused texture was reused. */
+	uint32 getHits() const;
+	/** Return the number of times a texture had to be loaded. */
+	uint32 getMisses() const;
+
+	/** Get the memory usage of all textures, biggest first. */
+	void getStats(std::vector<Stats> &stats);
+
+
+	/** Set the number of threads decoding texture images in the background.
+	 *
+	 *  0 means all images are decoded right when the texture is created.
+	 *  Should only be called while there are no textures.
+	 */
+	void setDecodeThreadCount(uint32 count);
+
 
 	TextureHandle add(Texture *texture, Common::UString name = "");
-	TextureHandle get(const Common::UString &name);
+	/** Get the texture of that name, loading it if necessary.
+	 *
+	 *  A newly loaded texture may have its image decoded in the background.
+	 *  Until it's ready, a placeholder texture is shown in its place.
+	 */
+	TextureHandle get(const Common::UString &name, bool background = false);
 
 
 	void reloadAll();
@@ -145,15 +206,59 @@ public:
 
 	void activeTexture(uint32 n);
 
+	/** Is the texture ready to be rendered?
+	 *
+	 *  A texture still being decoded or waiting to be uploaded isn't, the
+	 *  placeholder is shown in its place until then. A texture that failed
+	 *  to decode is, it keeps showing the placeholder.
+	 */
+	bool isReady(const TextureHandle &handle) const;
+
+	/** Return the OpenGL texture ID of this texture, or 0 if it's empty. */
+	TextureID getID(const TextureHandle &handle) const;
+
 
 private:
 	TextureMap _textures;
 	PLTList    _plts;
 
+	TextureUsageList _unused; ///< Unused textures, least recently used first.
+
+	uint32 _budget;     ///< Maximum size of all textures.
+	uint32 _size;       ///< Size of all textures whose size we know.
+	uint32 _unusedSize; ///< Size of all unused textures whose size we know.
+
+	uint32 _unknownSizes; ///< Number of textures whose size we don't know yet.
+
+	uint32 _hits;
+	uint32 _misses;
+
+	uint32 _resGeneration; ///< The resource manager generation of the unused textures.
+
 	std::list<PLTHandle> _newPLTs;
 
+	TextureLoader *_loader;      ///< Decoding texture images in the background.
+	Texture       *_placeholder; ///< Shown in place of textures still decoding.
+
 	Common::Mutex _mutex;
 
+	/** Return the ID of the texture, or of the placeholder if it's not uploaded yet. */
+	TextureID getID(const Texture &texture) const;
+
+	/** Find out the size of the texture, once its image is decoded. */
+	void updateSize(ManagedTexture &texture);
+	/** Find out the sizes of all textures whose images have been decoded since. */
+	void updateSizes();
+	/** Forget the size of all textures, because they were reloaded. */
+	void resetSizes();
+
+	/** Drop unused textures until we're within the budget. */
+	void enforceBudget();
+	/** Drop all unused textures. */
+	void dropUnused();
+	/** Remove this texture from the manager and delete it. */
+	void drop(TextureMap::iterator texture);
+
 	void release(TextureMap::iterator &i);
 	void release(PLTList::iterator &i);
 
@@ -0,0 +1,396 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/glstate.cpp
+ *  A shadow of the OpenGL state, filtering out redundant state changes.
+ */
+
+#include "graphics/glstate.h"
+#include "graphics/graphics.h"
+
+DECLARE_SINGLETON(Graphics::GLStateManager)
+
+/** A value no unit, texture, buffer or enum will ever have, for unknown state. */
+static const uint32 kUnknown = 0xFFFFFFFF;
+
+namespace Graphics {
+
+GLStateManager::GLStateManager() {
+	invalidate();
+	resetCounts();
+}
+
+GLStateManager::~GLStateManager() {
+}
+
+void GLStateManager::invalidate() {
+	_activeTexture       = kUnknown;
+	_clientActiveTexture = kUnknown;
+
+	for (uint32 i = 0; i < kMaxTextureUnits; i++) {
+		_texture         [i] = kUnknown;
+		_textureEnabled  [i] = kStateUnknown;
+		_texCoordsEnabled[i] = kStateUnknown;
+	}
+
+	for (int i = 0; i < kCapMAX; i++)
+		_caps[i] = kStateUnknown;
+	for (int i = 0; i < kArrayMAX; i++)
+		_arrays[i] = kStateUnknown;
+
+	_blendSFactor = kUnknown;
+	_blendDFactor = kUnknown;
+	_depthFunc    = kUnknown;
+
+	_arrayBuffer   = kUnknown;
+	_elementBuffer = kUnknown;
+}
+
+bool GLStateManager::isRedundant(bool redundant) {
+	if (redundant)
+		_elided++;
+
+	return redundant;
+}
+
+void GLStateManager::activeTexture(uint32 unit) {
+	// Without multiple texture support, everything happens on the first unit
+	if (!GfxMan.supportMultipleTextures()) {
+		_activeTexture = 0;
+		return;
+	}
+
+	if (isRedundant(unit == _activeTexture))
+		return;
+
+	glActiveTextureARB(GL_TEXTURE0_ARB + unit);
+
+	_activeTexture = unit;
+	_stateChanges++;
+}
+
+void GLStateManager::clientActiveTexture(uint32 unit) {
+	if (!GfxMan.supportMultipleTextures()) {
+		_clientActiveTexture = 0;
+		return;
+	}
+
+	if (isRedundant(unit == _clientActiveTexture))
+		return;
+
+	glClientActiveTextureARB(GL_TEXTURE0_ARB + unit);
+
+	_clientActiveTexture = unit;
+	_stateChanges++;
+}
+
+void GLStateManager::bindTexture(TextureID texture) {
+	// We can only know what's bound if we know which unit is active
+	if (_activeTexture < kMaxTextureUnits) {
+		if (isRedundant(_texture[_activeTexture] == texture))
+			return;
+
+		_texture[_activeTexture] = texture;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	_textureBinds++;
+}
+
+void GLStateManager::bindTexture(uint32 unit, TextureID texture) {
+	if (!hasTextureUnit(unit))
+		return;
+
+	if ((unit < kMaxTextureUnits) && isRedundant(_texture[unit] == texture))
+		return;
+
+	activeTexture(unit);
+	bindTexture(texture);
+}
+
+void GLStateManager::setTextureEnabled(uint32 unit, bool enabled) {
+	if (!hasTextureUnit(unit))
+		return;
+
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+	if ((unit < kMaxTextureUnits) && isRedundant(_textureEnabled[unit] == state))
+		return;
+
+	activeTexture(unit);
+	setActiveTextureEnabled(enabled);
+}
+
+void GLStateManager::setTexCoordsEnabled(uint32 unit, bool enabled) {
+	if (!hasTextureUnit(unit))
+		return;
+
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+	if ((unit < kMaxTextureUnits) && isRedundant(_texCoordsEnabled[unit] == state))
+		return;
+
+	clientActiveTexture(unit);
+	setActiveTexCoordsEnabled(enabled);
+}
+
+void GLStateManager::resetTextures() {
+	for (uint32 i = 1; i < GfxMan.getTextureUnitCount(); i++)
+		setTextureEnabled(i, false);
+
+	activeTexture(0);
+	setActiveTextureEnabled(true);
+	bindTexture(0);
+}
+
+void GLStateManager::enable(GLenum cap) {
+	if (cap == GL_TEXTURE_2D)
+		setActiveTextureEnabled(true);
+	else
+		setCap(cap, true);
+}
+
+void GLStateManager::disable(GLenum cap) {
+	if (cap == GL_TEXTURE_2D)
+		setActiveTextureEnabled(false);
+	else
+		setCap(cap, false);
+}
+
+void GLStateManager::enableClientState(GLenum array) {
+	if (array == GL_TEXTURE_COORD_ARRAY)
+		setActiveTexCoordsEnabled(true);
+	else
+		setClientState(array, true);
+}
+
+void GLStateManager::disableClientState(GLenum array) {
+	if (array == GL_TEXTURE_COORD_ARRAY)
+		setActiveTexCoordsEnabled(false);
+	else
+		setClientState(array, false);
+}
+
+void GLStateManager::blendFunc(GLenum sFactor, GLenum dFactor) {
+	if (isRedundant((sFactor == _blendSFactor) && (dFactor == _blendDFactor)))
+		return;
+
+	glBlendFunc(sFactor, dFactor);
+
+	_blendSFactor = sFactor;
+	_blendDFactor = dFactor;
+	_stateChanges++;
+}
+
+void GLStateManager::depthFunc(GLenum func) {
+	if (isRedundant(func == _depthFunc))
+		return;
+
+	glDepthFunc(func);
+
+	_depthFunc = func;
+	_stateChanges++;
+}
+
+void GLStateManager::bindBuffer(GLenum target, BufferID buffer) {
+	if (!GfxMan.supportBufferObjects())
+		return;
+
+	BufferID *bound = 0;
+	if      (target == GL_ARRAY_BUFFER_ARB)
+		bound = &_arrayBuffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER_ARB)
+		bound = &_elementBuffer;
+
+	if (bound && isRedundant(*bound == buffer))
+		return;
+
+	glBindBufferARB(target, buffer);
+
+	if (bound)
+		*bound = buffer;
+
+	_stateChanges++;
+}
+
+void GLStateManager::deleteTextures(uint32 count, const TextureID *textures) {
+	if (count == 0)
+		return;
+
+	// Deleting a bound texture reverts the unit to the default texture
+	for (uint32 i = 0; i < count; i++)
+		for (uint32 j = 0; j < kMaxTextureUnits; j++)
+			if (_texture[j] == textures[i])
+				_texture[j] = 0;
+
+	glDeleteTextures(count, textures);
+}
+
+void GLStateManager::deleteBuffers(uint32 count, const BufferID *buffers) {
+	if (count == 0)
+		return;
+
+	// Deleting a bound buffer object reverts the binding to 0
+	for (uint32 i = 0; i < count; i++) {
+		if (_arrayBuffer == buffers[i])
+			_arrayBuffer = 0;
+		if (_elementBuffer == buffers[i])
+			_elementBuffer = 0;
+	}
+
+	glDeleteBuffersARB(count, buffers);
+}
+
+void GLStateManager::resetCounts() {
+	_textureBinds = 0;
+	_stateChanges = 0;
+	_elided       = 0;
+}
+
+uint32 GLStateManager::getTextureBindCount() const {
+	return _textureBinds;
+}
+
+uint32 GLStateManager::getStateChangeCount() const {
+	return _stateChanges;
+}
+
+uint32 GLStateManager::getElidedCount() const {
+	return _elided;
+}
+
+bool GLStateManager::hasTextureUnit(uint32 unit) const {
+	// The texture unit count is 1 without multiple texture support, and never above kMaxTextureUnits
+	return unit < GfxMan.getTextureUnitCount();
+}
+
+void GLStateManager::setActiveTextureEnabled(bool enabled) {
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+
+	if (_activeTexture < kMaxTextureUnits) {
+		if (isRedundant(_textureEnabled[_activeTexture] == state))
+			return;
+
+		_textureEnabled[_activeTexture] = state;
+	}
+
+	if (enabled)
+		glEnable(GL_TEXTURE_2D);
+	else
+		glDisable(GL_TEXTURE_2D);
+
+	_stateChanges++;
+}
+
+void GLStateManager::setCap(GLenum cap, bool enabled) {
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+
+	int n = findCap(cap);
+	if (n >= 0) {
+		if (isRedundant(_caps[n] == state))
+			return;
+
+		_caps[n] = state;
+	}
+
+	if (enabled)
+		glEnable(cap);
+	else
+		glDisable(cap);
+
+	_stateChanges++;
+}
+
+void GLStateManager::setActiveTexCoordsEnabled(bool enabled) {
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+
+	if (_clientActiveTexture < kMaxTextureUnits) {
+		if (isRedundant(_texCoordsEnabled[_clientActiveTexture] == state))
+			return;
+
+		_texCoordsEnabled[_clientActiveTexture] = state;
+	}
+
+	if (enabled)
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	else
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	_stateChanges++;
+}
+
+void GLStateManager::setClientState(GLenum array, bool enabled) {
+	const State state = enabled ? kStateEnabled : kStateDisabled;
+
+	int n = findArray(array);
+	if (n >= 0) {
+		if (isRedundant(_arrays[n] == state))
+			return;
+
+		_arrays[n] = state;
+	}
+
+	if (enabled)
+		glEnableClientState(array);
+	else
+		glDisableClientState(array);
+
+	_stateChanges++;
+}
+
+int GLStateManager::findCap(GLenum cap) {
+	switch (cap) {
+		case GL_BLEND:
+			return kCapBlend;
+		case GL_DEPTH_TEST:
+			return kCapDepthTest;
+		case GL_ALPHA_TEST:
+			return kCapAlphaTest;
+		case GL_CULL_FACE:
+			return kCapCullFace;
+		case GL_COLOR_LOGIC_OP:
+			return kCapColorLogicOp;
+		default:
+			break;
+	}
+
+	return -1;
+}
+
+int GLStateManager::findArray(GLenum array) {
+	switch (array) {
+		case GL_VERTEX_ARRAY:
+			return kArrayVertex;
+		case GL_NORMAL_ARRAY:
+			return kArrayNormal;
+		case GL_COLOR_ARRAY:
+			return kArrayColor;
+		default:
+			break;
+	}
+
+	return -1;
+}
+
+} // End of namespace Graphics
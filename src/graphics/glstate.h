@@ -0,0 +1,183 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/glstate.h
+ *  A shadow of the OpenGL state, filtering out redundant state changes.
+ */
+
+#ifndef GRAPHICS_GLSTATE_H
+#define GRAPHICS_GLSTATE_H
+
+#include "common/types.h"
+#include "common/singleton.h"
+
+#include "graphics/types.h"
+
+namespace Graphics {
+
+/** A shadow of the OpenGL state, filtering out redundant state changes.
+ *
+ *  All changes to the texture bindings, enabled capabilities and client
+ *  arrays, blending and depth testing, and buffer bindings should go through
+ *  here. Changes that would set a state to the value it already has are then
+ *  dropped, instead of reaching the driver.
+ *
+ *  Unit-specific state can be set for a specific unit directly. The active
+ *  unit is then only switched if the state of that unit actually changes.
+ *
+ *  Any OpenGL command that changes the state behind our back, like calling or
+ *  compiling a display list, needs to be followed by invalidate(). Until a
+ *  state is set again, it's then unknown, and setting it always goes through.
+ */
+class GLStateManager : public Common::Singleton<GLStateManager> {
+public:
+	/** The number of texture units we keep track of, at most. */
+	static const uint32 kMaxTextureUnits = 8;
+
+	GLStateManager();
+	~GLStateManager();
+
+	/** Forget all known state. */
+	void invalidate();
+
+	/** Does the OpenGL implementation have that texture unit, and do we keep track of it? */
+	bool hasTextureUnit(uint32 unit) const;
+
+	/** Select the active texture unit. */
+	void activeTexture(uint32 unit);
+	/** Select the active texture unit for texture coordinate arrays. */
+	void clientActiveTexture(uint32 unit);
+
+	/** Bind a 2D texture to the active texture unit. */
+	void bindTexture(TextureID texture);
+	/** Bind a 2D texture to that texture unit, selecting it only if necessary. */
+	void bindTexture(uint32 unit, TextureID texture);
+
+	/** Enable/Disable 2D texturing on that texture unit, selecting it only if necessary. */
+	void setTextureEnabled(uint32 unit, bool enabled);
+	/** Enable/Disable the texture coordinate array of that texture unit, selecting it only if necessary. */
+	void setTexCoordsEnabled(uint32 unit, bool enabled);
+
+	/** Disable texturing on all but the first unit, and select it with no texture bound. */
+	void resetTextures();
+
+	/** Enable a capability. GL_TEXTURE_2D applies to the active texture unit. */
+	void enable(GLenum cap);
+	/** Disable a capability. GL_TEXTURE_2D applies to the active texture unit. */
+	void disable(GLenum cap);
+
+	/** Enable a client array. GL_TEXTURE_COORD_ARRAY applies to the client active texture unit. */
+	void enableClientState(GLenum array);
+	/** Disable a client array. GL_TEXTURE_COORD_ARRAY applies to the client active texture unit. */
+	void disableClientState(GLenum array);
+
+	/** Set the blending function. */
+	void blendFunc(GLenum sFactor, GLenum dFactor);
+	/** Set the depth test function. */
+	void depthFunc(GLenum func);
+
+	/** Bind a buffer object to GL_ARRAY_BUFFER_ARB or GL_ELEMENT_ARRAY_BUFFER_ARB. */
+	void bindBuffer(GLenum target, BufferID buffer);
+
+	/** Delete these textures, unbinding them where they're bound. */
+	void deleteTextures(uint32 count, const TextureID *textures);
+	/** Delete these buffer objects, unbinding them where they're bound. */
+	void deleteBuffers(uint32 count, const BufferID *buffers);
+
+	/** Reset the counters. */
+	void resetCounts();
+
+	/** Return the number of textures bound since the counters were reset. */
+	uint32 getTextureBindCount() const;
+	/** Return the number of other state changes since the counters were reset. */
+	uint32 getStateChangeCount() const;
+	/** Return the number of redundant state changes dropped since the counters were reset. */
+	uint32 getElidedCount() const;
+
+private:
+	/** A capability we keep track of. */
+	enum Cap {
+		kCapBlend = 0,
+		kCapDepthTest,
+		kCapAlphaTest,
+		kCapCullFace,
+		kCapColorLogicOp,
+		kCapMAX
+	};
+
+	/** A client array we keep track of, besides the texture coordinates. */
+	enum Array {
+		kArrayVertex = 0,
+		kArrayNormal,
+		kArrayColor,
+		kArrayMAX
+	};
+
+	/** The state of a capability or client array. */
+	enum State {
+		kStateUnknown = 0,
+		kStateDisabled,
+		kStateEnabled
+	};
+
+	uint32 _activeTexture;       ///< The active texture unit.
+	uint32 _clientActiveTexture; ///< The client active texture unit.
+
+	TextureID _texture         [kMaxTextureUnits]; ///< The texture bound to each unit.
+	State     _textureEnabled  [kMaxTextureUnits]; ///< Is texturing enabled on each unit?
+	State     _texCoordsEnabled[kMaxTextureUnits]; ///< Is the texture coordinate array enabled on each unit?
+
+	State _caps  [kCapMAX];   ///< The state of the capabilities.
+	State _arrays[kArrayMAX]; ///< The state of the client arrays.
+
+	GLenum _blendSFactor; ///< The source blending factor.
+	GLenum _blendDFactor; ///< The destination blending factor.
+	GLenum _depthFunc;    ///< The depth test function.
+
+	BufferID _arrayBuffer;   ///< The bound vertex buffer object.
+	BufferID _elementBuffer; ///< The bound index buffer object.
+
+	uint32 _textureBinds; ///< Number of textures bound.
+	uint32 _stateChanges; ///< Number of other state changes.
+	uint32 _elided;       ///< Number of redundant state changes dropped.
+
+	/** Return whether this state change is redundant, counting it as dropped if it is. */
+	bool isRedundant(bool redundant);
+
+	void setActiveTextureEnabled(bool enabled);
+	void setActiveTexCoordsEnabled(bool enabled);
+	void setCap(GLenum cap, bool enabled);
+	void setClientState(GLenum array, bool enabled);
+
+	static int findCap(GLenum cap);
+	static int findArray(GLenum array);
+};
+
+} // End of namespace Graphics
+
+/** Shortcut for accessing the OpenGL state manager. */
+#define GLStateMan Graphics::GLStateManager::instance()
+
+#endif // GRAPHICS_GLSTATE_H
@@ -36,18 +36,23 @@
 #include "common/file.h"
 #include "common/configman.h"
 #include "common/threads.h"
+#include "common/threadpool.h"
 #include "common/transmatrix.h"
+#include "common/frustum.h"
+#include "common/boundingbox.h"
 
 #include "events/requests.h"
 #include "events/events.h"
 #include "events/notifications.h"
 
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 #include "graphics/util.h"
 #include "graphics/cursor.h"
 #include "graphics/fpscounter.h"
 #include "graphics/queueman.h"
 #include "graphics/glcontainer.h"
+#include "graphics/texture.h"
 #include "graphics/renderable.h"
 #include "graphics/camera.h"
 
@@ -63,6 +68,8 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 
 	_needManualDeS3TC        = false;
 	_supportMultipleTextures = false;
+	_textureUnitCount        = 1;
+	_supportBufferObjects    = false;
 
 	_fullScreen = false;
 
@@ -75,6 +82,26 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 
 	_fpsCounter = new FPSCounter(3);
 
+	_animationThreads = 0;
+
+	_animationLOD.reducedDistance = 0.0f;
+	_animationLOD.rootDistance    = 0.0f;
+	_animationLOD.hysteresis      = 0.0f;
+	_animationLOD.reducedRate     = 0.0f;
+	_animationLOD.freezeOffScreen = false;
+
+	_worldObjectCount  = 0;
+	_culledObjectCount = 0;
+
+	_textureBindCount  = 0;
+	_stateChangeCount  = 0;
+	_elidedChangeCount = 0;
+
+	_textureUploadSize   = 0;
+	_textureUploadTime   = 0;
+	_textureUploadedSize = 0;
+	_textureUploadedTime = 0;
+
 	_frameLock = 0;
 
 	_cursor = 0;
@@ -132,6 +159,24 @@ void GraphicsManager::init() {
 	if (ConfigMan.hasKey("gamma"))
 		setGamma(ConfigMan.getDouble("gamma", 1.0));
 
+	// Spread the upload of textures decoded in the background over several frames
+	const uint64 uploadSize = MAX(ConfigMan.getInt("textureuploadsize", 4096), 0) * (uint64) 1024;
+	const uint64 uploadTime = MAX(ConfigMan.getInt("textureuploadtime",    4), 0) * (uint64) 1000;
+
+	setTextureUploadBudget(MIN<uint64>(uploadSize, 0xFFFFFFFF), MIN<uint64>(uploadTime, 0xFFFFFFFF));
+
+	// Worker threads for evaluating animations, in addition to the main thread
+	_animationThreads = new Common::ThreadPool(MAX(ConfigMan.getInt("animationthreads", 2), 0));
+
+	// Reducing the animation detail of objects far away or off screen
+	if (ConfigMan.getBool("animationlod", true)) {
+		_animationLOD.reducedDistance = MAX(ConfigMan.getDouble("animationlodreduced"   , 20.0), 0.0);
+		_animationLOD.rootDistance    = MAX(ConfigMan.getDouble("animationlodroot"      , 50.0), 0.0);
+		_animationLOD.hysteresis      = CLIP(ConfigMan.getDouble("animationlodhysteresis",  0.1), 0.0, 1.0);
+		_animationLOD.reducedRate     = MAX(ConfigMan.getDouble("animationlodrate"      , 10.0), 1.0);
+		_animationLOD.freezeOffScreen = ConfigMan.getBool("animationlodfreeze", true);
+	}
+
 	_ready = true;
 }
 
@@ -143,12 +188,21 @@ void GraphicsManager::deinit() {
 
 	QueueMan.clearAllQueues();
 
+	delete _animationThreads;
+	_animationThreads = 0;
+
+	_worldObjectTreeMutex.lock();
+	_worldObjectTree.clear();
+	_worldObjectTreeMutex.unlock();
+
 	SDL_Quit();
 
 	_ready = false;
 
 	_needManualDeS3TC        = false;
 	_supportMultipleTextures = false;
+	_textureUnitCount        = 1;
+	_supportBufferObjects    = false;
 }
 
 bool GraphicsManager::ready() const {
@@ -163,6 +217,14 @@ bool GraphicsManager::supportMultipleTextures() const {
 	return _supportMultipleTextures;
 }
 
+uint32 GraphicsManager::getTextureUnitCount() const {
+	return _textureUnitCount;
+}
+
+bool GraphicsManager::supportBufferObjects() const {
+	return _supportBufferObjects;
+}
+
 int GraphicsManager::getMaxFSAA() const {
 	return _fsaaMax;
 }
@@ -175,6 +237,35 @@ uint32 GraphicsManager::getFPS() const {
 	return _fpsCounter->getFPS();
 }
 
+uint32 GraphicsManager::getWorldObjectCount() const {
+	return _worldObjectCount;
+}
+
+uint32 GraphicsManager::getCulledObjectCount() const {
+	return _culledObjectCount;
+}
+
+uint32 GraphicsManager::getTextureBindCount() const {
+	return _textureBindCount;
+}
+
+uint32 GraphicsManager::getStateChangeCount() const {
+	return _stateChangeCount;
+}
+
+uint32 GraphicsManager::getElidedChangeCount() const {
+	return _elidedChangeCount;
+}
+
+void GraphicsManager::setTextureUploadBudget(uint32 size, uint32 time) {
+	_textureUploadSize = size;
+	_textureUploadTime = time;
+}
+
+const AnimationLOD &GraphicsManager::getAnimationLOD() const {
+	return _animationLOD;
+}
+
 void GraphicsManager::initSize(int width, int height, bool fullscreen) {
 	int bpp = SDL_GetVideoInfo()->vfmt->BitsPerPixel;
 	if ((bpp != 16) && (bpp != 24) && (bpp != 32))
@@ -333,6 +424,23 @@ void GraphicsManager::checkGLExtensions() {
 		_supportMultipleTextures = false;
 	} else
 		_supportMultipleTextures = true;
+
+	// Drivers only need to support 2 fixed-function texture units, and many only have 4
+	_textureUnitCount = 1;
+	if (_supportMultipleTextures) {
+		GLint textureUnits = 1;
+		glGetIntegerv(GL_MAX_TEXTURE_UNITS_ARB, &textureUnits);
+
+		_textureUnitCount = CLIP<uint32>(textureUnits, 1, GLStateManager::kMaxTextureUnits);
+	}
+
+	if (!GLEW_ARB_vertex_buffer_object) {
+		warning("Your graphics card does not support vertex buffer objects");
+		warning("Xoreos will fall back to display lists. This will be slower");
+
+		_supportBufferObjects = false;
+	} else
+		_supportBufferObjects = true;
 }
 
 void GraphicsManager::setWindowTitle(const Common::UString &title) {
@@ -368,21 +476,24 @@ void GraphicsManager::setupScene() {
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
+	// We don't know anything about the state of a new context
+	GLStateMan.invalidate();
+
 	glShadeModel(GL_SMOOTH);
 	glClearColor(0.0, 0.0, 0.0, 0.5);
 	glClearDepth(1.0);
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	GLStateMan.enable(GL_DEPTH_TEST);
+	GLStateMan.depthFunc(GL_LEQUAL);
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLStateMan.enable(GL_BLEND);
+	GLStateMan.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	glAlphaFunc(GL_GREATER, 0.1);
-	glEnable(GL_ALPHA_TEST);
+	GLStateMan.enable(GL_ALPHA_TEST);
 
-	glEnable(GL_CULL_FACE);
+	GLStateMan.enable(GL_CULL_FACE);
 
 	perspective(60.0, ((float) _screen->w) / ((float) _screen->h), 1.0, 1000.0);
 }
@@ -646,6 +757,19 @@ void GraphicsManager::abandon(ListID ids, uint32 count) {
 	_hasAbandoned = true;
 }
 
+void GraphicsManager::abandonBuffers(BufferID *ids, uint32 count) {
+	if (count == 0)
+		return;
+
+	Common::StackLock lock(_abandonMutex);
+
+	_abandonBuffers.reserve(_abandonBuffers.size() + count);
+	while (count-- > 0)
+		_abandonBuffers.push_back(*ids++);
+
+	_hasAbandoned = true;
+}
+
 void GraphicsManager::setCursor(Cursor *cursor) {
 	lockFrame();
 
@@ -694,8 +818,10 @@ Renderable *GraphicsManager::getGUIObjectAt(float x, float y) const {
 	return object;
 }
 
-Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
-	if (QueueMan.isQueueEmpty(kQueueVisibleWorldObject))
+Renderable *GraphicsManager::getWorldObjectAt(float x, float y) {
+	Common::StackLock lock(_worldObjectTreeMutex);
+
+	if (_worldObjectTree.empty())
 		return 0;
 
 		// Map the screen coordinates to OpenGL world screen coordinates
@@ -705,27 +831,8 @@ Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
 	if (!unproject(x, y, x1, y1, z1, x2, y2, z2))
 		return 0;
 
-	Renderable *object = 0;
-
-	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
-
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
-		Renderable &r = static_cast<Renderable &>(**o);
-
-		if (!r.isClickable())
-			// Object isn't clickable, don't check
-			continue;
-
-		// If the line intersects with the object, return it
-		if (r.isIn(x1, y1, z1, x2, y2, z2)) {
-			object = &r;
-			break;
-		}
-	}
-
-	QueueMan.unlockQueue(kQueueVisibleWorldObject);
-	return object;
+	// Find the clickable object closest to the viewer the line intersects with
+	return _worldObjectTree.getClosestHit(x1, y1, z1, x2, y2, z2);
 }
 
 Renderable *GraphicsManager::getObjectAt(float x, float y) {
@@ -740,6 +847,60 @@ Renderable *GraphicsManager::getObjectAt(float x, float y) {
 	return 0;
 }
 
+/** Advancing time for a list of objects, one object per part. */
+class AdvanceTimeJob : public Common::ThreadPool::Job {
+public:
+	AdvanceTimeJob(const std::vector<Renderable *> &objects, float dt) : _objects(&objects), _dt(dt) {
+	}
+
+	void run(uint32 part) {
+		(*_objects)[part]->advanceTime(_dt);
+	}
+
+private:
+	const std::vector<Renderable *> *_objects;
+	float _dt;
+};
+
+void GraphicsManager::advanceTime(const std::list<Queueable *> &objects, float dt) {
+	_animated.clear();
+	_animated.reserve(objects.size());
+
+	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin(); o != objects.rend(); ++o)
+		_animated.push_back(static_cast<Renderable *>(*o));
+
+	// Evaluate the animations, in parallel
+	AdvanceTimeJob job(_animated, dt);
+	if (_animationThreads)
+		_animationThreads->run(job, _animated.size());
+	else
+		for (uint32 i = 0; i < _animated.size(); i++)
+			job.run(i);
+
+	// And apply them to the objects
+	for (std::vector<Renderable *>::iterator o = _animated.begin(); o != _animated.end(); ++o)
+		(*o)->applyAnimation();
+}
+
+void GraphicsManager::updateWorldObjectBound(Renderable &object) {
+	Common::StackLock lock(_worldObjectTreeMutex);
+
+	const Common::BoundingBox *bound = object.getAbsoluteBound();
+	if (!bound || bound->isEmpty()) {
+		// Without a bounding box, it can't be hit anyway
+		_worldObjectTree.remove(object);
+		return;
+	}
+
+	_worldObjectTree.update(object, *bound);
+}
+
+void GraphicsManager::removeWorldObjectBound(Renderable &object) {
+	Common::StackLock lock(_worldObjectTreeMutex);
+
+	_worldObjectTree.remove(object);
+}
+
 void GraphicsManager::buildNewTextures() {
 	QueueMan.lockQueue(kQueueNewTexture);
 	const std::list<Queueable *> &text = QueueMan.getQueue(kQueueNewTexture);
@@ -748,13 +909,41 @@ void GraphicsManager::buildNewTextures() {
 		return;
 	}
 
-	for (std::list<Queueable *>::const_iterator t = text.begin(); t != text.end(); ++t)
-		static_cast<GLContainer *>(*t)->rebuild();
+	std::list<Queueable *>::const_iterator t = text.begin();
+	while (t != text.end()) {
+		// Building the texture removes it from the queue
+		Texture *texture = static_cast<Texture *>(*t++);
+
+		if (!texture->isDeferrable()) {
+			texture->buildNew();
+			continue;
+		}
+
+		// Still decoding, or over this frame's budget? Try again next frame
+		if (!texture->isDecoded() || textureUploadBudgetSpent())
+			continue;
+
+		uint64 start = getMicroseconds();
+
+		_textureUploadedSize += texture->getImageSize();
+
+		texture->buildNew();
+
+		_textureUploadedTime += getMicroseconds() - start;
+	}
 
-	QueueMan.clearQueue(kQueueNewTexture);
 	QueueMan.unlockQueue(kQueueNewTexture);
 }
 
+bool GraphicsManager::textureUploadBudgetSpent() const {
+	if ((_textureUploadSize > 0) && (_textureUploadedSize >= _textureUploadSize))
+		return true;
+	if ((_textureUploadTime > 0) && (_textureUploadedTime >= _textureUploadTime))
+		return true;
+
+	return false;
+}
+
 void GraphicsManager::beginScene() {
 	// Switch cursor on/off
 	if (_cursorState != kCursorStateStay)
@@ -766,7 +955,7 @@ void GraphicsManager::beginScene() {
 	// Clear
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glEnable(GL_TEXTURE_2D);
+	GLStateMan.enable(GL_TEXTURE_2D);
 }
 
 bool GraphicsManager::playVideo() {
@@ -794,8 +983,11 @@ bool GraphicsManager::playVideo() {
 }
 
 bool GraphicsManager::renderWorld() {
-	if (QueueMan.isQueueEmpty(kQueueVisibleWorldObject))
+	if (QueueMan.isQueueEmpty(kQueueVisibleWorldObject)) {
+		_worldObjectCount  = 0;
+		_culledObjectCount = 0;
 		return false;
+	}
 
 	float cPos[3];
 	float cOrient[3];
@@ -821,6 +1013,18 @@ bool GraphicsManager::renderWorld() {
 	// Apply camera position
 	glTranslatef(-cPos[0], -cPos[1], cPos[2]);
 
+	// The same camera transformation again, to find out what's on screen
+	Common::TransformationMatrix camera;
+
+	camera.rotate(-cOrient[0], 1.0, 0.0, 0.0);
+	camera.rotate( cOrient[1], 0.0, 1.0, 0.0);
+	camera.rotate(-cOrient[2], 0.0, 0.0, 1.0);
+
+	camera.translate(-cPos[0], -cPos[1], cPos[2]);
+
+	Common::Frustum frustum;
+	frustum.set(_projection * camera);
+
 	QueueMan.lockQueue(kQueueVisibleWorldObject);
 	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
 
@@ -835,32 +1039,61 @@ bool GraphicsManager::renderWorld() {
 	float elapsedTime = (now - _lastSampled) / 1000.0f;
 	_lastSampled = now;
 
-	// If game paused, skip the advanceTime loop below
+	// Find the objects that are on screen, keeping the back-to-front order
+	_onScreen.clear();
+	_onScreen.reserve(objects.size());
 
-	// Advance time for animation queues
 	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
 	     o != objects.rend(); ++o) {
-		static_cast<Renderable *>(*o)->advanceTime(elapsedTime);
+
+		Renderable *object = static_cast<Renderable *>(*o);
+
+		object->setOnScreen(object->isIn(frustum));
+		if (object->isOnScreen())
+			_onScreen.push_back(object);
 	}
 
+	// If game paused, skip the advanceTime call below
+
+	// Advance time for animation queues. Animations don't change the
+	// bounding boxes, so objects can decide how to animate based on
+	// whether they're on screen.
+	advanceTime(objects, elapsedTime);
+
+	_worldObjectCount  = objects.size();
+	_culledObjectCount = objects.size() - _onScreen.size();
+
+	// Queue the geometry of the objects on screen, where possible
+	_renderQueue.clear(cPos[0], cPos[1], -cPos[2]);
+
+	_unqueued.clear();
+	for (std::vector<Renderable *>::const_iterator o = _onScreen.begin(); o != _onScreen.end(); ++o)
+		if (!(*o)->addToRenderQueue(_renderQueue))
+			_unqueued.push_back(*o);
+
 	// Draw opaque objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	_renderQueue.render(kRenderPassOpaque);
 
+	for (std::vector<Renderable *>::const_iterator o = _unqueued.begin(); o != _unqueued.end(); ++o) {
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassOpaque);
+		(*o)->render(kRenderPassOpaque);
 		glPopMatrix();
 	}
 
-	// Draw transparent objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	// Draw transparent objects, all back-to-front. The unqueued objects
+	// are already in that order, so merge the queued geometry in between.
+	_renderQueue.beginTransparent();
+
+	for (std::vector<Renderable *>::const_iterator o = _unqueued.begin(); o != _unqueued.end(); ++o) {
+		_renderQueue.renderTransparent((*o)->getDistance());
 
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassTransparent);
+		(*o)->render(kRenderPassTransparent);
 		glPopMatrix();
 	}
 
+	_renderQueue.renderTransparent(0.0);
+
 	QueueMan.unlockQueue(kQueueVisibleWorldObject);
 	return true;
 }
@@ -869,7 +1102,7 @@ bool GraphicsManager::renderGUIFront() {
 	if (QueueMan.isQueueEmpty(kQueueVisibleGUIFrontObject))
 		return false;
 
-	glDisable(GL_DEPTH_TEST);
+	GLStateMan.disable(GL_DEPTH_TEST);
 
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
@@ -893,7 +1126,7 @@ bool GraphicsManager::renderGUIFront() {
 
 	QueueMan.unlockQueue(kQueueVisibleGUIFrontObject);
 
-	glEnable(GL_DEPTH_TEST);
+	GLStateMan.enable(GL_DEPTH_TEST);
 	return true;
 }
 
@@ -903,7 +1136,7 @@ bool GraphicsManager::renderCursor() {
 
 	buildNewTextures();
 
-	glDisable(GL_DEPTH_TEST);
+	GLStateMan.disable(GL_DEPTH_TEST);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	glScalef(2.0 / _screen->w, 2.0 / _screen->h, 0.0);
@@ -913,7 +1146,7 @@ bool GraphicsManager::renderCursor() {
 	glLoadIdentity();
 
 	_cursor->render();
-	glEnable(GL_DEPTH_TEST);
+	GLStateMan.enable(GL_DEPTH_TEST);
 	return true;
 }
 
@@ -927,6 +1160,15 @@ void GraphicsManager::endScene() {
 
 	_fpsCounter->finishedFrame();
 
+	_textureBindCount  = GLStateMan.getTextureBindCount();
+	_stateChangeCount  = GLStateMan.getStateChangeCount();
+	_elidedChangeCount = GLStateMan.getElidedCount();
+
+	GLStateMan.resetCounts();
+
+	_textureUploadedSize = 0;
+	_textureUploadedTime = 0;
+
 	if (_fsaa > 0)
 		glDisable(GL_MULTISAMPLE_ARB);
 }
@@ -1039,13 +1281,17 @@ void GraphicsManager::cleanupAbandoned() {
 	Common::StackLock lock(_abandonMutex);
 
 	if (!_abandonTextures.empty())
-		glDeleteTextures(_abandonTextures.size(), &_abandonTextures[0]);
+		GLStateMan.deleteTextures(_abandonTextures.size(), &_abandonTextures[0]);
 
 	for (std::list<ListID>::iterator l = _abandonLists.begin(); l != _abandonLists.end(); ++l)
 		glDeleteLists(*l, 1);
 
+	if (!_abandonBuffers.empty())
+		GLStateMan.deleteBuffers(_abandonBuffers.size(), &_abandonBuffers[0]);
+
 	_abandonTextures.clear();
 	_abandonLists.clear();
+	_abandonBuffers.clear();
 
 	_hasAbandoned = false;
 }
@@ -34,6 +34,8 @@
 #include <list>
 
 #include "graphics/types.h"
+#include "graphics/objecttree.h"
+#include "graphics/renderqueue.h"
 
 #include "common/types.h"
 #include "common/singleton.h"
@@ -42,6 +44,7 @@
 
 namespace Common {
 	class UString;
+	class ThreadPool;
 }
 
 namespace Graphics {
@@ -49,6 +52,7 @@ namespace Graphics {
 class FPSCounter;
 class Cursor;
 class Renderable;
+class Queueable;
 
 /** The graphics manager. */
 class GraphicsManager : public Common::Singleton<GraphicsManager> {
@@ -68,6 +72,10 @@ public:
 	bool needManualDeS3TC() const;
 	/** Do we have support for multiple textures? */
 	bool supportMultipleTextures() const;
+	/** Return the number of fixed-function texture units we can use. */
+	uint32 getTextureUnitCount() const;
+	/** Do we have support for vertex and index buffer objects? */
+	bool supportBufferObjects() const;
 
 	/** Set the screen size. */
 	void setScreenSize(int width, int height);
@@ -104,6 +112,30 @@ public:
 	/** How many frames per second to we render at the moments? */
 	uint32 getFPS() const;
 
+	/** How many world objects were there in the last frame? */
+	uint32 getWorldObjectCount() const;
+	/** How many world objects were culled from the last frame, for being off screen? */
+	uint32 getCulledObjectCount() const;
+
+	/** How many textures were bound in the last frame? */
+	uint32 getTextureBindCount() const;
+	/** How many other OpenGL state changes were there in the last frame? */
+	uint32 getStateChangeCount() const;
+	/** How many redundant OpenGL state changes were dropped in the last frame? */
+	uint32 getElidedChangeCount() const;
+
+	/** Limit the uploading of textures decoded in the background.
+	 *
+	 *  @param size The number of bytes to upload per frame, 0 means unlimited.
+	 *  @param time The time in microseconds to spend uploading per frame, 0 means unlimited.
+	 *
+	 *  At least one texture is uploaded each frame, no matter its size.
+	 */
+	void setTextureUploadBudget(uint32 size, uint32 time);
+
+	/** Return how to reduce the animation detail of objects far away or off screen. */
+	const AnimationLOD &getAnimationLOD() const;
+
 	/** That the window's title. */
 	void setWindowTitle(const Common::UString &title);
 
@@ -131,6 +163,11 @@ public:
 	/** Get the object at this screen position. */
 	Renderable *getObjectAt(float x, float y);
 
+	/** Update the bounding box of a visible world object, for finding it on the screen. */
+	void updateWorldObjectBound(Renderable &object);
+	/** Forget the bounding box of a world object that's not visible anymore. */
+	void removeWorldObjectBound(Renderable &object);
+
 	/** Recalculate all object distances to the camera and resort the objebts. */
 	void recalculateObjectDistances();
 
@@ -146,6 +183,8 @@ public:
 	void abandon(TextureID *ids, uint32 count);
 	/** Abandon these lists. */
 	void abandon(ListID ids, uint32 count);
+	/** Abandon these buffer objects. */
+	void abandonBuffers(BufferID *ids, uint32 count);
 
 
 	/** Render one complete frame of the scene. */
@@ -164,6 +203,8 @@ private:
 	// Extensions
 	bool _needManualDeS3TC;        ///< Do we need to do manual S3TC DXTn decompression?
 	bool _supportMultipleTextures; ///< Do we have support for multiple textures?
+	uint32 _textureUnitCount;      ///< Number of fixed-function texture units we can use.
+	bool _supportBufferObjects;    ///< Do we have support for vertex/index buffer objects?
 
 	bool _fullScreen; ///< Are we currently in fullscreen mode?
 
@@ -179,6 +220,32 @@ private:
 
 	FPSCounter *_fpsCounter; ///< Counts the current frames per seconds value.
 	uint32 _lastSampled; ///< Timestamp used to advance animations.
+
+	uint32 _worldObjectCount;  ///< Number of world objects in the last frame.
+	uint32 _culledObjectCount; ///< Number of world objects culled from the last frame.
+
+	uint32 _textureBindCount;  ///< Number of textures bound in the last frame.
+	uint32 _stateChangeCount;  ///< Number of other state changes in the last frame.
+	uint32 _elidedChangeCount; ///< Number of redundant state changes dropped in the last frame.
+
+	uint32 _textureUploadSize;   ///< Max bytes of background textures to upload per frame.
+	uint32 _textureUploadTime;   ///< Max microseconds to spend uploading background textures per frame.
+	uint32 _textureUploadedSize; ///< Bytes of background textures uploaded in the current frame.
+	uint32 _textureUploadedTime; ///< Microseconds spent uploading background textures in the current frame.
+
+	std::vector<Renderable *> _onScreen; ///< The world objects on screen in the current frame.
+	std::vector<Renderable *> _animated; ///< The world objects advanced in time in the current frame.
+	std::vector<Renderable *> _unqueued; ///< The world objects on screen not in the render queue.
+
+	RenderQueue _renderQueue; ///< The geometry of the world objects on screen.
+
+	Common::ThreadPool *_animationThreads; ///< Worker threads evaluating animations.
+
+	AnimationLOD _animationLOD; ///< How to reduce the animation detail.
+
+	ObjectTree    _worldObjectTree;      ///< The bounding boxes of all visible world objects.
+	Common::Mutex _worldObjectTreeMutex; ///< A mutex protecting the world object tree.
+
 	Common::Matrix _projection;    ///< Our projection matrix.
 	Common::Matrix _projectionInv; ///< The inverse of our projection matrix.
 
@@ -195,10 +262,11 @@ private:
 	uint32 _renderableID;             ///< The last ID given to a renderable.
 	Common::Mutex _renderableIDMutex; ///< The mutex to govern renderable ID creation.
 
-	bool _hasAbandoned; ///< Do we have abandoned textures/lists?
+	bool _hasAbandoned; ///< Do we have abandoned textures/lists/buffers?
 
 	std::vector<TextureID> _abandonTextures; ///< Abandoned textures.
 	std::list<ListID>      _abandonLists;    ///< Abandoned lists.
+	std::vector<BufferID>  _abandonBuffers;  ///< Abandoned buffer objects.
 
 	Common::Mutex _abandonMutex; ///< A mutex protecting abandoned structures.
 
@@ -224,9 +292,14 @@ private:
 	void cleanupAbandoned();
 
 	Renderable *getGUIObjectAt(float x, float y) const;
-	Renderable *getWorldObjectAt(float x, float y) const;
+	Renderable *getWorldObjectAt(float x, float y);
 
 	void buildNewTextures();
+	/** Have we uploaded as many background textures this frame as we may? */
+	bool textureUploadBudgetSpent() const;
+
+	/** Advance time for all these objects, evaluating their animations in parallel. */
+	void advanceTime(const std::list<Queueable *> &objects, float dt);
 
 	void beginScene();
 	bool playVideo();
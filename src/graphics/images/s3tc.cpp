@@ -27,177 +27,288 @@
  *  Manual S3TC DXTn decompression methods.
  */
 
+#include <cstring>
+
 #include "common/util.h"
-#include "common/stream.h"
+#include "common/error.h"
+#include "common/endianness.h"
 
 #include "graphics/images/s3tc.h"
 
+#if defined(XOREOS_LITTLE_ENDIAN) && defined(__SSE2__)
+	#include <emmintrin.h>
+	#define S3TC_SSE2
+#elif defined(XOREOS_LITTLE_ENDIAN) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+	#include <arm_neon.h>
+	#define S3TC_NEON
+#endif
+
 namespace Graphics {
 
-static uint32 convert565To8888(uint16 color) {
-	return ((color & 0x1F) << 11) | ((color & 0x7E0) << 13) | ((color & 0xF800) << 16) | 0xFF;
+/* All pixels are handled as 32-bit values with red in the lowest and alpha
+ * in the highest byte, so that writing them in little endian order results
+ * in RGBA pixels.
+ */
+
+enum S3TCFormat {
+	kS3TCDXT1,
+	kS3TCDXT3,
+	kS3TCDXT5
+};
+
+/** Write the 4x4 pixels of a block.
+ *
+ *  @param dest    The top left pixel of the block.
+ *  @param pitch   The number of bytes between two rows in dest.
+ *  @param colors  The block's four colors.
+ *  @param indices The 2-bit color index of each pixel, row by row.
+ *  @param alpha   The alpha of each pixel, to be ORed onto the colors.
+ */
+typedef void (*WriteBlockFunc)(byte *dest, uint32 pitch, const uint32 *colors,
+                               uint32 indices, const uint32 *alpha);
+
+static const uint32 kNoAlpha[16] = { 0 };
+
+static inline uint32 expand5(uint32 c) {
+	return (c << 3) | (c >> 2);
 }
 
-static uint32 interpolate32(double weight, uint32 color_0, uint32 color_1) {
-	byte r[3], g[3], b[3], a[3];
-	r[0] = color_0 >> 24;
-	r[1] = color_1 >> 24;
-	r[2] = (byte)((1.0f - weight) * (double)r[0] + weight * (double)r[1]);
-	g[0] = (color_0 >> 16) & 0xFF;
-	g[1] = (color_1 >> 16) & 0xFF;
-	g[2] = (byte)((1.0f - weight) * (double)g[0] + weight * (double)g[1]);
-	b[0] = (color_0 >> 8) & 0xFF;
-	b[1] = (color_1 >> 8) & 0xFF;
-	b[2] = (byte)((1.0f - weight) * (double)b[0] + weight * (double)b[1]);
-	a[0] = color_0 & 0xFF;
-	a[1] = color_1 & 0xFF;
-	a[2] = (byte)((1.0f - weight) * (double)a[0] + weight * (double)a[1]);
-	return r[2] << 24 | g[2] << 16 | b[2] << 8 | a[2];
+static inline uint32 expand6(uint32 c) {
+	return (c << 2) | (c >> 4);
 }
 
-struct DXT1Texel {
-	uint16 color_0;
-	uint16 color_1;
-	uint32 pixels;
-};
+static inline uint32 makePixel(uint32 r, uint32 g, uint32 b, uint32 a) {
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
 
-#define READ_DXT1_TEXEL(x) \
-	x.color_0 = src.readUint16LE(); \
-	x.color_1 = src.readUint16LE(); \
-	x.pixels = src.readUint32BE()
-
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT1Texel tex;
-			READ_DXT1_TEXEL(tex);
-			uint32 blended[4];
-
-			blended[0] = convert565To8888(tex.color_0);
-			blended[1] = convert565To8888(tex.color_1);
-
-			if (tex.color_0 > tex.color_1) {
-				blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-				blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-			} else {
-				blended[2] = interpolate32(0.5f, blended[0], blended[1]);
-				blended[3] = 0;
-			}
+/** Decode the four colors of a color block.
+ *
+ *  Only in DXT1, a block can have three colors and transparent black.
+ *  Otherwise, the colors are without alpha.
+ */
+static void decodeColors(const byte *block, uint32 *colors, bool dxt1) {
+	const uint32 color0 = READ_LE_UINT16(block    );
+	const uint32 color1 = READ_LE_UINT16(block + 2);
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+	const uint32 r0 = expand5( color0 >> 11        );
+	const uint32 g0 = expand6((color0 >>  5) & 0x3F);
+	const uint32 b0 = expand5( color0        & 0x1F);
+	const uint32 r1 = expand5( color1 >> 11        );
+	const uint32 g1 = expand6((color1 >>  5) & 0x3F);
+	const uint32 b1 = expand5( color1        & 0x1F);
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3]);
-					cpx >>= 2;
-				}
-			}
-		}
+	const uint32 a = dxt1 ? 0xFF : 0x00;
+
+	colors[0] = makePixel(r0, g0, b0, a);
+	colors[1] = makePixel(r1, g1, b1, a);
+
+	if (!dxt1 || (color0 > color1)) {
+		colors[2] = makePixel((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, a);
+		colors[3] = makePixel((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, a);
+	} else {
+		colors[2] = makePixel((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, a);
+		colors[3] = 0;
 	}
 }
 
-struct DXT23Texel : public DXT1Texel {
-	uint16 alpha[4];
-};
+/** Decode the explicit 4-bit alpha values of a DXT3 alpha block. */
+static void decodeExplicitAlpha(const byte *block, uint32 *alpha) {
+	uint64 bits = READ_LE_UINT32(block) | (((uint64) READ_LE_UINT32(block + 4)) << 32);
 
-#define READ_DXT3_TEXEL(x) \
-	x.alpha[0] = src.readUint16LE(); \
-	x.alpha[1] = src.readUint16LE(); \
-	x.alpha[2] = src.readUint16LE(); \
-	x.alpha[3] = src.readUint16LE(); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT23Texel tex;
-			uint32 blended[4];
-			READ_DXT3_TEXEL(tex);
-
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = (tex.alpha[y] >> (x * 4)) & 0xF;
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha << 4);
-					cpx >>= 2;
-				}
-			}
-		}
+	for (int i = 0; i < 16; i++, bits >>= 4)
+		alpha[i] = ((uint32) (bits & 0xF) * 0x11) << 24;
+}
+
+/** Decode the interpolated alpha values of a DXT5 alpha block. */
+static void decodeInterpolatedAlpha(const byte *block, uint32 *alpha) {
+	const uint32 a0 = block[0];
+	const uint32 a1 = block[1];
+
+	uint32 values[8];
+
+	values[0] = a0;
+	values[1] = a1;
+
+	if (a0 > a1) {
+		for (uint32 i = 1; i < 7; i++)
+			values[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+	} else {
+		for (uint32 i = 1; i < 5; i++)
+			values[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+
+		values[6] = 0x00;
+		values[7] = 0xFF;
 	}
+
+	uint64 bits = READ_LE_UINT16(block + 2) | (((uint64) READ_LE_UINT32(block + 4)) << 16);
+
+	for (int i = 0; i < 16; i++, bits >>= 3)
+		alpha[i] = values[bits & 7] << 24;
 }
 
-struct DXT45Texel : public DXT1Texel {
-	byte alpha_0;
-	byte alpha_1;
-	uint64 alphabl;
-};
+/** The scalar reference implementation of writing a block. */
+static void writeBlockScalar(byte *dest, uint32 pitch, const uint32 *colors,
+                             uint32 indices, const uint32 *alpha) {
+
+	for (int y = 0; y < 4; y++, dest += pitch, alpha += 4)
+		for (int x = 0; x < 4; x++, indices >>= 2)
+			WRITE_LE_UINT32(dest + x * 4, colors[indices & 3] | alpha[x]);
+}
+
+#if defined(S3TC_SSE2)
+
+/** Write a block, selecting the colors of a row of 4 pixels at once. */
+static void writeBlockSIMD(byte *dest, uint32 pitch, const uint32 *colors,
+                           uint32 indices, const uint32 *alpha) {
+
+	const __m128i color0 = _mm_set1_epi32(colors[0]);
+	const __m128i color1 = _mm_set1_epi32(colors[1]);
+	const __m128i color2 = _mm_set1_epi32(colors[2]);
+	const __m128i color3 = _mm_set1_epi32(colors[3]);
+
+	// The bits of each pixel's index within a row, and the values they can have
+	const __m128i index0 = _mm_setzero_si128();
+	const __m128i index1 = _mm_set_epi32(1 << 6, 1 << 4, 1 << 2, 1);
+	const __m128i index2 = _mm_set_epi32(2 << 6, 2 << 4, 2 << 2, 2);
+	const __m128i index3 = _mm_set_epi32(3 << 6, 3 << 4, 3 << 2, 3);
+
+	for (int y = 0; y < 4; y++, dest += pitch, alpha += 4, indices >>= 8) {
+		const __m128i row = _mm_and_si128(_mm_set1_epi32(indices & 0xFF), index3);
+
+		__m128i pixels = _mm_loadu_si128((const __m128i *) alpha);
+
+		pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(row, index0), color0));
+		pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(row, index1), color1));
+		pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(row, index2), color2));
+		pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(row, index3), color3));
+
+		_mm_storeu_si128((__m128i *) dest, pixels);
+	}
+}
+
+static const char *kSIMDName = "SSE2";
+
+#elif defined(S3TC_NEON)
+
+/** Write a block, selecting the colors of a row of 4 pixels at once. */
+static void writeBlockSIMD(byte *dest, uint32 pitch, const uint32 *colors,
+                           uint32 indices, const uint32 *alpha) {
+
+	const uint32x4_t color0 = vdupq_n_u32(colors[0]);
+	const uint32x4_t color1 = vdupq_n_u32(colors[1]);
+	const uint32x4_t color2 = vdupq_n_u32(colors[2]);
+	const uint32x4_t color3 = vdupq_n_u32(colors[3]);
+
+	// Shift each pixel's index within a row down into the lowest bits
+	static const int32 kShifts[4] = { 0, -2, -4, -6 };
 
-static uint64 readUint48LE(Common::SeekableReadStream &src) {
-	uint64 output = src.readUint32LE();
-	return output | ((uint64)src.readUint16LE() << 32);
+	const int32x4_t  shifts = vld1q_s32(kShifts);
+	const uint32x4_t mask   = vdupq_n_u32(3);
+
+	for (int y = 0; y < 4; y++, dest += pitch, alpha += 4, indices >>= 8) {
+		const uint32x4_t row = vandq_u32(vshlq_u32(vdupq_n_u32(indices & 0xFF), shifts), mask);
+
+		uint32x4_t pixels = vld1q_u32(alpha);
+
+		pixels = vorrq_u32(pixels, vandq_u32(vceqq_u32(row, vdupq_n_u32(0)), color0));
+		pixels = vorrq_u32(pixels, vandq_u32(vceqq_u32(row, vdupq_n_u32(1)), color1));
+		pixels = vorrq_u32(pixels, vandq_u32(vceqq_u32(row, vdupq_n_u32(2)), color2));
+		pixels = vorrq_u32(pixels, vandq_u32(vceqq_u32(row, vdupq_n_u32(3)), color3));
+
+		vst1q_u8(dest, vreinterpretq_u8_u32(pixels));
+	}
 }
 
-#define READ_DXT5_TEXEL(x) \
-	x.alpha_0 = src.readByte(); \
-	x.alpha_1 = src.readByte(); \
-	x.alphabl = readUint48LE(src); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			uint32 blended[4];
-			byte alphab[8];
-			DXT45Texel tex;
-			READ_DXT5_TEXEL(tex);
-
-			alphab[0] = tex.alpha_0;
-			alphab[1] = tex.alpha_1;
-
-			if (tex.alpha_0 > tex.alpha_1) {
-				alphab[2] = (byte)((6.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[3] = (byte)((5.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[4] = (byte)((4.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[5] = (byte)((3.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[6] = (byte)((2.0f * (double)alphab[0] + 5.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[7] = (byte)((1.0f * (double)alphab[0] + 6.0f * (double)alphab[1] + 3.0f) / 7.0f);
-			} else {
-				alphab[2] = (byte)((4.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[3] = (byte)((3.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[4] = (byte)((2.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[5] = (byte)((1.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[6] = 0;
-				alphab[7] = 255;
+static const char *kSIMDName = "NEON";
+
+#else
+
+static const char *kSIMDName = 0;
+
+#endif
+
+static void decompress(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                       uint32 pitch, S3TCFormat format, bool reference) {
+
+	const uint32 blockSize = (format == kS3TCDXT1) ? 8 : 16;
+
+	const uint32 blocksX = (width  + 3) / 4;
+	const uint32 blocksY = (height + 3) / 4;
+
+	if (size < (blocksX * blocksY * blockSize))
+		throw Common::Exception("Not enough S3TC data for a %ux%u image (%u < %u)",
+		                        width, height, size, blocksX * blocksY * blockSize);
+
+	WriteBlockFunc writeBlock = &writeBlockScalar;
+#if defined(S3TC_SSE2) || defined(S3TC_NEON)
+	if (!reference)
+		writeBlock = &writeBlockSIMD;
+#endif
+
+	uint32 colors[4];
+	uint32 alphaValues[16];
+
+	const uint32 *alpha = (format == kS3TCDXT1) ? kNoAlpha : alphaValues;
+
+	// Edge blocks are written here first, then copied as far as they fit
+	byte edge[4 * 4 * 4];
+
+	for (uint32 by = 0; by < blocksY; by++) {
+		const uint32 blockHeight = MIN<uint32>(height - by * 4, 4);
+
+		byte *row = dest + by * 4 * pitch;
+
+		for (uint32 bx = 0; bx < blocksX; bx++, src += blockSize) {
+			const uint32 blockWidth = MIN<uint32>(width - bx * 4, 4);
+
+			const byte *colorBlock = src;
+			if      (format == kS3TCDXT3) {
+				decodeExplicitAlpha(src, alphaValues);
+				colorBlock += 8;
+			} else if (format == kS3TCDXT5) {
+				decodeInterpolatedAlpha(src, alphaValues);
+				colorBlock += 8;
 			}
 
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = alphab[(tex.alphabl >> (3 * (4 * (3 - y) + x))) & 7];
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha);
-					cpx >>= 2;
-				}
+			decodeColors(colorBlock, colors, format == kS3TCDXT1);
+
+			const uint32 indices = READ_LE_UINT32(colorBlock + 4);
+
+			byte *pixels = row + bx * 4 * 4;
+
+			if ((blockWidth == 4) && (blockHeight == 4)) {
+				writeBlock(pixels, pitch, colors, indices, alpha);
+				continue;
 			}
+
+			writeBlock(edge, 4 * 4, colors, indices, alpha);
+
+			for (uint32 y = 0; y < blockHeight; y++)
+				std::memcpy(pixels + y * pitch, edge + y * 4 * 4, blockWidth * 4);
 		}
 	}
 }
 
+void decompressDXT1(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference) {
+
+	decompress(dest, src, size, width, height, pitch, kS3TCDXT1, reference);
+}
+
+void decompressDXT3(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference) {
+
+	decompress(dest, src, size, width, height, pitch, kS3TCDXT3, reference);
+}
+
+void decompressDXT5(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference) {
+
+	decompress(dest, src, size, width, height, pitch, kS3TCDXT5, reference);
+}
+
+const char *getS3TCSIMD() {
+	return kSIMDName;
+}
+
 } // End of namespace Graphics
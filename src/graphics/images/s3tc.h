@@ -32,15 +32,33 @@
 
 #include "common/types.h"
 
-namespace Common {
-	class SeekableReadStream;
-}
-
 namespace Graphics {
 
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
+/** Decompress DXT1 (BC1) image data into RGBA pixels.
+ *
+ *  Blocks are 8 bytes each, in rows of ((width + 3) / 4) blocks. Blocks at the
+ *  right or bottom edge of an image not a multiple of 4 pixels wide or high
+ *  only write the pixels within the image.
+ *
+ *  @param dest      The pixels to write, 4 bytes each.
+ *  @param src       The compressed blocks.
+ *  @param size      The size of the compressed data, in bytes.
+ *  @param width     The width of the image, in pixels.
+ *  @param height    The height of the image, in pixels.
+ *  @param pitch     The number of bytes between two rows in dest.
+ *  @param reference Use the plain scalar reference implementation.
+ */
+void decompressDXT1(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference = false);
+/** Decompress DXT3 (BC2) image data into RGBA pixels. Blocks are 16 bytes each. */
+void decompressDXT3(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference = false);
+/** Decompress DXT5 (BC3) image data into RGBA pixels. Blocks are 16 bytes each. */
+void decompressDXT5(byte *dest, const byte *src, uint32 size, uint32 width, uint32 height,
+                    uint32 pitch, bool reference = false);
+
+/** Return the name of the vectorized decompression, or 0 if there is none. */
+const char *getS3TCSIMD();
 
 } // End of namespace Graphics
 
@@ -28,20 +28,28 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 
 #include "graphics/indexbuffer.h"
+#include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 namespace Graphics {
 
-IndexBuffer::IndexBuffer() : _count(0), _size(0), _type(GL_UNSIGNED_INT), _data(0) {
+IndexBuffer::IndexBuffer() : _count(0), _size(0), _type(GL_UNSIGNED_INT), _data(0), _ibo(0) {
 	//ctor
 }
 
-IndexBuffer::IndexBuffer(const IndexBuffer &other) {
+IndexBuffer::IndexBuffer(const IndexBuffer &other) : _count(0), _size(0), _type(GL_UNSIGNED_INT),
+	_data(0), _ibo(0) {
+
 	*this = other;
 }
 
 IndexBuffer::~IndexBuffer() {
+	if (_ibo != 0)
+		GfxMan.abandonBuffers(&_ibo, 1);
+
 	if (_data)
 		std::free(_data);
 }
@@ -59,6 +67,12 @@ void IndexBuffer::setSize(uint32 indexCount, uint32 indexSize, GLenum indexType)
 	_size = indexSize;
 	_type = indexType;
 
+	// The buffer object holds the old data
+	if (_ibo != 0) {
+		GfxMan.abandonBuffers(&_ibo, 1);
+		_ibo = 0;
+	}
+
 	if (_data)
 		std::free(_data);
 
@@ -84,4 +98,50 @@ GLenum IndexBuffer::getType() const {
 	return _type;
 }
 
+void IndexBuffer::initGL() {
+	if ((_ibo != 0) || !_data)
+		return;
+
+	glGenBuffersARB(1, &_ibo);
+
+	GLStateMan.bindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, _ibo);
+	glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, _count * _size, _data, GL_STATIC_DRAW_ARB);
+	GLStateMan.bindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+	// Out of video memory? Then we'll just keep drawing from client memory
+	if (glGetError() == GL_OUT_OF_MEMORY)
+		destroyGL();
+}
+
+void IndexBuffer::destroyGL() {
+	if (_ibo == 0)
+		return;
+
+	GLStateMan.deleteBuffers(1, &_ibo);
+	_ibo = 0;
+}
+
+BufferID IndexBuffer::getIBO() const {
+	return _ibo;
+}
+
+const GLvoid *IndexBuffer::getPointer() const {
+	if (_ibo == 0)
+		return _data;
+
+	return 0;
+}
+
+void IndexBuffer::bind() const {
+	GLStateMan.bindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, _ibo);
+}
+
+void IndexBuffer::unbind() const {
+	GLStateMan.bindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+}
+
+void IndexBuffer::draw() const {
+	glDrawElements(GL_TRIANGLES, _count, _type, getPointer());
+}
+
 }
@@ -60,11 +60,35 @@ public:
 	/** Get element type */
 	GLenum getType() const;
 
+	/** Upload the buffer data into an index buffer object. Must be called from the main thread. */
+	void initGL();
+	/** Delete the index buffer object. Must be called from the main thread. */
+	void destroyGL();
+
+	/** Get the index buffer object, or 0 if there is none. */
+	BufferID getIBO() const;
+
+	/** Get the indices for glDrawElements(), for use while the buffer is bound.
+	 *
+	 *  With an index buffer object, this is the offset into the buffer object.
+	 *  Without, this is the pointer to the buffer data.
+	 */
+	const GLvoid *getPointer() const;
+
+	/** Bind the buffer, for drawing. Must be called from the main thread. */
+	void bind() const;
+	/** Unbind the buffer again. Must be called from the main thread. */
+	void unbind() const;
+
+	/** Draw the triangles of the bound buffer, with the currently bound vertices. */
+	void draw() const;
+
 private:
 	uint32 _count; ///< Number of elements in buffer
 	uint32 _size;  ///< Size of a buffer element in bytes
 	GLenum _type;  ///< Element type (GL_UNSIGNED_SHORT, GL_UNSIGNED_INT, ...)
 	GLvoid *_data; ///< Buffer data
+	BufferID _ibo; ///< Index buffer object
 };
 
 }
@@ -0,0 +1,422 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/objecttree.cpp
+ *  A bounding volume hierarchy of world objects.
+ */
+
+#include "common/util.h"
+#include "common/boundingbox.h"
+
+#include "graphics/objecttree.h"
+#include "graphics/renderable.h"
+
+/** How much larger than its object a leaf's box is, in each direction. */
+static const float kLeafMargin = 0.25f;
+
+static float surfaceArea(const float *min, const float *max) {
+	const float x = max[0] - min[0];
+	const float y = max[1] - min[1];
+	const float z = max[2] - min[2];
+
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+static float combinedArea(const float *min1, const float *max1, const float *min2, const float *max2) {
+	float min[3], max[3];
+	for (int i = 0; i < 3; i++) {
+		min[i] = MIN(min1[i], min2[i]);
+		max[i] = MAX(max1[i], max2[i]);
+	}
+
+	return surfaceArea(min, max);
+}
+
+static bool contains(const float *outerMin, const float *outerMax,
+                     const float *innerMin, const float *innerMax) {
+
+	for (int i = 0; i < 3; i++)
+		if ((innerMin[i] < outerMin[i]) || (innerMax[i] > outerMax[i]))
+			return false;
+
+	return true;
+}
+
+/** Does the line from o to o + d intersect the box? If so, t is where it enters the box,
+ *  as a fraction of the line's length.
+ */
+static bool intersect(const float *min, const float *max, const float *o, const float *d, float &t) {
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+
+	for (int i = 0; i < 3; i++) {
+		if (ABS(d[i]) < 1.0e-9f) {
+			// Parallel to the slab
+			if ((o[i] < min[i]) || (o[i] > max[i]))
+				return false;
+
+			continue;
+		}
+
+		float t1 = (min[i] - o[i]) / d[i];
+		float t2 = (max[i] - o[i]) / d[i];
+		if (t1 > t2)
+			SWAP(t1, t2);
+
+		tMin = MAX(tMin, t1);
+		tMax = MIN(tMax, t2);
+
+		if (tMin > tMax)
+			return false;
+	}
+
+	t = tMin;
+	return true;
+}
+
+namespace Graphics {
+
+bool ObjectTree::Node::isLeaf() const {
+	return child[0] == -1;
+}
+
+
+ObjectTree::ObjectTree() : _root(-1), _freeList(-1) {
+}
+
+ObjectTree::~ObjectTree() {
+}
+
+void ObjectTree::clear() {
+	_nodes.clear();
+	_leaves.clear();
+
+	_root     = -1;
+	_freeList = -1;
+}
+
+bool ObjectTree::empty() const {
+	return _root == -1;
+}
+
+void ObjectTree::update(Renderable &object, const Common::BoundingBox &box) {
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	int32 leaf;
+
+	LeafMap::iterator l = _leaves.find(&object);
+	if (l != _leaves.end()) {
+		leaf = l->second;
+
+		Node &node = _nodes[leaf];
+		for (int i = 0; i < 3; i++) {
+			node.objectMin[i] = min[i];
+			node.objectMax[i] = max[i];
+		}
+
+		// Still within the leaf's margin, nothing else to do
+		if (contains(node.min, node.max, min, max))
+			return;
+
+		removeLeaf(leaf);
+
+	} else {
+		leaf = allocateNode();
+
+		Node &node = _nodes[leaf];
+		node.object = &object;
+		for (int i = 0; i < 3; i++) {
+			node.objectMin[i] = min[i];
+			node.objectMax[i] = max[i];
+		}
+
+		_leaves.insert(std::make_pair(&object, leaf));
+	}
+
+	Node &node = _nodes[leaf];
+	for (int i = 0; i < 3; i++) {
+		node.min[i] = min[i] - kLeafMargin;
+		node.max[i] = max[i] + kLeafMargin;
+	}
+
+	insertLeaf(leaf);
+}
+
+void ObjectTree::remove(Renderable &object) {
+	LeafMap::iterator l = _leaves.find(&object);
+	if (l == _leaves.end())
+		return;
+
+	removeLeaf(l->second);
+	freeNode(l->second);
+
+	_leaves.erase(l);
+}
+
+Renderable *ObjectTree::getClosestHit(float x1, float y1, float z1, float x2, float y2, float z2) const {
+	if (_root == -1)
+		return 0;
+
+	const float o[3] = { x1, y1, z1 };
+	const float d[3] = { x2 - x1, y2 - y1, z2 - z1 };
+
+	Renderable *closest  = 0;
+	float       closestT = 2.0f;
+
+	std::vector<int32> stack;
+	stack.push_back(_root);
+
+	while (!stack.empty()) {
+		const Node &node = _nodes[stack.back()];
+		stack.pop_back();
+
+		// Don't descend into boxes the line enters behind what we've already found
+		float t;
+		if (!intersect(node.min, node.max, o, d, t) || (t >= closestT))
+			continue;
+
+		if (!node.isLeaf()) {
+			stack.push_back(node.child[0]);
+			stack.push_back(node.child[1]);
+			continue;
+		}
+
+		if (!intersect(node.objectMin, node.objectMax, o, d, t) || (t >= closestT))
+			continue;
+
+		if (!node.object->isClickable())
+			continue;
+
+		// Let the object have the final say, it might know its shape better than its box
+		if (!node.object->isIn(x1, y1, z1, x2, y2, z2))
+			continue;
+
+		closest  = node.object;
+		closestT = t;
+	}
+
+	return closest;
+}
+
+int32 ObjectTree::allocateNode() {
+	int32 index;
+
+	if (_freeList != -1) {
+		index     = _freeList;
+		_freeList = _nodes[index].parent;
+	} else {
+		index = _nodes.size();
+		_nodes.push_back(Node());
+	}
+
+	Node &node = _nodes[index];
+
+	node.parent   = -1;
+	node.child[0] = -1;
+	node.child[1] = -1;
+	node.height   =  0;
+	node.object   =  0;
+
+	return index;
+}
+
+void ObjectTree::freeNode(int32 node) {
+	_nodes[node].parent = _freeList;
+	_nodes[node].height = -1;
+	_nodes[node].object = 0;
+
+	_freeList = node;
+}
+
+void ObjectTree::insertLeaf(int32 leaf) {
+	if (_root == -1) {
+		_root = leaf;
+		_nodes[leaf].parent = -1;
+		return;
+	}
+
+	const float *leafMin = _nodes[leaf].min;
+	const float *leafMax = _nodes[leaf].max;
+
+	/* Find the best sibling for the new leaf, descending into the child
+	 * that grows the least in surface area by including the leaf. */
+
+	int32 index = _root;
+	while (!_nodes[index].isLeaf()) {
+		const Node &node = _nodes[index];
+
+		const float area     = surfaceArea(node.min, node.max);
+		const float combined = combinedArea(node.min, node.max, leafMin, leafMax);
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combined;
+
+		// Minimum cost of pushing the leaf further down the tree
+		const float inheritance = 2.0f * (combined - area);
+
+		float childCost[2];
+		for (int i = 0; i < 2; i++) {
+			const Node &child = _nodes[node.child[i]];
+
+			childCost[i] = combinedArea(child.min, child.max, leafMin, leafMax) + inheritance;
+			if (!child.isLeaf())
+				childCost[i] -= surfaceArea(child.min, child.max);
+		}
+
+		if ((cost < childCost[0]) && (cost < childCost[1]))
+			break;
+
+		index = (childCost[0] < childCost[1]) ? node.child[0] : node.child[1];
+	}
+
+	const int32 sibling   = index;
+	const int32 oldParent = _nodes[sibling].parent;
+	const int32 newParent = allocateNode();
+
+	_nodes[newParent].parent   = oldParent;
+	_nodes[newParent].child[0] = sibling;
+	_nodes[newParent].child[1] = leaf;
+
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf   ].parent = newParent;
+
+	if (oldParent != -1) {
+		if (_nodes[oldParent].child[0] == sibling)
+			_nodes[oldParent].child[0] = newParent;
+		else
+			_nodes[oldParent].child[1] = newParent;
+	} else
+		_root = newParent;
+
+	// Walk back up, fixing the boxes and heights
+	for (index = newParent; index != -1; index = _nodes[index].parent) {
+		refit(index);
+		index = balance(index);
+	}
+}
+
+void ObjectTree::removeLeaf(int32 leaf) {
+	if (leaf == _root) {
+		_root = -1;
+		return;
+	}
+
+	const int32 parent      = _nodes[leaf].parent;
+	const int32 grandParent = _nodes[parent].parent;
+
+	const int32 sibling = (_nodes[parent].child[0] == leaf) ?
+	                      _nodes[parent].child[1] : _nodes[parent].child[0];
+
+	freeNode(parent);
+
+	_nodes[sibling].parent = grandParent;
+
+	if (grandParent == -1) {
+		_root = sibling;
+		return;
+	}
+
+	if (_nodes[grandParent].child[0] == parent)
+		_nodes[grandParent].child[0] = sibling;
+	else
+		_nodes[grandParent].child[1] = sibling;
+
+	// Walk back up, fixing the boxes and heights
+	for (int32 index = grandParent; index != -1; index = _nodes[index].parent) {
+		refit(index);
+		index = balance(index);
+	}
+}
+
+int32 ObjectTree::balance(int32 a) {
+	Node &nodeA = _nodes[a];
+	if (nodeA.isLeaf() || (nodeA.height < 2))
+		return a;
+
+	const int32 b = nodeA.child[0];
+	const int32 c = nodeA.child[1];
+
+	const int32 diff = _nodes[c].height - _nodes[b].height;
+	if ((diff >= -1) && (diff <= 1))
+		return a;
+
+	/* One child is more than one level deeper than the other. Rotate that
+	 * deeper child up to take a's place, moving a down to be its child.
+	 * Of the deeper child's own children, the deeper one stays with it,
+	 * while the shallower one is handed over to a. */
+
+	const int32 upSide = (diff > 1) ? 1 : 0;
+
+	const int32 up   = nodeA.child[upSide];
+	Node       &nodeUp = _nodes[up];
+
+	const int32 f = nodeUp.child[0];
+	const int32 g = nodeUp.child[1];
+
+	const bool fDeeper = _nodes[f].height > _nodes[g].height;
+
+	const int32 keep = fDeeper ? f : g;
+	const int32 give = fDeeper ? g : f;
+
+	// Put the rotated node into a's place
+	nodeUp.parent = nodeA.parent;
+	if (nodeUp.parent != -1) {
+		if (_nodes[nodeUp.parent].child[0] == a)
+			_nodes[nodeUp.parent].child[0] = up;
+		else
+			_nodes[nodeUp.parent].child[1] = up;
+	} else
+		_root = up;
+
+	nodeUp.child[0] = a;
+	nodeUp.child[1] = keep;
+	nodeA.parent    = up;
+
+	nodeA.child[upSide]  = give;
+	_nodes[give].parent = a;
+
+	refit(a);
+	refit(up);
+
+	return up;
+}
+
+void ObjectTree::refit(int32 node) {
+	Node &n = _nodes[node];
+
+	const Node &child1 = _nodes[n.child[0]];
+	const Node &child2 = _nodes[n.child[1]];
+
+	for (int i = 0; i < 3; i++) {
+		n.min[i] = MIN(child1.min[i], child2.min[i]);
+		n.max[i] = MAX(child1.max[i], child2.max[i]);
+	}
+
+	n.height = 1 + MAX(child1.height, child2.height);
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,122 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/objecttree.h
+ *  A bounding volume hierarchy of world objects.
+ */
+
+#ifndef GRAPHICS_OBJECTTREE_H
+#define GRAPHICS_OBJECTTREE_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+
+namespace Common {
+	class BoundingBox;
+}
+
+namespace Graphics {
+
+class Renderable;
+
+/** A dynamic bounding volume hierarchy of world objects.
+ *
+ *  A binary tree of axis-aligned boxes, with one leaf for each object,
+ *  kept balanced as objects are added, moved and removed. It's used to
+ *  quickly find the objects hit by a line, without checking every single
+ *  object in the world.
+ *
+ *  Leaves are slightly larger than their objects, so that an object moving
+ *  only a little doesn't need to be reinserted into the tree.
+ */
+class ObjectTree {
+public:
+	ObjectTree();
+	~ObjectTree();
+
+	/** Remove all objects. */
+	void clear();
+
+	/** Are there no objects in the tree? */
+	bool empty() const;
+
+	/** Add an object, or update its bounding box if it's already in the tree. */
+	void update(Renderable &object, const Common::BoundingBox &box);
+	/** Remove an object from the tree. */
+	void remove(Renderable &object);
+
+	/** Find the clickable object hit by the line from x1.y1.z1 to x2.y2.z2
+	 *  that's closest to x1.y1.z1.
+	 */
+	Renderable *getClosestHit(float x1, float y1, float z1, float x2, float y2, float z2) const;
+
+private:
+	/** A node within the tree. */
+	struct Node {
+		float min[3]; ///< The lower corner of the node's box.
+		float max[3]; ///< The upper corner of the node's box.
+
+		int32 parent;   ///< The parent node, or the next free node.
+		int32 child[2]; ///< The child nodes, or -1 for leaves.
+
+		/** The length of the longest path to a leaf, 0 for leaves, -1 for free nodes. */
+		int32 height;
+
+		Renderable *object; ///< The object in a leaf.
+
+		float objectMin[3]; ///< The lower corner of the leaf object's actual box.
+		float objectMax[3]; ///< The upper corner of the leaf object's actual box.
+
+		bool isLeaf() const;
+	};
+
+	typedef std::map<Renderable *, int32> LeafMap;
+
+	std::vector<Node> _nodes; ///< All nodes, used and free.
+
+	int32 _root;     ///< The root node, or -1 when empty.
+	int32 _freeList; ///< The first free node, or -1.
+
+	LeafMap _leaves; ///< The leaf node of each object.
+
+
+	int32 allocateNode();
+	void freeNode(int32 node);
+
+	void insertLeaf(int32 leaf);
+	void removeLeaf(int32 leaf);
+
+	/** Rotate the subtree at this node, if it's unbalanced. Return the new subtree root. */
+	int32 balance(int32 a);
+
+	/** Recalculate the box and height of this node from its children. */
+	void refit(int32 node);
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_OBJECTTREE_H
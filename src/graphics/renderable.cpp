@@ -35,7 +35,7 @@
 
 namespace Graphics {
 
-Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0) {
+Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0), _onScreen(true) {
 	if        (type == kRenderableTypeVideo) {
 		_queueExists  = kQueueVideo;
 		_queueVisible = kQueueVisibleVideo;
@@ -95,6 +95,11 @@ void Renderable::resort() {
 	sortQueue(_queueVisible);
 }
 
+void Renderable::updateBound() {
+	if ((_queueVisible == kQueueVisibleWorldObject) && isVisible())
+		GfxMan.updateWorldObjectBound(*this);
+}
+
 void Renderable::show() {
 	lockQueue(_queueVisible);
 
@@ -102,9 +107,15 @@ void Renderable::show() {
 	sortQueue(_queueVisible);
 
 	unlockQueue(_queueVisible);
+
+	if (_queueVisible == kQueueVisibleWorldObject)
+		GfxMan.updateWorldObjectBound(*this);
 }
 
 void Renderable::hide() {
+	if (_queueVisible == kQueueVisibleWorldObject)
+		GfxMan.removeWorldObjectBound(*this);
+
 	removeFromQueue(_queueVisible);
 }
 
@@ -120,4 +131,25 @@ bool Renderable::isIn(float x1, float y1, float z1, float x2, float y2, float z2
 	return false;
 }
 
+bool Renderable::isIn(const Common::Frustum &frustum) const {
+	// Without knowing our bounds, we have to assume we're visible
+	return true;
+}
+
+const Common::BoundingBox *Renderable::getAbsoluteBound() const {
+	return 0;
+}
+
+bool Renderable::addToRenderQueue(RenderQueue &queue) {
+	return false;
+}
+
+bool Renderable::isOnScreen() const {
+	return _onScreen;
+}
+
+void Renderable::setOnScreen(bool onScreen) {
+	_onScreen = onScreen;
+}
+
 } // End of namespace Graphics
@@ -35,8 +35,15 @@
 #include "graphics/types.h"
 #include "graphics/queueable.h"
 
+namespace Common {
+	class Frustum;
+	class BoundingBox;
+}
+
 namespace Graphics {
 
+class RenderQueue;
+
 /** An object that can be displayed by the graphics manager. */
 class Renderable : public Queueable {
 public:
@@ -48,12 +55,26 @@ public:
 	/** Calculate the object's distance. */
 	virtual void calculateDistance() = 0;
 
-	/** Advance time (used by renderables with animations). */
+	/** Advance time (used by renderables with animations).
+	 *
+	 *  This is called for many objects in parallel, from several threads.
+	 *  It should only evaluate the object's new state, to be applied in
+	 *  applyAnimation(), and must not change any other object.
+	 */
 	virtual void advanceTime(float dt) {};
+	/** Apply the state evaluated by advanceTime(). Called from the main thread. */
+	virtual void applyAnimation() {};
 
 	/** Render the object. */
 	virtual void render(RenderPass pass) = 0;
 
+	/** Add the object's geometry to a render queue, instead of rendering it directly.
+	 *
+	 *  Returns false if the object can't be rendered that way, and needs to
+	 *  be rendered with render() instead.
+	 */
+	virtual bool addToRenderQueue(RenderQueue &queue);
+
 	/** Get the distance of the object from the viewer. */
 	double getDistance() const;
 
@@ -82,6 +103,17 @@ public:
 	/** Does the line from x1.y1.z1 to x2.y2.z2 intersect with the object? */
 	virtual bool isIn(float x1, float y1, float z1, float x2, float y2, float z2) const;
 
+	/** Might the object be within that view frustum, and therefore needs to be rendered? */
+	virtual bool isIn(const Common::Frustum &frustum) const;
+
+	/** Get the object's bounding box in world coordinates, or 0 if it has none. */
+	virtual const Common::BoundingBox *getAbsoluteBound() const;
+
+	/** Was the object within the view frustum in the last frame? */
+	bool isOnScreen() const;
+	/** Set whether the object was within the view frustum in the last frame. */
+	void setOnScreen(bool onScreen);
+
 protected:
 	QueueType _queueExists;
 	QueueType _queueVisible;
@@ -93,7 +125,12 @@ protected:
 
 	double _distance; ///< The distance of the object from the viewer.
 
+	bool _onScreen; ///< Was the object within the view frustum in the last frame?
+
 	void resort();
+
+	/** The object's bounding box changed, update it in the graphics manager. */
+	void updateBound();
 };
 
 } // End of namespace Graphics
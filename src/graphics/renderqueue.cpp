@@ -0,0 +1,200 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/renderqueue.cpp
+ *  A queue of geometry to render, sorted to minimize OpenGL state changes.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include "common/util.h"
+#include "common/transmatrix.h"
+
+#include "graphics/renderqueue.h"
+#include "graphics/vertexbuffer.h"
+#include "graphics/indexbuffer.h"
+#include "graphics/graphics.h"
+#include "graphics/glstate.h"
+
+namespace Graphics {
+
+bool RenderQueue::StateCompare::operator()(const Item *a, const Item *b) const {
+	if (a->textureCount != b->textureCount)
+		return a->textureCount < b->textureCount;
+
+	for (uint32 i = 0; i < a->textureCount; i++)
+		if (a->textures[i] != b->textures[i])
+			return a->textures[i] < b->textures[i];
+
+	if (a->vertices != b->vertices)
+		return a->vertices < b->vertices;
+	if (a->indices != b->indices)
+		return a->indices < b->indices;
+
+	return a->order < b->order;
+}
+
+bool RenderQueue::DistanceCompare::operator()(const Item *a, const Item *b) const {
+	if (a->distance != b->distance)
+		return a->distance > b->distance;
+
+	return a->order < b->order;
+}
+
+
+RenderQueue::RenderQueue() : _next(0) {
+	_camera[0] = 0.0f;
+	_camera[1] = 0.0f;
+	_camera[2] = 0.0f;
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+void RenderQueue::clear(float cameraX, float cameraY, float cameraZ) {
+	_camera[0] = cameraX;
+	_camera[1] = cameraY;
+	_camera[2] = cameraZ;
+
+	// Keep the memory around, we're going to need about as much next frame
+	for (int i = 0; i < kRenderPassAll; i++)
+		_items[i].clear();
+}
+
+void RenderQueue::add(RenderPass pass, const VertexBuffer &vertices, const IndexBuffer &indices,
+                      const TextureID *textures, uint32 textureCount,
+                      const Common::TransformationMatrix &transform) {
+
+	if ((pass != kRenderPassOpaque) && (pass != kRenderPassTransparent))
+		return;
+
+	// We can only use as many textures as there are texture units
+	textureCount = MIN<uint32>(textureCount, GfxMan.getTextureUnitCount());
+
+	_items[pass].push_back(Item());
+	Item &item = _items[pass].back();
+
+	item.vertices = &vertices;
+	item.indices  = &indices;
+
+	item.textureCount = MIN(textureCount, kMaxTextures);
+	for (uint32 i = 0; i < item.textureCount; i++)
+		item.textures[i] = textures[i];
+
+	memcpy(item.transform, transform.get(), 16 * sizeof(float));
+
+	// The same distance the objects rendered directly are sorted by
+	const float x = ABS(transform.getX() - _camera[0]);
+	const float y = ABS(transform.getY() - _camera[1]);
+	const float z = ABS(transform.getZ() - _camera[2]);
+
+	item.distance = x + y + z;
+
+	item.order = _items[pass].size() - 1;
+}
+
+void RenderQueue::render(RenderPass pass) {
+	sort(pass);
+	renderSorted(_sorted.size());
+}
+
+void RenderQueue::beginTransparent() {
+	sort(kRenderPassTransparent);
+}
+
+void RenderQueue::renderTransparent(double distance) {
+	// Everything that far away or further comes next, back-to-front
+	uint32 end = _next;
+	while ((end < _sorted.size()) && (_sorted[end]->distance >= distance))
+		end++;
+
+	renderSorted(end);
+}
+
+void RenderQueue::sort(RenderPass pass) {
+	_sorted.clear();
+	_next = 0;
+
+	if ((pass != kRenderPassOpaque) && (pass != kRenderPassTransparent))
+		return;
+
+	std::vector<Item> &items = _items[pass];
+
+	_sorted.reserve(items.size());
+
+	for (std::vector<Item>::iterator i = items.begin(); i != items.end(); ++i)
+		_sorted.push_back(&*i);
+
+	if (pass == kRenderPassOpaque)
+		std::sort(_sorted.begin(), _sorted.end(), StateCompare());
+	else
+		std::sort(_sorted.begin(), _sorted.end(), DistanceCompare());
+}
+
+void RenderQueue::renderSorted(uint32 end) {
+	if (_next >= end)
+		return;
+
+	const VertexBuffer *vertices = 0;
+	for (uint32 i = _next; i < end; i++) {
+		const Item &item = *_sorted[i];
+
+		// Only what differs from the previous item actually changes
+		setTextures(item);
+
+		if (item.vertices != vertices)
+			item.vertices->bind();
+		item.indices->bind();
+
+		vertices = item.vertices;
+
+		glPushMatrix();
+		glMultMatrixf(item.transform);
+
+		item.indices->draw();
+
+		glPopMatrix();
+	}
+
+	vertices->unbind();
+	_sorted[end - 1]->indices->unbind();
+
+	GLStateMan.resetTextures();
+
+	_next = end;
+}
+
+void RenderQueue::setTextures(const Item &item) {
+	for (uint32 i = 0; i < GfxMan.getTextureUnitCount(); i++) {
+		const bool enabled = i < item.textureCount;
+
+		GLStateMan.setTextureEnabled(i, enabled);
+		if (enabled)
+			GLStateMan.bindTexture(i, item.textures[i]);
+	}
+}
+
+} // End of namespace Graphics
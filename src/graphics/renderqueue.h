@@ -0,0 +1,134 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/renderqueue.h
+ *  A queue of geometry to render, sorted to minimize OpenGL state changes.
+ */
+
+#ifndef GRAPHICS_RENDERQUEUE_H
+#define GRAPHICS_RENDERQUEUE_H
+
+#include <vector>
+
+#include "common/types.h"
+
+#include "graphics/types.h"
+
+namespace Common {
+	class TransformationMatrix;
+}
+
+namespace Graphics {
+
+class VertexBuffer;
+class IndexBuffer;
+
+/** A queue of geometry to render, sorted to minimize OpenGL state changes.
+ *
+ *  Opaque geometry is sorted by its textures and buffers, so that geometry
+ *  sharing them is drawn one after the other, without binding them again.
+ *  Transparent geometry is sorted back-to-front instead, so that it's
+ *  blended correctly.
+ */
+class RenderQueue {
+public:
+	/** The maximum number of textures a piece of geometry can use. */
+	static const uint32 kMaxTextures = 4;
+
+	RenderQueue();
+	~RenderQueue();
+
+	/** Remove all geometry, for a new frame seen from that camera position. */
+	void clear(float cameraX, float cameraY, float cameraZ);
+
+	/** Add geometry to the queue.
+	 *
+	 *  @param pass         Is the geometry opaque or transparent?
+	 *  @param vertices     The geometry's vertices.
+	 *  @param indices      The geometry's triangles.
+	 *  @param textures     The textures, one for each texture unit. 0 for none.
+	 *  @param textureCount The number of textures.
+	 *  @param transform    The geometry's transformation into world space.
+	 */
+	void add(RenderPass pass, const VertexBuffer &vertices, const IndexBuffer &indices,
+	         const TextureID *textures, uint32 textureCount,
+	         const Common::TransformationMatrix &transform);
+
+	/** Sort and render all geometry of that pass. */
+	void render(RenderPass pass);
+
+	/** Sort the transparent geometry, to render it back-to-front in several
+	 *  steps with renderTransparent(). That way, it can be interleaved with
+	 *  the transparent parts of objects that are rendered directly.
+	 */
+	void beginTransparent();
+	/** Render the transparent geometry not yet rendered that is at least that far
+	 *  away from the camera, with the distance measured like Renderable::getDistance().
+	 */
+	void renderTransparent(double distance);
+
+private:
+	/** A piece of geometry to render. */
+	struct Item {
+		const VertexBuffer *vertices; ///< The geometry's vertices.
+		const IndexBuffer  *indices;  ///< The geometry's triangles.
+
+		uint32    textureCount;           ///< The number of textures.
+		TextureID textures[kMaxTextures]; ///< The textures, one for each texture unit.
+
+		float transform[16]; ///< The transformation into world space.
+		float distance;      ///< The distance to the camera, like Renderable::getDistance().
+
+		uint32 order; ///< The order the geometry was added in.
+	};
+
+	/** Is this geometry to be drawn before that one, to minimize state changes? */
+	struct StateCompare {
+		bool operator()(const Item *a, const Item *b) const;
+	};
+
+	/** Is this geometry further away from the camera than that one? */
+	struct DistanceCompare {
+		bool operator()(const Item *a, const Item *b) const;
+	};
+
+	float _camera[3]; ///< The camera position.
+
+	std::vector<Item>   _items[kRenderPassAll]; ///< All geometry, by pass.
+	std::vector<Item *> _sorted;                ///< The geometry of one pass, sorted.
+
+	uint32 _next; ///< The next piece of sorted geometry to render.
+
+	/** Sort the geometry of that pass, for rendering it with renderSorted(). */
+	void sort(RenderPass pass);
+	/** Render the sorted geometry from the next piece up to, not including, that one. */
+	void renderSorted(uint32 end);
+
+	void setTextures(const Item &item);
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_RENDERQUEUE_H
@@ -42,4 +42,22 @@ Texture::Texture() {
 Texture::~Texture() {
 }
 
+bool Texture::isDecoded() const {
+	return true;
+}
+
+bool Texture::isDeferrable() const {
+	return false;
+}
+
+uint32 Texture::getImageSize() const {
+	return 0;
+}
+
+void Texture::buildNew() {
+	rebuild();
+
+	removeFromQueue(kQueueNewTexture);
+}
+
 } // End of namespace Graphics
@@ -30,6 +30,8 @@
 #ifndef GRAPHICS_TEXTURE_H
 #define GRAPHICS_TEXTURE_H
 
+#include "common/types.h"
+
 #include "graphics/types.h"
 #include "graphics/glcontainer.h"
 #include "graphics/queueable.h"
@@ -41,6 +43,16 @@ class Texture : public GLContainer {
 public:
 	Texture();
 	~Texture();
+
+	/** Is the texture's image ready to be uploaded? */
+	virtual bool isDecoded() const;
+	/** May the upload of this texture be spread over several frames? */
+	virtual bool isDeferrable() const;
+	/** Return the number of bytes the texture's image data takes up. */
+	virtual uint32 getImageSize() const;
+
+	/** Upload the new texture and remove it from the new texture queue. */
+	void buildNew();
 };
 
 } // End of namespace Graphics
@@ -42,6 +42,7 @@ namespace Graphics {
 
 typedef GLuint TextureID;
 typedef GLuint ListID;
+typedef GLuint BufferID;
 
 enum PixelFormat {
 	kPixelFormatRGB  = GL_RGB ,
@@ -104,6 +105,23 @@ struct ColorPosition {
 
 typedef std::vector<ColorPosition> ColorPositions;
 
+/** How to reduce the animation detail of objects far away or off screen. */
+struct AnimationLOD {
+	/** Beyond this distance to the camera, update animations at a reduced rate. 0 to disable. */
+	float reducedDistance;
+	/** Beyond this distance to the camera, only animate the root nodes. 0 to disable. */
+	float rootDistance;
+
+	/** Fraction of a distance an object has to come back closer to get more detail again. */
+	float hysteresis;
+
+	/** The number of animation updates per second at a reduced rate. */
+	float reducedRate;
+
+	/** Stop animating objects that are off screen? */
+	bool freezeOffScreen;
+};
+
 } // End of namespace Graphics
 
 #endif // GRAPHICS_TYPES_H
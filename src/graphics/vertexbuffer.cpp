@@ -27,21 +27,97 @@
  *  Vertex buffer implementation.
  */
 
+#include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 #include "graphics/vertexbuffer.h"
+#include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 namespace Graphics {
 
-VertexBuffer::VertexBuffer() : _count(0), _size(0), _data(0) {
+// OpenGL < 2 vertex attribute helper functions
+
+static void EnableVertexPos(const VertexAttrib &va, const GLvoid *pointer) {
+	GLStateMan.enableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(va.size, va.type, va.stride, pointer);
+}
+
+static void EnableVertexNorm(const VertexAttrib &va, const GLvoid *pointer) {
+	assert(va.size == 3);
+	GLStateMan.enableClientState(GL_NORMAL_ARRAY);
+	glNormalPointer(va.type, va.stride, pointer);
+}
+
+static void EnableVertexCol(const VertexAttrib &va, const GLvoid *pointer) {
+	GLStateMan.enableClientState(GL_COLOR_ARRAY);
+	glColorPointer(va.size, va.type, va.stride, pointer);
+}
+
+static void EnableVertexTex(const VertexAttrib &va, const GLvoid *pointer) {
+	// Don't overwrite the coordinates of another unit
+	if (!GLStateMan.hasTextureUnit(va.index - VTCOORD))
+		return;
+
+	GLStateMan.setTexCoordsEnabled(va.index - VTCOORD, true);
+	glTexCoordPointer(va.size, va.type, va.stride, pointer);
+}
+
+static void DisableVertexPos() {
+	GLStateMan.disableClientState(GL_VERTEX_ARRAY);
+}
+
+static void DisableVertexNorm() {
+	GLStateMan.disableClientState(GL_NORMAL_ARRAY);
+}
+
+static void DisableVertexCol() {
+	GLStateMan.disableClientState(GL_COLOR_ARRAY);
+}
+
+static void DisableVertexTex(uint32 unit) {
+	GLStateMan.setTexCoordsEnabled(unit, false);
+}
+
+/** Enable a vertex attribute. The pointer is an offset if a vertex buffer object is bound. */
+static void EnableVertexAttrib(const VertexAttrib &va, const GLvoid *pointer) {
+	if (va.index == VPOSITION)
+		EnableVertexPos(va, pointer);
+	else if (va.index == VNORMAL)
+		EnableVertexNorm(va, pointer);
+	else if (va.index == VCOLOR)
+		EnableVertexCol(va, pointer);
+	else if (va.index >= VTCOORD)
+		EnableVertexTex(va, pointer);
+}
+
+/** Disable all vertex attributes not in the mask of attribute indices. */
+static void DisableVertexAttribs(uint32 keep) {
+	if (!(keep & (1 << VPOSITION)))
+		DisableVertexPos();
+	if (!(keep & (1 << VNORMAL)))
+		DisableVertexNorm();
+	if (!(keep & (1 << VCOLOR)))
+		DisableVertexCol();
+
+	for (uint32 i = 0; i < GfxMan.getTextureUnitCount(); i++)
+		if (!(keep & (1 << (VTCOORD + i))))
+			DisableVertexTex(i);
+}
+
+VertexBuffer::VertexBuffer() : _count(0), _size(0), _data(0), _vbo(0) {
 	//ctor
 }
 
-VertexBuffer::VertexBuffer(const VertexBuffer &other) {
+VertexBuffer::VertexBuffer(const VertexBuffer &other) : _count(0), _size(0), _data(0), _vbo(0) {
 	*this = other;
 }
 
 VertexBuffer::~VertexBuffer() {
+	if (_vbo != 0)
+		GfxMan.abandonBuffers(&_vbo, 1);
+
 	if (_data)
 		std::free(_data);
 }
@@ -51,6 +127,17 @@ VertexBuffer &VertexBuffer::operator=(const VertexBuffer &other) {
 		setVertexDecl(other._decl);
 		setSize(other._count, other._size);
 		memcpy(_data, other._data, other._count * other._size);
+
+		// Let the attributes point into our own copy of the data
+		const byte *otherStart = (const byte *) other._data;
+		const byte *otherEnd   = otherStart + other._count * other._size;
+
+		for (VertexDecl::iterator a = _decl.begin(); a != _decl.end(); ++a) {
+			const byte *pointer = (const byte *) a->pointer;
+
+			if ((pointer >= otherStart) && (pointer < otherEnd))
+				a->pointer = (const byte *) _data + (pointer - otherStart);
+		}
 	}
 	return *this;
 }
@@ -59,6 +146,12 @@ void VertexBuffer::setSize(uint32 vertCount, uint32 vertSize) {
 	_count = vertCount;
 	_size = vertSize;
 
+	// The buffer object holds the old data
+	if (_vbo != 0) {
+		GfxMan.abandonBuffers(&_vbo, 1);
+		_vbo = 0;
+	}
+
 	if (_data)
 		std::free(_data);
 
@@ -92,4 +185,59 @@ uint32 VertexBuffer::getSize() const {
 	return _size;
 }
 
+void VertexBuffer::initGL() {
+	if ((_vbo != 0) || !_data)
+		return;
+
+	glGenBuffersARB(1, &_vbo);
+
+	GLStateMan.bindBuffer(GL_ARRAY_BUFFER_ARB, _vbo);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, _count * _size, _data, GL_STATIC_DRAW_ARB);
+	GLStateMan.bindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+
+	// Out of video memory? Then we'll just keep drawing from client memory
+	if (glGetError() == GL_OUT_OF_MEMORY)
+		destroyGL();
+}
+
+void VertexBuffer::destroyGL() {
+	if (_vbo == 0)
+		return;
+
+	GLStateMan.deleteBuffers(1, &_vbo);
+	_vbo = 0;
+}
+
+BufferID VertexBuffer::getVBO() const {
+	return _vbo;
+}
+
+const GLvoid *VertexBuffer::getPointer(const VertexAttrib &attrib) const {
+	if (_vbo == 0)
+		return attrib.pointer;
+
+	return (const GLvoid *) ((const byte *) attrib.pointer - (const byte *) _data);
+}
+
+void VertexBuffer::bind() const {
+	GLStateMan.bindBuffer(GL_ARRAY_BUFFER_ARB, _vbo);
+
+	// Enable our attributes and disable all others. Buffers with the same
+	// layout then don't need to change any arrays when switching between them.
+	uint32 attribs = 0;
+	for (uint32 i = 0; i < _decl.size(); i++) {
+		EnableVertexAttrib(_decl[i], getPointer(_decl[i]));
+
+		attribs |= 1 << _decl[i].index;
+	}
+
+	DisableVertexAttribs(attribs);
+}
+
+void VertexBuffer::unbind() const {
+	DisableVertexAttribs(0);
+
+	GLStateMan.bindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+}
+
 }
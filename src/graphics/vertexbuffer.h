@@ -88,11 +88,32 @@ public:
 	/** Get vertex element size in bytes */
 	uint32 getSize() const;
 
+	/** Upload the buffer data into a vertex buffer object. Must be called from the main thread. */
+	void initGL();
+	/** Delete the vertex buffer object. Must be called from the main thread. */
+	void destroyGL();
+
+	/** Get the vertex buffer object, or 0 if there is none. */
+	BufferID getVBO() const;
+
+	/** Get where this vertex attribute starts, for use while the buffer is bound.
+	 *
+	 *  With a vertex buffer object, this is the offset into the buffer object.
+	 *  Without, this is the pointer into the buffer data.
+	 */
+	const GLvoid *getPointer(const VertexAttrib &attrib) const;
+
+	/** Bind the buffer and enable only its vertex attributes, for drawing. Must be called from the main thread. */
+	void bind() const;
+	/** Disable all vertex attributes and unbind the buffer again. Must be called from the main thread. */
+	void unbind() const;
+
 private:
 	VertexDecl _decl; ///< Vertex declaration
 	uint32 _count;    ///< Number of elements in buffer
 	uint32 _size;     ///< Size of a buffer element in bytes (vertex attributes size sum)
 	GLvoid *_data;    ///< Buffer data
+	BufferID _vbo;    ///< Vertex buffer object
 };
 
 }
@@ -0,0 +1,1011 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file nwscriptbench.cpp
+ *  Headless NWScript benchmark runner.
+ *
+ *  Runs compiled NWScript scripts over and over again, outside of any game
+ *  engine, with all engine functions replaced by stubs. Reports the runs
+ *  and instructions executed per second, the heap allocations per run and
+ *  the distribution of the run times, to measure the script VM's performance.
+ *
+ *  A typical heartbeat script to benchmark ships in src/bench/.
+ *
+ *  To check the bytecode analysis, it can also disassemble scripts, and
+ *  verify that scripts behave the same with and without superinstructions.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <new>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "common/ustring.h"
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+#include "common/file.h"
+#include "common/filepath.h"
+#include "common/debugman.h"
+#include "common/threads.h"
+
+#include "aurora/types.h"
+#include "aurora/util.h"
+#include "aurora/resman.h"
+
+#include "aurora/nwscript/types.h"
+#include "aurora/nwscript/variable.h"
+#include "aurora/nwscript/functioncontext.h"
+#include "aurora/nwscript/functionman.h"
+#include "aurora/nwscript/ncsfile.h"
+#include "aurora/nwscript/ncscache.h"
+#include "aurora/nwscript/profiler.h"
+#include "aurora/nwscript/allocations.h"
+
+using Aurora::NWScript::Type;
+using Aurora::NWScript::Signature;
+using Aurora::NWScript::Parameters;
+using Aurora::NWScript::Variable;
+using Aurora::NWScript::FunctionContext;
+
+typedef std::map<Common::UString, uint32, Common::UString::iless> CostMap;
+
+struct Options {
+	Common::UString path;      ///< The base directory of the resources.
+	Common::UString signatures; ///< The nwscript.nss file to read the engine functions from.
+
+	std::vector<Common::UString> archives; ///< Archives to index, relative to the path.
+	std::vector<Common::UString> scripts;  ///< Scripts to run. Empty means all.
+
+	uint32 runs;   ///< Number of measured runs of each script.
+	uint32 warmup; ///< Number of unmeasured runs of each script before that.
+
+	uint32  cost;      ///< Default cost of an engine function call, in microseconds.
+	CostMap functions; ///< Costs of specific engine functions, in microseconds.
+
+	bool fusion;      ///< Execute superinstructions?
+	bool disassemble; ///< Disassemble the scripts instead of running them?
+	bool verify;      ///< Verify the scripts instead of benchmarking them?
+
+	Options() : runs(100), warmup(1), cost(0), fusion(true), disassemble(false), verify(false) {
+	}
+};
+
+/** The engine function calls made while verifying a script. */
+static std::vector<Common::UString> *trace = 0;
+
+/** The results of benchmarking one script. */
+struct Result {
+	Common::UString name;
+
+	uint32 runs;
+	uint64 instructions; ///< Instructions executed per run.
+	uint64 allocations;  ///< Heap allocations made in all runs.
+	uint64 time;         ///< Wall time of all runs, in microseconds.
+
+	std::vector<uint64> latencies; ///< Wall time of each run, in microseconds, sorted.
+
+	Result(const Common::UString &n = "") : name(n), runs(0), instructions(0), allocations(0), time(0) {
+	}
+};
+
+// --- Counting heap allocations ---
+
+// To count heap allocations, we replace the global operator new. Only this
+// benchmark does that, the game itself keeps the standard allocator.
+
+/** The number of heap allocations made so far, by all threads. */
+static uint64 allocationCount = 0;
+
+static uint64 getAllocationCount() {
+	return __sync_add_and_fetch(&allocationCount, 0);
+}
+
+static void *allocate(std::size_t size) {
+	__sync_add_and_fetch(&allocationCount, 1);
+
+	if (size == 0)
+		size = 1;
+
+	// Like the standard operator new, call the new handler until it frees enough memory
+	for (;;) {
+		void *ptr = std::malloc(size);
+		if (ptr)
+			return ptr;
+
+		std::new_handler handler = std::set_new_handler(0);
+		std::set_new_handler(handler);
+
+		if (!handler)
+			throw std::bad_alloc();
+
+		handler();
+	}
+}
+
+/** Free memory from allocate().
+ *
+ *  Not inlined, so that the compiler doesn't see operator delete calling
+ *  std::free() on memory from operator new, and warn about the mismatch.
+ */
+static void __attribute__((__noinline__)) deallocate(void *ptr) {
+	std::free(ptr);
+}
+
+void *operator new(std::size_t size) throw(std::bad_alloc) {
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size) throw(std::bad_alloc) {
+	return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) throw() {
+	try {
+		return allocate(size);
+	} catch (std::bad_alloc &) {
+		return 0;
+	}
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) throw() {
+	try {
+		return allocate(size);
+	} catch (std::bad_alloc &) {
+		return 0;
+	}
+}
+
+void operator delete(void *ptr) throw() {
+	deallocate(ptr);
+}
+
+void operator delete[](void *ptr) throw() {
+	deallocate(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) throw() {
+	deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) throw() {
+	deallocate(ptr);
+}
+
+// --- Parsing the command line ---
+
+static void displayUsage(const char *name) {
+	std::printf("Usage: %s [options] [script...]\n\n", name);
+	std::printf("          --help              This text\n");
+	std::printf("  -pDIR   --path=DIR          Load resources from directory DIR\n");
+	std::printf("  -aFILE  --archive=FILE      Also load resources from archive FILE\n");
+	std::printf("  -sFILE  --signatures=FILE   Read the engine functions from FILE\n");
+	std::printf("  -nNUM   --runs=NUM          Run each script NUM times (default: 100)\n");
+	std::printf("  -wNUM   --warmup=NUM        Before that, run each script NUM times\n");
+	std::printf("                              without measuring (default: 1)\n");
+	std::printf("  -cCOST  --cost=COST         Set the cost of engine functions to COST\n");
+	std::printf("          --no-fusion         Don't execute superinstructions\n");
+	std::printf("          --disassemble       Disassemble the scripts instead\n");
+	std::printf("          --verify            Instead, run the scripts with and without\n");
+	std::printf("                              superinstructions and compare the results\n");
+	std::printf("\n");
+	std::printf("DIR:  Absolute or relative path to a directory.\n");
+	std::printf("FILE: Path to a file. Archives are relative to DIR and can be\n");
+	std::printf("      KEY, ERF, MOD, HAK, NWM, RIM or ZIP files.\n");
+	std::printf("NUM:  A positive integer.\n");
+	std::printf("COST: Either US, the time every engine function call busy-waits, or\n");
+	std::printf("      NAME:US, the time calls to the engine function NAME busy-wait.\n");
+	std::printf("US:   A positive integer, in microseconds.\n");
+	std::printf("\n");
+	std::printf("Without explicit scripts, all scripts found are run. Without a\n");
+	std::printf("signatures file, the nwscript.nss found within the resources is used.\n");
+	std::printf("All engine functions are stubs that do nothing but wait for their\n");
+	std::printf("cost, and that return 0, 0.0, \"\", OBJECT_INVALID or empty values.\n");
+	std::printf("\n");
+	std::printf("Examples:\n");
+	std::printf("%s -p/path/to/nwn/ -achitin.key -n1000 nw_c2_default1\n", name);
+	std::printf("  Runs the script nw_c2_default1 from NWN's base resources 1000 times.\n");
+	std::printf("%s -p/path/to/scripts/ -s/path/to/nwscript.nss -c5 -cRandom:0\n", name);
+	std::printf("  Runs all loose scripts in /path/to/scripts/ 100 times, with every\n");
+	std::printf("  engine function except Random() taking 5 microseconds.\n");
+	std::printf("%s -psrc/bench/ -n10000 heartbeat\n", name);
+	std::printf("  Runs the sample heartbeat script from xoreos' sources 10000 times.\n");
+	std::printf("\n");
+}
+
+static bool parseNumber(const Common::UString &str, uint32 &number) {
+	char *end = 0;
+	unsigned long n = std::strtoul(str.c_str(), &end, 10);
+
+	if (str.empty() || (*end != '\0'))
+		return false;
+
+	number = (uint32) n;
+	return true;
+}
+
+static bool parseCost(const Common::UString &str, Options &options) {
+	const char *colon = std::strchr(str.c_str(), ':');
+	if (!colon)
+		return parseNumber(str, options.cost);
+
+	uint32 cost;
+	if (!parseNumber(colon + 1, cost))
+		return false;
+
+	options.functions[Common::UString(str.c_str(), colon - str.c_str())] = cost;
+	return true;
+}
+
+static bool setOption(const Common::UString &key, const Common::UString &value, Options &options) {
+	bool valid = true;
+
+	if      (key == "path")
+		options.path = value;
+	else if (key == "archive")
+		options.archives.push_back(value);
+	else if (key == "signatures")
+		options.signatures = value;
+	else if (key == "runs")
+		valid = parseNumber(value, options.runs) && (options.runs > 0);
+	else if (key == "warmup")
+		valid = parseNumber(value, options.warmup);
+	else if (key == "cost")
+		valid = parseCost(value, options);
+	else {
+		warning("Unrecognized command line option \"%s\"", key.c_str());
+		return false;
+	}
+
+	if (!valid)
+		warning("Invalid value \"%s\" for command line option \"%s\"", value.c_str(), key.c_str());
+
+	return valid;
+}
+
+static Common::UString convertShortToLongOption(char shortOption) {
+	if (shortOption == 'p')
+		return "path";
+	if (shortOption == 'a')
+		return "archive";
+	if (shortOption == 's')
+		return "signatures";
+	if (shortOption == 'n')
+		return "runs";
+	if (shortOption == 'w')
+		return "warmup";
+	if (shortOption == 'c')
+		return "cost";
+
+	return "";
+}
+
+static bool parseCommandline(int argc, char **argv, Options &options, int &code) {
+	code = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (arg[0] != '-') {
+			options.scripts.push_back(Common::FilePath::getStem(arg));
+			continue;
+		}
+
+		if (!std::strcmp(arg, "--help")) {
+			displayUsage(argv[0]);
+			code = 0;
+			return false;
+		}
+
+		Common::UString key, value;
+		if (arg[1] == '-') {
+			const char *e = std::strchr(arg + 2, '=');
+			if (e) {
+				key   = Common::UString(arg + 2, e - (arg + 2));
+				value = e + 1;
+			} else
+				key = arg + 2;
+
+		} else if (arg[1] != '\0') {
+			key   = convertShortToLongOption(arg[1]);
+			value = arg + 2;
+		}
+
+		if (key.empty()) {
+			warning("Unrecognized command line argument \"%s\"", arg);
+			return false;
+		}
+
+		if (key == "no-fusion") {
+			options.fusion = false;
+			continue;
+		}
+		if (key == "disassemble") {
+			options.disassemble = true;
+			continue;
+		}
+		if (key == "verify") {
+			options.verify = true;
+			continue;
+		}
+
+		// The value can also be the next argument
+		if (value.empty() && ((i + 1) < argc))
+			value = argv[++i];
+
+		if (!setOption(key, value, options))
+			return false;
+	}
+
+	if (options.path.empty()) {
+		warning("No resource directory specified");
+		return false;
+	}
+
+	return true;
+}
+
+// --- Indexing the resources ---
+
+static Aurora::ArchiveType getArchiveType(const Common::UString &file) {
+	Common::UString ext = Common::FilePath::getExtension(file);
+
+	if (ext.equalsIgnoreCase(".key"))
+		return Aurora::kArchiveKEY;
+	if (ext.equalsIgnoreCase(".erf") || ext.equalsIgnoreCase(".mod") ||
+	    ext.equalsIgnoreCase(".hak") || ext.equalsIgnoreCase(".nwm"))
+		return Aurora::kArchiveERF;
+	if (ext.equalsIgnoreCase(".rim"))
+		return Aurora::kArchiveRIM;
+	if (ext.equalsIgnoreCase(".zip"))
+		return Aurora::kArchiveZIP;
+
+	throw Common::Exception("Unknown archive type \"%s\"", file.c_str());
+}
+
+static void indexResources(const Options &options) {
+	Common::UString baseDir = Common::FilePath::makeAbsolute(options.path);
+	if (!Common::FilePath::isDirectory(baseDir))
+		throw Common::Exception("No such directory \"%s\"", baseDir.c_str());
+
+	ResMan.registerDataBaseDir(baseDir);
+
+	// KEY files reference their BIFs relative to the base directory
+	if (!Common::FilePath::findSubDirectory(baseDir, "data", true).empty())
+		ResMan.addArchiveDir(Aurora::kArchiveBIF, "data");
+
+	for (std::vector<Common::UString>::const_iterator a = options.archives.begin();
+	     a != options.archives.end(); ++a) {
+
+		Aurora::ArchiveType type = getArchiveType(*a);
+
+		// Look for the archive in its own subdirectory of the base directory
+		const char *slash = std::strrchr(a->c_str(), '/');
+		if (slash)
+			ResMan.addArchiveDir(type, Common::UString(a->c_str(), slash - a->c_str()));
+
+		ResMan.addArchive(type, Common::FilePath::getFile(*a), 10);
+	}
+
+	// Loose scripts override everything within the archives
+	ResMan.addResourceDir("", ".*\\.(ncs|nss)", -1, 100);
+}
+
+// --- Reading the engine function signatures ---
+
+static Type parseType(const std::string &type) {
+	if (type == "void")
+		return Aurora::NWScript::kTypeVoid;
+	if (type == "int")
+		return Aurora::NWScript::kTypeInt;
+	if (type == "float")
+		return Aurora::NWScript::kTypeFloat;
+	if (type == "string")
+		return Aurora::NWScript::kTypeString;
+	if (type == "object")
+		return Aurora::NWScript::kTypeObject;
+	if (type == "vector")
+		return Aurora::NWScript::kTypeVector;
+	if (type == "action")
+		return Aurora::NWScript::kTypeScriptState;
+
+	// effect, event, location, talent, itemproperty, ...
+	return Aurora::NWScript::kTypeEngineType;
+}
+
+static bool isIdentifier(char c) {
+	return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+	       ((c >= '0') && (c <= '9')) || (c == '_');
+}
+
+static std::string readIdentifier(const std::string &str, size_t &pos) {
+	while ((pos < str.size()) && !isIdentifier(str[pos]) && std::isspace((unsigned char) str[pos]))
+		pos++;
+
+	size_t start = pos;
+	while ((pos < str.size()) && isIdentifier(str[pos]))
+		pos++;
+
+	return str.substr(start, pos - start);
+}
+
+/** Strip comments and preprocessor lines, and split the source into statements. */
+static void splitStatements(const std::string &source, std::vector<std::string> &statements) {
+	std::string statement;
+
+	bool lineStart = true;
+	for (size_t i = 0; i < source.size(); i++) {
+		char c = source[i];
+
+		if ((c == '/') && ((i + 1) < source.size()) && (source[i + 1] == '/')) {
+			i = source.find('\n', i);
+			if (i == std::string::npos)
+				break;
+
+			c = '\n';
+		} else if ((c == '/') && ((i + 1) < source.size()) && (source[i + 1] == '*')) {
+			i = source.find("*/", i + 2);
+			if (i == std::string::npos)
+				break;
+
+			i++;
+			continue;
+		} else if (lineStart && (c == '#')) {
+			i = source.find('\n', i);
+			if (i == std::string::npos)
+				break;
+
+			c = '\n';
+		} else if (c == '"') {
+			size_t end = source.find('"', i + 1);
+			if (end == std::string::npos)
+				break;
+
+			statement += source.substr(i, end - i + 1);
+			i = end;
+			lineStart = false;
+			continue;
+		}
+
+		if (c == ';') {
+			statements.push_back(statement);
+			statement.clear();
+		} else
+			statement += c;
+
+		if (c == '\n')
+			lineStart = true;
+		else if (!std::isspace((unsigned char) c))
+			lineStart = false;
+	}
+}
+
+/** Format a script variable's value for the call trace. */
+static Common::UString formatVariable(const Variable &var) {
+	switch (var.getType()) {
+		case Aurora::NWScript::kTypeInt:
+			return Common::UString::sprintf("%d", var.getInt());
+
+		case Aurora::NWScript::kTypeFloat:
+			return Common::UString::sprintf("%f", var.getFloat());
+
+		case Aurora::NWScript::kTypeString:
+			return "\"" + var.getString() + "\"";
+
+		case Aurora::NWScript::kTypeObject:
+			return var.getObject() ? "object" : "OBJECT_INVALID";
+
+		case Aurora::NWScript::kTypeVector: {
+			float x, y, z;
+			var.getVector(x, y, z);
+
+			return Common::UString::sprintf("[%f, %f, %f]", x, y, z);
+		}
+
+		case Aurora::NWScript::kTypeScriptState: {
+			const Aurora::NWScript::ScriptState &state = var.getScriptState();
+
+			Common::UString str = Common::UString::sprintf("state(%d", state.offset);
+			for (size_t i = 0; i < state.globals.size(); i++)
+				str += ", " + formatVariable(state.globals[i]);
+			str += " |";
+			for (size_t i = 0; i < state.locals.size(); i++)
+				str += " " + formatVariable(state.locals[i]);
+
+			return str + ")";
+		}
+
+		case Aurora::NWScript::kTypeVoid:
+			return "void";
+
+		default:
+			break;
+	}
+
+	return Common::UString::sprintf("type%d", var.getType());
+}
+
+/** Trace the call of an engine function, then busy-wait for its cost.
+ *
+ *  The function's return value stays the default value of its type.
+ */
+static void stubFunction(FunctionContext &ctx, uint32 cost) {
+	if (trace) {
+		Common::UString call = ctx.getName() + "(";
+		for (uint32 i = 0; i < ctx.getParamsSpecified(); i++)
+			call += ((i > 0) ? ", " : "") + formatVariable(ctx.getParams()[i]);
+
+		trace->push_back(call + ")");
+	}
+
+	if (cost == 0)
+		return;
+
+	uint64 start = getMicroseconds();
+	while ((getMicroseconds() - start) < cost)
+		;
+}
+
+/** Register a stub for every engine function declared in an nwscript.nss.
+ *
+ *  Engine functions are numbered in the order they are declared in. Everything
+ *  that isn't a function declaration, i.e. constants, is skipped.
+ */
+static uint32 registerStubs(Common::SeekableReadStream &nss, const Options &options) {
+	std::string source;
+	source.resize(nss.size());
+	if (!source.empty() && (nss.read(&source[0], source.size()) != source.size()))
+		throw Common::Exception(Common::kReadError);
+
+	std::vector<std::string> statements;
+	splitStatements(source, statements);
+
+	CostMap costs = options.functions;
+
+	uint32 id = 0;
+	for (std::vector<std::string>::const_iterator s = statements.begin(); s != statements.end(); ++s) {
+		size_t pos = 0;
+
+		std::string returnType = readIdentifier(*s, pos);
+		std::string name       = readIdentifier(*s, pos);
+
+		while ((pos < s->size()) && std::isspace((unsigned char) (*s)[pos]))
+			pos++;
+
+		if (returnType.empty() || name.empty() || (pos >= s->size()) || ((*s)[pos] != '('))
+			continue;
+
+		size_t end = s->rfind(')');
+		if ((end == std::string::npos) || (end < pos))
+			throw Common::Exception("Broken declaration of engine function \"%s\"", name.c_str());
+
+		Signature  signature(1, parseType(returnType));
+		Parameters defaults;
+
+		// Split the parameters at all commas outside of vector constants
+		std::string params = s->substr(pos + 1, end - pos - 1);
+		for (size_t start = 0, i = 0, depth = 0; i <= params.size(); i++) {
+			if ((i < params.size()) && (params[i] == '['))
+				depth++;
+			else if ((i < params.size()) && (params[i] == ']') && (depth > 0))
+				depth--;
+
+			if ((i < params.size()) && ((params[i] != ',') || (depth > 0)))
+				continue;
+
+			std::string param = params.substr(start, i - start);
+			start = i + 1;
+
+			size_t paramPos = 0;
+			std::string paramType = readIdentifier(param, paramPos);
+			if (paramType.empty())
+				continue;
+
+			Type type = parseType(paramType);
+
+			signature.push_back(type);
+
+			// Compiled scripts always push all arguments, so the default value itself is irrelevant
+			if ((param.find('=') != std::string::npos) || !defaults.empty())
+				defaults.push_back(Variable(type));
+		}
+
+		Common::UString functionName = name.c_str();
+
+		uint32 cost = options.cost;
+
+		CostMap::iterator c = costs.find(functionName);
+		if (c != costs.end()) {
+			cost = c->second;
+			costs.erase(c);
+		}
+
+		FunctionMan.registerFunction(functionName, id++, boost::bind(&stubFunction, _1, cost),
+		                             signature, defaults);
+	}
+
+	for (CostMap::const_iterator c = costs.begin(); c != costs.end(); ++c)
+		warning("No engine function \"%s\"", c->first.c_str());
+
+	return id;
+}
+
+static void registerStubs(const Options &options) {
+	Common::SeekableReadStream *nss = 0;
+	if (!options.signatures.empty()) {
+		Common::File *file = new Common::File;
+		if (!file->open(options.signatures)) {
+			delete file;
+			throw Common::Exception("Can't open \"%s\"", options.signatures.c_str());
+		}
+
+		nss = file;
+	} else
+		if (!(nss = ResMan.getResource("nwscript", Aurora::kFileTypeNSS)))
+			throw Common::Exception("No nwscript.nss found. Please specify a signatures file");
+
+	try {
+		uint32 count = registerStubs(*nss, options);
+
+		status("Registered %d engine function stubs", count);
+	} catch (...) {
+		delete nss;
+		throw;
+	}
+
+	delete nss;
+}
+
+// --- Running the scripts ---
+
+static void findScripts(std::vector<Common::UString> &scripts) {
+	std::list<Aurora::ResourceManager::ResourceID> resources;
+	ResMan.getAvailableResources(Aurora::kFileTypeNCS, resources);
+
+	for (std::list<Aurora::ResourceManager::ResourceID>::const_iterator r = resources.begin();
+	     r != resources.end(); ++r)
+		scripts.push_back(r->name);
+
+	std::sort(scripts.begin(), scripts.end(), Common::UString::iless());
+}
+
+/** Count the instructions a single run of the script executes, with the help of the profiler. */
+static uint64 countInstructions(Aurora::NWScript::NCSFile &script) {
+	ScriptProf.clear();
+	ScriptProf.setEnabled(true);
+
+	try {
+		script.run();
+	} catch (...) {
+		ScriptProf.setEnabled(false);
+		throw;
+	}
+
+	ScriptProf.setEnabled(false);
+
+	std::vector<Aurora::NWScript::ScriptProfiler::Stats> stats;
+	ScriptProf.getScriptStats(stats);
+
+	uint64 instructions = 0;
+	for (std::vector<Aurora::NWScript::ScriptProfiler::Stats>::const_iterator s = stats.begin();
+	     s != stats.end(); ++s)
+		instructions += s->instructions;
+
+	ScriptProf.clear();
+	return instructions;
+}
+
+static void benchmark(const Common::UString &name, const Options &options, Result &result) {
+	Aurora::NWScript::NCSFile script(name);
+
+	script.setFusion(options.fusion);
+
+	// The first run doubles as a warmup run
+	result.instructions = countInstructions(script);
+
+	for (uint32 i = 1; i < options.warmup; i++)
+		script.run();
+
+	result.latencies.reserve(options.runs);
+
+	for (uint32 i = 0; i < options.runs; i++) {
+		uint64 allocations = Aurora::NWScript::getAllocationCount();
+		uint64 start       = getMicroseconds();
+
+		script.run();
+
+		uint64 time = getMicroseconds() - start;
+
+		result.allocations += Aurora::NWScript::getAllocationCount() - allocations;
+		result.time        += time;
+
+		result.latencies.push_back(time);
+		result.runs++;
+	}
+
+	std::sort(result.latencies.begin(), result.latencies.end());
+}
+
+// --- Verifying the analysis ---
+
+static void disassemble(const Common::UString &name) {
+	std::vector<Common::UString> lines;
+	NCSCacheMan.get(name)->disassemble(lines);
+
+	std::printf("; %s\n", name.c_str());
+	for (std::vector<Common::UString>::const_iterator l = lines.begin(); l != lines.end(); ++l)
+		std::printf("%s\n", l->c_str());
+	std::printf("\n");
+}
+
+/** Run a script, recording the engine function calls made and the result.
+ *
+ *  With a step count, the script is suspended and resumed after that many
+ *  instructions each, as the script scheduler does.
+ */
+static void record(const Common::UString &name, bool fusion, uint32 steps,
+                   std::vector<Common::UString> &calls) {
+
+	Aurora::NWScript::NCSFile script(name);
+	script.setFusion(fusion);
+
+	trace = &calls;
+
+	uint32 slices = 1;
+	try {
+		if (steps == 0)
+			script.run();
+		else
+			for (script.start(Aurora::NWScript::NCSFile::getEmptyState()); !script.resume(steps); slices++)
+				;
+
+		calls.push_back("=> " + formatVariable(script.getReturn()));
+
+	} catch (Common::Exception &e) {
+		calls.push_back(Common::UString("=> ") + e.what());
+	}
+
+	if (steps != 0)
+		calls.push_back(Common::UString::sprintf("=> %d slices", slices));
+
+	trace = 0;
+}
+
+/** Compare two recordings of the same script, printing the first difference. */
+static bool compare(const Common::UString &name, const char *what,
+                    const std::vector<Common::UString> &a, const std::vector<Common::UString> &b) {
+
+	for (size_t i = 0; (i < a.size()) || (i < b.size()); i++) {
+		const Common::UString lineA = (i < a.size()) ? a[i] : "(nothing)";
+		const Common::UString lineB = (i < b.size()) ? b[i] : "(nothing)";
+
+		if (lineA == lineB)
+			continue;
+
+		std::printf("%-16s MISMATCH (%s), line %u:\n", name.c_str(), what, (uint) i);
+		std::printf("    %s\n    %s\n", lineA.c_str(), lineB.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/** Run a script with and without superinstructions, and compare what happens. */
+static bool verify(const Common::UString &name) {
+	std::vector<Common::UString> unfused, fused, unfusedSliced, fusedSliced;
+
+	record(name, false, 0, unfused);
+	record(name, true , 0, fused);
+	record(name, false, 3, unfusedSliced);
+	record(name, true , 3, fusedSliced);
+
+	if (!compare(name, "fused", unfused, fused) ||
+	    !compare(name, "fused, sliced", unfusedSliced, fusedSliced))
+		return false;
+
+	// Suspending and resuming doesn't change what a script does
+	std::vector<Common::UString> sliced(unfusedSliced.begin(), unfusedSliced.end() - 1);
+	if (!compare(name, "sliced", unfused, sliced))
+		return false;
+
+	std::printf("%-16s OK (%u calls, %s, %s)\n", name.c_str(), (uint) (unfused.size() - 1),
+	            unfused.back().c_str(), unfusedSliced.back().c_str() + 3);
+	return true;
+}
+
+// --- Reporting ---
+
+/** Return the p-th percentile of sorted values, using the nearest-rank method. */
+static uint64 getPercentile(const std::vector<uint64> &values, uint32 p) {
+	if (values.empty())
+		return 0;
+
+	size_t rank = (values.size() * p + 99) / 100;
+
+	return values[MAX<size_t>(rank, 1) - 1];
+}
+
+/** Return how many of something happened per second, in that many microseconds. */
+static double getPerSecond(uint64 count, uint64 time) {
+	if (time == 0)
+		return 0.0;
+
+	return (count * 1000000.0) / time;
+}
+
+static void printHeader() {
+	std::printf("%-16s %7s %10s %10s %12s %10s %8s %8s %8s %8s %8s\n", "Script", "Runs", "Runs/s",
+	            "Instr/run", "Instr/s", "Allocs/run", "min us", "p50 us", "p90 us", "p99 us", "max us");
+}
+
+static void printResult(const Result &result) {
+	std::printf("%-16s %7u %10.0f %10llu %12.0f %10.1f %8llu %8llu %8llu %8llu %8llu\n",
+	            result.name.c_str(), result.runs, getPerSecond(result.runs, result.time),
+	            (unsigned long long) result.instructions,
+	            getPerSecond(result.instructions * result.runs, result.time),
+	            (double) result.allocations / result.runs,
+	            (unsigned long long) result.latencies.front(),
+	            (unsigned long long) getPercentile(result.latencies, 50),
+	            (unsigned long long) getPercentile(result.latencies, 90),
+	            (unsigned long long) getPercentile(result.latencies, 99),
+	            (unsigned long long) result.latencies.back());
+}
+
+static void printTotal(const std::vector<Result> &results) {
+	Result total("TOTAL");
+
+	uint64 instructions = 0;
+	for (std::vector<Result>::const_iterator r = results.begin(); r != results.end(); ++r) {
+		total.runs        += r->runs;
+		total.allocations += r->allocations;
+		total.time        += r->time;
+
+		instructions += r->instructions * r->runs;
+
+		total.latencies.insert(total.latencies.end(), r->latencies.begin(), r->latencies.end());
+	}
+
+	if (total.runs == 0)
+		return;
+
+	std::sort(total.latencies.begin(), total.latencies.end());
+
+	std::printf("%-16s %7u %10.0f %10.0f %12.0f %10.1f %8llu %8llu %8llu %8llu %8llu\n",
+	            total.name.c_str(), total.runs, getPerSecond(total.runs, total.time),
+	            (double) instructions / total.runs, getPerSecond(instructions, total.time),
+	            (double) total.allocations / total.runs,
+	            (unsigned long long) total.latencies.front(),
+	            (unsigned long long) getPercentile(total.latencies, 50),
+	            (unsigned long long) getPercentile(total.latencies, 90),
+	            (unsigned long long) getPercentile(total.latencies, 99),
+	            (unsigned long long) total.latencies.back());
+}
+
+void deinit();
+
+int main(int argc, char **argv) {
+	atexit(deinit);
+
+	Options options;
+
+	int code;
+	if (!parseCommandline(argc, argv, options, code))
+		return code;
+
+	Common::initThreads();
+
+	Aurora::NWScript::setAllocationCounter(&getAllocationCount);
+
+	std::vector<Result> results;
+	uint32 failed = 0;
+
+	try {
+		indexResources(options);
+		registerStubs(options);
+
+		if (options.scripts.empty())
+			findScripts(options.scripts);
+		if (options.scripts.empty())
+			throw Common::Exception("No scripts found");
+
+		if (options.disassemble) {
+			for (std::vector<Common::UString>::const_iterator s = options.scripts.begin();
+			     s != options.scripts.end(); ++s)
+				disassemble(*s);
+
+			return 0;
+		}
+
+		if (options.verify) {
+			for (std::vector<Common::UString>::const_iterator s = options.scripts.begin();
+			     s != options.scripts.end(); ++s)
+				if (!verify(*s))
+					failed++;
+
+			if (failed > 0) {
+				warning("%d of %d scripts failed verification", failed, (int) options.scripts.size());
+				return 1;
+			}
+
+			return 0;
+		}
+
+		status("Running %d scripts %d times each", (int) options.scripts.size(), options.runs);
+
+		printHeader();
+
+		for (std::vector<Common::UString>::const_iterator s = options.scripts.begin();
+		     s != options.scripts.end(); ++s) {
+
+			Result result(*s);
+
+			try {
+				benchmark(*s, options, result);
+			} catch (Common::Exception &e) {
+				e.add("Failed running script \"%s\"", s->c_str());
+				Common::printException(e, "WARNING: ");
+
+				failed++;
+				continue;
+			}
+
+			printResult(result);
+			results.push_back(result);
+		}
+
+		printTotal(results);
+
+	} catch (Common::Exception &e) {
+		Common::printException(e);
+		return 1;
+	}
+
+	if (failed > 0) {
+		warning("%d of %d scripts failed", failed, (int) options.scripts.size());
+		return 1;
+	}
+
+	return 0;
+}
+
+void deinit() {
+	// Destroy global singletons
+	Aurora::NWScript::NCSCacheManager::destroy();
+	Aurora::NWScript::ScriptProfiler::destroy();
+	Aurora::NWScript::FunctionManager::destroy();
+
+	Aurora::ResourceManager::destroy();
+	Aurora::FileTypeManager::destroy();
+
+	Common::DebugManager::destroy();
+}
@@ -0,0 +1,577 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file s3tcbench.cpp
+ *  Headless S3TC decompression benchmark.
+ *
+ *  First checks that both the vectorized and the scalar DXT1/3/5
+ *  decompression produce exactly the pixels the S3TC formulas give, and
+ *  that a few known blocks decode to the pixels worked out by hand. Then
+ *  decompresses random images with both, and with the image's rows of
+ *  blocks split over several threads. Reports the throughput in megapixels
+ *  per second.
+ *
+ *  "make check" runs only the checks, through s3tccheck.sh.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/ustring.h"
+#include "common/util.h"
+#include "common/endianness.h"
+#include "common/error.h"
+#include "common/debugman.h"
+#include "common/threads.h"
+#include "common/threadpool.h"
+
+#include "graphics/images/s3tc.h"
+
+struct Options {
+	uint32 size;       ///< Width and height of the benchmarked images.
+	uint32 iterations; ///< Number of measured decompressions of each image.
+	uint32 threads;    ///< Maximum number of worker threads.
+
+	bool check; ///< Only check the decompression, without measuring it?
+
+	Options() : size(1024), iterations(20), threads(4), check(false) {
+	}
+};
+
+typedef void (*DecompressFunc)(byte *dest, const byte *src, uint32 size, uint32 width,
+                               uint32 height, uint32 pitch, bool reference);
+
+/** How a compressed format stores the alpha of its pixels. */
+enum AlphaType {
+	kAlphaColorBlock,  ///< DXT1: In the color block, as transparent black.
+	kAlphaExplicit,    ///< DXT3: 4 bits per pixel.
+	kAlphaInterpolated ///< DXT5: A 3-bit index into 8 values per pixel.
+};
+
+/** A compressed format, as far as the benchmark is concerned. */
+struct Format {
+	const char    *name;
+	uint32         blockSize;
+	AlphaType      alpha;
+	DecompressFunc decompress;
+};
+
+static const Format kFormats[] = {
+	{ "DXT1",  8, kAlphaColorBlock  , &Graphics::decompressDXT1 },
+	{ "DXT3", 16, kAlphaExplicit    , &Graphics::decompressDXT3 },
+	{ "DXT5", 16, kAlphaInterpolated, &Graphics::decompressDXT5 }
+};
+
+/** A simple, reproducible pseudo-random number generator. */
+class Random {
+public:
+	Random(uint32 seed) : _state(seed) {
+	}
+
+	uint32 next() {
+		_state ^= _state << 13;
+		_state ^= _state >> 17;
+		_state ^= _state <<  5;
+
+		return _state;
+	}
+
+	void fill(std::vector<byte> &data) {
+		for (std::vector<byte>::iterator d = data.begin(); d != data.end(); ++d)
+			*d = next() >> 24;
+	}
+
+private:
+	uint32 _state;
+};
+
+static void displayUsage(const char *name) {
+	std::printf("Usage: %s [options]\n\n", name);
+	std::printf("          --help              This text\n");
+	std::printf("  -sNUM   --size=NUM          Decompress NUMxNUM images (default: 1024)\n");
+	std::printf("  -iNUM   --iterations=NUM    Measure NUM decompressions each (default: 20)\n");
+	std::printf("  -tNUM   --threads=NUM       Measure with up to NUM worker threads\n");
+	std::printf("                              (default: 4)\n");
+	std::printf("          --check             Only check the decompression, for\n");
+	std::printf("                              \"make check\"\n");
+	std::printf("\n");
+	std::printf("NUM:  A positive integer.\n");
+	std::printf("\n");
+}
+
+static bool parseNumber(const char *str, uint32 &number) {
+	char *end = 0;
+	unsigned long n = std::strtoul(str, &end, 10);
+
+	if ((*str == '\0') || (*end != '\0'))
+		return false;
+
+	number = (uint32) n;
+	return true;
+}
+
+static bool parseCommandline(int argc, char **argv, Options &options, int &code) {
+	code = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+
+		if (!std::strcmp(arg, "--help")) {
+			displayUsage(argv[0]);
+			code = 0;
+			return false;
+		}
+
+		if (!std::strcmp(arg, "--check")) {
+			options.check = true;
+			continue;
+		}
+
+		uint32 *value = 0;
+		const char *number = 0;
+
+		if      (!std::strncmp(arg, "--size=", 7)       || !std::strncmp(arg, "-s", 2))
+			value = &options.size;
+		else if (!std::strncmp(arg, "--iterations=", 13) || !std::strncmp(arg, "-i", 2))
+			value = &options.iterations;
+		else if (!std::strncmp(arg, "--threads=", 10)   || !std::strncmp(arg, "-t", 2))
+			value = &options.threads;
+
+		if (value)
+			number = (arg[1] == '-') ? (std::strchr(arg, '=') + 1) : (arg + 2);
+
+		if (!value || !parseNumber(number, *value)) {
+			warning("Invalid command line argument \"%s\"", arg);
+			return false;
+		}
+	}
+
+	if ((options.size == 0) || (options.iterations == 0)) {
+		warning("Nothing to decompress");
+		return false;
+	}
+
+	return true;
+}
+
+static uint32 getDataSize(const Format &format, uint32 width, uint32 height) {
+	return ((width + 3) / 4) * ((height + 3) / 4) * format.blockSize;
+}
+
+/** Read a number of bits, starting at that bit, out of little endian data. */
+static uint32 readBits(const byte *data, uint32 bit, uint32 count) {
+	uint32 value = 0;
+
+	for (uint32 i = 0; i < count; i++, bit++)
+		value |= ((data[bit / 8] >> (bit % 8)) & 1) << i;
+
+	return value;
+}
+
+/** Expand a 5 or 6 bit color channel to 8 bits, by replicating its top bits into the bottom. */
+static uint32 expandChannel(uint32 value, uint32 bits) {
+	return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+/** Decode one pixel, straight from the S3TC formulas.
+ *
+ *  This doesn't share any code with the decompression itself, to have something
+ *  independent to check both of its implementations against. It's much too slow
+ *  for anything else.
+ */
+static void decodePixel(const Format &format, const byte *data, uint32 width,
+                        uint32 x, uint32 y, byte *pixel) {
+
+	const byte *block      = data + ((y / 4) * ((width + 3) / 4) + (x / 4)) * format.blockSize;
+	const byte *colorBlock = block + format.blockSize - 8;
+
+	const uint32 n = (y % 4) * 4 + (x % 4);
+
+	const uint32 color0 = colorBlock[0] | (colorBlock[1] << 8);
+	const uint32 color1 = colorBlock[2] | (colorBlock[3] << 8);
+
+	const uint32 index = readBits(colorBlock + 4, n * 2, 2);
+
+	// Only DXT1 blocks can switch to three colors and transparent black
+	const bool fourColors = (format.alpha != kAlphaColorBlock) || (color0 > color1);
+
+	// Red, green and blue, with their bit positions and sizes
+	static const uint32 kChannelShift[3] = { 11, 5, 0 };
+	static const uint32 kChannelBits [3] = {  5, 6, 5 };
+
+	for (uint32 c = 0; c < 3; c++) {
+		const uint32 mask = (1 << kChannelBits[c]) - 1;
+
+		const uint32 c0 = expandChannel((color0 >> kChannelShift[c]) & mask, kChannelBits[c]);
+		const uint32 c1 = expandChannel((color1 >> kChannelShift[c]) & mask, kChannelBits[c]);
+
+		uint32 value;
+		if      (index == 0)
+			value = c0;
+		else if (index == 1)
+			value = c1;
+		else if (fourColors)
+			value = (index == 2) ? ((2 * c0 + c1) / 3) : ((c0 + 2 * c1) / 3);
+		else
+			value = (index == 2) ? ((c0 + c1) / 2) : 0;
+
+		pixel[c] = value;
+	}
+
+	if        (format.alpha == kAlphaColorBlock) {
+		pixel[3] = (!fourColors && (index == 3)) ? 0x00 : 0xFF;
+
+	} else if (format.alpha == kAlphaExplicit) {
+		pixel[3] = readBits(block, n * 4, 4) * 0xFF / 0xF;
+
+	} else if (format.alpha == kAlphaInterpolated) {
+		const uint32 a0 = block[0];
+		const uint32 a1 = block[1];
+
+		const uint32 code = readBits(block + 2, n * 3, 3);
+
+		if      (code == 0)
+			pixel[3] = a0;
+		else if (code == 1)
+			pixel[3] = a1;
+		else if (a0 > a1)
+			pixel[3] = ((8 - code) * a0 + (code - 1) * a1 + 3) / 7;
+		else if (code < 6)
+			pixel[3] = ((6 - code) * a0 + (code - 1) * a1 + 2) / 5;
+		else
+			pixel[3] = (code == 6) ? 0x00 : 0xFF;
+	}
+}
+
+/** Decompress the data with both implementations, and compare them against each decoded pixel.
+ *
+ *  The destination rows are wider than the image, to make sure nothing is
+ *  written outside of it.
+ */
+static bool compare(const Format &format, const std::vector<byte> &data,
+                    uint32 width, uint32 height) {
+
+	static const byte kGuard = 0xA5;
+
+	const uint32 pitch = width * 4 + 8;
+
+	std::vector<byte> reference(pitch * height, kGuard);
+	std::vector<byte> simd     (pitch * height, kGuard);
+
+	format.decompress(&reference[0], &data[0], data.size(), width, height, pitch, true);
+	format.decompress(&simd[0]     , &data[0], data.size(), width, height, pitch, false);
+
+	for (uint32 y = 0; y < height; y++) {
+		for (uint32 x = width * 4; x < pitch; x++) {
+			const uint32 i = y * pitch + x;
+
+			if ((reference[i] != kGuard) || (simd[i] != kGuard)) {
+				warning("%s %ux%u: Wrote outside of the image at row %u", format.name, width, height, y);
+				return false;
+			}
+		}
+
+		for (uint32 x = 0; x < width; x++) {
+			const uint32 i = y * pitch + x * 4;
+
+			byte expected[4];
+			decodePixel(format, &data[0], width, x, y, expected);
+
+			if (std::memcmp(&reference[i], expected, 4) || std::memcmp(&simd[i], expected, 4)) {
+				warning("%s %ux%u: Pixel (%u, %u) is %08X (scalar) and %08X (vectorized) instead of %08X",
+				        format.name, width, height, x, y, READ_BE_UINT32(&reference[i]),
+				        READ_BE_UINT32(&simd[i]), READ_BE_UINT32(expected));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/** Decompress a single block with the reference and check the pixels against what we expect. */
+static bool checkBlock(const Format &format, const byte *block, const uint32 *expected) {
+	byte pixels[4 * 4 * 4];
+
+	std::vector<byte> data(block, block + format.blockSize);
+
+	format.decompress(pixels, &data[0], data.size(), 4, 4, 4 * 4, true);
+
+	for (uint32 i = 0; i < 16; i++) {
+		const uint32 pixel = (pixels[i * 4 + 0] << 24) | (pixels[i * 4 + 1] << 16) |
+		                     (pixels[i * 4 + 2] <<  8) |  pixels[i * 4 + 3];
+
+		if (pixel != expected[i]) {
+			warning("%s: Known block pixel %u is %08X instead of %08X", format.name, i, pixel, expected[i]);
+			return false;
+		}
+	}
+
+	return compare(format, data, 4, 4);
+}
+
+/** Check the decoding of a few blocks, with the expected RGBA pixels worked out by hand. */
+static bool checkKnownBlocks() {
+	// White to black, indices 0, 1, 2, 3 in each row
+	static const byte kDXT1Opaque[8] = { 0xFF, 0xFF, 0x00, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+	static const uint32 kDXT1OpaquePixels[4] = { 0xFFFFFFFF, 0x000000FF, 0xAAAAAAFF, 0x555555FF };
+
+	// Black to white, three colors and transparent black, indices 3, 2, 1, 0 in each row
+	static const byte kDXT1Trans[8] = { 0x00, 0x00, 0xFF, 0xFF, 0x1B, 0x1B, 0x1B, 0x1B };
+	static const uint32 kDXT1TransPixels[4] = { 0x00000000, 0x7F7F7FFF, 0xFFFFFFFF, 0x000000FF };
+
+	// Pure red and blue, 4-bit alpha 0x0, 0x5, 0xA, 0xF in each row
+	static const byte kDXT3[16] = { 0x50, 0xFA, 0x50, 0xFA, 0x50, 0xFA, 0x50, 0xFA,
+	                                0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+	static const uint32 kDXT3Pixels[4] = { 0xFF000000, 0x0000FF55, 0xAA0055AA, 0x5500AAFF };
+
+	// Alpha from 255 to 0, in 8 steps, indices 0 and 1, then 2 to 7, twice
+	static const byte kDXT5[16] = { 0xFF, 0x00, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA,
+	                                0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00 };
+	static const uint32 kDXT5Alpha[8] = { 0xFF, 0x00, 0xDB, 0xB6, 0x92, 0x6D, 0x49, 0x24 };
+
+	uint32 expected[16];
+
+	for (uint32 i = 0; i < 16; i++)
+		expected[i] = kDXT1OpaquePixels[i % 4];
+	if (!checkBlock(kFormats[0], kDXT1Opaque, expected))
+		return false;
+
+	for (uint32 i = 0; i < 16; i++)
+		expected[i] = kDXT1TransPixels[i % 4];
+	if (!checkBlock(kFormats[0], kDXT1Trans, expected))
+		return false;
+
+	for (uint32 i = 0; i < 16; i++)
+		expected[i] = kDXT3Pixels[i % 4];
+	if (!checkBlock(kFormats[1], kDXT3, expected))
+		return false;
+
+	static const uint32 kDXT5Indices[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7 };
+	for (uint32 i = 0; i < 16; i++)
+		expected[i] = 0xFFFFFF00 | kDXT5Alpha[kDXT5Indices[i]];
+	if (!checkBlock(kFormats[2], kDXT5, expected))
+		return false;
+
+	return true;
+}
+
+/** Check that both implementations decode all kinds of blocks and image sizes correctly. */
+static bool checkConformance() {
+	if (!checkKnownBlocks())
+		return false;
+
+	Random random(0x5EED);
+
+	for (uint32 f = 0; f < ARRAYSIZE(kFormats); f++) {
+		const Format &format = kFormats[f];
+		const uint32 colorOffset = format.blockSize - 8;
+
+		// All pairs of 6-bit green and 5-bit red and blue endpoint values, with all indices
+		std::vector<byte> data(64 * 64 * format.blockSize);
+		for (uint32 i = 0; i < 64 * 64; i++) {
+			byte *block = &data[i * format.blockSize];
+
+			const uint32 c0 = i / 64, c1 = i % 64;
+
+			WRITE_LE_UINT16(block + colorOffset + 0, ((c0 & 0x1F) << 11) | (c0 << 5) | (c1 & 0x1F));
+			WRITE_LE_UINT16(block + colorOffset + 2, ((c1 & 0x1F) << 11) | (c1 << 5) | (c0 & 0x1F));
+			WRITE_LE_UINT32(block + colorOffset + 4, 0xE4E4E4E4 ^ random.next());
+
+			for (uint32 j = 0; j < colorOffset; j++)
+				block[j] = random.next();
+		}
+
+		if (!compare(format, data, 64 * 4, 64 * 4))
+			return false;
+
+		// All pairs of DXT5 alpha endpoints, with all indices
+		if (f == 2) {
+			data.resize(256 * 256 * format.blockSize);
+			random.fill(data);
+
+			for (uint32 i = 0; i < 256 * 256; i++) {
+				byte *block = &data[i * format.blockSize];
+
+				block[0] = i / 256;
+				block[1] = i % 256;
+
+				// Indices 0 to 7, twice
+				static const byte kIndices[6] = { 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA };
+				std::memcpy(block + 2, kIndices, 6);
+			}
+
+			if (!compare(format, data, 256 * 4, 256 * 4))
+				return false;
+		}
+
+		// Random blocks, in images of all small sizes, including partial blocks at the edges
+		for (uint32 height = 1; height <= 13; height++) {
+			for (uint32 width = 1; width <= 13; width++) {
+				data.resize(getDataSize(format, width, height));
+				random.fill(data);
+
+				if (!compare(format, data, width, height))
+					return false;
+			}
+		}
+
+		// And a big random image
+		data.resize(getDataSize(format, 512, 512));
+		random.fill(data);
+
+		if (!compare(format, data, 512, 512))
+			return false;
+
+		status("%s: Both implementations match the S3TC formulas", format.name);
+	}
+
+	return true;
+}
+
+/** Decompressing an image, one row of blocks per part. */
+class DecompressJob : public Common::ThreadPool::Job {
+public:
+	DecompressJob(const Format &format, byte *dest, const byte *src, uint32 size) :
+		_format(&format), _dest(dest), _src(src), _size(size) {
+	}
+
+	void run(uint32 part) {
+		const uint32 height = MIN<uint32>(_size - part * 4, 4);
+		const uint32 offset = part * ((_size + 3) / 4) * _format->blockSize;
+
+		_format->decompress(_dest + part * 4 * _size * 4, _src + offset,
+		                    getDataSize(*_format, _size, height), _size, height, _size * 4, false);
+	}
+
+private:
+	const Format *_format;
+
+	byte       *_dest;
+	const byte *_src;
+
+	uint32 _size;
+};
+
+/** Decompress the image a number of times, returning the megapixels per second. */
+static double measure(const Format &format, std::vector<byte> &pixels,
+                      const std::vector<byte> &data, uint32 size, uint32 iterations,
+                      bool reference, Common::ThreadPool *pool) {
+
+	DecompressJob job(format, &pixels[0], &data[0], size);
+
+	const uint64 start = getMicroseconds();
+
+	for (uint32 i = 0; i < iterations; i++) {
+		if (pool)
+			pool->run(job, (size + 3) / 4);
+		else
+			format.decompress(&pixels[0], &data[0], data.size(), size, size, size * 4, reference);
+	}
+
+	const uint64 time = MAX<uint64>(getMicroseconds() - start, 1);
+
+	return ((double) size * size * iterations) / time;
+}
+
+void deinit();
+
+int main(int argc, char **argv) {
+	atexit(deinit);
+
+	Options options;
+
+	int code;
+	if (!parseCommandline(argc, argv, options, code))
+		return code;
+
+	Common::initThreads();
+
+	const char *simd = Graphics::getS3TCSIMD();
+
+	status("Vectorized S3TC decompression: %s", simd ? simd : "none");
+
+	try {
+		if (!checkConformance())
+			return 1;
+	} catch (Common::Exception &e) {
+		Common::printException(e);
+		return 1;
+	}
+
+	if (options.check)
+		return 0;
+
+	status("Decompressing %ux%u images, %u times each", options.size, options.size, options.iterations);
+
+	std::vector<Common::ThreadPool *> pools;
+	for (uint32 threads = 0; threads <= options.threads; threads++)
+		pools.push_back(new Common::ThreadPool(threads));
+
+	std::vector<byte> pixels(options.size * options.size * 4);
+
+	std::printf("%-6s %-10s %12s %8s\n", "format", "variant", "MPixels/s", "speedup");
+
+	Random random(0xB10C);
+
+	for (uint32 f = 0; f < ARRAYSIZE(kFormats); f++) {
+		const Format &format = kFormats[f];
+
+		std::vector<byte> data(getDataSize(format, options.size, options.size));
+		random.fill(data);
+
+		// Warm up
+		measure(format, pixels, data, options.size, 1, true, 0);
+
+		const double reference = measure(format, pixels, data, options.size, options.iterations, true, 0);
+		std::printf("%-6s %-10s %12.1f %7.2fx\n", format.name, "scalar", reference, 1.0);
+
+		const double vectorized = measure(format, pixels, data, options.size, options.iterations, false, 0);
+		std::printf("%-6s %-10s %12.1f %7.2fx\n", format.name, simd ? simd : "scalar",
+		            vectorized, vectorized / reference);
+
+		for (uint32 threads = 1; threads <= options.threads; threads++) {
+			const double threaded = measure(format, pixels, data, options.size, options.iterations,
+			                                false, pools[threads]);
+
+			const Common::UString variant =
+				Common::UString::sprintf("%u thread%s", threads, (threads == 1) ? "" : "s");
+			std::printf("%-6s %-10s %12.1f %7.2fx\n", format.name, variant.c_str(),
+			            threaded, threaded / reference);
+		}
+	}
+
+	for (std::vector<Common::ThreadPool *>::iterator p = pools.begin(); p != pools.end(); ++p)
+		delete *p;
+
+	return 0;
+}
+
+void deinit() {
+	// Destroy global singletons
+	Common::DebugManager::destroy();
+}
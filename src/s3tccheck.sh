@@ -0,0 +1,3 @@
+#!/bin/sh
+# Check the S3TC decompression, without benchmarking it
+exec ./s3tcbench --check
@@ -34,6 +34,7 @@
 #include "common/threads.h"
 
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 #include "graphics/images/surface.h"
 
@@ -162,7 +163,7 @@ void VideoDecoder::doRebuild() {
 	// Generate the texture ID
 	glGenTextures(1, &_texture);
 
-	glBindTexture(GL_TEXTURE_2D, _texture);
+	GLStateMan.bindTexture(_texture);
 
 	// Texture clamping
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -180,7 +181,7 @@ void VideoDecoder::doDestroy() {
 	if (_texture == 0)
 		return;
 
-	glDeleteTextures(1, &_texture);
+	GLStateMan.deleteTextures(1, &_texture);
 
 	_texture = 0;
 }
@@ -194,7 +195,7 @@ void VideoDecoder::copyData() {
 	if (_texture == 0)
 		throw Common::Exception("No texture while trying to copy");
 
-	glBindTexture(GL_TEXTURE_2D, _texture);
+	GLStateMan.bindTexture(_texture);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _surface->getWidth(), _surface->getHeight(),
 	                GL_BGRA, GL_UNSIGNED_BYTE, _surface->getData());
 
@@ -269,7 +270,7 @@ void VideoDecoder::render(Graphics::RenderPass pass) {
 	float hWidth  = width  / 2.0;
 	float hHeight = height / 2.0;
 
-	glBindTexture(GL_TEXTURE_2D, _texture);
+	GLStateMan.bindTexture(_texture);
 	glBegin(GL_QUADS);
 		glTexCoord2f(0.0, 0.0);
 		glVertex3f(-hWidth, -hHeight, -1.0);
@@ -44,8 +44,13 @@
 #include "aurora/talkman.h"
 #include "aurora/util.h"
 
+#include "aurora/nwscript/ncscache.h"
+#include "aurora/nwscript/profiler.h"
+#include "aurora/nwscript/scheduler.h"
+
 #include "graphics/queueman.h"
 #include "graphics/graphics.h"
+#include "graphics/glstate.h"
 
 #include "sound/sound.h"
 
@@ -246,6 +251,24 @@ void init() {
 	status("Sound subsystem initialized");
 	EventMan.init();
 	status("Event subsystem initialized");
+
+	// Threads decoding texture images in the background. 0 means decoding them right away
+	TextureMan.setDecodeThreadCount(MAX(ConfigMan.getInt("texturethreads", 2), 0));
+
+	// Limit the size of all textures, in KiB. Unused textures are kept around until then
+	const uint64 textureBudget = MAX(ConfigMan.getInt("texturebudget", 262144), 0) * (uint64) 1024;
+	TextureMan.setBudget(MIN<uint64>(textureBudget, 0xFFFFFFFF));
+
+	// Limit the size of the script cache, in KiB. 0 means unlimited
+	const uint64 scriptCacheSize = MAX(ConfigMan.getInt("scriptcachesize", 0), 0) * (uint64) 1024;
+	NCSCacheMan.setBudget(MIN<uint64>(scriptCacheSize, 0xFFFFFFFF));
+
+	// Collect script profiling statistics right from the start?
+	ScriptProf.setEnabled(ConfigMan.getBool("scriptprofile", false));
+
+	// Limit the time scheduled scripts may run each frame, in milliseconds. 0 means unlimited
+	const uint64 scriptBudget = MAX(ConfigMan.getInt("scriptbudget", 0), 0) * (uint64) 1000;
+	ScriptSchedMan.setBudget(MIN<uint64>(scriptBudget, 0xFFFFFFFF));
 }
 
 void deinit() {
@@ -264,6 +287,10 @@ void deinit() {
 	Graphics::Aurora::CursorManager::destroy();
 	Graphics::Aurora::TextureManager::destroy();
 
+	Aurora::NWScript::NCSCacheManager::destroy();
+	Aurora::NWScript::ScriptScheduler::destroy();
+	Aurora::NWScript::ScriptProfiler::destroy();
+
 	Aurora::TalkManager::destroy();
 	Aurora::TwoDARegistry::destroy();
 	Aurora::ResourceManager::destroy();
@@ -278,6 +305,7 @@ void deinit() {
 	Sound::SoundManager::destroy();
 
 	Graphics::GraphicsManager::destroy();
+	Graphics::GLStateManager::destroy();
 	Graphics::QueueManager::destroy();
 
 	Common::DebugManager::destroy();